@@ -211,6 +211,19 @@ public:
     /// Can be called manually by the user inside planners. Keep in mind that the internal simulation thread also calls this function periodically. See \ref arch_simulation for more about the simulation thread.
     virtual void StepSimulation(dReal timeStep) = 0;
 
+    /** \brief Makes numsteps simulation time steps while keeping the environment locked. <b>[multi-thread safe]</b>
+
+        Meant for simulating long periods as fast as possible. Every step is the same as StepSimulation(timeStep), except that
+        the published bodies are only updated every publishInterval steps and GetSimulationStepTimes is not updated.
+        Since the simulation time advances by the same integer number of microseconds every step and the internal simulation
+        thread cannot run in between, the result only depends on the initial state and the arguments. The internal simulation
+        thread keeps its real-time schedule relative to the new simulation time.
+        \param numsteps the number of steps to take
+        \param timeStep the delta time of every step
+        \param publishInterval if > 0, the published bodies are updated every publishInterval steps and after the last step, otherwise they are not updated.
+     */
+    virtual void FastForwardSimulation(int numsteps, dReal timeStep, int publishInterval=0) = 0;
+
     /** \brief Start the internal simulation thread. <b>[multi-thread safe]</b>
 
         Resets simulation time to 0. See \ref arch_simulation for more about the simulation thread.
@@ -235,6 +248,30 @@ public:
     ///
     /// See \ref arch_simulation for more about the simulation thread.
     virtual uint64_t GetSimulationTime() = 0;
+
+    /// \brief Time spent in each phase of the last StepSimulation call (in microseconds).
+    struct SimulationStepTimes
+    {
+        uint64_t physics = 0; ///< PhysicsEngineBase::SimulateStep
+        uint64_t bodies = 0; ///< KinBody::SimulationStep of all bodies, which also steps the robot controllers
+        uint64_t modules = 0; ///< ModuleBase::SimulationStep of the modules stepped in order
+        uint64_t sensors = 0; ///< SensorBase::SimulationStep of the sensors stepped in order, including the sensors attached to robots
+        uint64_t readonly = 0; ///< the read-only modules and sensors when they are stepped concurrently, see SetSimulationStepThreads
+        uint64_t total = 0; ///< the entire step
+    };
+
+    /// \brief Sets the number of threads used to step the modules and sensors whose SimulationStep is read-only. <b>[multi-thread safe]</b>
+    ///
+    /// Bodies, and the modules and sensors that are not read-only (see SensorBase::IsSimulationStepReadOnly and ModuleBase::IsSimulationStepReadOnly), are always stepped in order by the thread calling StepSimulation.
+    /// The read-only ones are stepped concurrently after them while the calling thread keeps the environment locked.
+    /// \param numthreads the number of threads including the calling one. If <= 1, everything is stepped by the calling thread (default).
+    virtual void SetSimulationStepThreads(int numthreads) = 0;
+
+    /// \brief Returns the number of threads set by SetSimulationStepThreads. <b>[multi-thread safe]</b>
+    virtual int GetSimulationStepThreads() const = 0;
+
+    /// \brief Returns the time spent in each phase of the last StepSimulation call. <b>[multi-thread safe]</b>
+    virtual void GetSimulationStepTimes(SimulationStepTimes& times) const = 0;
     //@}
 
     /// \name File Loading and Parsing
@@ -286,6 +323,22 @@ public:
     /// \param uri the URI of the scene. Used to inject the URI into the environment.
     virtual bool LoadJSON(const rapidjson::Value& rEnvInfo, UpdateFromInfoMode updateMode, std::vector<KinBodyPtr>& vCreatedBodies, std::vector<KinBodyPtr>& vModifiedBodies, std::vector<KinBodyPtr>& vRemovedBodies, const AttributesList& atts = AttributesList(), const std::string &uri = std::string()) = 0;
 
+    /** \brief updates the scene from a delta that only contains the bodies that changed. <b>[multi-thread safe]</b>
+
+        The delta has the layout of the environment json, but every entry in "bodies" only has "id" (or "name") and the changed fields, for example
+        \code
+        {"unitInfo": {...}, "bodies": [{"id": "box0", "transform": [1,0,0,0,0.1,0,0]}, {"id": "robot0", "dofValues": [{"jointName": "j0", "value": 0.5}]}, {"id": "box1", "__deleted__": true}]}
+        \endcode
+        Entries of existing bodies with only "transform" and "dofValues" are set directly on the bodies without going through infos. Entries with "__deleted__" remove the body. All other entries are loaded with \ref LoadJSON using UFIM_OnlySpecifiedBodiesExact, so only they are parsed and compared. Entries are applied in their order in the delta, consecutive entries that are loaded with \ref LoadJSON are loaded together.
+
+        MsgPack deltas can be converted with MsgPack::ParseMsgPack first.
+        \param vCreatedBodies the bodies created in this operation
+        \param vModifiedBodies the bodies modified in this operation
+        \param vRemovedBodies the bodies removed from the environment in this operation
+        \param atts attributes that is passed to JSONReader for the entries that are not only transforms and dof values.
+     */
+    virtual bool UpdateFromDelta(const rapidjson::Value& rDelta, std::vector<KinBodyPtr>& vCreatedBodies, std::vector<KinBodyPtr>& vModifiedBodies, std::vector<KinBodyPtr>& vRemovedBodies, const AttributesList& atts = AttributesList()) = 0;
+
     virtual bool LoadXMLData(const std::string& data, const AttributesList& atts = AttributesList()) {
         return LoadData(data,atts);
     }
@@ -559,6 +612,19 @@ public:
     /// \throw openrave_exception with ORE_Timeout error code
     virtual void GetPublishedBodies(std::vector<KinBody::BodyState>& vbodies, uint64_t timeout=0) = 0;
 
+    typedef boost::shared_ptr<const std::vector<KinBody::BodyStateConstPtr> > PublishedBodiesConstPtr;
+
+    /// \brief Retrieve the published bodies without copying them, completes even if environment is locked. <b>[multi-thread safe]</b>
+    ///
+    /// A separate **interface mutex** is locked only while retrieving the snapshot pointer.
+    /// The snapshot and the states it points to are never modified, so they can be read without locks as long as the pointer is held.
+    /// States of bodies whose update stamp did not change are shared between consecutive snapshots.
+    /// Note that the pbody pointers might become invalid as soon as GetPublishedBodiesSnapshot returns.
+    /// \param timeout microseconds to wait before throwing an exception, if 0, will block indefinitely.
+    /// \throw openrave_exception with ORE_Timeout error code
+    /// \return the published bodies, never null
+    virtual PublishedBodiesConstPtr GetPublishedBodiesSnapshot(uint64_t timeout=0) = 0;
+
     /// \brief Retrieve published body of specified name, completes even if environment is locked. <b>[multi-thread safe]</b>
     ///
     /// A separate **interface mutex** is locked for reading the modules.
@@ -590,6 +656,7 @@ public:
     ///
     /// For example, calling this function inside a planning loop allows the viewer to update the environment
     /// reflecting the status of the planner.
+    /// Only the states of bodies whose KinBody::GetUpdateStamp changed are refreshed, and the new snapshot replaces the old one atomically.
     /// Assumes that the physics are locked.
     /// \param timeout microseconds to wait before throwing an exception, if 0, will block indefinitely.
     /// \throw openrave_exception with ORE_Timeout error code
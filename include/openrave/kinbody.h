@@ -668,6 +668,31 @@ private:
     typedef boost::shared_ptr<GeometryInfo> GeometryInfoPtr;
     typedef boost::shared_ptr<GeometryInfo const> GeometryInfoConstPtr;
 
+    /// \brief flag marking geometry data that is built on first use.
+    ///
+    /// It is read without the lazy geometry mutex, so it is set with release and read with acquire ordering, and the data is complete whenever the flag reads false. Copies take the current value.
+    class LazyGeometryFlag
+    {
+public:
+        LazyGeometryFlag(bool b=false) : _b(b) {
+        }
+        LazyGeometryFlag(const LazyGeometryFlag& r) : _b(r._b.load(std::memory_order_acquire)) {
+        }
+        inline LazyGeometryFlag& operator=(const LazyGeometryFlag& r) {
+            _b.store(r._b.load(std::memory_order_acquire), std::memory_order_release);
+            return *this;
+        }
+        inline LazyGeometryFlag& operator=(bool b) {
+            _b.store(b, std::memory_order_release);
+            return *this;
+        }
+        inline operator bool() const {
+            return _b.load(std::memory_order_acquire);
+        }
+private:
+        std::atomic<bool> _b;
+    };
+
     /// \brief geometry object holding a link parent and wrapping access to a protected geometry info
     class OPENRAVE_API Geometry
     {
@@ -786,17 +811,32 @@ public:
         }
 
         /// \brief returns the local collision mesh
+        ///
+        /// With lazy geometry (OPENRAVE_LAZY_GEOMETRY=1), primitive geometries are tessellated on the first call.
+        /// Cloned trimesh geometries copy their mesh out of the shared buffer on the first call.
         inline const TriMesh& GetCollisionMesh() const {
+            if( _bCollisionMeshPending || _bCollisionMeshShared ) {
+                _InitPendingCollisionMesh();
+            }
             return _info._meshcollision;
         }
 
+        /// \brief returns the buffer holding the local collision mesh if the geometry shares it with the body it was cloned from, otherwise an empty pointer.
+        ///
+        /// Cloned trimesh geometries only hold this buffer until GetCollisionMesh or GetInfo is called, so reading the mesh from here avoids copying it.
+        TriMeshBufferConstPtr GetCollisionMeshBuffer() const;
+
+        /// \brief returns the info of the geometry. With lazy geometry, _meshcollision of a primitive geometry is empty until GetCollisionMesh is called.
         inline const KinBody::GeometryInfo& GetInfo() const {
+            if( _bCollisionMeshShared ) {
+                _InitPendingCollisionMesh();
+            }
             return _info;
         }
 
         inline const KinBody::GeometryInfo& UpdateAndGetInfo() {
             UpdateInfo();
-            return _info;
+            return GetInfo();
         }
 
         void UpdateInfo();
@@ -938,6 +978,18 @@ public:
 protected:
         boost::weak_ptr<Link> _parent;
         KinBody::GeometryInfo _info; ///< geometry info
+        mutable TriMeshBufferConstPtr _pmeshcollisionbuffer; ///< immutable copy of the trimesh of _info._meshcollision shared with the clones of the geometry, accessed atomically. \see _GetCollisionMeshBufferForClone
+        mutable LazyGeometryFlag _bCollisionMeshPending; ///< true if the tessellation of _info._meshcollision is deferred to the first GetCollisionMesh call. Only cleared while holding the lazy geometry mutex.
+        mutable LazyGeometryFlag _bCollisionMeshShared; ///< true if _info._meshcollision is empty and the mesh is only held by _pmeshcollisionbuffer until the first GetCollisionMesh or GetInfo call. Only cleared while holding the lazy geometry mutex.
+
+        /// \brief tessellates the collision mesh now, or on first use when lazy geometry is enabled
+        void _InitCollisionMeshOrDefer();
+
+        /// \brief tessellates the collision mesh deferred by _InitCollisionMeshOrDefer, or copies it out of the shared buffer
+        void _InitPendingCollisionMesh() const;
+
+        /// \brief returns the buffer to share with a clone of a trimesh geometry, building it from _info._meshcollision if necessary
+        TriMeshBufferConstPtr _GetCollisionMeshBufferForClone() const;
 #ifdef RAVE_PRIVATE
 #ifdef _MSC_VER
         friend class OpenRAVEXMLParser::LinkXMLReader;
@@ -1141,7 +1193,11 @@ public:
         inline int GetIndex() const {
             return _index;
         }
+        /// \brief returns the triangulation of all the geometries in the link coordinate system. With lazy geometry, it is built on the first call.
         inline const TriMesh& GetCollisionData() const {
+            if( _bCollisionDataPending ) {
+                _InitPendingCollisionData();
+            }
             return _collision;
         }
 
@@ -1401,6 +1457,12 @@ protected:
         /// \param parameterschanged if true, will
         void _Update(bool parameterschanged=true, uint32_t extraParametersChanged=0);
 
+        /// \brief builds _collision from the geometries
+        void _UpdateCollisionData() const;
+
+        /// \brief builds _collision deferred by _Update
+        void _InitPendingCollisionData() const;
+
         std::vector<GeometryPtr> _vGeometries;         ///< \see GetGeometries
 
         LinkInfo _info; ///< parameter information of the link
@@ -1413,8 +1475,9 @@ private:
         KinBodyWeakPtr _parent;         ///< \see GetParent
         std::vector<int> _vParentLinks;         ///< \see GetParentLinks, IsParentLink
         std::vector<int> _vRigidlyAttachedLinks;         ///< \see IsRigidlyAttached, GetRigidlyAttachedLinks
-        TriMesh _collision; ///< triangles for collision checking, triangles are always the triangulation
-                            ///< of the body when it is at the identity transformation
+        mutable TriMesh _collision; ///< triangles for collision checking, triangles are always the triangulation
+                                    ///< of the body when it is at the identity transformation
+        mutable LazyGeometryFlag _bCollisionDataPending; ///< true if _collision is built on the first GetCollisionData call. Only cleared while holding the lazy geometry mutex.
         //@}
 #ifdef RAVE_PRIVATE
 #ifdef _MSC_VER
@@ -3270,6 +3333,19 @@ private:
     /// \param linkIndices vector of link index. Each combination among them is set as adjacent links. elements have to be unique
     void SetAdjacentLinksCombinations(const std::vector<int>& linkIndices);
 
+    /// \brief sets the link pairs that can never collide inside the joint limits. They are pruned from \ref GetNonAdjacentLinks.
+    ///
+    /// The pairs are usually learned offline by sampling the configuration space, see openravepy.databases.selfcollisionpairs.
+    /// They are not part of the body info and are cleared when the body is re-initialized.
+    /// \param linkIndices pairs of link indices, replaces all previously set pairs
+    void SetNeverCollidingLinksPairs(const std::vector<std::pair<int, int> >& linkIndices);
+
+    /// \brief gets the link pairs set with \ref SetNeverCollidingLinksPairs. For each pair, first < second.
+    void GetNeverCollidingLinksPairs(std::vector<std::pair<int, int> >& linkIndices) const;
+
+    /// \brief return true if the two links were set to never collide.
+    bool AreNeverCollidingLinks(int linkindex0, int linkindex1) const;
+
     inline ManageDataPtr GetManageData() const {
         return _pManageData;
     }
@@ -3560,6 +3636,18 @@ protected:
      */
     virtual void _ComputeInternalInformation();
 
+    /// \brief the part of the kinematics hierarchy that only depends on the link/joint topology, shared between bodies with the same kinematics. Defined in kinbody.cpp
+    class HierarchySnapshot;
+    typedef boost::shared_ptr<HierarchySnapshot> HierarchySnapshotPtr;
+
+    /// \brief computes the all-pairs shortest paths, link parents and depths, topological joint order and closed loops of the current links and joints
+    ///
+    /// Called from _ComputeInternalInformation after the joint indices and mimic equations are set.
+    void _ComputeHierarchySnapshot(HierarchySnapshot& snapshot) const;
+
+    /// \brief returns a key that changes whenever the result of _ComputeHierarchySnapshot can change
+    std::string _GetHierarchySnapshotKey() const;
+
     /// \brief de-initializes any internal information computed
     virtual void _DeinitializeInternalInformation();
 
@@ -3648,6 +3736,7 @@ protected:
     std::vector<JointPtr> _vPassiveJoints; ///< \see GetPassiveJoints()
     std::vector<int8_t> _vAdjacentLinks; ///< a vector of which links are connected to which if link i and j are connected and i < j, then value at (i + j * (j - 1) /2) is 1 where N is the number of links for the body
     std::vector<int8_t> _vForcedAdjacentLinks; ///< internally stores forced adjacent links. \see _vAdjacentLinks for internal representation
+    std::vector<int8_t> _vNeverCollidingLinks; ///< link pairs that never collide, pruned from _vNonAdjacentLinks. \see _vAdjacentLinks for internal representation
     std::list<KinBodyWeakPtr> _listAttachedBodies; ///< list of bodies that are directly attached to this body (can have duplicates)
 
     std::vector<Transform*> _vLinkTransformPointers; ///< holds a pointers to the Transform Link::_t  in _veclinks. Used for fast access fo the custom kinematics
@@ -3753,10 +3842,8 @@ public:
         _listNonCollidingIsValid = false;
     }
 
-    inline void _SetLinkNonCollidingIsValid(bool bIsValid)
-    {
-        _listNonCollidingIsValid = bIsValid;
-    }
+    /// \brief sets whether _listNonCollidingLinksWhenGrabbed is valid. If valid, the link masks of the other grabbed bodies are updated from it.
+    void _SetLinkNonCollidingIsValid(bool bIsValid);
 
     inline bool IsListNonCollidingLinksValid() const
     {
@@ -3768,6 +3855,18 @@ public:
     ///        more than once with different input links to ignore.
     void AddMoreIgnoreLinks(const std::set<int>& setAdditionalGrabberLinksToIgnore);
 
+    /// \brief returns true if the link of another grabbed body is in _listNonCollidingLinksWhenGrabbed. Logarithmic in the number of grabbed bodies.
+    ///
+    /// \param envBodyIndex the environment body index of the other grabbed body
+    inline bool IsNonCollidingOtherGrabbedLink(int envBodyIndex, int linkindex) const
+    {
+        std::map<int, std::vector<uint64_t> >::const_iterator it = _mapNonCollidingOtherGrabbedLinksMask.find(envBodyIndex);
+        return it != _mapNonCollidingOtherGrabbedLinksMask.end() && _IsLinkInMask(it->second, linkindex);
+    }
+
+    /// \brief removes the links of another grabbed body from _listNonCollidingLinksWhenGrabbed. Called when it is released.
+    void _RemoveNonCollidingOtherGrabbedLinks(KinBodyConstPtr pOtherGrabbedBody);
+
     // Member Variables
     KinBodyWeakPtr _pGrabbedBody; ///< the body being grabbed
     KinBody::LinkPtr _pGrabbingLink; ///< the link used for grabbing _pGrabbedBody. Its transform (as well as the transforms of other links rigidly attached to _pGrabbingLink) relative to the grabbed body remains constant until the grabbed body is released.
@@ -3776,7 +3875,26 @@ public:
     std::set<int> _setGrabberLinkIndicesToIgnore; ///< indices to the links of the grabber whose collisions with the grabbed bodies should be ignored.
     rapidjson::Document _rGrabbedUserData; ///< user-defined data to be updated when kinbody grabs and releases objects
 private:
+    static inline bool _IsLinkInMask(const std::vector<uint64_t>& vmask, int linkindex)
+    {
+        const size_t iword = static_cast<size_t>(linkindex) >> 6;
+        return iword < vmask.size() && ((vmask[iword] >> (linkindex & 63)) & 1);
+    }
+
+    static inline void _SetLinkInMask(std::vector<uint64_t>& vmask, int linkindex)
+    {
+        const size_t iword = static_cast<size_t>(linkindex) >> 6;
+        if( iword >= vmask.size() ) {
+            vmask.resize(iword+1, 0);
+        }
+        vmask[iword] |= uint64_t(1) << (linkindex & 63);
+    }
+
+    /// \brief recomputes _mapNonCollidingOtherGrabbedLinksMask from _listNonCollidingLinksWhenGrabbed
+    void _UpdateNonCollidingLinksMasks();
+
     bool _listNonCollidingIsValid = false; ///< a flag indicating whether the current _listNonCollidingLinksWhenGrabbed is valid or not.
+    std::map<int, std::vector<uint64_t> > _mapNonCollidingOtherGrabbedLinksMask; ///< for every other grabbed body (by environment body index), bit i is set if its link i is in _listNonCollidingLinksWhenGrabbed. Only valid when _listNonCollidingIsValid is true.
     std::vector<KinBody::LinkPtr> _vAttachedToGrabbingLink; ///< vector of all links that are rigidly attached to _pGrabbingLink
     KinBody::KinBodyStateSaverPtr _pGrabberSaver; ///< statesaver that saves the snapshot of the grabber at the time Grab is called. The saved state will be used (i.e. restored) temporarily when computation of _listNonCollidingLinksWhenGrabbed is necessary.
     KinBody::KinBodyStateSaverPtr _pGrabbedSaver; ///< statesaver that saves the snapshot of the grabbed at the time Grab is called. The saved state will be used (i.e. restored) temporarily when computation of _listNonCollidingLinksWhenGrabbed is necessary.
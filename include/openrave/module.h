@@ -58,6 +58,13 @@ public:
     virtual bool SimulationStep(dReal fElapsedTime) {
         return false;
     }
+
+    /// \brief Returns true if SimulationStep only reads the scene, so it can run concurrently with other read-only steps.
+    ///
+    /// \see SensorBase::IsSimulationStepReadOnly
+    virtual bool IsSimulationStepReadOnly() const {
+        return false;
+    }
     
 private:
     virtual const char* GetHash() const {
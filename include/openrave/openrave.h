@@ -58,6 +58,7 @@
 #include <iomanip>
 #include <fstream>
 #include <sstream>
+#include <atomic>
 
 // QTBUG-22829 alternative workaround
 #ifndef Q_MOC_RUN
@@ -2503,6 +2504,66 @@ public:
 OPENRAVE_API std::ostream& operator<<(std::ostream& O, const TriMesh& trimesh);
 OPENRAVE_API std::istream& operator>>(std::istream& I, TriMesh& trimesh);
 
+/// \brief Compact and immutable triangle mesh that is shared by reference instead of copied.
+///
+/// Vertices are stored as three dReal and indices as uint16 when every index is in [0, 0xffff] (regardless of the number of vertices), so a vertex takes 3*sizeof(dReal) bytes instead of
+/// the 4*sizeof(dReal) of \ref TriMesh and converting back and forth is lossless. \ref TriMesh remains the editable representation, convert with \ref GetTriMesh.
+class OPENRAVE_API TriMeshBuffer
+{
+public:
+    explicit TriMeshBuffer(const TriMesh& trimesh);
+
+    inline size_t GetNumVertices() const {
+        return _vertices.size()/3;
+    }
+    inline size_t GetNumIndices() const {
+        return _indices32.size() > 0 ? _indices32.size() : _indices16.size();
+    }
+
+    /// \brief x,y,z of every vertex
+    inline const dReal* GetVertexData() const {
+        return _vertices.data();
+    }
+
+    /// \brief true if the indices are stored in \ref GetIndexData16, otherwise in \ref GetIndexData32
+    inline bool HasIndices16() const {
+        return _indices32.empty();
+    }
+    inline const uint16_t* GetIndexData16() const {
+        return _indices16.data();
+    }
+    inline const int32_t* GetIndexData32() const {
+        return _indices32.data();
+    }
+
+    inline Vector GetVertex(size_t ivertex) const {
+        const dReal* pvertex = &_vertices[3*ivertex];
+        return Vector(pvertex[0], pvertex[1], pvertex[2]);
+    }
+    inline int32_t GetIndex(size_t iindex) const {
+        return _indices32.size() > 0 ? _indices32[iindex] : (int32_t)_indices16[iindex];
+    }
+
+    /// \brief fills trimesh with the vertices and indices of the buffer
+    void GetTriMesh(TriMesh& trimesh) const;
+
+    /// \brief computes the bounding box of the vertices transformed by t
+    AABB ComputeAABB(const Transform& t) const;
+
+    /// \brief number of bytes used by the vertices and indices
+    size_t GetMemoryUsage() const;
+
+    /// \brief writes the same output as \ref TriMesh::serialize
+    void serialize(std::ostream& o, int options=0) const;
+
+private:
+    std::vector<dReal> _vertices;
+    std::vector<uint16_t> _indices16;
+    std::vector<int32_t> _indices32;
+};
+
+typedef boost::shared_ptr<TriMeshBuffer const> TriMeshBufferConstPtr;
+
 /// \brief Selects which DOFs of the affine transformation to include in the active configuration.
 enum DOFAffine
 {
@@ -502,21 +502,44 @@ inline void LoadJsonValue(const rapidjson::Value& v, OpenRAVE::TriMesh& t)
         throw OPENRAVE_EXCEPTION_FORMAT0("Cannot load TriMesh of non-object.", OpenRAVE::ORE_InvalidArguments);
     }
 
-    if (!v.HasMember("vertices") || !v["vertices"].IsArray() || v["vertices"].Size() % 3 != 0) {
+    rapidjson::Value::ConstMemberIterator itVertices = v.FindMember("vertices");
+    if (itVertices == v.MemberEnd() || !itVertices->value.IsArray() || itVertices->value.Size() % 3 != 0) {
         throw OPENRAVE_EXCEPTION_FORMAT0("failed to deserialize json, value cannot be decoded as a TriMesh, \"vertices\" malformatted", OpenRAVE::ORE_InvalidArguments);
     }
 
-    t.vertices.clear();
-    t.vertices.reserve(v["vertices"].Size() / 3);
+    // meshes are the bulk of the scene data, so read numbers directly and only fall back to LoadJsonValue for other types
+    const rapidjson::Value& rVertices = itVertices->value;
+    t.vertices.resize(rVertices.Size() / 3);
+    rapidjson::Value::ConstValueIterator itVertexValue = rVertices.Begin();
+    for (OpenRAVE::Vector& vertex : t.vertices) {
+        for (int idim = 0; idim < 3; ++idim, ++itVertexValue) {
+            if (itVertexValue->IsNumber()) {
+                vertex[idim] = itVertexValue->GetDouble();
+            }
+            else {
+                LoadJsonValue(*itVertexValue, vertex[idim]);
+            }
+        }
+    }
 
-    for (rapidjson::Value::ConstValueIterator it = v["vertices"].Begin(); it != v["vertices"].End(); ) {
-        OpenRAVE::Vector vertex;
-        LoadJsonValue(*(it++), vertex.x);
-        LoadJsonValue(*(it++), vertex.y);
-        LoadJsonValue(*(it++), vertex.z);
-        t.vertices.push_back(vertex);
+    rapidjson::Value::ConstMemberIterator itIndices = v.FindMember("indices");
+    if (itIndices == v.MemberEnd()) {
+        throw OPENRAVE_EXCEPTION_FORMAT0("failed to deserialize json, value cannot be decoded as a TriMesh, \"indices\" missing", OpenRAVE::ORE_InvalidArguments);
+    }
+    const rapidjson::Value& rIndices = itIndices->value;
+    if (!rIndices.IsArray()) {
+        throw OPENRAVE_EXCEPTION_FORMAT("Cannot convert JSON type %s to Array", GetJsonTypeName(rIndices), OpenRAVE::ORE_InvalidArguments);
+    }
+    t.indices.resize(rIndices.Size());
+    std::vector<int32_t>::iterator itIndex = t.indices.begin();
+    for (rapidjson::Value::ConstValueIterator itIndexValue = rIndices.Begin(); itIndexValue != rIndices.End(); ++itIndexValue, ++itIndex) {
+        if (itIndexValue->IsInt()) {
+            *itIndex = itIndexValue->GetInt();
+        }
+        else {
+            LoadJsonValue(*itIndexValue, *itIndex);
+        }
     }
-    LoadJsonValue(v["indices"], t.indices);
 }
 
 template<class T>
@@ -20,6 +20,7 @@
 
 #include <openrave/config.h>
 
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <iostream>
@@ -30,8 +31,19 @@ namespace OpenRAVE {
 
 namespace MsgPack {
 
-OPENRAVE_API void DumpMsgPack(const rapidjson::Value& value, std::ostream& os);
-OPENRAVE_API void DumpMsgPack(const rapidjson::Value& value, std::vector<char>& output);
+/// \brief msgpack extension type used for DMO_TypedArrays
+///
+/// The payload is the numpy-style dtype character ('B' uint8, 'H' uint16, 'i' int32, 'q' int64, 'f' float32, 'd' float64), a uint8 number of dimensions, a little-endian uint32 per dimension, and the little-endian elements.
+static const int8_t MSGPACK_EXT_TYPEDARRAY = 0x10;
+
+/// \brief options for DumpMsgPack
+enum DumpMsgPackOptions
+{
+    DMO_TypedArrays = 1, ///< write long numeric arrays of one type as MSGPACK_EXT_TYPEDARRAY blobs instead of per-element values. ParseMsgPack converts them back to json arrays. Other msgpack readers need to understand the extension.
+};
+
+OPENRAVE_API void DumpMsgPack(const rapidjson::Value& value, std::ostream& os, int options=0);
+OPENRAVE_API void DumpMsgPack(const rapidjson::Value& value, std::vector<char>& output, int options=0);
 
 OPENRAVE_API void ParseMsgPack(rapidjson::Document& d, const std::string& str);
 OPENRAVE_API void ParseMsgPack(rapidjson::Document& d, std::istream& is);
@@ -24,6 +24,7 @@
 #define OPENRAVE_PLANNINGUTILS_H
 
 #include <openrave/openrave.h>
+#include <atomic>
 
 namespace OpenRAVE {
 
@@ -58,6 +59,18 @@ OPENRAVE_API int JitterCurrentConfiguration(PlannerBase::PlannerParametersConstP
  */
 OPENRAVE_API void VerifyTrajectory(PlannerBase::PlannerParametersConstPtr parameters, TrajectoryBaseConstPtr trajectory, dReal samplingstep=0.002);
 
+/** \brief validates a trajectory with respect to the planning constraints using several threads.
+
+    Performs the same checks as \ref VerifyTrajectory, but splits the waypoints and sampled time segments into chunks that are checked by worker threads. Each worker owns a clone of trajectory->GetEnv() (Clone_Bodies), of the trajectory, and of the parameters, which are made with PlannerParameters::SetConfigurationSpecification from trajectory->GetConfigurationSpecification() in the cloned environment.
+    The reported violation is always the earliest one in trajectory time, independent of thread scheduling.
+    Assume that trajectory->GetEnv() is locked.
+    \param parameters If initialized, its functions can be bound to state that cannot be rebuilt in the cloned environments, so the trajectory is verified serially like \ref VerifyTrajectory. Pass empty parameters to verify in parallel.
+    \param numthreads number of worker threads. If <= 0, uses the hardware concurrency. If 1, same as \ref VerifyTrajectory.
+    \param bAbortOnFirstFailure If true, workers stop as soon as they pass a known violation. If false, the entire trajectory is checked and every violation is logged before throwing the earliest one.
+    \throw openrave_exception If the trajectory is invalid, will throw ORE_InconsistentConstraints.
+ */
+OPENRAVE_API void VerifyTrajectoryParallel(PlannerBase::PlannerParametersConstPtr parameters, TrajectoryBaseConstPtr trajectory, dReal samplingstep=0.002, int numthreads=0, bool bAbortOnFirstFailure=true);
+
 /** \brief Extends the last ramp of the trajectory in order to reach a goal. THe configuration space matches the positional data of the trajectory.
 
     Useful when appending jittered points to the trajectory.
@@ -562,6 +575,50 @@ protected:
     ConstraintFilterReturnPtr _filterreturn;
 } RAVE_DEPRECATED;
 
+/** \brief Lock-free single-producer/single-consumer handoff of waypoints into a trajectory.
+
+    Used for online execution where one thread generates waypoints while another one executes and samples the trajectory. The producer thread calls \ref Push for every new waypoint, the thread owning the trajectory periodically calls \ref Flush to append all pending waypoints at the end of the trajectory. Push never blocks nor allocates memory. Flush never waits for the producer, but appending to the trajectory can allocate memory.
+ */
+class OPENRAVE_API TrajectoryWaypointStream
+{
+public:
+    /// \param spec the configuration specification of the pushed waypoints
+    /// \param capacity the max number of pending waypoints, rounded up to a power of two
+    TrajectoryWaypointStream(const ConfigurationSpecification& spec, size_t capacity=1024);
+
+    /// \brief pushes one waypoint of GetConfigurationSpecification().GetDOF() values. Only called from the producer thread.
+    ///
+    /// \return false if the stream is full and the waypoint was not added
+    bool Push(const dReal* pwaypoint);
+
+    inline bool Push(const std::vector<dReal>& waypoint) {
+        OPENRAVE_ASSERT_OP((int)waypoint.size(),==,_spec.GetDOF());
+        return Push(waypoint.data());
+    }
+
+    /// \brief appends all pending waypoints at the end of traj. Only called from the consumer thread.
+    ///
+    /// \return the number of appended waypoints
+    size_t Flush(TrajectoryBasePtr traj);
+
+    /// \brief returns the number of waypoints pushed, but not flushed yet
+    size_t GetNumPending() const;
+
+    inline const ConfigurationSpecification& GetConfigurationSpecification() const {
+        return _spec;
+    }
+
+protected:
+    ConfigurationSpecification _spec;
+    std::vector<dReal> _vbuffer; ///< ring buffer of capacity waypoints
+    size_t _capacitymask; ///< capacity-1
+    int _dof;
+    std::atomic<size_t> _writeindex; ///< number of waypoints pushed so far, only modified by the producer
+    std::atomic<size_t> _readindex; ///< number of waypoints flushed so far, only modified by the consumer
+};
+
+typedef boost::shared_ptr<TrajectoryWaypointStream> TrajectoryWaypointStreamPtr;
+
 /// \brief simple distance metric based on joint weights
 class OPENRAVE_API SimpleDistanceMetric
 {
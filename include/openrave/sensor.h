@@ -571,6 +571,14 @@ public:
     /// Only valid if this sensor is simulation based. A sensor hooked up to a real device can ignore this call
     virtual bool SimulationStep(dReal fTimeElapsed) OPENRAVE_DUMMY_IMPLEMENTATION;
 
+    /// \brief Returns true if SimulationStep only reads the scene, so it can run concurrently with other read-only steps.
+    ///
+    /// A read-only step is called from a different thread while the thread calling EnvironmentBase::StepSimulation keeps the environment locked.
+    /// It must not modify any bodies, lock the environment, or use shared resources like the environment collision checker.
+    virtual bool IsSimulationStepReadOnly() const {
+        return false;
+    }
+
     /// \brief Returns the sensor geometry. This method is thread safe.
     ///
     /// \param type the requested sensor type to create. A sensor can support many types. If type is ST_Invalid, then returns any structure that represents the geometry.
@@ -289,6 +289,17 @@ OPENRAVE_API std::string GetMD5HashString(const std::string& s);
 /// \brief compute the md5 hash of an array
 OPENRAVE_API std::string GetMD5HashString(const std::vector<uint8_t>& v);
 
+/// \brief removes the least recently modified files of a cache directory until the files add up to at most maxbytes
+///
+/// Files ending in .tmp are skipped since they are still being written, unless they were left for more than an hour. Errors are ignored.
+/// \return the size of the files left in the directory
+OPENRAVE_API uint64_t PruneFileCache(const std::string& directory, uint64_t maxbytes);
+
+/// \brief returns a .tmp file name next to filename that is unique to the calling process and thread
+///
+/// Used to write a file completely before renaming it to filename.
+OPENRAVE_API std::string GetTemporaryFilename(const std::string& filename);
+
 template<class T>
 inline T ClampOnRange(T value, T min, T max)
 {
@@ -18,6 +18,12 @@
 #include <boost/bind/bind.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <thread>
+
 using namespace boost::placeholders;
 
 class IdealController : public ControllerBase
@@ -33,17 +39,27 @@ If \ref ControllerBase::SetPath is called and the trajectory finishes, then the
 If SetDesired is called, only joint values will be set at every timestep leaving the transformation alone.\n";
         RegisterCommand("Pause",boost::bind(&IdealController::_Pause,this,_1,_2),
                         "pauses the controller from reacting to commands ");
+        RegisterCommand("SetSpeed",boost::bind(&IdealController::_SetSpeed,this,_1,_2),
+                        "Sets how fast the trajectories are executed relative to the simulation time, 1 by default. Format is:\n\n  speed");
         RegisterCommand("SetCheckCollisions",boost::bind(&IdealController::_SetCheckCollisions,this,_1,_2),
                         "If set, will check if the robot gets into a collision during movement");
         RegisterCommand("SetThrowExceptions",boost::bind(&IdealController::_SetThrowExceptions,this,_1,_2),
                         "If set, will throw exceptions instead of print warnings. Format is:\n\n  [0/1]");
         RegisterCommand("SetEnableLogging",boost::bind(&IdealController::_SetEnableLogging,this,_1,_2),
-                        "If set, will write trajectories to disk");
+                        "If set, will write trajectories to disk. Format is:\n\n  [0/1] [blocksize [groupname quantization]*]\n\nIf blocksize is specified, the logged trajectories are compressed with the trajectory Compress command.");
+        RegisterCommand("SetRealTimeRate",boost::bind(&IdealController::_SetRealTimeRate,this,_1,_2),
+                        "If the rate is > 0, trajectories are pre-sampled at that rate and a separate thread advances through the samples at a fixed rate, scaled by the speed and frozen while paused. The thread sets the sample it reached when it can lock the environment without waiting, otherwise SimulationStep sets the latest one. Trajectories with grab groups are executed normally. Format is:\n\n  rate_in_hz");
+        RegisterCommand("GetRealTimeStats",boost::bind(&IdealController::_GetRealTimeStats,this,_1,_2),
+                        "Returns the statistics of the real-time thread since the last SetRealTimeRate. Format is:\n\n  numcycles numoverruns meanjitter maxjitter\n\nThe jitters are the wake up delays in seconds, an overrun is a delay of at least one period.");
+        RegisterCommand("SetLookAheadCollisionChecking",boost::bind(&IdealController::_SetLookAheadCollisionChecking,this,_1,_2),
+                        "If the look-ahead time is > 0, a separate thread checks the collisions of the trajectory up to that time ahead of the current time, every timestep seconds, in a clone of the environment. The clone is only made again when a trajectory is set after other bodies changed, and the grab groups of the trajectory are applied to it. The trajectory is stopped at the last checked configuration before a collision, and waits if the checks fall behind, also when executed by the real-time thread. Format is:\n\n  lookaheadtime [timestep]\n\ntimestep is 0.01 by default.");
         _fCommandTime = 0;
         _fSpeed = 1;
         _nControlTransformation = 0;
     }
     virtual ~IdealController() {
+        _StopRealTimeThread();
+        _StopLookAheadThread();
     }
 
     virtual bool Init(RobotBasePtr robot, const std::vector<int>& dofindices, int nControlTransformation)
@@ -96,6 +112,8 @@ If SetDesired is called, only joint values will be set at every timestep leaving
     virtual void Reset(int options)
     {
         _ptraj.reset();
+        _SetRealTimeTrajectory(RealTimeTrajectoryConstPtr());
+        _CancelLookAhead();
         _vecdesired.resize(0);
         if( flog.is_open() ) {
             flog.close();
@@ -117,6 +135,8 @@ If SetDesired is called, only joint values will be set at every timestep leaving
         }
         _fCommandTime = 0;
         _ptraj.reset();
+        _SetRealTimeTrajectory(RealTimeTrajectoryConstPtr());
+        _CancelLookAhead();
         // do not set done to true here! let it be picked up by the simulation thread.
         // this will also let it have consistent mechanics as SetPath
         // (there's a race condition we're avoiding where a user calls SetDesired and then state savers revert the robot)
@@ -144,7 +164,15 @@ If SetDesired is called, only joint values will be set at every timestep leaving
     virtual bool SetPath(TrajectoryBaseConstPtr ptraj)
     {
         OPENRAVE_ASSERT_FORMAT0(!ptraj || GetEnv()==ptraj->GetEnv(), "trajectory needs to come from the same environment as the controller", ORE_InvalidArguments);
-        std::lock_guard<std::mutex> lock(_mutex);
+        boost::shared_ptr<EnvironmentLock> lockenv;
+        std::unique_lock<std::mutex> lock(_mutex);
+        if( _fLookAheadTime > 0 && !!ptraj ) {
+            // the look-ahead checking clones the environment, so lock it before _mutex like in SimulationStep. _fLookAheadTime can
+            // only become > 0 while _mutex is locked, so it does not need to be checked again.
+            lock.unlock();
+            lockenv.reset(new EnvironmentLock(GetEnv()->GetMutex()));
+            lock.lock();
+        }
         if( _bPause ) {
             RAVELOG_DEBUG("IdealController cannot start trajectories when paused\n");
             _ptraj.reset();
@@ -155,6 +183,8 @@ If SetDesired is called, only joint values will be set at every timestep leaving
         _bIsDone = true;
         _vecdesired.resize(0);
         _ptraj.reset();
+        _SetRealTimeTrajectory(RealTimeTrajectoryConstPtr());
+        _CancelLookAhead();
 
         if( !!ptraj ) {
             RobotBasePtr probot = _probot.lock();
@@ -243,11 +273,46 @@ If SetDesired is called, only joint values will be set at every timestep leaving
             }
 
             if( !!flog && _bEnableLogging ) {
-                ptraj->serialize(flog);
+                if( _sLoggingCompression.size() > 0 ) {
+                    TrajectoryBasePtr plogtraj = RaveCreateTrajectory(GetEnv(),ptraj->GetXMLId());
+                    plogtraj->Clone(ptraj,0);
+                    stringstream sout, sinput;
+                    sinput << "Compress " << _sLoggingCompression;
+                    try {
+                        plogtraj->SendCommand(sout, sinput);
+                    }
+                    catch(const openrave_exception& ex) {
+                        RAVELOG_WARN_FORMAT("failed to compress logged trajectory: %s", ex.what());
+                    }
+                    plogtraj->serialize(flog);
+                }
+                else {
+                    ptraj->serialize(flog);
+                }
             }
 
             _ptraj = RaveCreateTrajectory(GetEnv(),ptraj->GetXMLId());
             _ptraj->Clone(ptraj,0);
+            if( _fRealTimeStep > 0 ) {
+                if( _vgrablinks.size() > 0 || _vgrabbodylinks.size() > 0 ) {
+                    RAVELOG_DEBUG_FORMAT("robot %s trajectory has grab groups, so executing it in the simulation thread", probot->GetName());
+                }
+                else if( _samplespec.GetDOF() > 0 ) {
+                    boost::shared_ptr<RealTimeTrajectory> prealtimetraj(new RealTimeTrajectory());
+                    _ptraj->SamplePointsSameDeltaTime(prealtimetraj->vsamples, _fRealTimeStep, true, _samplespec);
+                    prealtimetraj->dof = _samplespec.GetDOF();
+                    prealtimetraj->numsamples = prealtimetraj->vsamples.size()/prealtimetraj->dof;
+                    prealtimetraj->generation = ++_nRealTimeGeneration;
+                    prealtimetraj->blookahead = _fLookAheadTime > 0;
+                    _nRealTimeAppliedSample = -1;
+                    if( prealtimetraj->numsamples > 0 ) {
+                        _SetRealTimeTrajectory(prealtimetraj);
+                    }
+                }
+            }
+            if( _fLookAheadTime > 0 ) {
+                _StartLookAhead(probot);
+            }
             _bIsDone = false;
         }
 
@@ -261,7 +326,18 @@ If SetDesired is called, only joint values will be set at every timestep leaving
         }
         std::lock_guard<std::mutex> lock(_mutex);
         TrajectoryBaseConstPtr ptraj = _ptraj; // because of multi-threading setting issues
-        if( !!ptraj ) {
+        RealTimeTrajectoryConstPtr prealtimetraj = boost::atomic_load(&_prealtimetraj);
+        if( !!prealtimetraj ) {
+            // the real-time thread decides which sample is current and sets it when the environment is free, only catch up here
+            uint64_t published = _nRealTimePublishedSample.load(std::memory_order_acquire);
+            if( (published>>32) == prealtimetraj->generation ) {
+                _ApplyRealTimeSample(prealtimetraj, static_cast<int>(published&0xffffffff));
+            }
+        }
+        else if( !!ptraj && !_CheckLookAhead(_fCommandTime) ) {
+            // stopped before a collision or waiting for the look-ahead checks
+        }
+        else if( !!ptraj ) {
             RobotBasePtr probot = _probot.lock();
             vector<dReal> sampledata;
             ptraj->Sample(sampledata,_fCommandTime,_samplespec);
@@ -324,25 +400,7 @@ If SetDesired is called, only joint values will be set at every timestep leaving
                 }
             }
 
-            vector<dReal> vdofvalues;
-            if( _bTrajHasJoints && _dofindices.size() > 0 ) {
-                vdofvalues.resize(_dofindices.size());
-                _samplespec.ExtractJointValues(vdofvalues.begin(),sampledata.begin(), probot, _dofindices, 0);
-            }
-
-            Transform t;
-            if( _bTrajHasTransform && _nControlTransformation ) {
-                _samplespec.ExtractTransform(t,sampledata.begin(),probot);
-                if( vdofvalues.size() > 0 ) {
-                    _SetDOFValues(vdofvalues,t, _fCommandTime > 0 ? fTimeElapsed : 0);
-                }
-                else {
-                    probot->SetTransform(t);
-                }
-            }
-            else if( vdofvalues.size() > 0 ) {
-                _SetDOFValues(vdofvalues, _fCommandTime > 0 ? fTimeElapsed : 0);
-            }
+            _SetSampledValues(probot, sampledata.begin(), _fCommandTime > 0 ? fTimeElapsed : 0);
 
             // always release after setting dof values
             FOREACH(itbody,listrelease) {
@@ -364,6 +422,7 @@ If SetDesired is called, only joint values will be set at every timestep leaving
             if( bIsDone ) {
                 // trajectory is done, so reset it so that the controller doesn't continously set the dof values (which can get annoying)
                 _ptraj.reset();
+                _CancelLookAhead();
             }
         }
 
@@ -391,10 +450,74 @@ If SetDesired is called, only joint values will be set at every timestep leaving
     }
 
 private:
+    /// \brief trajectory pre-sampled for the real-time thread
+    struct RealTimeTrajectory
+    {
+        std::vector<dReal> vsamples; ///< samples in _samplespec every _fRealTimeStep, the last one is at the end of the trajectory
+        int dof = 0;
+        int numsamples = 0;
+        uint64_t generation = 0; ///< identifies the trajectory in _nRealTimePublishedSample
+        bool blookahead = false; ///< if true, the thread does not go past the samples checked by the look-ahead thread
+    };
+    typedef boost::shared_ptr<RealTimeTrajectory const> RealTimeTrajectoryConstPtr;
+
+    struct GrabBody
+    {
+        GrabBody() : offset(0), robotlinkindex(0) {
+        }
+        GrabBody(int offset_, int robotlinkindex_, KinBodyPtr pbody_) : offset(offset_), robotlinkindex(robotlinkindex_), pbody(pbody_) {
+        }
+        int offset;
+        int robotlinkindex;
+        KinBodyPtr pbody;
+        boost::shared_ptr<Transform> trelativepose; ///< relative pose of body with link when grabbed. if it doesn't exist, then do not pre-transform the pose
+    };
+
+    /// \brief trajectory checked by the look-ahead thread
+    struct LookAheadJob
+    {
+        TrajectoryBasePtr ptraj; ///< copy of the trajectory in _pLookAheadEnv
+        ConfigurationSpecification spec;
+        std::string robotname;
+        std::vector<int> dofindices;
+        bool bHasJoints = false, bHasTransform = false;
+        std::vector< pair<int, int> > vgrablinks; ///< see _vgrablinks
+        std::vector<GrabBody> vgrabbodylinks; ///< see _vgrabbodylinks, the bodies are in the cloned environment
+        dReal flookahead = 0, fstep = 0;
+        uint64_t generation = 0;
+    };
+
+    /// \brief identifies the state of the environment that _pLookAheadEnv was cloned from
+    struct LookAheadEnvStamp
+    {
+        std::vector< pair<int, int> > vbodystamps; ///< (environment body index, update stamp) of the bodies, -1 for the robot and the bodies it grabs since the job sets their state
+        std::string robothash; ///< kinematics geometry hash of the robot
+        std::vector<KinBody::GrabbedInfo> vgrabbedinfos; ///< grabbed bodies of the robot
+        bool operator==(const LookAheadEnvStamp& r) const {
+            return vbodystamps == r.vbodystamps && robothash == r.robothash && vgrabbedinfos == r.vgrabbedinfos;
+        }
+    };
+
     virtual bool _Pause(std::ostream& os, std::istream& is)
     {
-        is >> _bPause;
-        return !!is;
+        bool bPause = false;
+        is >> bPause;
+        if( !is ) {
+            return false;
+        }
+        _bPause = bPause;
+        return true;
+    }
+    virtual bool _SetSpeed(std::ostream& os, std::istream& is)
+    {
+        dReal fspeed = 1;
+        is >> fspeed;
+        if( !is ) {
+            return false;
+        }
+        OPENRAVE_ASSERT_OP(fspeed, >=, 0);
+        _fSpeed = fspeed;
+        return true;
     }
     virtual bool _SetCheckCollisions(std::ostream& os, std::istream& is)
     {
@@ -406,13 +529,83 @@ private:
     }
     virtual bool _SetThrowExceptions(std::ostream& os, std::istream& is)
     {
-        is >> _bThrowExceptions;
-        return !!is;
+        bool bThrowExceptions = false;
+        is >> bThrowExceptions;
+        if( !is ) {
+            return false;
+        }
+        _bThrowExceptions = bThrowExceptions;
+        return true;
     }
     virtual bool _SetEnableLogging(std::ostream& os, std::istream& is)
     {
         is >> _bEnableLogging;
-        return !!is;
+        if( !is ) {
+            return false;
+        }
+        // the rest are the optional compression arguments
+        _sLoggingCompression.clear();
+        std::string token;
+        while( is >> token ) {
+            if( _sLoggingCompression.size() > 0 ) {
+                _sLoggingCompression += " ";
+            }
+            _sLoggingCompression += token;
+        }
+        return true;
+    }
+
+    virtual bool _SetRealTimeRate(std::ostream& os, std::istream& is)
+    {
+        dReal frate = 0;
+        is >> frate;
+        if( !is ) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        _StopRealTimeThread();
+        // trajectories sampled at the previous rate continue in the simulation thread
+        _SetRealTimeTrajectory(RealTimeTrajectoryConstPtr());
+        _nRealTimeCycles = 0;
+        _nRealTimeOverruns = 0;
+        _nRealTimeJitterSum = 0;
+        _nRealTimeJitterMax = 0;
+        _fRealTimeStep = frate > 0 ? 1/frate : 0;
+        if( _fRealTimeStep > 0 ) {
+            _bRealTimeRunning = true;
+            _threadRealTime = std::thread(boost::bind(&IdealController::_RealTimeThread, this, _fRealTimeStep));
+        }
+        return true;
+    }
+    virtual bool _SetLookAheadCollisionChecking(std::ostream& os, std::istream& is)
+    {
+        dReal flookahead = 0, fstep = 0.01;
+        is >> flookahead;
+        if( !is ) {
+            return false;
+        }
+        if( !(is >> fstep) ) {
+            fstep = 0.01;
+        }
+        OPENRAVE_ASSERT_OP(fstep, >, 0);
+        std::lock_guard<std::mutex> lock(_mutex);
+        // only the following trajectories are checked
+        _StopLookAheadThread();
+        _fLookAheadTime = flookahead;
+        _fLookAheadStep = fstep;
+        if( _fLookAheadTime > 0 ) {
+            _bStopLookAhead = false;
+            _threadLookAhead = std::thread(boost::bind(&IdealController::_LookAheadThread, this));
+        }
+        return true;
+    }
+    virtual bool _GetRealTimeStats(std::ostream& os, std::istream& is)
+    {
+        uint64_t numcycles = _nRealTimeCycles.load(std::memory_order_relaxed);
+        os << numcycles << " " << _nRealTimeOverruns.load(std::memory_order_relaxed) << " "
+           << (numcycles > 0 ? 1e-9*_nRealTimeJitterSum.load(std::memory_order_relaxed)/numcycles : 0) << " "
+           << 1e-9*_nRealTimeJitterMax.load(std::memory_order_relaxed);
+        return true;
     }
 
     inline boost::shared_ptr<IdealController> shared_controller() {
@@ -425,6 +618,439 @@ private:
         return shared_controller();
     }
 
+    /// \brief advances through the samples of _prealtimetraj every fstep seconds and publishes the current sample.
+    ///
+    /// Advances by _fSpeed samples every period and not at all while paused. Missed periods are skipped so that the samples follow the wall clock.
+    /// Only sets the sample if the environment and _mutex can be locked without waiting, so a busy environment never delays the thread.
+    void _RealTimeThread(dReal fstep)
+    {
+        typedef std::chrono::steady_clock Clock;
+        const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(fstep));
+        Clock::time_point deadline = Clock::now();
+        RealTimeTrajectoryConstPtr prealtimetraj;
+        dReal fsample = 0; ///< fractional position in the samples of prealtimetraj
+        int isample = 0;
+        while( _bRealTimeRunning ) {
+            deadline += period;
+            std::this_thread::sleep_until(deadline);
+            Clock::duration delay = Clock::now() - deadline;
+            if( delay < Clock::duration::zero() ) {
+                delay = Clock::duration::zero();
+            }
+            int64_t nmissed = delay/period;
+            uint64_t jitter = std::chrono::duration_cast<std::chrono::nanoseconds>(delay).count();
+            _nRealTimeCycles.fetch_add(1, std::memory_order_relaxed);
+            _nRealTimeJitterSum.fetch_add(jitter, std::memory_order_relaxed);
+            if( jitter > _nRealTimeJitterMax.load(std::memory_order_relaxed) ) {
+                _nRealTimeJitterMax.store(jitter, std::memory_order_relaxed); // only this thread writes it
+            }
+            if( nmissed > 0 ) {
+                _nRealTimeOverruns.fetch_add(1, std::memory_order_relaxed);
+                deadline += nmissed*period;
+            }
+
+            RealTimeTrajectoryConstPtr pnewtraj = boost::atomic_load(&_prealtimetraj);
+            if( pnewtraj != prealtimetraj ) {
+                prealtimetraj = pnewtraj;
+                fsample = 0;
+                isample = 0;
+            }
+            else if( !!prealtimetraj && !_bPause ) {
+                fsample = std::min(fsample + (1 + nmissed)*_fSpeed.load(std::memory_order_relaxed), dReal(prealtimetraj->numsamples-1));
+                if( prealtimetraj->blookahead && _fLookAheadCollisionTime.load(std::memory_order_acquire) == std::numeric_limits<dReal>::infinity() ) {
+                    // wait at the last checked sample instead of skipping the samples that could not be checked in time. once a
+                    // collision is found, _CheckLookAhead stops the trajectory when the index passes the checked samples.
+                    fsample = std::min(fsample, std::max(dReal(0), std::floor(_fLookAheadCheckedTime.load(std::memory_order_acquire)/fstep)));
+                }
+                isample = static_cast<int>(fsample);
+            }
+            if( !!prealtimetraj ) {
+                _nRealTimePublishedSample.store((prealtimetraj->generation<<32)|static_cast<uint64_t>(isample), std::memory_order_release);
+                // exceptions are left to SimulationStep so that they reach the simulation thread
+                if( !_bPause && !_bThrowExceptions ) {
+                    EnvironmentLock lockenv(GetEnv()->GetMutex(), OpenRAVE::try_to_lock_t());
+                    if( !!lockenv ) {
+                        std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+                        if( !!lock && boost::atomic_load(&_prealtimetraj) == prealtimetraj ) {
+                            try {
+                                _ApplyRealTimeSample(prealtimetraj, isample);
+                            }
+                            catch(const std::exception& ex) {
+                                RAVELOG_WARN_FORMAT("failed to set real-time sample %d: %s", isample%ex.what());
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /// \brief sets sample isample of prealtimetraj if it is not set yet. The environment and _mutex should be locked.
+    void _ApplyRealTimeSample(RealTimeTrajectoryConstPtr prealtimetraj, int isample)
+    {
+        if( isample == _nRealTimeAppliedSample || !_CheckLookAhead(isample*_fRealTimeStep) ) {
+            return;
+        }
+        RobotBasePtr probot = _probot.lock();
+        if( !probot ) {
+            return;
+        }
+        dReal timeelapsed = _nRealTimeAppliedSample >= 0 ? (isample-_nRealTimeAppliedSample)*_fRealTimeStep : 0;
+        _nRealTimeAppliedSample = isample;
+        _fCommandTime = isample*_fRealTimeStep;
+        _SetSampledValues(probot, prealtimetraj->vsamples.begin()+isample*prealtimetraj->dof, timeelapsed);
+        if( isample+1 >= prealtimetraj->numsamples ) {
+            if( !!_ptraj ) {
+                _fCommandTime = _ptraj->GetDuration();
+            }
+            _bIsDone = true;
+            _ptraj.reset();
+            _SetRealTimeTrajectory(RealTimeTrajectoryConstPtr());
+            _CancelLookAhead();
+        }
+    }
+
+    void _StopRealTimeThread()
+    {
+        _bRealTimeRunning = false;
+        if( _threadRealTime.joinable() ) {
+            _threadRealTime.join();
+        }
+    }
+
+    inline void _SetRealTimeTrajectory(RealTimeTrajectoryConstPtr prealtimetraj)
+    {
+        boost::atomic_store(&_prealtimetraj, prealtimetraj);
+    }
+
+    /// \brief starts checking _ptraj ahead of the execution in a clone of the environment. Environment should be locked.
+    ///
+    /// Cloning is expensive, so the clone is reused when no other body changed since it was made. Only the state of the robot is set then.
+    void _StartLookAhead(RobotBasePtr probot)
+    {
+        boost::shared_ptr<LookAheadJob> pjob(new LookAheadJob());
+        {
+            std::lock_guard<std::mutex> lock(_mutexLookAhead);
+            pjob->generation = ++_nLookAheadGeneration;
+            _pLookAheadJob.reset();
+            _fLookAheadCommandTime = 0;
+            _fLookAheadCheckedTime = -1;
+            _fLookAheadCollisionTime = std::numeric_limits<dReal>::infinity();
+        }
+        LookAheadEnvStamp envstamp;
+        _GetLookAheadEnvStamp(probot, envstamp);
+        if( !_pLookAheadEnv ) {
+            _pLookAheadEnv = GetEnv()->CloneSelf(Clone_Bodies);
+            _bLookAheadEnvGrabbed = false;
+        }
+        else {
+            // the thread cannot be checking the previous job while holding the lock
+            EnvironmentLock lockclone(_pLookAheadEnv->GetMutex());
+            RobotBasePtr pclonerobot = _pLookAheadEnv->GetRobot(probot->GetName());
+            if( !pclonerobot || _bLookAheadEnvGrabbed || !(envstamp == _lookAheadEnvStamp) ) {
+                _pLookAheadEnv->Clone(GetEnv(), Clone_Bodies);
+            }
+            else {
+                std::vector<dReal> vdofvalues;
+                std::vector<uint8_t> venablestates;
+                probot->GetDOFValues(vdofvalues);
+                probot->GetLinkEnableStates(venablestates);
+                pclonerobot->SetLinkEnableStates(venablestates);
+                pclonerobot->SetDOFValues(vdofvalues, probot->GetTransform(), KinBody::CLA_Nothing);
+            }
+            // jobs of older generations stop before changing the clone, so they cannot set it again
+            _bLookAheadEnvGrabbed = false;
+        }
+        _lookAheadEnvStamp = envstamp;
+        pjob->ptraj = RaveCreateTrajectory(_pLookAheadEnv, _ptraj->GetXMLId());
+        pjob->ptraj->Clone(_ptraj, 0);
+        pjob->spec = _samplespec;
+        pjob->robotname = probot->GetName();
+        pjob->dofindices = _dofindices;
+        pjob->bHasJoints = _bTrajHasJoints && _dofindices.size() > 0;
+        pjob->bHasTransform = _bTrajHasTransform && _nControlTransformation;
+        pjob->vgrablinks = _vgrablinks;
+        FOREACHC(itgrabinfo, _vgrabbodylinks) {
+            // environment body indices are kept by cloning
+            KinBodyPtr pclonebody = _pLookAheadEnv->GetBodyFromEnvironmentBodyIndex(itgrabinfo->pbody->GetEnvironmentBodyIndex());
+            if( !!pclonebody ) {
+                pjob->vgrabbodylinks.push_back(*itgrabinfo);
+                pjob->vgrabbodylinks.back().pbody = pclonebody;
+            }
+        }
+        pjob->flookahead = _fLookAheadTime;
+        pjob->fstep = _fLookAheadStep;
+        {
+            std::lock_guard<std::mutex> lock(_mutexLookAhead);
+            _pLookAheadJob = pjob;
+        }
+        _bLookAheadActive = true;
+        _condLookAhead.notify_all();
+    }
+
+    /// \brief gets the stamp of the bodies of the environment that affect the look-ahead checks of probot. Environment should be locked.
+    void _GetLookAheadEnvStamp(RobotBasePtr probot, LookAheadEnvStamp& envstamp)
+    {
+        std::vector<KinBodyPtr> vbodies;
+        GetEnv()->GetBodies(vbodies);
+        probot->GetGrabbedInfo(envstamp.vgrabbedinfos);
+        envstamp.robothash = probot->GetKinematicsGeometryHash();
+        envstamp.vbodystamps.resize(0);
+        envstamp.vbodystamps.reserve(vbodies.size());
+        FOREACHC(itbody, vbodies) {
+            bool bSetByJob = *itbody == probot || !!probot->IsGrabbing(**itbody);
+            envstamp.vbodystamps.emplace_back((*itbody)->GetEnvironmentBodyIndex(), bSetByJob ? -1 : (*itbody)->GetUpdateStamp());
+        }
+    }
+
+    /// \brief stops checking the current trajectory
+    void _CancelLookAhead()
+    {
+        _bLookAheadActive = false;
+        {
+            std::lock_guard<std::mutex> lock(_mutexLookAhead);
+            ++_nLookAheadGeneration;
+            _pLookAheadJob.reset();
+            // nothing is checked until the next job starts
+            _fLookAheadCheckedTime.store(-1, std::memory_order_release);
+            _fLookAheadCollisionTime.store(std::numeric_limits<dReal>::infinity(), std::memory_order_release);
+        }
+        _condLookAhead.notify_all();
+    }
+
+    /// \brief returns true if the trajectory can be set at ftime according to the look-ahead checks.
+    ///
+    /// Only reads the results of the look-ahead thread. If a collision is coming, stops the trajectory and reports the error.
+    bool _CheckLookAhead(dReal ftime)
+    {
+        if( !_bLookAheadActive ) {
+            return true;
+        }
+        {
+            // the look-ahead thread waits for the command time to advance
+            std::lock_guard<std::mutex> lock(_mutexLookAhead);
+            _fLookAheadCommandTime.store(ftime, std::memory_order_relaxed);
+        }
+        _condLookAhead.notify_all();
+        dReal fcollisiontime = _fLookAheadCollisionTime.load(std::memory_order_acquire);
+        if( ftime > fcollisiontime - _fLookAheadStep ) {
+            std::string collision;
+            {
+                std::lock_guard<std::mutex> lock(_mutexLookAhead);
+                collision = _sLookAheadCollision;
+            }
+            RobotBasePtr probot = _probot.lock();
+            _ptraj.reset();
+            _SetRealTimeTrajectory(RealTimeTrajectoryConstPtr());
+            _CancelLookAhead();
+            _bIsDone = true;
+            _ReportError(str(boost::format("robot %s stopped at time %f before collision at time %f: %s")%(!probot ? std::string() : probot->GetName())%ftime%fcollisiontime%collision));
+            return false;
+        }
+        return ftime <= _fLookAheadCheckedTime.load(std::memory_order_acquire);
+    }
+
+    void _LookAheadThread()
+    {
+        uint64_t generation = 0;
+        while( true ) {
+            boost::shared_ptr<LookAheadJob> pjob;
+            {
+                std::unique_lock<std::mutex> lock(_mutexLookAhead);
+                _condLookAhead.wait(lock, [&]() {
+                    return _bStopLookAhead || (!!_pLookAheadJob && _pLookAheadJob->generation != generation);
+                });
+                if( _bStopLookAhead ) {
+                    return;
+                }
+                pjob = _pLookAheadJob;
+                generation = pjob->generation;
+            }
+            try {
+                _RunLookAheadJob(pjob);
+            }
+            catch(const std::exception& ex) {
+                // cannot validate the rest of the trajectory, so stop it
+                std::lock_guard<std::mutex> lock(_mutexLookAhead);
+                if( _nLookAheadGeneration == pjob->generation ) {
+                    _sLookAheadCollision = str(boost::format("look-ahead checking failed: %s")%ex.what());
+                    _fLookAheadCollisionTime.store(_fLookAheadCheckedTime.load() + pjob->fstep, std::memory_order_release);
+                }
+            }
+        }
+    }
+
+    /// \brief checks the configurations of the job every fstep until a collision or the end of the trajectory, staying at most flookahead ahead of _fLookAheadCommandTime
+    void _RunLookAheadJob(boost::shared_ptr<LookAheadJob> pjob)
+    {
+        EnvironmentBasePtr penv = pjob->ptraj->GetEnv();
+        CollisionReportPtr report(new CollisionReport());
+        std::vector<dReal> vsample, vdofvalues(pjob->dofindices.size());
+        const dReal fduration = pjob->ptraj->GetDuration();
+        for(int istep = 0; ; ++istep) {
+            dReal ftime = std::min(istep*pjob->fstep, fduration);
+            if( ftime > _fLookAheadCommandTime.load(std::memory_order_relaxed) + pjob->flookahead ) {
+                // _CheckLookAhead notifies when the command time advances, _StartLookAhead, _CancelLookAhead and _StopLookAheadThread when the job ends
+                std::unique_lock<std::mutex> lock(_mutexLookAhead);
+                _condLookAhead.wait(lock, [&]() {
+                    return _nLookAheadGeneration != pjob->generation || _bStopLookAhead || ftime <= _fLookAheadCommandTime.load(std::memory_order_relaxed) + pjob->flookahead;
+                });
+                if( _nLookAheadGeneration != pjob->generation || _bStopLookAhead ) {
+                    return;
+                }
+            }
+
+            bool bcollision = false;
+            {
+                EnvironmentLock lockenv(penv->GetMutex());
+                if( _nLookAheadGeneration != pjob->generation || _bStopLookAhead ) {
+                    return;
+                }
+                RobotBasePtr probot = penv->GetRobot(pjob->robotname);
+                if( !probot ) {
+                    throw OPENRAVE_EXCEPTION_FORMAT("cannot find robot %s in cloned environment", pjob->robotname, ORE_InvalidState);
+                }
+                pjob->ptraj->Sample(vsample, ftime, pjob->spec);
+                if( pjob->bHasTransform ) {
+                    Transform t;
+                    pjob->spec.ExtractTransform(t, vsample.begin(), probot);
+                    probot->SetTransform(t);
+                }
+                if( pjob->bHasJoints ) {
+                    pjob->spec.ExtractJointValues(vdofvalues.begin(), vsample.begin(), probot, pjob->dofindices, 0);
+                    probot->SetDOFValues(vdofvalues, KinBody::CLA_Nothing, pjob->dofindices);
+                }
+                if( pjob->vgrablinks.size() > 0 || pjob->vgrabbodylinks.size() > 0 ) {
+                    _ApplyLookAheadGrabs(*pjob, probot, vsample);
+                }
+                bcollision = penv->CheckCollision(KinBodyConstPtr(probot), report) || probot->CheckSelfCollision(report);
+            }
+
+            std::lock_guard<std::mutex> lock(_mutexLookAhead);
+            if( _nLookAheadGeneration != pjob->generation ) {
+                return;
+            }
+            if( bcollision ) {
+                _sLookAheadCollision = report->__str__();
+                _fLookAheadCollisionTime.store(ftime, std::memory_order_release);
+                return;
+            }
+            if( ftime >= fduration ) {
+                _fLookAheadCheckedTime.store(std::numeric_limits<dReal>::infinity(), std::memory_order_release);
+                return;
+            }
+            _fLookAheadCheckedTime.store(ftime, std::memory_order_release);
+        }
+    }
+
+    /// \brief grabs and releases the bodies of the grab groups of vsample in the cloned environment like SimulationStep, so that
+    /// the bodies about to be grabbed are not reported as collisions. Cloned environment should be locked.
+    void _ApplyLookAheadGrabs(const LookAheadJob& job, RobotBasePtr probot, const std::vector<dReal>& vsample)
+    {
+        EnvironmentBasePtr penv = probot->GetEnv();
+        list<KinBodyPtr> listrelease;
+        list<pair<KinBodyPtr, KinBody::LinkPtr> > listgrab;
+        list<const GrabBody*> listgrabbodies;
+        FOREACHC(itgrabinfo, job.vgrablinks) {
+            int bodyid = int(std::floor(vsample.at(itgrabinfo->first)+0.5));
+            if( bodyid == 0 ) {
+                continue;
+            }
+            KinBodyPtr pbody = penv->GetBodyFromEnvironmentBodyIndex(abs(bodyid));
+            if( !pbody ) {
+                continue;
+            }
+            KinBody::LinkPtr pgrabbinglink = probot->IsGrabbing(*pbody);
+            if( bodyid < 0 ) {
+                if( !!pgrabbinglink ) {
+                    listrelease.push_back(pbody);
+                }
+            }
+            else if( !pgrabbinglink || pgrabbinglink->GetIndex() != itgrabinfo->second ) {
+                if( !!pgrabbinglink ) {
+                    listrelease.push_back(pbody);
+                }
+                listgrab.emplace_back(pbody, probot->GetLinks().at(itgrabinfo->second));
+            }
+        }
+        FOREACHC(itgrabinfo, job.vgrabbodylinks) {
+            int dograb = int(std::floor(vsample.at(itgrabinfo->offset)+0.5));
+            KinBody::LinkPtr pgrabbinglink = probot->IsGrabbing(*itgrabinfo->pbody);
+            if( dograb <= 0 ) {
+                if( !!pgrabbinglink ) {
+                    listrelease.push_back(itgrabinfo->pbody);
+                }
+            }
+            else if( !pgrabbinglink ) {
+                // SimulationStep grabs again at the same relative pose every step, so grabbing once is enough
+                listgrabbodies.push_back(&*itgrabinfo);
+            }
+        }
+        if( listrelease.empty() && listgrab.empty() && listgrabbodies.empty() ) {
+            return;
+        }
+        _bLookAheadEnvGrabbed = true;
+        FOREACH(itbody, listrelease) {
+            probot->Release(**itbody);
+        }
+        FOREACH(itgrabinfo, listgrabbodies) {
+            KinBody::LinkPtr plink = probot->GetLinks().at((*itgrabinfo)->robotlinkindex);
+            if( !!(*itgrabinfo)->trelativepose ) {
+                (*itgrabinfo)->pbody->SetTransform(plink->GetTransform() * *(*itgrabinfo)->trelativepose);
+            }
+            probot->Grab((*itgrabinfo)->pbody, plink, rapidjson::Value());
+        }
+        FOREACH(it, listgrab) {
+            probot->Grab(it->first, it->second, rapidjson::Value());
+        }
+    }
+
+    void _StopLookAheadThread()
+    {
+        _bLookAheadActive = false;
+        {
+            std::lock_guard<std::mutex> lock(_mutexLookAhead);
+            _bStopLookAhead = true;
+            ++_nLookAheadGeneration;
+            _pLookAheadJob.reset();
+            // the real-time thread does not wait for checks anymore
+            _fLookAheadCheckedTime.store(std::numeric_limits<dReal>::infinity(), std::memory_order_release);
+            _fLookAheadCollisionTime.store(std::numeric_limits<dReal>::infinity(), std::memory_order_release);
+        }
+        _condLookAhead.notify_all();
+        if( _threadLookAhead.joinable() ) {
+            _threadLookAhead.join();
+        }
+        if( !!_pLookAheadEnv ) {
+            _pLookAheadEnv->Destroy();
+            _pLookAheadEnv.reset();
+        }
+    }
+
+    /// \brief sets the joint values and transform of a sample of _samplespec
+    void _SetSampledValues(RobotBasePtr probot, std::vector<dReal>::const_iterator itdata, dReal timeelapsed)
+    {
+        vector<dReal> vdofvalues;
+        if( _bTrajHasJoints && _dofindices.size() > 0 ) {
+            vdofvalues.resize(_dofindices.size());
+            _samplespec.ExtractJointValues(vdofvalues.begin(),itdata, probot, _dofindices, 0);
+        }
+
+        Transform t;
+        if( _bTrajHasTransform && _nControlTransformation ) {
+            _samplespec.ExtractTransform(t,itdata,probot);
+            if( vdofvalues.size() > 0 ) {
+                _SetDOFValues(vdofvalues,t, timeelapsed);
+            }
+            else {
+                probot->SetTransform(t);
+            }
+        }
+        else if( vdofvalues.size() > 0 ) {
+            _SetDOFValues(vdofvalues, timeelapsed);
+        }
+    }
+
     virtual void _SetJointLimits()
     {
         RobotBasePtr probot = _probot.lock();
@@ -530,21 +1156,10 @@ private:
     }
 
     RobotBaseWeakPtr _probot;               ///< controlled body
-    dReal _fSpeed;                    ///< how fast the robot should go
+    std::atomic<dReal> _fSpeed;                    ///< how fast the robot should go, also read by the real-time thread
     TrajectoryBasePtr _ptraj;         ///< computed trajectory robot needs to follow in chunks of _pbody->GetDOF()
     bool _bTrajHasJoints, _bTrajHasTransform;
     std::vector< pair<int, int> > _vgrablinks; /// (data offset, link index) pairs
-    struct GrabBody
-    {
-        GrabBody() : offset(0), robotlinkindex(0) {
-        }
-        GrabBody(int offset_, int robotlinkindex_, KinBodyPtr pbody_) : offset(offset_), robotlinkindex(robotlinkindex_), pbody(pbody_) {
-        }
-        int offset;
-        int robotlinkindex;
-        KinBodyPtr pbody;
-        boost::shared_ptr<Transform> trelativepose; ///< relative pose of body with link when grabbed. if it doesn't exist, then do not pre-transform the pose
-    };
     std::vector<GrabBody> _vgrabbodylinks;
     dReal _fCommandTime;
 
@@ -556,13 +1171,44 @@ private:
     boost::array< std::vector<dReal>, 3> _vlower, _vupper; ///< position, velocity, acceleration limits
     int _nControlTransformation;
     ofstream flog;
+    std::string _sLoggingCompression; ///< arguments to the trajectory Compress command for logged trajectories. If empty, logs uncompressed.
     int cmdid;
-    bool _bPause, _bIsDone, _bCheckCollision, _bThrowExceptions, _bEnableLogging;
+    std::atomic<bool> _bPause; ///< also read by the real-time thread
+    bool _bIsDone, _bCheckCollision;
+    std::atomic<bool> _bThrowExceptions; ///< also read by the real-time thread
+    bool _bEnableLogging;
     CollisionReportPtr _report;
     UserDataPtr _cblimits;
     ConfigurationSpecification _samplespec;
     boost::shared_ptr<ConfigurationSpecification::Group> _gjointvalues, _gtransform;
     std::mutex _mutex;
+
+    RealTimeTrajectoryConstPtr _prealtimetraj; ///< only accessed with boost::atomic_load/atomic_store
+    dReal _fRealTimeStep = 0; ///< period of the real-time thread, 0 if not running
+    std::thread _threadRealTime;
+    std::atomic<bool> _bRealTimeRunning{false};
+    std::atomic<uint64_t> _nRealTimePublishedSample{0}; ///< (generation<<32)|sample index of the last sample reached by the real-time thread
+    uint64_t _nRealTimeGeneration = 0;
+    int _nRealTimeAppliedSample = -1; ///< sample last set, protected by _mutex
+    std::atomic<uint64_t> _nRealTimeCycles{0}, _nRealTimeOverruns{0};
+    std::atomic<uint64_t> _nRealTimeJitterSum{0}, _nRealTimeJitterMax{0}; ///< in nanoseconds
+
+    dReal _fLookAheadTime = 0; ///< how far ahead the trajectory is checked for collisions, 0 if not checked. Protected by _mutex
+    dReal _fLookAheadStep = 0.01; ///< time step of the look-ahead checks
+    EnvironmentBasePtr _pLookAheadEnv; ///< clone of the environment used by the look-ahead thread
+    std::thread _threadLookAhead;
+    std::mutex _mutexLookAhead; ///< protects the following members. The atomic ones are only written with it locked.
+    std::condition_variable _condLookAhead;
+    boost::shared_ptr<LookAheadJob> _pLookAheadJob;
+    std::atomic<uint64_t> _nLookAheadGeneration{0};
+    std::atomic<bool> _bStopLookAhead{false};
+    bool _bLookAheadActive = false; ///< true if the current trajectory is being checked, protected by _mutex
+    LookAheadEnvStamp _lookAheadEnvStamp; ///< state of the environment when _pLookAheadEnv was cloned
+    std::atomic<bool> _bLookAheadEnvGrabbed{false}; ///< true if the look-ahead thread grabbed or released bodies in _pLookAheadEnv since it was cloned
+    std::string _sLookAheadCollision; ///< description of the collision at _fLookAheadCollisionTime
+    std::atomic<dReal> _fLookAheadCommandTime{0}; ///< last time set by the controller
+    std::atomic<dReal> _fLookAheadCheckedTime{-1}; ///< the trajectory is collision-free up to this time
+    std::atomic<dReal> _fLookAheadCollisionTime{std::numeric_limits<dReal>::infinity()}; ///< first checked time in collision
 };
 
 ControllerBasePtr CreateIdealController(EnvironmentBasePtr penv, std::istream& sinput)
@@ -135,8 +135,9 @@ FCLSpace::FCLKinBodyInfoPtr FCLSpace::InitKinBody(KinBodyConstPtr pbody, FCLKinB
             const std::vector<KinBody::Link::GeometryPtr> & vgeometries = plink->GetGeometries();
             FOREACH(itgeom, vgeometries) {
                 const KinBody::GeometryPtr& pgeom = *itgeom;
-                const KinBody::GeometryInfo& geominfo = pgeom->GetInfo();
-                const CollisionGeometryPtr pfclgeom = _CreateFCLGeomFromGeometryInfo(geominfo);
+                // cloned trimeshes are only held by the shared buffer, reading them from the info would copy them
+                const OpenRAVE::TriMeshBufferConstPtr pmeshbuffer = pgeom->GetCollisionMeshBuffer();
+                const CollisionGeometryPtr pfclgeom = !!pmeshbuffer ? _CreateFCLGeomFromTriMeshBuffer(*pmeshbuffer) : _CreateFCLGeomFromGeometryInfo(pgeom->GetInfo());
 
                 if( !pfclgeom ) {
                     continue;
@@ -151,14 +152,13 @@ FCLSpace::FCLKinBodyInfoPtr FCLSpace::InitKinBody(KinBodyConstPtr pbody, FCLKinB
                 CollisionObjectPtr pfclcoll = boost::make_shared<fcl::CollisionObject>(pfclgeom);
                 pfclcoll->setUserData(linkinfo.get());
 
-                linkinfo->vgeoms.push_back(TransformCollisionPair(geominfo.GetTransform(), pfclcoll));
+                linkinfo->vgeoms.push_back(TransformCollisionPair(pgeom->GetTransform(), pfclcoll));
 
-                KinBody::Link::Geometry _tmpgeometry(boost::shared_ptr<KinBody::Link>(), geominfo);
                 if( itgeom == vgeometries.begin() ) {
-                    enclosingBV = ConvertAABBToFcl(_tmpgeometry.ComputeAABB(Transform()));
+                    enclosingBV = ConvertAABBToFcl(pgeom->ComputeAABB(Transform()));
                 }
                 else {
-                    enclosingBV += ConvertAABBToFcl(_tmpgeometry.ComputeAABB(Transform()));
+                    enclosingBV += ConvertAABBToFcl(pgeom->ComputeAABB(Transform()));
                 }
             }
         }
@@ -562,6 +562,27 @@ CollisionGeometryPtr FCLSpace::_CreateFCLGeomFromGeometryInfo(const KinBody::Geo
     }
 }
 
+CollisionGeometryPtr FCLSpace::_CreateFCLGeomFromTriMeshBuffer(const OpenRAVE::TriMeshBuffer& meshbuffer)
+{
+    if( meshbuffer.GetNumVertices() == 0 || meshbuffer.GetNumIndices() == 0 ) {
+        return CollisionGeometryPtr();
+    }
+
+    OPENRAVE_ASSERT_OP(meshbuffer.GetNumIndices() % 3, ==, 0);
+    std::vector<fcl::Vec3f> fcl_points(meshbuffer.GetNumVertices());
+    const OpenRAVE::dReal* pvertices = meshbuffer.GetVertexData();
+    for (size_t ipoint = 0; ipoint < fcl_points.size(); ++ipoint) {
+        fcl_points[ipoint] = fcl::Vec3f(pvertices[3*ipoint], pvertices[3*ipoint+1], pvertices[3*ipoint+2]);
+    }
+
+    std::vector<fcl::Triangle> fcl_triangles(meshbuffer.GetNumIndices() / 3);
+    for (size_t itri = 0; itri < fcl_triangles.size(); ++itri) {
+        fcl_triangles[itri] = fcl::Triangle(meshbuffer.GetIndex(3*itri), meshbuffer.GetIndex(3*itri+1), meshbuffer.GetIndex(3*itri+2));
+    }
+
+    return _meshFactory(fcl_points, fcl_triangles);
+}
+
 void FCLSpace::_Synchronize(FCLKinBodyInfo& info, const KinBody& body)
 {
     //KinBodyPtr pbody = info.GetBody();
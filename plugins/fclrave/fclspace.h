@@ -265,6 +265,9 @@ private:
     // what about the tests on non-zero size (eg. box extents) ?
     CollisionGeometryPtr _CreateFCLGeomFromGeometryInfo(const KinBody::GeometryInfo &info);
 
+    /// \brief converts the mesh that a cloned trimesh geometry shares with its original, see KinBody::Geometry::GetCollisionMeshBuffer
+    CollisionGeometryPtr _CreateFCLGeomFromTriMeshBuffer(const OpenRAVE::TriMeshBuffer& meshbuffer);
+
     /// \brief pass in info.GetBody() as a reference to avoid dereferencing the weak pointer in FCLKinBodyInfo
     void _Synchronize(FCLKinBodyInfo& info, const KinBody& body);
 
@@ -16,8 +16,10 @@
 #include "plugindefs.h"
 
 #include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
+#include <thread>
 #include <cmath>
 #include <boost/bind/bind.hpp>
 
@@ -86,15 +88,18 @@ public:
         RegisterCommand("Grasp",boost::bind(&GrasperModule::_GraspCommand,this,_1,_2),
                         "Performs a grasp and returns contact points");
         RegisterCommand("GraspThreaded",boost::bind(&GrasperModule::_GraspThreadedCommand,this,_1,_2),
-                        "Parllelizes the computation of the grasp planning and force closure. Number of threads can be specified with 'numthreads'.");
+                        "Parllelizes the computation of the grasp planning and force closure. Number of threads can be specified with 'numthreads'. The worker threads and their environments are kept between calls.");
         RegisterCommand("ComputeDistanceMap",boost::bind(&GrasperModule::_ComputeDistanceMapCommand,this,_1,_2),
                         "Computes a distance map around a particular point in space");
         RegisterCommand("GetStableContacts",boost::bind(&GrasperModule::_GetStableContactsCommand,this,_1,_2),
                         "Returns the stable contacts as defined by the closing direction");
+        RegisterCommand("ComputeGraspQualities",boost::bind(&GrasperModule::_ComputeGraspQualitiesCommand,this,_1,_2),
+                        "Given the contacts of many grasps, returns the force closure epsilon (distance of the origin to the boundary of the wrench space convex hull) and the volume of each grasp");
         RegisterCommand("ConvexHull",boost::bind(&GrasperModule::_ConvexHullCommand,this,_1,_2),
                         "Given a point cloud, returns information about its convex hull like normal planes, vertex indices, and triangle indices. Computed planes point outside the mesh, face indices are not ordered, triangles point outside the mesh (counter-clockwise)");
     }
     virtual ~GrasperModule() {
+        _StopGraspWorkers();
         if( !!outfile )
             fclose(outfile);
         if( !!errfile )
@@ -103,6 +108,7 @@ public:
 
     virtual void Destroy()
     {
+        _StopGraspWorkers();
         _planner.reset();
         _robot.reset();
     }
@@ -156,6 +162,8 @@ public:
         bool bComputeForceClosure = false;
         bool bOutputFinal = false;
         dReal friction = 0;
+        int nfrictionconefacets = 8;
+        dReal ftargetdistancefieldresolution = 0;
 
         GraspParametersPtr params(new GraspParameters(GetEnv()));
         params->bavoidcontact = false;
@@ -259,6 +267,16 @@ public:
                 // initialization
                 sinput >> friction;
             }
+            else if( cmd == "frictionconefacets" ) {
+                sinput >> nfrictionconefacets;
+                if( !!sinput && nfrictionconefacets < 3 ) {
+                    RAVELOG_ERROR_FORMAT("frictionconefacets needs at least 3 facets, got %d", nfrictionconefacets);
+                    return false;
+                }
+            }
+            else if( cmd == "targetdistancefield" ) {
+                sinput >> ftargetdistancefieldresolution;
+            }
             else if( cmd == "getlinkcollisions" ) {
                 // ignore
                 bGetLinkCollisions = true;
@@ -330,6 +348,11 @@ public:
         params->SetRobotActiveJoints(_robot);
         _robot->GetActiveDOFValues(params->vinitialconfig);
 
+        {
+            stringstream sdistancefieldin, sdistancefieldout;
+            sdistancefieldin << "SetTargetDistanceField " << ftargetdistancefieldresolution;
+            _planner->SendCommand(sdistancefieldout, sdistancefieldin);
+        }
         if( !_planner->InitPlan(_robot, params) ) {
             RAVELOG_WARN("InitPlan failed\n");
             return false;
@@ -405,7 +428,7 @@ public:
                 for(size_t i = 0; i < c.size(); ++i) {
                     c[i] = contacts[i].first;
                 }
-                analysis = _AnalyzeContacts3D(c,friction,8);
+                analysis = _AnalyzeContacts3D(c,friction,nfrictionconefacets);
             }
             catch(const std::exception& ex) {
                 RAVELOG_WARN("AnalyzeContacts3D: %s\n",ex.what());
@@ -525,6 +548,86 @@ public:
         return true;
     }
 
+    virtual bool _ComputeGraspQualitiesCommand(std::ostream& sout, std::istream& sinput)
+    {
+        string cmd;
+        dReal mu = 0;
+        int nfrictionconefacets = 8;
+        bool bprune = false;
+        vector<CollisionReport::CONTACT> vcontacts; // contacts of all grasps
+        vector<size_t> vgraspoffsets(1,0); // contacts of grasp i are in [vgraspoffsets[i], vgraspoffsets[i+1])
+        while(!sinput.eof()) {
+            sinput >> cmd;
+            if( !sinput ) {
+                break;
+            }
+            std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+
+            if( cmd == "friction" ) {
+                sinput >> mu;
+            }
+            else if( cmd == "frictionconefacets" ) {
+                sinput >> nfrictionconefacets;
+                if( !!sinput && nfrictionconefacets < 3 ) {
+                    RAVELOG_ERROR_FORMAT("frictionconefacets needs at least 3 facets, got %d", nfrictionconefacets);
+                    return false;
+                }
+            }
+            else if( cmd == "prune" ) {
+                sinput >> bprune;
+            }
+            else if( cmd == "grasps" ) {
+                int numgrasps = 0;
+                sinput >> numgrasps;
+                if( numgrasps < 0 ) {
+                    RAVELOG_ERROR_FORMAT("invalid number of grasps %d", numgrasps);
+                    return false;
+                }
+                vgraspoffsets.reserve(vgraspoffsets.size()+numgrasps);
+                for(int igrasp = 0; igrasp < numgrasps && !!sinput; ++igrasp) {
+                    int numcontacts = 0;
+                    sinput >> numcontacts;
+                    if( numcontacts < 0 ) {
+                        RAVELOG_ERROR_FORMAT("grasp %d has an invalid number of contacts %d", igrasp%numcontacts);
+                        return false;
+                    }
+                    size_t offset = vcontacts.size();
+                    vcontacts.resize(offset+numcontacts);
+                    for(int icontact = 0; icontact < numcontacts; ++icontact) {
+                        CollisionReport::CONTACT& c = vcontacts[offset+icontact];
+                        sinput >> c.pos.x >> c.pos.y >> c.pos.z >> c.norm.x >> c.norm.y >> c.norm.z;
+                    }
+                    vgraspoffsets.push_back(vcontacts.size());
+                }
+            }
+            else {
+                RAVELOG_WARN(str(boost::format("unrecognized command: %s\n")%cmd));
+                break;
+            }
+
+            if( !sinput ) {
+                RAVELOG_ERROR(str(boost::format("failed processing command %s\n")%cmd));
+                return false;
+            }
+        }
+
+        // the friction cone facets and the buffers are shared by all grasps
+        GraspQualityCache cache;
+        vector<CollisionReport::CONTACT> vgraspcontacts;
+        for(size_t igrasp = 0; igrasp+1 < vgraspoffsets.size(); ++igrasp) {
+            vgraspcontacts.assign(vcontacts.begin()+vgraspoffsets[igrasp], vcontacts.begin()+vgraspoffsets[igrasp+1]);
+            GRASPANALYSIS analysis;
+            try {
+                analysis = _AnalyzeContacts3D(vgraspcontacts, mu, nfrictionconefacets, bprune, cache);
+            }
+            catch(const std::exception& ex) {
+                RAVELOG_WARN_FORMAT("grasp %d: AnalyzeContacts3D failed: %s", igrasp%ex.what());
+            }
+            sout << analysis.mindist << " " << analysis.volume << " ";
+        }
+        return true;
+    }
+
     virtual bool _ConvexHullCommand(std::ostream& sout, std::istream& sinput)
     {
         string cmd;
@@ -666,6 +769,8 @@ public:
             ftranslationstepmult = 0.1;
             nGraspingNoiseRetries = 0;
             forceclosurethreshold = 0;
+            nfrictionconefacets = 8;
+            ftargetdistancefieldresolution = 0;
             ffinestep = 0.001f;
             bCheckGraspIK = false;
         }
@@ -679,6 +784,8 @@ public:
         bool bComputeForceClosure;
         dReal forceclosurethreshold;
         dReal friction;
+        int nfrictionconefacets; ///< number of facets of the linearized friction cones
+        dReal ftargetdistancefieldresolution; ///< voxel size of the distance field of the target, 0 if not used
         string collisionchecker;
         dReal ftranslationstepmult;
         dReal ffinestep;
@@ -689,6 +796,14 @@ public:
         Vector affineaxis;
 
         bool bCheckGraspIK;
+
+        // grasp candidates, candidate id indexes their cross-product
+        vector< pair<Vector, Vector> > approachrays;
+        vector<dReal> rolls;
+        vector< vector<dReal> > preshapes;
+        vector<Vector> manipulatordirections;
+        vector<dReal> standoffs;
+        size_t numgrasps = 0; ///< number of candidates
     };
 
     struct GraspParametersThread
@@ -711,6 +826,16 @@ public:
     typedef boost::shared_ptr<GraspParametersThread> GraspParametersThreadPtr;
     typedef boost::shared_ptr<WorkerParameters> WorkerParametersPtr;
 
+    /// \brief persistent worker of GraspThreaded with its own clone of the environment
+    struct GraspWorker
+    {
+        size_t index = 0; ///< workers with index >= _nGraspActiveWorkers skip the current command
+        uint64_t stamp = 0; ///< number of commands the environment was prepared for
+        EnvironmentBasePtr penv;
+        boost::shared_ptr<std::thread> thread;
+    };
+    typedef boost::shared_ptr<GraspWorker> GraspWorkerPtr;
+
     virtual bool _GraspThreadedCommand(std::ostream& sout, std::istream& sinput)
     {
         EnvironmentLock lock543(GetEnv()->GetMutex());
@@ -718,11 +843,11 @@ public:
         WorkerParametersPtr worker_params(new WorkerParameters());
         int numthreads = 2;
         string cmd;
-        vector< pair<Vector, Vector> > approachrays;
-        vector<dReal> rolls;
-        vector< vector<dReal> > preshapes;
-        vector<Vector> manipulatordirections;
-        vector<dReal> standoffs;
+        vector< pair<Vector, Vector> >& approachrays = worker_params->approachrays;
+        vector<dReal>& rolls = worker_params->rolls;
+        vector< vector<dReal> >& preshapes = worker_params->preshapes;
+        vector<Vector>& manipulatordirections = worker_params->manipulatordirections;
+        vector<dReal>& standoffs = worker_params->standoffs;
         size_t startindex = 0;
         size_t maxgrasps = 0;
 
@@ -759,6 +884,16 @@ public:
             else if( cmd == "friction" ) {
                 sinput >> worker_params->friction;
             }
+            else if( cmd == "frictionconefacets" ) {
+                sinput >> worker_params->nfrictionconefacets;
+                if( !!sinput && worker_params->nfrictionconefacets < 3 ) {
+                    RAVELOG_ERROR_FORMAT("frictionconefacets needs at least 3 facets, got %d", worker_params->nfrictionconefacets);
+                    return false;
+                }
+            }
+            else if( cmd == "targetdistancefield" ) {
+                sinput >> worker_params->ftargetdistancefieldresolution;
+            }
             else if( cmd == "forceclosure" ) {
                 sinput >> worker_params->bComputeForceClosure >> worker_params->forceclosurethreshold;
             }
@@ -838,55 +973,54 @@ public:
         worker_params->affinedofs = _robot->GetAffineDOF();
         worker_params->affineaxis = _robot->GetAffineRotationAxis();
 
-        EnvironmentBasePtr pcloneenv = GetEnv()->CloneSelf(Clone_Bodies|Clone_Simulation);
-
-        _bContinueWorker = true;
-        // start worker threads
-        vector<boost::shared_ptr<std::thread> > listthreads(numthreads);
-        for (int threadIdx = 0; threadIdx < numthreads; ++threadIdx) {
-            listthreads[threadIdx] = boost::make_shared<std::thread>(std::bind(&GrasperModule::_WorkerThread, this, worker_params, pcloneenv));
+        if( numthreads < 1 ) {
+            numthreads = 1;
         }
-
-        _listGraspResults.clear();
-        size_t numgrasps = approachrays.size()*rolls.size()*preshapes.size()*standoffs.size()*manipulatordirections.size();
+        worker_params->numgrasps = approachrays.size()*rolls.size()*preshapes.size()*standoffs.size()*manipulatordirections.size();
         if( maxgrasps == 0 ) {
-            maxgrasps = numgrasps;
+            maxgrasps = worker_params->numgrasps;
         }
-        RAVELOG_INFO(str(boost::format("number of grasps to test: %d\n")%numgrasps));
-        size_t id = startindex;
-        for(id=startindex; id < numgrasps; ++id) {
-            size_t istandoff = id % standoffs.size();
-            size_t ipreshape = (id / standoffs.size()) % preshapes.size();
-            size_t iroll = (id / (preshapes.size() * standoffs.size())) % rolls.size();
-            size_t iapproachray = (id / (rolls.size() * preshapes.size() * standoffs.size()))%approachrays.size();
-            size_t imanipulatordirection = (id / (rolls.size() * preshapes.size() * standoffs.size()*approachrays.size()));
+        RAVELOG_INFO(str(boost::format("number of grasps to test: %d\n")%worker_params->numgrasps));
 
-            std::unique_lock<std::mutex> lock123(_mutexGrasp);
-            if( _listGraspResults.size() >= maxgrasps ) {
-                break;
+        // bring the environments of the persistent workers up to date, cloning reuses the bodies that did not change
+        while( (int)_vGraspWorkers.size() < numthreads ) {
+            GraspWorkerPtr worker(new GraspWorker());
+            worker->index = _vGraspWorkers.size();
+            worker->penv = GetEnv()->CloneSelf(Clone_Bodies|Clone_Simulation);
+            _vGraspWorkers.push_back(worker);
+            worker->thread = boost::make_shared<std::thread>(std::bind(&GrasperModule::_GraspWorkerThread, this, worker, _nGraspGeneration));
+        }
+        for(int iworker = 0; iworker < numthreads; ++iworker) {
+            if( _vGraspWorkers[iworker]->stamp != 0 ) { // was just cloned otherwise
+                _vGraspWorkers[iworker]->penv->Clone(GetEnv(), Clone_Bodies|Clone_Simulation);
             }
-
-            // initialize _graspParamsWork
-            BOOST_ASSERT(!_graspParamsWork);
-            _graspParamsWork.reset(new GraspParametersThread());
-            _graspParamsWork->id = id;
-            _graspParamsWork->vtargetposition = approachrays.at(iapproachray).first;
-            _graspParamsWork->vtargetdirection = approachrays.at(iapproachray).second;
-            _graspParamsWork->vmanipulatordirection = manipulatordirections.at(imanipulatordirection);
-            _graspParamsWork->ftargetroll = rolls.at(iroll);
-            _graspParamsWork->fstandoff = standoffs.at(istandoff);
-            _graspParamsWork->preshape = preshapes.at(ipreshape);
-            _condGraspHasWork.notify_one();     // notify there is work
-            _condGraspReceivedWork.wait(lock123);     // wait for more work
+            _vGraspWorkers[iworker]->stamp++;
         }
 
-        // wait for workers
-        _bContinueWorker = false;
-        FOREACH(itthread,listthreads) {
-            _condGraspHasWork.notify_all();     // signal
-            (*itthread)->join();
+        // workers claim the candidates one at a time, so expensive candidates do not leave the other workers idle
+        size_t id = startindex;
+        {
+            std::unique_lock<std::mutex> lock123(_mutexGrasp);
+            _listGraspResults.clear();
+            _nextGraspId = startindex;
+            _bContinueWorker = true;
+            _graspWorkerParams = worker_params;
+            _nGraspActiveWorkers = numthreads;
+            _nGraspWorkersBusy = numthreads;
+            ++_nGraspGeneration;
+            _condGraspHasWork.notify_all();
+
+            // results are added as they are found, so stop as soon as there are enough
+            _condGraspResult.wait(lock123, [this, maxgrasps]() {
+                return _nGraspWorkersBusy == 0 || _listGraspResults.size() >= maxgrasps;
+            });
+            _bContinueWorker = false;
+            _condGraspResult.wait(lock123, [this]() {
+                return _nGraspWorkersBusy == 0;
+            });
+            _graspWorkerParams.reset();
+            id = min(_nextGraspId.load(), max(startindex, worker_params->numgrasps));
         }
-        listthreads.clear();
 
         // parse results to output
         sout << id << " " << _listGraspResults.size() << " ";
@@ -912,14 +1046,18 @@ public:
         return true;
     }
 
-    void _WorkerThread(const WorkerParametersPtr worker_params, EnvironmentBasePtr penv)
+    /// \brief tests the candidates of worker_params until none are left or _bContinueWorker is reset
+    void _RunGraspWorker(const WorkerParametersPtr worker_params, EnvironmentBasePtr pcloneenv)
     {
-        // clone environment
-        EnvironmentBasePtr pcloneenv = penv->CloneSelf(Clone_Bodies|Clone_Simulation);
         {
             EnvironmentLock lock765(pcloneenv->GetMutex());
             boost::shared_ptr<CollisionCheckerMngr> pcheckermngr(new CollisionCheckerMngr(pcloneenv, worker_params->collisionchecker));
             PlannerBasePtr planner = RaveCreatePlanner(pcloneenv,"Grasper");
+            if( worker_params->ftargetdistancefieldresolution > 0 ) {
+                stringstream sdistancefieldin, sdistancefieldout;
+                sdistancefieldin << "SetTargetDistanceField " << worker_params->ftargetdistancefieldresolution;
+                planner->SendCommand(sdistancefieldout, sdistancefieldin);
+            }
             RobotBasePtr probot = pcloneenv->GetRobot(_robot->GetName());
             string strsavetraj;
 
@@ -938,6 +1076,7 @@ public:
             CollisionReportPtr report(new CollisionReport());
             TrajectoryBasePtr ptraj = RaveCreateTrajectory(pcloneenv,"");
             GraspParametersThreadPtr grasp_params;
+            GraspQualityCache qualitycache;
 
             // calculate the contact normals
             std::vector<KinBody::LinkPtr> vlinks, vindependentlinks;
@@ -951,20 +1090,24 @@ public:
             pcloneenv->GetCollisionChecker()->SetCollisionOptions(coloptions|CO_Contacts);
 
             while(_bContinueWorker) {
-                {
-                    // wait for work
-                    std::unique_lock<std::mutex> lock653(_mutexGrasp);
-                    if( !_graspParamsWork ) {
-                        _condGraspHasWork.wait(lock653);
-                        // after signal
-                        if( !_graspParamsWork ) {
-                            continue;
-                        }
-                    }
-                    grasp_params = _graspParamsWork;
-                    _graspParamsWork.reset();
-                    _condGraspReceivedWork.notify_all();
+                const size_t id = _nextGraspId++;
+                if( id >= worker_params->numgrasps ) {
+                    break;
                 }
+                size_t istandoff = id % worker_params->standoffs.size();
+                size_t ipreshape = (id / worker_params->standoffs.size()) % worker_params->preshapes.size();
+                size_t iroll = (id / (worker_params->preshapes.size() * worker_params->standoffs.size())) % worker_params->rolls.size();
+                size_t iapproachray = (id / (worker_params->rolls.size() * worker_params->preshapes.size() * worker_params->standoffs.size()))%worker_params->approachrays.size();
+                size_t imanipulatordirection = (id / (worker_params->rolls.size() * worker_params->preshapes.size() * worker_params->standoffs.size()*worker_params->approachrays.size()));
+
+                grasp_params.reset(new GraspParametersThread());
+                grasp_params->id = id;
+                grasp_params->vtargetposition = worker_params->approachrays.at(iapproachray).first;
+                grasp_params->vtargetdirection = worker_params->approachrays.at(iapproachray).second;
+                grasp_params->vmanipulatordirection = worker_params->manipulatordirections.at(imanipulatordirection);
+                grasp_params->ftargetroll = worker_params->rolls.at(iroll);
+                grasp_params->fstandoff = worker_params->standoffs.at(istandoff);
+                grasp_params->preshape = worker_params->preshapes.at(ipreshape);
 
                 RAVELOG_DEBUG(str(boost::format("grasp %d: start")%grasp_params->id));
 
@@ -1046,7 +1189,8 @@ public:
                         for(size_t i = 0; i < c.size(); ++i) {
                             c[i] = grasp_params->contacts[i].first;
                         }
-                        analysis = _AnalyzeContacts3D(c,worker_params->friction,8);
+                        // grasps with no force closure are rejected when there is a threshold, so no need for their volume
+                        analysis = _AnalyzeContacts3D(c,worker_params->friction,worker_params->nfrictionconefacets,worker_params->forceclosurethreshold > 0,qualitycache);
                         if( analysis.mindist < worker_params->forceclosurethreshold ) {
                             RAVELOG_DEBUG(str(boost::format("grasp %d: force closure failed")%grasp_params->id));
                             continue;
@@ -1165,16 +1309,70 @@ public:
 
                 std::lock_guard<std::mutex> lock(_mutexGrasp);
                 _listGraspResults.push_back(grasp_params);
+                _condGraspResult.notify_all();
+            }
+        }
+    }
+
+    void _GraspWorkerThread(GraspWorkerPtr worker, uint64_t generation)
+    {
+        while(true) {
+            WorkerParametersPtr worker_params;
+            {
+                // wait for work
+                std::unique_lock<std::mutex> lock653(_mutexGrasp);
+                _condGraspHasWork.wait(lock653, [this, &worker, &generation]() {
+                    return _bShutdownGraspWorkers || (_nGraspGeneration != generation && worker->index < _nGraspActiveWorkers);
+                });
+                if( _bShutdownGraspWorkers ) {
+                    break;
+                }
+                generation = _nGraspGeneration;
+                worker_params = _graspWorkerParams;
+            }
+
+            try {
+                _RunGraspWorker(worker_params, worker->penv);
             }
+            catch(const std::exception& ex) {
+                RAVELOG_WARN_FORMAT("env=%s, grasp worker %d failed: %s", GetEnv()->GetNameId()%worker->index%ex.what());
+            }
+
+            std::lock_guard<std::mutex> lock(_mutexGrasp);
+            --_nGraspWorkersBusy;
+            _condGraspResult.notify_all();
+        }
+    }
+
+    void _StopGraspWorkers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutexGrasp);
+            _bShutdownGraspWorkers = true;
+            _bContinueWorker = false;
         }
-        pcloneenv->Destroy();
+        _condGraspHasWork.notify_all();
+        FOREACH(itworker, _vGraspWorkers) {
+            (*itworker)->thread->join();
+            (*itworker)->penv->Destroy();
+        }
+        _vGraspWorkers.clear();
+        _bShutdownGraspWorkers = false;
     }
 
-    bool _bContinueWorker;
+    std::atomic<bool> _bContinueWorker{false};
+    std::atomic<size_t> _nextGraspId{0}; ///< next candidate to be claimed by a worker
     std::mutex _mutexGrasp;
-    GraspParametersThreadPtr _graspParamsWork;
+    WorkerParametersPtr _graspWorkerParams; ///< parameters of the current command
     list<GraspParametersThreadPtr> _listGraspResults;
-    std::condition_variable _condGraspHasWork, _condGraspReceivedWork;
+    std::condition_variable _condGraspHasWork; ///< notified when a command starts or the workers shut down
+    std::condition_variable _condGraspResult; ///< notified when a result is found or a worker finished the command
+    vector<GraspWorkerPtr> _vGraspWorkers; ///< started on demand, kept alive between commands
+    uint64_t _nGraspGeneration = 0; ///< incremented for every command
+    size_t _nGraspActiveWorkers = 0; ///< number of workers used by the current command
+    size_t _nGraspWorkersBusy = 0; ///< active workers that have not finished the current command
+    bool _bShutdownGraspWorkers = false;
+
 
 protected:
     void _ComputeJointMaxLengths(vector<dReal>& vjointlengths)
@@ -1558,79 +1756,186 @@ protected:
         }
     }
 
+    /// \brief buffers for evaluating the force closure of many grasps without reallocating
+    struct GraspQualityCache
+    {
+        int nconefacets = 0; ///< number of facets vsin and vcos were computed for
+        vector<dReal> vsin, vcos; ///< facet directions of the linearized friction cone around the contact normal
+        vector<double> vwrenches; ///< 6D wrenches, one after another
+        vector<double> vconvexplanes;
+        vector<CollisionReport::CONTACT> vreducedcontacts;
+    };
+
     virtual GRASPANALYSIS _AnalyzeContacts3D(const vector<CollisionReport::CONTACT>& contacts, dReal mu, int Nconepoints)
+    {
+        GraspQualityCache cache;
+        return _AnalyzeContacts3D(contacts, mu, Nconepoints, false, cache);
+    }
+
+    /// \brief computes the force closure of the contacts with their friction cones linearized by Nconepoints facets
+    ///
+    /// \param bprune if true, skips computing the convex hull when all the wrenches are on one side of a coordinate plane. Then the grasp is not force closure, and its volume is not computed.
+    virtual GRASPANALYSIS _AnalyzeContacts3D(const vector<CollisionReport::CONTACT>& contacts, dReal mu, int Nconepoints, bool bprune, GraspQualityCache& cache)
     {
         if( mu == 0 ) {
-            return _AnalyzeContacts3D(contacts);
+            cache.vwrenches.resize(0);
+            _AppendContactWrenches(contacts.data(), contacts.size(), 0, cache);
+            return _AnalyzeWrenches(bprune, cache);
         }
 
         if( contacts.size() > 16 ) {
             // try reduce time by computing a subset of the points
-            vector<CollisionReport::CONTACT> reducedcontacts;
-            reducedcontacts.reserve(16);
-            for(size_t i = 0; i < reducedcontacts.capacity(); ++i) {
-                reducedcontacts.push_back( contacts.at((i*contacts.size())/reducedcontacts.capacity()) );
-            }
-            GRASPANALYSIS analysis = _AnalyzeContacts3D(reducedcontacts, mu, Nconepoints);
+            vector<CollisionReport::CONTACT>& reducedcontacts = cache.vreducedcontacts;
+            reducedcontacts.resize(16);
+            for(size_t i = 0; i < reducedcontacts.size(); ++i) {
+                reducedcontacts[i] = contacts.at((i*contacts.size())/reducedcontacts.size());
+            }
+            _ComputeFrictionConeFacets(Nconepoints, cache);
+            cache.vwrenches.resize(0);
+            _AppendContactWrenches(reducedcontacts.data(), reducedcontacts.size(), mu, cache);
+            GRASPANALYSIS analysis = _AnalyzeWrenches(bprune, cache);
             if( analysis.mindist > 1e-9 ) {
                 return analysis;
             }
         }
 
-        dReal fdeltaang = 2*PI/(dReal)Nconepoints;
+        _ComputeFrictionConeFacets(Nconepoints, cache);
+        cache.vwrenches.resize(0);
+        _AppendContactWrenches(contacts.data(), contacts.size(), mu, cache);
+        return _AnalyzeWrenches(bprune, cache);
+    }
+
+    virtual GRASPANALYSIS _AnalyzeContacts3D(const vector<CollisionReport::CONTACT>& contacts)
+    {
+        return _AnalyzeContacts3D(contacts, 0, 0);
+    }
+
+    static void _ComputeFrictionConeFacets(int nconefacets, GraspQualityCache& cache)
+    {
+        OPENRAVE_ASSERT_OP(nconefacets, >=, 3);
+        if( cache.nconefacets == nconefacets ) {
+            return;
+        }
+        cache.nconefacets = nconefacets;
+        cache.vsin.resize(nconefacets);
+        cache.vcos.resize(nconefacets);
+        dReal fdeltaang = 2*PI/(dReal)nconefacets;
         dReal fang = 0;
-        vector<pair<dReal,dReal> > vsincos(Nconepoints);
-        FOREACH(it,vsincos) {
-            it->first = RaveSin(fang);
-            it->second = RaveCos(fang);
+        for(int i = 0; i < nconefacets; ++i) {
+            cache.vsin[i] = RaveSin(fang);
+            cache.vcos[i] = RaveCos(fang);
             fang += fdeltaang;
         }
+    }
+
+    /// \brief appends the wrenches of the contacts to cache.vwrenches.
+    ///
+    /// If mu is 0, the contact normals are used, otherwise the facets of the linearized friction cones computed by _ComputeFrictionConeFacets.
+    static void _AppendContactWrenches(const CollisionReport::CONTACT* pcontacts, size_t numcontacts, dReal mu, GraspQualityCache& cache)
+    {
+        vector<double>& vwrenches = cache.vwrenches;
+        if( mu == 0 ) {
+            size_t offset = vwrenches.size();
+            vwrenches.resize(offset + 6*numcontacts);
+            double* pwrench = &vwrenches[offset];
+            for(size_t icontact = 0; icontact < numcontacts; ++icontact, pwrench += 6) {
+                const CollisionReport::CONTACT& contact = pcontacts[icontact];
+                Vector v = contact.pos.cross(contact.norm);
+                pwrench[0] = contact.norm.x;
+                pwrench[1] = contact.norm.y;
+                pwrench[2] = contact.norm.z;
+                pwrench[3] = v.x;
+                pwrench[4] = v.y;
+                pwrench[5] = v.z;
+            }
+            return;
+        }
 
-        vector<CollisionReport::CONTACT> newcontacts;
-        newcontacts.reserve(contacts.size()*Nconepoints);
-        FOREACHC(itcontact,contacts) {
+        const int nconefacets = cache.nconefacets;
+        const dReal* psin = cache.vsin.data();
+        const dReal* pcos = cache.vcos.data();
+        size_t offset = vwrenches.size();
+        vwrenches.resize(offset + 6*nconefacets*numcontacts);
+        double* pwrench = vwrenches.data() + offset;
+        for(size_t icontact = 0; icontact < numcontacts; ++icontact) {
+            const CollisionReport::CONTACT& contact = pcontacts[icontact];
             // find a coordinate system where z is the normal
-            TransformMatrix torient = matrixFromQuat(quatRotateDirection(Vector(0,0,1),itcontact->norm));
-            Vector right(torient.m[0],torient.m[4],torient.m[8]);
-            Vector up(torient.m[1],torient.m[5],torient.m[9]);
-            FOREACH(it,vsincos) {
-                newcontacts.push_back(CollisionReport::CONTACT(itcontact->pos, (itcontact->norm + mu*it->first*right + mu*it->second*up).normalize3(),0));
+            TransformMatrix torient = matrixFromQuat(quatRotateDirection(Vector(0,0,1),contact.norm));
+            const dReal rx = mu*torient.m[0], ry = mu*torient.m[4], rz = mu*torient.m[8];
+            const dReal ux = mu*torient.m[1], uy = mu*torient.m[5], uz = mu*torient.m[9];
+            const dReal nx = contact.norm.x, ny = contact.norm.y, nz = contact.norm.z;
+            const dReal px = contact.pos.x, py = contact.pos.y, pz = contact.pos.z;
+            // straight loop over the facets with no branches so that it is vectorized
+            for(int ifacet = 0; ifacet < nconefacets; ++ifacet) {
+                dReal dx = nx + psin[ifacet]*rx + pcos[ifacet]*ux;
+                dReal dy = ny + psin[ifacet]*ry + pcos[ifacet]*uy;
+                dReal dz = nz + psin[ifacet]*rz + pcos[ifacet]*uz;
+                const dReal finvlen = 1/RaveSqrt(dx*dx + dy*dy + dz*dz);
+                dx *= finvlen;
+                dy *= finvlen;
+                dz *= finvlen;
+                double* pw = pwrench + 6*ifacet;
+                pw[0] = dx;
+                pw[1] = dy;
+                pw[2] = dz;
+                pw[3] = py*dz - pz*dy;
+                pw[4] = pz*dx - px*dz;
+                pw[5] = px*dy - py*dx;
+            }
+            pwrench += 6*nconefacets;
+        }
+    }
+
+    /// \brief returns true if all the wrenches are on one side of a coordinate plane, in which case the origin is not strictly inside their convex hull
+    static bool _AreWrenchesInCoordinateHalfspace(const vector<double>& vwrenches)
+    {
+        double vmin[6], vmax[6];
+        for(int j = 0; j < 6; ++j) {
+            vmin[j] = 1e30;
+            vmax[j] = -1e30;
+        }
+        const double* pwrench = vwrenches.data();
+        const size_t numwrenches = vwrenches.size()/6;
+        for(size_t i = 0; i < numwrenches; ++i, pwrench += 6) {
+            for(int j = 0; j < 6; ++j) {
+                vmin[j] = min(vmin[j], pwrench[j]);
+                vmax[j] = max(vmax[j], pwrench[j]);
+            }
+        }
+        for(int j = 0; j < 6; ++j) {
+            if( vmin[j] >= 0 || vmax[j] <= 0 ) {
+                return true;
             }
         }
-        return _AnalyzeContacts3D(newcontacts);
+        return false;
     }
 
-    virtual GRASPANALYSIS _AnalyzeContacts3D(const vector<CollisionReport::CONTACT>& contacts)
+    /// \brief computes the force closure of cache.vwrenches
+    virtual GRASPANALYSIS _AnalyzeWrenches(bool bprune, GraspQualityCache& cache)
     {
-        if( contacts.size() < 7 ) {
+        const size_t numwrenches = cache.vwrenches.size()/6;
+        if( numwrenches < 7 ) {
             RAVELOG_DEBUG("need at least 7 contact wrenches to have force closure in 3D\n");
             return GRASPANALYSIS();
         }
-        RAVELOG_DEBUG(str(boost::format("analyzing %d contacts for force closure\n")%contacts.size()));
+        if( bprune && _AreWrenchesInCoordinateHalfspace(cache.vwrenches) ) {
+            RAVELOG_VERBOSE("contact wrenches are in a half-space, so no force closure\n");
+            return GRASPANALYSIS();
+        }
+        RAVELOG_DEBUG(str(boost::format("analyzing %d contacts for force closure\n")%numwrenches));
         GRASPANALYSIS analysis;
-        vector<double> vpoints(6*contacts.size()), vconvexplanes;
-        vector<double>::iterator itpoint = vpoints.begin();
-        FOREACHC(itcontact, contacts) {
-            *itpoint++ = itcontact->norm.x;
-            *itpoint++ = itcontact->norm.y;
-            *itpoint++ = itcontact->norm.z;
-            Vector v = itcontact->pos.cross(itcontact->norm);
-            *itpoint++ = v.x;
-            *itpoint++ = v.y;
-            *itpoint++ = v.z;
-        }
-
-        analysis.volume = _ComputeConvexHull(vpoints,vconvexplanes,boost::shared_ptr< vector<int> >(),6);
+        vector<double>& vconvexplanes = cache.vconvexplanes;
+        analysis.volume = _ComputeConvexHull(cache.vwrenches,vconvexplanes,boost::shared_ptr< vector<int> >(),6);
         if( vconvexplanes.size() == 0 ) {
             return analysis;
         }
         // go through each of the faces and check if center is inside, and compute its distance
         double mindist = 1e30;
-        for(size_t i = 0; i < vconvexplanes.size(); i += 7) {
-            if(( vconvexplanes.at(i+6) > 0) ||( RaveFabs(vconvexplanes.at(i+6)) < 1e-15) ) {
+        for(size_t i = 6; i < vconvexplanes.size(); i += 7) {
+            if(( vconvexplanes[i] > 0) ||( RaveFabs(vconvexplanes[i]) < 1e-15) ) {
                 return analysis;
             }
-            mindist = min(mindist,-vconvexplanes.at(i+6));
+            mindist = min(mindist,-vconvexplanes[i]);
         }
         analysis.mindist = mindist;
         return analysis;
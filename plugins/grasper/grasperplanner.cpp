@@ -14,8 +14,12 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "plugindefs.h"
+#include "targetdistancefield.h"
 
 #include <openrave/planningutils.h>
+#include <boost/bind/bind.hpp>
+
+using namespace boost::placeholders;
 
 class GrasperPlanner :  public PlannerBase
 {
@@ -35,6 +39,8 @@ class GrasperPlanner :  public PlannerBase
 public:
     GrasperPlanner(EnvironmentBasePtr penv, std::istream& sinput) : PlannerBase(penv), _report(new CollisionReport()) {
         __description = ":Interface Authors: Rosen Diankov, Dmitry Berenson\n\nSimple planner that performs a follow and squeeze operation of a robotic hand.";
+        RegisterCommand("SetTargetDistanceField",boost::bind(&GrasperPlanner::_SetTargetDistanceFieldCommand,this,_1,_2),
+                        "Sets the voxel size of the distance field of the target used to skip collision checks of links far from it. 0 disables the distance field.");
     }
     bool InitPlan(RobotBasePtr pbase, PlannerParametersConstPtr pparams)
     {
@@ -108,6 +114,23 @@ public:
         CollisionCheckerMngr checkermngr(GetEnv(),"");
         GetEnv()->GetCollisionChecker()->SetCollisionOptions(0);
 
+        _ptargetdistancefield.reset();
+        _bTargetOnlyObstacle = false;
+        if( _ftargetdistancefieldresolution > 0 && !!_parameters->targetbody ) {
+            _ptargetdistancefield = TargetDistanceField::GetTargetDistanceField(_parameters->targetbody, _ftargetdistancefieldresolution);
+            _tTargetInv = _parameters->targetbody->GetTransform().inverse();
+            // if nothing else can be hit, the distance field can also skip the checks against the whole environment
+            _bTargetOnlyObstacle = true;
+            std::vector<KinBodyPtr> vbodies;
+            GetEnv()->GetBodies(vbodies);
+            FOREACHC(itbody, vbodies) {
+                if( *itbody != _robot && *itbody != _parameters->targetbody && (*itbody)->IsEnabled() ) {
+                    _bTargetOnlyObstacle = false;
+                    break;
+                }
+            }
+        }
+
         // do not disable any links of the robot here!
         KinBody::LinkPtr pbase;
         if( !!pmanip ) {
@@ -557,7 +580,10 @@ public:
     {
         int ct = (plink->GetIndex()<<CT_LinkMaskShift);
         bool bcollision;
-        if( !!targetbody ) {
+        if( _IsFarFromTarget(plink, targetbody) ) {
+            bcollision = false;
+        }
+        else if( !!targetbody ) {
             bcollision = GetEnv()->CheckCollision(plink, KinBodyConstPtr(targetbody),_report);
         }
         else {
@@ -601,6 +627,30 @@ public:
     }
 
 protected:
+    bool _SetTargetDistanceFieldCommand(std::ostream& sout, std::istream& sinput)
+    {
+        dReal fresolution = 0;
+        sinput >> fresolution;
+        if( !sinput ) {
+            return false;
+        }
+        _ftargetdistancefieldresolution = fresolution;
+        return true;
+    }
+
+    /// \brief returns true if the distance field of the target proves that the link cannot hit anything checked against.
+    bool _IsFarFromTarget(KinBody::LinkConstPtr plink, KinBodyPtr targetbody) const
+    {
+        if( !_ptargetdistancefield ) {
+            return false;
+        }
+        if( !!targetbody ? targetbody != _parameters->targetbody : !_bTargetOnlyObstacle ) {
+            return false;
+        }
+        AABB ab = plink->ComputeAABB();
+        return _ptargetdistancefield->GetDistanceLowerBound(_tTargetInv*ab.pos) > RaveSqrt(ab.extents.lengthsqr3());
+    }
+
     virtual int _MoveStraight(TrajectoryBasePtr ptraj, const Vector& vapproachdir, vector<dReal>& dofvals, int checkcollisions)
     {
         dReal* pX = NULL, *pY = NULL, *pZ = NULL;
@@ -710,6 +760,11 @@ protected:
     std::vector<KinBody::LinkPtr> _vlinks;
     Vector _vTargetCenter;
     dReal _fTargetRadius;
+
+    dReal _ftargetdistancefieldresolution = 0; ///< voxel size of the distance field of the target, 0 if not used
+    TargetDistanceFieldConstPtr _ptargetdistancefield; ///< distance field of the target for the current plan
+    Transform _tTargetInv; ///< inverse of the target transform for the current plan
+    bool _bTargetOnlyObstacle = false; ///< true if the robot and the target are the only enabled bodies
 };
 
 PlannerBasePtr CreateGrasperPlanner(EnvironmentBasePtr penv, std::istream& sinput)
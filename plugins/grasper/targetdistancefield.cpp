@@ -0,0 +1,440 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2012 Rosen Diankov <rosen.diankov@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "targetdistancefield.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <list>
+#include <mutex>
+
+#ifdef HAVE_BOOST_FILESYSTEM
+#include <boost/filesystem/operations.hpp>
+#endif
+
+namespace {
+
+const int s_nMaxDistanceFieldDims = 256; ///< maximum number of voxels along each axis
+const double s_fDistanceFieldInf = 1e20;
+const char s_distanceFieldMagic[8] = {'O','R','T','D','F','0','0','1'};
+const size_t s_nDistanceFieldHeaderSize = sizeof(s_distanceFieldMagic) + 10*sizeof(double) + 3*sizeof(int32_t);
+const uint64_t s_nDistanceFieldsMaxMemoryBytes = 256*1024*1024; ///< maximum size of the fields kept in memory
+const uint64_t s_nDistanceFieldsMaxDiskBytes = 256*1024*1024; ///< maximum size of the cache directory
+
+/// \brief exact 1D squared euclidean distance transform of the sampled function f (Felzenszwalb and Huttenlocher)
+///
+/// Entries of f that are >= s_fDistanceFieldInf are not sources.
+void _DistanceTransform1D(const double* f, int n, double* d, int* v, double* z)
+{
+    int k = -1;
+    for(int q = 0; q < n; ++q) {
+        if( f[q] >= s_fDistanceFieldInf ) {
+            continue;
+        }
+        if( k < 0 ) {
+            k = 0;
+            v[0] = q;
+            z[0] = -s_fDistanceFieldInf;
+            z[1] = s_fDistanceFieldInf;
+            continue;
+        }
+        double s = ((f[q]+(double)q*q)-(f[v[k]]+(double)v[k]*v[k]))/(2.0*(q-v[k]));
+        while( s <= z[k] ) {
+            --k;
+            s = ((f[q]+(double)q*q)-(f[v[k]]+(double)v[k]*v[k]))/(2.0*(q-v[k]));
+        }
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k+1] = s_fDistanceFieldInf;
+    }
+    if( k < 0 ) {
+        std::fill(d, d+n, s_fDistanceFieldInf);
+        return;
+    }
+    k = 0;
+    for(int q = 0; q < n; ++q) {
+        while( z[k+1] < q ) {
+            ++k;
+        }
+        d[q] = (double)(q-v[k])*(q-v[k]) + f[v[k]];
+    }
+}
+
+/// \brief distance from a point to an axis aligned box, 0 if inside
+dReal _ComputeBoxDistance(const Vector& p, const Vector& vmin, const Vector& vmax)
+{
+    dReal dx = std::max(std::max(vmin.x - p.x, p.x - vmax.x), dReal(0));
+    dReal dy = std::max(std::max(vmin.y - p.y, p.y - vmax.y), dReal(0));
+    dReal dz = std::max(std::max(vmin.z - p.z, p.z - vmax.z), dReal(0));
+    return RaveSqrt(dx*dx + dy*dy + dz*dz);
+}
+
+} // end namespace
+
+void TargetDistanceField::Build(KinBodyConstPtr pbody, dReal fresolution)
+{
+    OPENRAVE_ASSERT_OP(fresolution, >, 0);
+    TriMesh trimesh;
+    Transform tinvbody = pbody->GetTransform().inverse();
+    FOREACHC(itlink, pbody->GetLinks()) {
+        trimesh.Append((*itlink)->GetCollisionData(), tinvbody*(*itlink)->GetTransform());
+    }
+
+    _fresolution = fresolution;
+    _vdistances.clear();
+    _dims[0] = _dims[1] = _dims[2] = 0;
+    if( trimesh.indices.size() < 3 ) {
+        _vmeshmin = _vmeshmax = _vorigin = Vector();
+        return;
+    }
+
+    _vmeshmin = _vmeshmax = trimesh.vertices.at(0);
+    FOREACHC(itvertex, trimesh.vertices) {
+        _vmeshmin.x = std::min(_vmeshmin.x, itvertex->x); _vmeshmax.x = std::max(_vmeshmax.x, itvertex->x);
+        _vmeshmin.y = std::min(_vmeshmin.y, itvertex->y); _vmeshmax.y = std::max(_vmeshmax.y, itvertex->y);
+        _vmeshmin.z = std::min(_vmeshmin.z, itvertex->z); _vmeshmax.z = std::max(_vmeshmax.z, itvertex->z);
+    }
+
+    // pad by a couple of voxels so that the surface is always inside the grid
+    Vector vextents = _vmeshmax - _vmeshmin;
+    dReal fmaxextent = std::max(vextents.x, std::max(vextents.y, vextents.z));
+    if( fmaxextent + 4*_fresolution > (s_nMaxDistanceFieldDims-1)*_fresolution ) {
+        _fresolution = fmaxextent/(s_nMaxDistanceFieldDims-5);
+        RAVELOG_DEBUG_FORMAT("body %s is too large, increasing distance field resolution from %f to %f", pbody->GetName()%fresolution%_fresolution);
+    }
+    const dReal fpadding = 2*_fresolution;
+    _vorigin = _vmeshmin - Vector(fpadding, fpadding, fpadding);
+    for(int i = 0; i < 3; ++i) {
+        _dims[i] = (int)std::ceil((vextents[i] + 2*fpadding)/_fresolution) + 1;
+    }
+    const size_t numvoxels = (size_t)_dims[0]*_dims[1]*_dims[2];
+
+    // mark the voxels whose cells contain the surface. triangles are subdivided until they are smaller than a voxel, so
+    // marking the cells overlapping their bounding boxes stays tight.
+    std::vector<double> vsqdistances(numvoxels, s_fDistanceFieldInf);
+    const dReal fsqresolution = _fresolution*_fresolution;
+    std::vector< boost::array<Vector, 3> > vtriangles;
+    for(size_t itri = 0; itri+2 < trimesh.indices.size(); itri += 3) {
+        boost::array<Vector, 3> tri = {{trimesh.vertices.at(trimesh.indices[itri]), trimesh.vertices.at(trimesh.indices[itri+1]), trimesh.vertices.at(trimesh.indices[itri+2])}};
+        vtriangles.push_back(tri);
+        while( !vtriangles.empty() ) {
+            tri = vtriangles.back();
+            vtriangles.pop_back();
+            dReal fmaxedge = std::max((tri[1]-tri[0]).lengthsqr3(), std::max((tri[2]-tri[1]).lengthsqr3(), (tri[0]-tri[2]).lengthsqr3()));
+            if( fmaxedge > fsqresolution ) {
+                Vector v01 = 0.5*(tri[0]+tri[1]), v12 = 0.5*(tri[1]+tri[2]), v20 = 0.5*(tri[2]+tri[0]);
+                boost::array<Vector, 3> sub0 = {{tri[0], v01, v20}}, sub1 = {{v01, tri[1], v12}}, sub2 = {{v20, v12, tri[2]}}, sub3 = {{v01, v12, v20}};
+                vtriangles.push_back(sub0);
+                vtriangles.push_back(sub1);
+                vtriangles.push_back(sub2);
+                vtriangles.push_back(sub3);
+                continue;
+            }
+            int imin[3], imax[3];
+            for(int j = 0; j < 3; ++j) {
+                dReal fmin = std::min(tri[0][j], std::min(tri[1][j], tri[2][j]));
+                dReal fmax = std::max(tri[0][j], std::max(tri[1][j], tri[2][j]));
+                imin[j] = std::max(0, (int)std::floor((fmin - _vorigin[j])/_fresolution + 0.5));
+                imax[j] = std::min(_dims[j]-1, (int)std::floor((fmax - _vorigin[j])/_fresolution + 0.5));
+            }
+            for(int iz = imin[2]; iz <= imax[2]; ++iz) {
+                for(int iy = imin[1]; iy <= imax[1]; ++iy) {
+                    for(int ix = imin[0]; ix <= imax[0]; ++ix) {
+                        vsqdistances[_GetIndex(ix, iy, iz)] = 0;
+                    }
+                }
+            }
+        }
+    }
+
+    // squared distance in voxels to the closest marked voxel, separable along each axis
+    {
+        int maxdim = std::max(_dims[0], std::max(_dims[1], _dims[2]));
+        std::vector<double> vf(maxdim), vd(maxdim), vz(maxdim+1);
+        std::vector<int> vv(maxdim);
+        const size_t vstrides[3] = {1, (size_t)_dims[0], (size_t)_dims[0]*_dims[1]};
+        for(int axis = 0; axis < 3; ++axis) {
+            const int n = _dims[axis];
+            const size_t stride = vstrides[axis];
+            for(size_t istart = 0; istart < numvoxels; ++istart) {
+                // only start from the voxels at the beginning of each line along axis
+                if( (istart/stride) % n != 0 ) {
+                    continue;
+                }
+                for(int q = 0; q < n; ++q) {
+                    vf[q] = vsqdistances[istart + q*stride];
+                }
+                _DistanceTransform1D(vf.data(), n, vd.data(), vv.data(), vz.data());
+                for(int q = 0; q < n; ++q) {
+                    vsqdistances[istart + q*stride] = vd[q];
+                }
+            }
+        }
+    }
+
+    // the surface can be anywhere inside a marked cell, so remove half of the cell diagonal to stay conservative
+    const dReal fhalfdiagonal = 0.5*RaveSqrt(dReal(3))*_fresolution;
+    _vdistances.resize(numvoxels);
+    for(size_t ivoxel = 0; ivoxel < numvoxels; ++ivoxel) {
+        _vdistances[ivoxel] = (float)std::max(dReal(0), RaveSqrt((dReal)vsqdistances[ivoxel])*_fresolution - fhalfdiagonal);
+    }
+    _ComputeSigns(trimesh);
+}
+
+void TargetDistanceField::_ComputeSigns(const TriMesh& trimesh)
+{
+    // cast rays along x through the voxel centers and flip inside/outside at every crossing
+    std::vector< std::vector<dReal> > vcolumncrossings((size_t)_dims[1]*_dims[2]);
+    for(size_t itri = 0; itri+2 < trimesh.indices.size(); itri += 3) {
+        const Vector& v0 = trimesh.vertices.at(trimesh.indices[itri]);
+        const Vector& v1 = trimesh.vertices.at(trimesh.indices[itri+1]);
+        const Vector& v2 = trimesh.vertices.at(trimesh.indices[itri+2]);
+        dReal fdet = (v1.y-v0.y)*(v2.z-v0.z) - (v2.y-v0.y)*(v1.z-v0.z);
+        if( RaveFabs(fdet) <= 1e-15 ) {
+            continue; // parallel to the rays
+        }
+        int iymin = std::max(0, (int)std::ceil((std::min(v0.y, std::min(v1.y, v2.y)) - _vorigin.y)/_fresolution));
+        int iymax = std::min(_dims[1]-1, (int)std::floor((std::max(v0.y, std::max(v1.y, v2.y)) - _vorigin.y)/_fresolution));
+        int izmin = std::max(0, (int)std::ceil((std::min(v0.z, std::min(v1.z, v2.z)) - _vorigin.z)/_fresolution));
+        int izmax = std::min(_dims[2]-1, (int)std::floor((std::max(v0.z, std::max(v1.z, v2.z)) - _vorigin.z)/_fresolution));
+        for(int iz = izmin; iz <= izmax; ++iz) {
+            dReal z = _vorigin.z + iz*_fresolution;
+            for(int iy = iymin; iy <= iymax; ++iy) {
+                dReal y = _vorigin.y + iy*_fresolution;
+                // barycentric coordinates in the yz plane, half-open so that shared edges are counted once
+                dReal b1 = ((y-v0.y)*(v2.z-v0.z) - (v2.y-v0.y)*(z-v0.z))/fdet;
+                dReal b2 = ((v1.y-v0.y)*(z-v0.z) - (y-v0.y)*(v1.z-v0.z))/fdet;
+                if( b1 < 0 || b2 < 0 || b1+b2 >= 1 ) {
+                    continue;
+                }
+                vcolumncrossings[(size_t)iz*_dims[1]+iy].push_back(v0.x + b1*(v1.x-v0.x) + b2*(v2.x-v0.x));
+            }
+        }
+    }
+
+    for(int iz = 0; iz < _dims[2]; ++iz) {
+        for(int iy = 0; iy < _dims[1]; ++iy) {
+            std::vector<dReal>& vcrossings = vcolumncrossings[(size_t)iz*_dims[1]+iy];
+            if( vcrossings.size() < 2 ) {
+                continue;
+            }
+            std::sort(vcrossings.begin(), vcrossings.end());
+            size_t icrossing = 0;
+            for(int ix = 0; ix < _dims[0]; ++ix) {
+                dReal x = _vorigin.x + ix*_fresolution;
+                while( icrossing < vcrossings.size() && vcrossings[icrossing] < x ) {
+                    ++icrossing;
+                }
+                if( icrossing & 1 ) {
+                    float& fdistance = _vdistances[_GetIndex(ix, iy, iz)];
+                    fdistance = -fdistance;
+                }
+            }
+        }
+    }
+}
+
+dReal TargetDistanceField::GetDistanceLowerBound(const Vector& plocal) const
+{
+    if( _vdistances.empty() ) {
+        return _dims[0] == 0 && _fresolution > 0 ? std::numeric_limits<dReal>::max() : 0;
+    }
+    // the bounding box of the geometry always gives a bound
+    dReal fboxdistance = _ComputeBoxDistance(plocal, _vmeshmin, _vmeshmax);
+    int ivoxel[3];
+    for(int i = 0; i < 3; ++i) {
+        ivoxel[i] = (int)std::floor((plocal[i] - _vorigin[i])/_fresolution + 0.5);
+        if( ivoxel[i] < 0 || ivoxel[i] >= _dims[i] ) {
+            return fboxdistance;
+        }
+    }
+    float fdistance = _vdistances[_GetIndex(ivoxel[0], ivoxel[1], ivoxel[2])];
+    if( fdistance <= 0 ) {
+        return fboxdistance;
+    }
+    // distance is 1-Lipschitz, so move the bound from the voxel center to the point
+    Vector vcenter(_vorigin.x + ivoxel[0]*_fresolution, _vorigin.y + ivoxel[1]*_fresolution, _vorigin.z + ivoxel[2]*_fresolution);
+    return std::max(fboxdistance, fdistance - RaveSqrt((plocal - vcenter).lengthsqr3()));
+}
+
+dReal TargetDistanceField::GetSignedDistance(const Vector& plocal) const
+{
+    int ivoxel[3];
+    for(int i = 0; i < 3; ++i) {
+        ivoxel[i] = (int)std::floor((plocal[i] - _vorigin[i])/_fresolution + 0.5);
+        if( _vdistances.empty() || ivoxel[i] < 0 || ivoxel[i] >= _dims[i] ) {
+            return _ComputeBoxDistance(plocal, _vmeshmin, _vmeshmax);
+        }
+    }
+    return _vdistances[_GetIndex(ivoxel[0], ivoxel[1], ivoxel[2])];
+}
+
+bool TargetDistanceField::Save(const std::string& filename) const
+{
+#ifdef HAVE_BOOST_FILESYSTEM
+    const std::string tempfilename = utils::GetTemporaryFilename(filename);
+    try {
+        boost::filesystem::create_directories(boost::filesystem::path(filename).parent_path());
+        {
+            std::ofstream f(tempfilename.c_str(), std::ios::binary|std::ios::trunc);
+            if( !f ) {
+                return false;
+            }
+            f.write(s_distanceFieldMagic, sizeof(s_distanceFieldMagic));
+            double values[10] = {_fresolution, _vorigin.x, _vorigin.y, _vorigin.z, _vmeshmin.x, _vmeshmin.y, _vmeshmin.z, _vmeshmax.x, _vmeshmax.y, _vmeshmax.z};
+            f.write(reinterpret_cast<const char*>(values), sizeof(values));
+            int32_t dims[3] = {_dims[0], _dims[1], _dims[2]};
+            f.write(reinterpret_cast<const char*>(dims), sizeof(dims));
+            if( !_vdistances.empty() ) {
+                f.write(reinterpret_cast<const char*>(_vdistances.data()), _vdistances.size()*sizeof(float));
+            }
+            if( !f ) {
+                f.close();
+                boost::filesystem::remove(tempfilename);
+                return false;
+            }
+        }
+        // rename is atomic, so concurrent processes never read a partially written file
+        boost::filesystem::rename(tempfilename, filename);
+    }
+    catch(const boost::filesystem::filesystem_error& ex) {
+        RAVELOG_DEBUG_FORMAT("failed to write distance field %s: %s", filename%ex.what());
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool TargetDistanceField::Load(const std::string& filename)
+{
+    std::ifstream f(filename.c_str(), std::ios::binary);
+    if( !f ) {
+        return false;
+    }
+    f.seekg(0, std::ios::end);
+    const std::streamoff filesize = f.tellg();
+    f.seekg(0, std::ios::beg);
+    if( filesize < (std::streamoff)s_nDistanceFieldHeaderSize ) {
+        return false;
+    }
+    char magic[sizeof(s_distanceFieldMagic)];
+    double values[10];
+    int32_t dims[3];
+    f.read(magic, sizeof(magic));
+    f.read(reinterpret_cast<char*>(values), sizeof(values));
+    f.read(reinterpret_cast<char*>(dims), sizeof(dims));
+    if( !f || !std::equal(magic, magic+sizeof(magic), s_distanceFieldMagic) ) {
+        return false;
+    }
+    for(int i = 0; i < 10; ++i) {
+        if( !std::isfinite(values[i]) ) {
+            return false;
+        }
+    }
+    if( values[0] <= 0 ) {
+        return false;
+    }
+    for(int i = 0; i < 3; ++i) {
+        if( dims[i] < 0 || dims[i] > s_nMaxDistanceFieldDims ) {
+            return false;
+        }
+    }
+    // a truncated or padded file is rejected instead of being partially read
+    const size_t numvoxels = (size_t)dims[0]*dims[1]*dims[2];
+    if( (uint64_t)filesize != s_nDistanceFieldHeaderSize + numvoxels*sizeof(float) ) {
+        return false;
+    }
+    std::vector<float> vdistances(numvoxels);
+    if( !vdistances.empty() ) {
+        f.read(reinterpret_cast<char*>(vdistances.data()), vdistances.size()*sizeof(float));
+        if( !f ) {
+            return false;
+        }
+    }
+    _fresolution = values[0];
+    _vorigin = Vector(values[1], values[2], values[3]);
+    _vmeshmin = Vector(values[4], values[5], values[6]);
+    _vmeshmax = Vector(values[7], values[8], values[9]);
+    for(int i = 0; i < 3; ++i) {
+        _dims[i] = dims[i];
+    }
+    _vdistances.swap(vdistances);
+    return true;
+}
+
+TargetDistanceFieldConstPtr TargetDistanceField::GetTargetDistanceField(KinBodyConstPtr pbody, dReal fresolution)
+{
+    static std::mutex s_mutexDistanceFields;
+    static std::map<std::string, TargetDistanceFieldConstPtr> s_mapDistanceFields;
+    static std::list<std::string> s_listDistanceFieldKeys; ///< keys of s_mapDistanceFields, oldest first
+    static uint64_t s_nDistanceFieldsBytes = 0;
+
+    std::string key = pbody->GetKinematicsGeometryHash();
+    if( key.size() == 0 ) {
+        boost::shared_ptr<TargetDistanceField> pfield(new TargetDistanceField());
+        pfield->Build(pbody, fresolution);
+        return pfield;
+    }
+    if( pbody->GetDOF() > 0 ) {
+        // geometry depends on the configuration
+        std::vector<dReal> vdofvalues;
+        pbody->GetDOFValues(vdofvalues);
+        std::stringstream ss;
+        ss << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+        FOREACHC(itvalue, vdofvalues) {
+            ss << *itvalue << " ";
+        }
+        key += std::string("_") + utils::GetMD5HashString(ss.str());
+    }
+    key += str(boost::format("_%d")%(int)(fresolution*1e6+0.5));
+
+    std::lock_guard<std::mutex> lock(s_mutexDistanceFields);
+    std::map<std::string, TargetDistanceFieldConstPtr>::iterator it = s_mapDistanceFields.find(key);
+    if( it != s_mapDistanceFields.end() ) {
+        return it->second;
+    }
+
+    const std::string cachedirectory = RaveGetHomeDirectory() + "/grasperdistancefields";
+    const std::string filename = str(boost::format("%s/%s.bin")%cachedirectory%key);
+    boost::shared_ptr<TargetDistanceField> pfield(new TargetDistanceField());
+    if( !pfield->Load(filename) ) {
+        uint64_t starttime = utils::GetMicroTime();
+        pfield->Build(pbody, fresolution);
+        RAVELOG_DEBUG_FORMAT("built distance field of %s with %dx%dx%d voxels in %fs", pbody->GetName()%pfield->_dims[0]%pfield->_dims[1]%pfield->_dims[2]%(1e-6*(utils::GetMicroTime()-starttime)));
+        if( pfield->Save(filename) ) {
+            utils::PruneFileCache(cachedirectory, s_nDistanceFieldsMaxDiskBytes);
+        }
+        else {
+            RAVELOG_WARN_FORMAT("failed to save distance field of %s to %s", pbody->GetName()%filename);
+        }
+    }
+
+    // evict the oldest fields, callers still holding them keep them alive
+    const uint64_t nfieldbytes = pfield->_vdistances.size()*sizeof(float);
+    while( !s_listDistanceFieldKeys.empty() && s_nDistanceFieldsBytes + nfieldbytes > s_nDistanceFieldsMaxMemoryBytes ) {
+        std::map<std::string, TargetDistanceFieldConstPtr>::iterator itold = s_mapDistanceFields.find(s_listDistanceFieldKeys.front());
+        s_nDistanceFieldsBytes -= itold->second->_vdistances.size()*sizeof(float);
+        s_mapDistanceFields.erase(itold);
+        s_listDistanceFieldKeys.pop_front();
+    }
+    s_mapDistanceFields[key] = pfield;
+    s_listDistanceFieldKeys.push_back(key);
+    s_nDistanceFieldsBytes += nfieldbytes;
+    return pfield;
+}
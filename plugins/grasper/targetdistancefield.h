@@ -0,0 +1,70 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2012 Rosen Diankov <rosen.diankov@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef OPENRAVE_GRASPER_TARGETDISTANCEFIELD_H
+#define OPENRAVE_GRASPER_TARGETDISTANCEFIELD_H
+
+#include "plugindefs.h"
+
+/// \brief voxelized signed distance field of the collision geometry of a body, in the coordinate system of the body.
+///
+/// The stored distances are conservative: their magnitude never exceeds the real distance to the surface, so they
+/// can be used to prove that geometry is not in collision with the body. The sign is negative inside closed meshes.
+class TargetDistanceField
+{
+public:
+    /// \brief builds the field from the collision meshes of the links of pbody at their current configuration.
+    ///
+    /// \param fresolution size of a voxel, increased if the grid would be too large
+    void Build(KinBodyConstPtr pbody, dReal fresolution);
+
+    /// \brief returns a lower bound of the distance from a point to the surface of the body, 0 if the point can be inside.
+    ///
+    /// \param plocal point in the coordinate system of the body
+    dReal GetDistanceLowerBound(const Vector& plocal) const;
+
+    /// \brief returns the signed distance of the voxel closest to the point.
+    dReal GetSignedDistance(const Vector& plocal) const;
+
+    inline dReal GetResolution() const {
+        return _fresolution;
+    }
+
+    bool Save(const std::string& filename) const;
+    bool Load(const std::string& filename);
+
+    /// \brief returns the distance field of the body, sharing one per geometry and resolution.
+    ///
+    /// Recently used fields are kept in memory and persisted in the grasperdistancefields directory of the OpenRAVE home,
+    /// so they are computed only once per geometry. Both caches are bounded in size.
+    static boost::shared_ptr<TargetDistanceField const> GetTargetDistanceField(KinBodyConstPtr pbody, dReal fresolution);
+
+private:
+    inline size_t _GetIndex(int ix, int iy, int iz) const {
+        return ((size_t)iz*_dims[1] + iy)*_dims[0] + ix;
+    }
+
+    void _ComputeSigns(const TriMesh& trimesh);
+
+    Vector _vorigin; ///< center of voxel (0,0,0)
+    Vector _vmeshmin, _vmeshmax; ///< bounding box of the geometry
+    dReal _fresolution = 0;
+    int _dims[3] = {0, 0, 0};
+    std::vector<float> _vdistances; ///< signed distance of each voxel center, x changes fastest
+};
+
+typedef boost::shared_ptr<TargetDistanceField const> TargetDistanceFieldConstPtr;
+
+#endif
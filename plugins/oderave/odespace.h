@@ -335,6 +335,7 @@ private:
             else {
                 // add all the current geometry objects
                 FOREACHC(itgeom, (*itlink)->GetGeometries()) {
+                    (*itgeom)->GetCollisionMesh(); // some primitives are created from their tessellation, which lazy geometry only builds here
                     dGeomID odegeomtrans = _CreateODEGeomFromGeometryInfo(pinfo->space, link, (*itgeom)->GetInfo());
                     if( !odegeomtrans ) {
                         continue;
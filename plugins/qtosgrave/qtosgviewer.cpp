@@ -2065,7 +2065,7 @@ void QtOSGViewer::UpdateFromModel()
     }
 
     std::lock_guard<std::mutex> lock(_mutexUpdateModels);
-    vector<KinBody::BodyState> vecbodies;
+    EnvironmentBase::PublishedBodiesConstPtr pvecbodies;
 
     EnvironmentLock lockenv(GetEnv()->GetMutex(), OpenRAVE::defer_lock_t());
 
@@ -2081,7 +2081,7 @@ void QtOSGViewer::UpdateFromModel()
     }
 
     try {
-        GetEnv()->GetPublishedBodies(vecbodies,100000); // 0.1s
+        pvecbodies = GetEnv()->GetPublishedBodiesSnapshot(100000); // 0.1s
     }
     catch(const std::exception& ex) {
         RAVELOG_WARN("timeout of GetPublishedBodies\n");
@@ -2092,7 +2092,8 @@ void QtOSGViewer::UpdateFromModel()
     }
 
     bool newdata = false; // set to true if new object was created
-    FOREACH(itbody, vecbodies) {
+    for(const KinBody::BodyStateConstPtr& pbodystate : *pvecbodies) {
+        const KinBody::BodyState* itbody = pbodystate.get();
         BOOST_ASSERT( !!itbody->pbody );
         KinBodyPtr pbody = itbody->pbody; // try to use only as an id, don't call any methods!
         KinBodyItemPtr pitem = boost::dynamic_pointer_cast<KinBodyItem>(pbody->GetUserData(_userdatakey));
@@ -18,6 +18,9 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/bind/bind.hpp>
 
+#include <random>
+#include <thread>
+
 using namespace boost::placeholders;
 
 class BaseManipulation : public ModuleBase
@@ -61,6 +64,11 @@ Method wraps the WorkspaceTrajectoryTracker planner. For more details on paramet
                         "Sets post processing parameters.");
         RegisterCommand("SetRobot",boost::bind(&BaseManipulation::SetRobotCommand,this,_1,_2),
                         "Sets the robot.");
+        RegisterCommand("ComputeNeverCollidingLinksPairs",boost::bind(&BaseManipulation::ComputeNeverCollidingLinksPairs,this,_1,_2),
+                        "Samples the joint limits of the robot in parallel and returns the non-adjacent link pairs that never collided. Output is the number of pairs followed by the link indices of each pair. Parameters:\n\n\
+- numsamples - the number of configurations to sample.\n\n\
+- numthreads - the number of threads, each using its own clone of the environment.\n\n\
+- seed - the seed of the random generator.");
         _minimumgoalpaths=1;
     }
 
@@ -1110,6 +1118,120 @@ protected:
         return true;
     }
 
+    bool ComputeNeverCollidingLinksPairs(ostream& sout, istream& sinput)
+    {
+        int numsamples = 10000, numthreads = 2;
+        uint32_t seed = 0;
+        string cmd;
+        while(!sinput.eof()) {
+            sinput >> cmd;
+            if( !sinput ) {
+                break;
+            }
+            std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+
+            if( cmd == "numsamples" ) {
+                sinput >> numsamples;
+            }
+            else if( cmd == "numthreads" ) {
+                sinput >> numthreads;
+            }
+            else if( cmd == "seed" ) {
+                sinput >> seed;
+            }
+            else {
+                RAVELOG_WARN(str(boost::format("unrecognized command: %s\n")%cmd));
+                break;
+            }
+
+            if( !sinput ) {
+                RAVELOG_ERROR(str(boost::format("failed processing command %s\n")%cmd));
+                return false;
+            }
+        }
+        if( !robot ) {
+            RAVELOG_ERROR("ComputeNeverCollidingLinksPairs - robot is not set.\n");
+            return false;
+        }
+        // without samples every candidate pair would be reported as never colliding and self-collision would be disabled
+        if( numsamples < 1 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("env=%d, ComputeNeverCollidingLinksPairs needs at least 1 sample, got %d", GetEnv()->GetId()%numsamples, ORE_InvalidArguments);
+        }
+        if( numthreads < 1 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("env=%d, ComputeNeverCollidingLinksPairs needs at least 1 thread, got %d", GetEnv()->GetId()%numthreads, ORE_InvalidArguments);
+        }
+        numthreads = min(numthreads, numsamples);
+
+        // candidates are all non-adjacent pairs, including the ones that were previously pruned
+        std::vector<std::pair<int, int> > vPreviousPairs;
+        robot->GetNeverCollidingLinksPairs(vPreviousPairs);
+        robot->SetNeverCollidingLinksPairs(std::vector<std::pair<int, int> >());
+        const std::vector<int> vCandidatePairs = robot->GetNonAdjacentLinks(0);
+        robot->SetNeverCollidingLinksPairs(vPreviousPairs);
+
+        std::vector<EnvironmentBasePtr> vclonedenvs(numthreads);
+        for(int ithread = 0; ithread < numthreads; ++ithread) {
+            vclonedenvs[ithread] = GetEnv()->CloneSelf(Clone_Bodies);
+        }
+
+        std::vector< std::vector<uint8_t> > vcollided(numthreads, std::vector<uint8_t>(vCandidatePairs.size(), 0));
+        std::vector<std::thread> vthreads;
+        const string robotname = robot->GetName();
+        for(int ithread = 0; ithread < numthreads; ++ithread) {
+            const int numthreadsamples = numsamples/numthreads + (ithread < numsamples%numthreads ? 1 : 0);
+            vthreads.emplace_back([&, ithread, numthreadsamples]() {
+                EnvironmentBasePtr penv = vclonedenvs[ithread];
+                EnvironmentLock lock(penv->GetMutex());
+                RobotBasePtr pclonedrobot = penv->GetRobot(robotname);
+                CollisionCheckerBasePtr collisionchecker = penv->GetCollisionChecker();
+                if( !pclonedrobot || !collisionchecker ) {
+                    std::fill(vcollided[ithread].begin(), vcollided[ithread].end(), 1);
+                    return;
+                }
+                CollisionOptionsStateSaver colsaver(collisionchecker, CO_IgnoreCallbacks);
+                std::mt19937 rng(seed + ithread);
+                std::vector<dReal> vlower, vupper, vvalues(pclonedrobot->GetDOF());
+                pclonedrobot->GetDOFLimits(vlower, vupper);
+                const std::vector<KinBody::LinkPtr>& vlinks = pclonedrobot->GetLinks();
+                std::vector<uint8_t>& vthreadcollided = vcollided[ithread];
+                for(int isample = 0; isample < numthreadsamples; ++isample) {
+                    for(size_t idof = 0; idof < vvalues.size(); ++idof) {
+                        vvalues[idof] = std::uniform_real_distribution<dReal>(vlower[idof], vupper[idof])(rng);
+                    }
+                    pclonedrobot->SetDOFValues(vvalues, KinBody::CLA_Nothing);
+                    for(size_t ipair = 0; ipair < vCandidatePairs.size(); ++ipair) {
+                        if( !vthreadcollided[ipair] && collisionchecker->CheckCollision(KinBody::LinkConstPtr(vlinks.at(vCandidatePairs[ipair]&0xffff)), KinBody::LinkConstPtr(vlinks.at(vCandidatePairs[ipair]>>16))) ) {
+                            vthreadcollided[ipair] = 1;
+                        }
+                    }
+                }
+            });
+        }
+        for(std::thread& thread : vthreads) {
+            thread.join();
+        }
+        for(EnvironmentBasePtr& penv : vclonedenvs) {
+            penv->Destroy();
+        }
+
+        std::vector<std::pair<int, int> > vNeverCollidingPairs;
+        for(size_t ipair = 0; ipair < vCandidatePairs.size(); ++ipair) {
+            bool bCollided = false;
+            for(int ithread = 0; ithread < numthreads; ++ithread) {
+                bCollided |= !!vcollided[ithread][ipair];
+            }
+            if( !bCollided ) {
+                vNeverCollidingPairs.emplace_back(vCandidatePairs[ipair]&0xffff, vCandidatePairs[ipair]>>16);
+            }
+        }
+        RAVELOG_DEBUG_FORMAT("env=%d, robot %s has %d/%d never colliding link pairs after %d samples", GetEnv()->GetId()%robotname%vNeverCollidingPairs.size()%vCandidatePairs.size()%numsamples);
+        sout << vNeverCollidingPairs.size();
+        for(const std::pair<int, int>& linkpair : vNeverCollidingPairs) {
+            sout << " " << linkpair.first << " " << linkpair.second;
+        }
+        return true;
+    }
+
 protected:
     bool SetMinimumGoalPathsCommand(ostream& sout, istream& sinput)
     {
@@ -17,6 +17,132 @@ namespace OpenRAVE {
 
 namespace PiecewisePolynomialsInternal {
 
+/// \brief the maximum number of coefficients of polynomials that can be checked with the chunk routines (quintic)
+const static size_t g_nMaxChunkCoeffs = 6;
+
+/// \brief Evaluate the polynomial with the given coefficients (weakest term first) at t.
+inline dReal _EvalCoefficients(const dReal* pcoeffs, const int degree, const dReal t)
+{
+    dReal val = pcoeffs[degree];
+    for( int icoeff = degree - 1; icoeff >= 0; --icoeff ) {
+        val = val*t + pcoeffs[icoeff];
+    }
+    return val;
+}
+
+/// \brief Find the root of a polynomial that is monotonic in [tlow, thigh] and changes sign there. flow is the value at tlow.
+static dReal _FindBracketedRoot(const dReal* pcoeffs, const dReal* pderivcoeffs, const int degree, dReal tlow, dReal thigh, dReal flow)
+{
+    dReal t = 0.5*(tlow + thigh);
+    for( int iter = 0; iter < 100; ++iter ) {
+        const dReal f = _EvalCoefficients(pcoeffs, degree, t);
+        if( f == 0 ) {
+            break;
+        }
+        if( (f < 0) == (flow < 0) ) {
+            tlow = t;
+            flow = f;
+        }
+        else {
+            thigh = t;
+        }
+        // Newton step, falling back to bisection when it leaves the bracket
+        const dReal df = _EvalCoefficients(pderivcoeffs, degree - 1, t);
+        dReal tnext = df != 0 ? t - f/df : tlow;
+        if( !(tnext > tlow && tnext < thigh) ) {
+            tnext = 0.5*(tlow + thigh);
+        }
+        if( RaveFabs(tnext - t) <= g_fEpsilonForTimeInstant ) {
+            t = tnext;
+            break;
+        }
+        t = tnext;
+    }
+    return t;
+}
+
+/// \brief Compute the roots in [tmin, tmax] of the polynomial with the given coefficients (weakest term first).
+///
+/// Linear and quadratic polynomials are solved in closed form. For higher degrees, the roots of the derivative split
+/// [tmin, tmax] into intervals in which the polynomial is monotonic so each interval contains at most one root.
+/// \return the number of roots written to proots, in increasing order
+static int _FindRootsInRange(const dReal* pcoeffs, int degree, const dReal tmin, const dReal tmax, dReal* proots)
+{
+    while( degree > 0 && pcoeffs[degree] == 0 ) {
+        --degree;
+    }
+    int numroots = 0;
+    if( degree <= 0 ) {
+        return 0;
+    }
+    else if( degree == 1 ) {
+        const dReal t = -pcoeffs[0]/pcoeffs[1];
+        if( t >= tmin && t <= tmax ) {
+            proots[numroots++] = t;
+        }
+        return numroots;
+    }
+    else if( degree == 2 ) {
+        // same closed-form formula as Polynomial::_FindAllLocalExtrema
+        const dReal a = pcoeffs[2], b = pcoeffs[1], c = pcoeffs[0];
+        const dReal det = b*b - 4*a*c;
+        const dReal tol = 64.0*std::numeric_limits<dReal>::epsilon();
+        dReal rawroots[2];
+        int numrawroots = 0;
+        if( det >= -tol ) {
+            if( det <= tol ) {
+                rawroots[numrawroots++] = -0.5*b/a;
+            }
+            else {
+                dReal temp;
+                if( b >= 0 ) {
+                    temp = -0.5*(b + RaveSqrt(det));
+                }
+                else {
+                    temp = -0.5*(b - RaveSqrt(det));
+                }
+                rawroots[numrawroots++] = temp/a;
+                rawroots[numrawroots++] = c/temp;
+                if( rawroots[1] < rawroots[0] ) {
+                    Swap(rawroots[0], rawroots[1]);
+                }
+            }
+        }
+        for( int iroot = 0; iroot < numrawroots; ++iroot ) {
+            if( rawroots[iroot] >= tmin && rawroots[iroot] <= tmax ) {
+                proots[numroots++] = rawroots[iroot];
+            }
+        }
+        return numroots;
+    }
+
+    dReal derivcoeffs[g_nMaxChunkCoeffs], criticalpoints[g_nMaxChunkCoeffs];
+    for( int icoeff = 0; icoeff < degree; ++icoeff ) {
+        derivcoeffs[icoeff] = (icoeff + 1)*pcoeffs[icoeff + 1];
+    }
+    const int numcriticalpoints = _FindRootsInRange(derivcoeffs, degree - 1, tmin, tmax, criticalpoints);
+    dReal tleft = tmin, fleft = _EvalCoefficients(pcoeffs, degree, tmin);
+    if( fleft == 0 ) {
+        proots[numroots++] = tmin;
+    }
+    for( int ipoint = 0; ipoint <= numcriticalpoints; ++ipoint ) {
+        const dReal tright = ipoint < numcriticalpoints ? criticalpoints[ipoint] : tmax;
+        if( tright <= tleft ) {
+            continue; // a critical point at tmin or a repeated one, already handled
+        }
+        const dReal fright = _EvalCoefficients(pcoeffs, degree, tright);
+        if( fright == 0 ) {
+            proots[numroots++] = tright;
+        }
+        else if( fleft != 0 && (fleft < 0) != (fright < 0) ) {
+            proots[numroots++] = _FindBracketedRoot(pcoeffs, derivcoeffs, degree, tleft, tright, fleft);
+        }
+        tleft = tright;
+        fleft = fright;
+    }
+    return numroots;
+}
+
 const char* GetPolynomialCheckReturnString(PolynomialCheckReturn ret)
 {
     switch(ret) {
@@ -56,6 +182,166 @@ void PolynomialChecker::Initialize(size_t ndof_, int envid_)
     _cacheAVect.resize(ndof_);
 }
 
+bool PolynomialChecker::_LoadChunkCoefficients(const Chunk& c)
+{
+    if( c.vpolynomials.size() != ndof || ndof == 0 ) {
+        return false;
+    }
+    size_t numcoeffs = 0;
+    for( size_t idof = 0; idof < ndof; ++idof ) {
+        numcoeffs = std::max(numcoeffs, c.vpolynomials[idof].vcoeffs.size());
+    }
+    if( numcoeffs == 0 || numcoeffs > g_nMaxChunkCoeffs ) {
+        return false;
+    }
+    _numChunkCoeffs = numcoeffs;
+    _vChunkCoeffs.resize(numcoeffs*ndof);
+    _vChunkDurations.resize(ndof);
+    _vChunkZeroTimes.resize(ndof, 0);
+    _vChunkValues.resize(ndof);
+    for( size_t idof = 0; idof < ndof; ++idof ) {
+        const std::vector<dReal>& vcoeffs = c.vpolynomials[idof].vcoeffs;
+        for( size_t icoeff = 0; icoeff < numcoeffs; ++icoeff ) {
+            _vChunkCoeffs[icoeff*ndof + idof] = icoeff < vcoeffs.size() ? vcoeffs[icoeff] : 0;
+        }
+        _vChunkDurations[idof] = c.vpolynomials[idof].duration;
+    }
+    return true;
+}
+
+void PolynomialChecker::_EvalChunkDerivative(const size_t ideriv, const dReal* pt, const size_t idofend, dReal* pvalues) const
+{
+    if( ideriv >= _numChunkCoeffs ) {
+        std::fill(pvalues, pvalues + idofend, dReal(0));
+        return;
+    }
+    // Horner's method on the coefficients of the ideriv-th derivative, where coefficient icoeff gets multiplied by icoeff!/(icoeff - ideriv)!
+    for( size_t icoeff = _numChunkCoeffs; icoeff-- > ideriv; ) {
+        dReal fmult = 1;
+        for( size_t i = icoeff - ideriv + 1; i <= icoeff; ++i ) {
+            fmult *= i;
+        }
+        const dReal* pcoeffs = &_vChunkCoeffs[icoeff*ndof];
+        if( icoeff + 1 == _numChunkCoeffs ) {
+            for( size_t idof = 0; idof < idofend; ++idof ) {
+                pvalues[idof] = fmult*pcoeffs[idof];
+            }
+        }
+        else {
+            for( size_t idof = 0; idof < idofend; ++idof ) {
+                pvalues[idof] = pvalues[idof]*pt[idof] + fmult*pcoeffs[idof];
+            }
+        }
+    }
+}
+
+size_t PolynomialChecker::_FindFirstChunkDurationDiscrepancy(const Chunk& c, const size_t idofend) const
+{
+    for( size_t idof = 0; idof < idofend; ++idof ) {
+        if( !FuzzyEquals(c.duration, _vChunkDurations[idof], g_fPolynomialEpsilon) ) {
+            return idof;
+        }
+    }
+    return idofend;
+}
+
+size_t PolynomialChecker::_FindFirstChunkValuesDiscrepancy(const dReal* pt, const std::vector<dReal>& xVect, const std::vector<dReal>& vVect, const std::vector<dReal>& aVect, size_t idofend)
+{
+    dReal* pvalues = &_vChunkValues[0];
+    const std::vector<dReal>* pexpectedvalues[3] = {&xVect, &vVect, &aVect};
+    const dReal epsilons[3] = {epsilonForPositionDiscrepancyChecking, epsilonForVelocityDiscrepancyChecking, epsilonForAccelerationDiscrepancyChecking};
+    for( size_t ideriv = 0; ideriv < 3 && idofend > 0; ++ideriv ) {
+        _EvalChunkDerivative(ideriv, pt, idofend, pvalues);
+        const dReal* pexpected = &(*pexpectedvalues[ideriv])[0];
+        for( size_t idof = 0; idof < idofend; ++idof ) {
+            if( !FuzzyEquals(pvalues[idof], pexpected[idof], epsilons[ideriv]) ) {
+                idofend = idof;
+                break;
+            }
+        }
+    }
+    return idofend;
+}
+
+size_t PolynomialChecker::_FindFirstChunkLimitsViolation(const std::vector<dReal>& xminVect, const std::vector<dReal>& xmaxVect,
+                                                         const std::vector<dReal>& vmVect, const std::vector<dReal>& amVect, const std::vector<dReal>& jmVect, size_t idofend)
+{
+    // A limit is checked only if the limits vector is given and the limit is strictly positive, same as CheckPolynomialLimits.
+    const std::vector<dReal>* plimitsvects[4] = {NULL, &vmVect, &amVect, &jmVect};
+    const size_t maxderiv = std::min(size_t(3), _numChunkCoeffs - 1);
+    dReal* pvalues = &_vChunkValues[0];
+
+    // Check boundary values of all DOFs first since they are cheap. Each violation shrinks the range of DOFs that still need checking.
+    for( int iboundary = 0; iboundary < 2; ++iboundary ) {
+        const dReal* pt = iboundary == 0 ? &_vChunkZeroTimes[0] : &_vChunkDurations[0];
+        for( size_t ideriv = 0; ideriv <= maxderiv && idofend > 0; ++ideriv ) {
+            if( ideriv == 0 ) {
+                _EvalChunkDerivative(ideriv, pt, idofend, pvalues);
+                for( size_t idof = 0; idof < idofend; ++idof ) {
+                    if( pvalues[idof] > xmaxVect[idof] + g_fPolynomialEpsilon || pvalues[idof] < xminVect[idof] - g_fPolynomialEpsilon ) {
+                        idofend = idof;
+                        break;
+                    }
+                }
+            }
+            else if( plimitsvects[ideriv]->size() == ndof ) {
+                const dReal* plimits = &(*plimitsvects[ideriv])[0];
+                const dReal tol = ideriv == 3 ? epsilonForJerkLimitsChecking : g_fPolynomialEpsilon;
+                _EvalChunkDerivative(ideriv, pt, idofend, pvalues);
+                for( size_t idof = 0; idof < idofend; ++idof ) {
+                    if( plimits[idof] > g_fPolynomialEpsilon && (pvalues[idof] > plimits[idof] + tol || pvalues[idof] < -plimits[idof] - tol) ) {
+                        idofend = idof;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    // Check the values at the critical points in [-epsilon, T + epsilon], the same range in which CheckPolynomialLimits checks
+    // the extrema. The maximum and minimum of each derivative are either at the boundaries or at these points, so checking
+    // all critical points (not only strict extrema) is enough.
+    dReal vcoeffs[g_nMaxChunkCoeffs], vderivcoeffs[g_nMaxChunkCoeffs], vcriticalpoints[g_nMaxChunkCoeffs];
+    for( size_t idof = 0; idof < idofend; ++idof ) {
+        const dReal T = _vChunkDurations[idof];
+        for( size_t icoeff = 0; icoeff < _numChunkCoeffs; ++icoeff ) {
+            vcoeffs[icoeff] = _vChunkCoeffs[icoeff*ndof + idof];
+        }
+        int degree = (int)_numChunkCoeffs - 1;
+        for( size_t ideriv = 0; ideriv <= maxderiv; ++ideriv ) {
+            // vcoeffs holds the ideriv-th derivative, vderivcoeffs the next one
+            for( int icoeff = 0; icoeff < degree; ++icoeff ) {
+                vderivcoeffs[icoeff] = (icoeff + 1)*vcoeffs[icoeff + 1];
+            }
+            dReal lower, upper;
+            bool bCheck = true;
+            if( ideriv == 0 ) {
+                lower = xminVect[idof] - g_fPolynomialEpsilon;
+                upper = xmaxVect[idof] + g_fPolynomialEpsilon;
+            }
+            else {
+                const std::vector<dReal>& vlimits = *plimitsvects[ideriv];
+                bCheck = vlimits.size() == ndof && vlimits[idof] > g_fPolynomialEpsilon;
+                const dReal tol = ideriv == 3 ? epsilonForJerkLimitsChecking : g_fPolynomialEpsilon;
+                upper = bCheck ? vlimits[idof] + tol : 0;
+                lower = -upper;
+            }
+            if( bCheck && degree > 1 ) {
+                const int numcriticalpoints = _FindRootsInRange(vderivcoeffs, degree - 1, -g_fPolynomialEpsilon, T + g_fPolynomialEpsilon, vcriticalpoints);
+                for( int ipoint = 0; ipoint < numcriticalpoints; ++ipoint ) {
+                    const dReal val = _EvalCoefficients(vcoeffs, degree, vcriticalpoints[ipoint]);
+                    if( val > upper || val < lower ) {
+                        return idof;
+                    }
+                }
+            }
+            std::copy(vderivcoeffs, vderivcoeffs + degree, vcoeffs);
+            --degree;
+        }
+    }
+    return idofend;
+}
+
 PolynomialCheckReturn PolynomialChecker::CheckPolynomialValues(const Polynomial& p, const dReal t, const dReal x, const dReal v, const dReal a)
 {
     if( t > p.duration + g_fPolynomialEpsilon ) {
@@ -346,8 +632,22 @@ PolynomialCheckReturn PolynomialChecker::CheckChunk(const Chunk& c, const std::v
     bool bHasVelocityLimits = vmVect.size() == ndof;
     bool bHasAccelerationLimits = amVect.size() == ndof;
     bool bHasJerkLimits = jmVect.size() == ndof;
-    PolynomialCheckReturn ret;
-    for( size_t idof = 0; idof < ndof; ++idof ) {
+    PolynomialCheckReturn ret = PCR_Normal;
+
+    // Check all DOFs together first. Only when some DOF fails, run the per-DOF checks starting from that DOF to get
+    // the exact return code and debug information.
+    size_t istartdof = 0;
+    if( _LoadChunkCoefficients(c) ) {
+        size_t idofend = _FindFirstChunkDurationDiscrepancy(c, ndof);
+        idofend = _FindFirstChunkValuesDiscrepancy(&_vChunkZeroTimes[0], x0Vect, v0Vect, a0Vect, idofend);
+        idofend = _FindFirstChunkValuesDiscrepancy(&_vChunkDurations[0], x1Vect, v1Vect, a1Vect, idofend);
+        idofend = _FindFirstChunkLimitsViolation(xminVect, xmaxVect, vmVect, amVect, jmVect, idofend);
+        if( idofend == ndof ) {
+            return PCR_Normal;
+        }
+        istartdof = idofend;
+    }
+    for( size_t idof = istartdof; idof < ndof; ++idof ) {
         if( bHasVelocityLimits ) {
             vm = vmVect[idof];
         }
@@ -400,7 +700,11 @@ PolynomialCheckReturn PolynomialChecker::CheckChunkLimits(const Chunk& c, const
                                                           const std::vector<dReal>& vmVect, const std::vector<dReal>& amVect, const std::vector<dReal>& jmVect)
 {
     PolynomialCheckReturn ret = PCR_Normal;
-    for( size_t idof = 0; idof < ndof; ++idof ) {
+    size_t istartdof = 0;
+    if( _LoadChunkCoefficients(c) ) {
+        istartdof = _FindFirstChunkLimitsViolation(xminVect, xmaxVect, vmVect, amVect, jmVect, ndof);
+    }
+    for( size_t idof = istartdof; idof < ndof; ++idof ) {
         ret = CheckPolynomialLimits(c.vpolynomials[idof], xminVect[idof], xmaxVect[idof], vmVect[idof], amVect[idof], jmVect[idof]);
         if( ret != PCR_Normal ) {
 #ifdef JERK_LIMITED_POLY_CHECKER_DEBUG
@@ -464,7 +768,16 @@ PolynomialCheckReturn PolynomialChecker::CheckChunks(const std::vector<Chunk>& v
             bCheckValues = true;
         }
 
-        for( size_t idof = 0; idof < ndof; ++idof ) {
+        size_t istartdof = 0;
+        if( _LoadChunkCoefficients(*itchunk) ) {
+            size_t idofend = _FindFirstChunkDurationDiscrepancy(*itchunk, ndof);
+            if( bCheckValues ) {
+                idofend = _FindFirstChunkValuesDiscrepancy(&_vChunkZeroTimes[0], prevXVect, prevVVect, prevAVect, idofend);
+            }
+            istartdof = _FindFirstChunkLimitsViolation(xminVect, xmaxVect, vmVect, amVect, jmVect, idofend);
+        }
+
+        for( size_t idof = istartdof; idof < ndof; ++idof ) {
             if( bHasVelocityLimits ) {
                 vm = vmVect[idof];
             }
@@ -157,6 +157,38 @@ public:
 #endif
 
 private:
+    /// \brief Copy the coefficients of all polynomials of the chunk into _vChunkCoeffs so that the checks on all DOFs
+    ///        can be done together in loops over DOFs.
+    ///
+    /// \return false if the chunk cannot be checked this way, in which case only the per-DOF checks should be used.
+    bool _LoadChunkCoefficients(const Chunk& c);
+
+    /// \brief Evaluate the ideriv-th derivative of the loaded polynomials of DOFs [0, idofend) at times pt[idof].
+    void _EvalChunkDerivative(const size_t ideriv, const dReal* pt, const size_t idofend, dReal* pvalues) const;
+
+    /// \brief Check the durations of the loaded chunk against the chunk duration.
+    ///
+    /// \return the first DOF in [0, idofend) whose polynomial duration differs from the chunk duration, or idofend if none.
+    size_t _FindFirstChunkDurationDiscrepancy(const Chunk& c, const size_t idofend) const;
+
+    /// \brief Check the values of the loaded chunk evaluated at times pt[idof].
+    ///
+    /// \return the first DOF in [0, idofend) whose values are inconsistent with the given ones, or idofend if none.
+    size_t _FindFirstChunkValuesDiscrepancy(const dReal* pt, const std::vector<dReal>& xVect, const std::vector<dReal>& vVect, const std::vector<dReal>& aVect, const size_t idofend);
+
+    /// \brief Check the limits of the loaded chunk. Boundary values of all DOFs are checked first. The critical points
+    ///        are then computed only for the DOFs before the first boundary violation.
+    ///
+    /// \return the first DOF in [0, idofend) that might violate the limits, or idofend if none.
+    size_t _FindFirstChunkLimitsViolation(const std::vector<dReal>& xminVect, const std::vector<dReal>& xmaxVect,
+                                          const std::vector<dReal>& vmVect, const std::vector<dReal>& amVect, const std::vector<dReal>& jmVect, const size_t idofend);
+
+    size_t _numChunkCoeffs = 0; ///< number of coefficients of the loaded chunk
+    std::vector<dReal> _vChunkCoeffs; ///< coefficient icoeff of DOF idof of the loaded chunk is at icoeff*ndof + idof
+    std::vector<dReal> _vChunkDurations; ///< durations of the polynomials of the loaded chunk
+    std::vector<dReal> _vChunkZeroTimes; ///< zeros, for evaluating the loaded chunk at t = 0
+    std::vector<dReal> _vChunkValues; ///< cache for evaluating the loaded chunk
+
     // Specific tolerance for checking discrepancies.
     dReal epsilonForPositionDiscrepancyChecking = g_fPolynomialEpsilon;
     dReal epsilonForVelocityDiscrepancyChecking = g_fPolynomialEpsilon;
@@ -0,0 +1,117 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 Rosen Diankov <rosen.diankov@gmail.com>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "testinterfaces.h"
+
+#include <openrave/openrave.h>
+#include <boost/bind/bind.hpp>
+#include <mutex>
+
+using namespace OpenRAVE;
+using namespace boost::placeholders;
+
+namespace testinterfaces {
+
+/// \brief module whose SimulationStep reads the transforms of all links, so it can be stepped concurrently. See EnvironmentBase::SetSimulationStepThreads.
+class ReadOnlyStepModule : public ModuleBase
+{
+public:
+    ReadOnlyStepModule(EnvironmentBasePtr penv) : ModuleBase(penv), _nsteps(0), _laststamp(0), _numlinks(0)
+    {
+        __description = ":Interface Author: Rosen Diankov\n\nOnly used by the tests. Every simulation step reads the transforms of all the links in the environment without modifying anything.";
+        RegisterCommand("GetStepInfo",boost::bind(&ReadOnlyStepModule::_GetStepInfoCommand,this,_1,_2),
+                        "returns the number of steps, the simulation time of the last step, and the number of links the last step read");
+    }
+
+    bool SimulationStep(dReal fElapsedTime) override
+    {
+        // the bodies are only read, the environment is locked by the thread calling StepSimulation
+        std::vector<KinBodyPtr> vbodies;
+        GetEnv()->GetBodies(vbodies);
+        size_t numlinks = 0;
+        Vector vsum;
+        for(const KinBodyPtr& pbody : vbodies) {
+            for(const KinBody::LinkPtr& plink : pbody->GetLinks()) {
+                vsum += plink->GetTransform().trans;
+                ++numlinks;
+            }
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_nsteps;
+        _laststamp = GetEnv()->GetSimulationTime();
+        _numlinks = numlinks;
+        _vlastsum = vsum;
+        return false;
+    }
+
+    bool IsSimulationStepReadOnly() const override
+    {
+        return true;
+    }
+
+protected:
+    bool _GetStepInfoCommand(std::ostream& sout, std::istream& sinput)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        sout << _nsteps << " " << _laststamp << " " << _numlinks;
+        return true;
+    }
+
+    std::mutex _mutex; ///< protects the members below, SimulationStep runs on the worker threads
+    int _nsteps;
+    uint64_t _laststamp;
+    size_t _numlinks;
+    Vector _vlastsum; ///< sum of the link positions of the last step
+};
+
+} // end namespace testinterfaces
+
+const std::string TestInterfacesPlugin::_pluginname = "TestInterfacesPlugin";
+
+TestInterfacesPlugin::TestInterfacesPlugin()
+{
+    _interfaces[OpenRAVE::PT_Module].push_back("ReadOnlyStepTest");
+}
+
+TestInterfacesPlugin::~TestInterfacesPlugin() {}
+
+OpenRAVE::InterfaceBasePtr TestInterfacesPlugin::CreateInterface(OpenRAVE::InterfaceType type, const std::string& interfacename, std::istream& sinput, OpenRAVE::EnvironmentBasePtr penv)
+{
+    switch(type) {
+    case OpenRAVE::PT_Module:
+        if( interfacename == "readonlysteptest" ) {
+            return boost::make_shared<testinterfaces::ReadOnlyStepModule>(penv);
+        }
+        break;
+    default:
+        break;
+    }
+    return OpenRAVE::InterfaceBasePtr();
+}
+
+const RavePlugin::InterfaceMap& TestInterfacesPlugin::GetInterfaces() const
+{
+    return _interfaces;
+}
+
+const std::string& TestInterfacesPlugin::GetPluginName() const
+{
+    return _pluginname;
+}
+
+OPENRAVE_PLUGIN_API RavePlugin* CreatePlugin() {
+    return new TestInterfacesPlugin();
+}
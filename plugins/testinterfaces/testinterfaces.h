@@ -0,0 +1,36 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 Rosen Diankov <rosen.diankov@gmail.com>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef OPENRAVE_PLUGIN_TESTINTERFACES_H
+#define OPENRAVE_PLUGIN_TESTINTERFACES_H
+
+#include <openrave/plugin.h>
+
+/// \brief interfaces that are only used by the tests to exercise the environment, they are not meant for applications
+struct TestInterfacesPlugin : public RavePlugin {
+    TestInterfacesPlugin();
+    ~TestInterfacesPlugin() override;
+
+    OpenRAVE::InterfaceBasePtr CreateInterface(OpenRAVE::InterfaceType type, const std::string& interfacename, std::istream& sinput, OpenRAVE::EnvironmentBasePtr penv) override;
+    const InterfaceMap& GetInterfaces() const override;
+    const std::string& GetPluginName() const override;
+
+private:
+    static const std::string _pluginname;
+    InterfaceMap _interfaces;
+};
+
+#endif // OPENRAVE_PLUGIN_TESTINTERFACES_H
@@ -68,6 +68,8 @@ protected:
 
     CollisionAction _CollisionCallback(object fncallback, CollisionReportPtr preport, bool bFromPhysics);
 
+    py::object _UpdateFromDelta(const rapidjson::Value& rDelta, const AttributesList& atts);
+
 public:
     PyEnvironmentBase(int options=ECO_StartSimulationThread);
     PyEnvironmentBase(const std::string& name, int options=ECO_StartSimulationThread);
@@ -128,6 +130,8 @@ public:
     bool Load(const std::string &filename, object odictatts);
     bool LoadURI(const std::string &filename, object odictatts=py::none_());
     py::object LoadJSON(py::object oEnvInfo, UpdateFromInfoMode updateMode, object odictatts=py::none_(), const std::string &uri = "");
+    py::object UpdateFromDelta(py::object oDelta, object odictatts=py::none_());
+    py::object UpdateFromDeltaMsgPack(const std::string& data, object odictatts=py::none_());
     bool LoadData(const std::string &data);
     bool LoadData(const std::string &data, object odictatts);
 
@@ -196,10 +200,14 @@ public:
     bool HasRegisteredCollisionCallbacks();
 
     void StepSimulation(dReal timeStep);
+    void FastForwardSimulation(int numsteps, dReal timeStep, int publishInterval=0);
     void StartSimulation(dReal fDeltaTime, bool bRealTime=true);
     void StopSimulation(int shutdownthread=1);
     uint64_t GetSimulationTime();
     bool IsSimulationRunning();
+    void SetSimulationStepThreads(int numthreads);
+    int GetSimulationStepThreads();
+    object GetSimulationStepTimes();
 
     void Lock();
 
@@ -336,6 +336,9 @@ public:
     void SetAdjacentLinks(int linkindex0, int linkindex1);
     void SetAdjacentLinksCombinations(py::object olinkIndices);
     py::object GetAdjacentLinks() const;
+    void SetNeverCollidingLinksPairs(py::object olinkpairs);
+    py::object GetNeverCollidingLinksPairs() const;
+    bool AreNeverCollidingLinks(int linkindex0, int linkindex1) const;
     py::object GetManageData() const;
     int GetUpdateStamp() const;
     std::string serialize(int options) const;
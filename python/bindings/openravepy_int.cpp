@@ -20,6 +20,7 @@
 #include <mutex>
 #include <thread>
 #include <openrave/utils.h>
+#include <openrave/openravemsgpack.h>
 #include <boost/scoped_ptr.hpp>
 #include <boost/filesystem/operations.hpp>
 
@@ -1764,6 +1765,60 @@ py::object PyEnvironmentBase::LoadJSON(py::object oEnvInfo, UpdateFromInfoMode u
     return py::make_tuple(createdBodies, modifiedBodies, removedBodies);
 }
 
+py::object PyEnvironmentBase::UpdateFromDelta(py::object oDelta, object odictatts)
+{
+    AttributesList dictatts = toAttributesList(odictatts);
+    rapidjson::Document rDelta;
+    toRapidJSONValue(oDelta, rDelta, rDelta.GetAllocator());
+    return _UpdateFromDelta(rDelta, dictatts);
+}
+
+py::object PyEnvironmentBase::UpdateFromDeltaMsgPack(const std::string& data, object odictatts)
+{
+    AttributesList dictatts = toAttributesList(odictatts);
+    rapidjson::Document rDelta;
+    MsgPack::ParseMsgPack(rDelta, data);
+    return _UpdateFromDelta(rDelta, dictatts);
+}
+
+py::object PyEnvironmentBase::_UpdateFromDelta(const rapidjson::Value& rDelta, const AttributesList& atts)
+{
+    std::vector<KinBodyPtr> vCreatedBodies, vModifiedBodies, vRemovedBodies;
+    bool bSuccess = false;
+    {
+        openravepy::PythonThreadSaver threadsaver;
+        bSuccess = _penv->UpdateFromDelta(rDelta, vCreatedBodies, vModifiedBodies, vRemovedBodies, atts);
+    }
+
+    if( !bSuccess ) {
+        return py::make_tuple(py::none_(), py::none_(), py::none_());
+    }
+
+    py::list createdBodies, modifiedBodies, removedBodies;
+    FOREACHC(itbody, vCreatedBodies) {
+        if ((*itbody)->IsRobot()) {
+            createdBodies.append(openravepy::toPyRobot(RaveInterfaceCast<RobotBase>(*itbody),shared_from_this()));
+        } else {
+            createdBodies.append(openravepy::toPyKinBody(*itbody,shared_from_this()));
+        }
+    }
+    FOREACHC(itbody, vModifiedBodies) {
+        if ((*itbody)->IsRobot()) {
+            modifiedBodies.append(openravepy::toPyRobot(RaveInterfaceCast<RobotBase>(*itbody),shared_from_this()));
+        } else {
+            modifiedBodies.append(openravepy::toPyKinBody(*itbody,shared_from_this()));
+        }
+    }
+    FOREACHC(itbody, vRemovedBodies) {
+        if ((*itbody)->IsRobot()) {
+            removedBodies.append(openravepy::toPyRobot(RaveInterfaceCast<RobotBase>(*itbody),shared_from_this()));
+        } else {
+            removedBodies.append(openravepy::toPyKinBody(*itbody,shared_from_this()));
+        }
+    }
+    return py::make_tuple(createdBodies, modifiedBodies, removedBodies);
+}
+
 bool PyEnvironmentBase::LoadData(const std::string &data) {
     openravepy::PythonThreadSaver threadsaver;
     return _penv->LoadData(data);
@@ -2175,6 +2230,9 @@ bool PyEnvironmentBase::HasRegisteredCollisionCallbacks()
 void PyEnvironmentBase::StepSimulation(dReal timeStep) {
     _penv->StepSimulation(timeStep);
 }
+void PyEnvironmentBase::FastForwardSimulation(int numsteps, dReal timeStep, int publishInterval) {
+    _penv->FastForwardSimulation(numsteps, timeStep, publishInterval);
+}
 void PyEnvironmentBase::StartSimulation(dReal fDeltaTime, bool bRealTime) {
     _penv->StartSimulation(fDeltaTime,bRealTime);
 }
@@ -2187,6 +2245,24 @@ uint64_t PyEnvironmentBase::GetSimulationTime() {
 bool PyEnvironmentBase::IsSimulationRunning() {
     return _penv->IsSimulationRunning();
 }
+void PyEnvironmentBase::SetSimulationStepThreads(int numthreads) {
+    _penv->SetSimulationStepThreads(numthreads);
+}
+int PyEnvironmentBase::GetSimulationStepThreads() {
+    return _penv->GetSimulationStepThreads();
+}
+object PyEnvironmentBase::GetSimulationStepTimes() {
+    EnvironmentBase::SimulationStepTimes times;
+    _penv->GetSimulationStepTimes(times);
+    py::dict otimes;
+    otimes["physics"] = times.physics;
+    otimes["bodies"] = times.bodies;
+    otimes["modules"] = times.modules;
+    otimes["sensors"] = times.sensors;
+    otimes["readonly"] = times.readonly;
+    otimes["total"] = times.total;
+    return otimes;
+}
 
 void PyEnvironmentBase::Lock()
 {
@@ -3084,11 +3160,14 @@ PyInterfaceBasePtr RaveCreateInterface(PyEnvironmentBasePtr pyenv, InterfaceType
 #ifndef USE_PYBIND11_PYTHON_BINDINGS
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(LoadURI_overloads, LoadURI, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(LoadJSON_overloads, LoadJSON, 2, 4)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(UpdateFromDelta_overloads, UpdateFromDelta, 1, 2)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(UpdateFromDeltaMsgPack_overloads, UpdateFromDeltaMsgPack, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ReadRobotJSON_overloads, ReadRobotJSON, 1, 3)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ReadKinBodyJSON_overloads, ReadKinBody, 1, 3)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(SetCamera_overloads, SetCamera, 2, 4)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(StartSimulation_overloads, StartSimulation, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(StopSimulation_overloads, StopSimulation, 0, 1)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(FastForwardSimulation_overloads, FastForwardSimulation, 2, 3)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(SetViewer_overloads, SetViewer, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(SetDefaultViewer_overloads, SetDefaultViewer, 0, 1)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(CheckCollisionRays_overloads, CheckCollisionRays, 2, 3)
@@ -3524,6 +3603,21 @@ Because race conditions can pop up when trying to lock the openrave environment
                           )
 #else
                      .def("LoadJSON",&PyEnvironmentBase::LoadJSON,LoadJSON_overloads(PY_ARGS("envInfo","updateMode","atts","uri") DOXY_FN(EnvironmentBase,LoadJSON)))
+#endif
+#ifdef USE_PYBIND11_PYTHON_BINDINGS
+                     .def("UpdateFromDelta", &PyEnvironmentBase::UpdateFromDelta,
+                          "delta"_a,
+                          "atts"_a = py::none_(),
+                          DOXY_FN(EnvironmentBase, UpdateFromDelta)
+                          )
+                     .def("UpdateFromDeltaMsgPack", &PyEnvironmentBase::UpdateFromDeltaMsgPack,
+                          "data"_a,
+                          "atts"_a = py::none_(),
+                          DOXY_FN(EnvironmentBase, UpdateFromDelta)
+                          )
+#else
+                     .def("UpdateFromDelta",&PyEnvironmentBase::UpdateFromDelta,UpdateFromDelta_overloads(PY_ARGS("delta","atts") DOXY_FN(EnvironmentBase,UpdateFromDelta)))
+                     .def("UpdateFromDeltaMsgPack",&PyEnvironmentBase::UpdateFromDeltaMsgPack,UpdateFromDeltaMsgPack_overloads(PY_ARGS("data","atts") DOXY_FN(EnvironmentBase,UpdateFromDelta)))
 #endif
                      .def("Load",load1, PY_ARGS("filename") DOXY_FN(EnvironmentBase,Load))
                      .def("Load",load2, PY_ARGS("filename","atts") DOXY_FN(EnvironmentBase,Load))
@@ -3634,6 +3728,16 @@ Because race conditions can pop up when trying to lock the openrave environment
                      .def("RegisterCollisionCallback",&PyEnvironmentBase::RegisterCollisionCallback, PY_ARGS("callback") DOXY_FN(EnvironmentBase,RegisterCollisionCallback))
                      .def("HasRegisteredCollisionCallbacks",&PyEnvironmentBase::HasRegisteredCollisionCallbacks,DOXY_FN(EnvironmentBase,HasRegisteredCollisionCallbacks))
                      .def("StepSimulation",&PyEnvironmentBase::StepSimulation, PY_ARGS("timestep") DOXY_FN(EnvironmentBase,StepSimulation))
+#ifdef USE_PYBIND11_PYTHON_BINDINGS
+                     .def("FastForwardSimulation", &PyEnvironmentBase::FastForwardSimulation,
+                          "numsteps"_a,
+                          "timestep"_a,
+                          "publishinterval"_a = 0,
+                          DOXY_FN(EnvironmentBase,FastForwardSimulation)
+                          )
+#else
+                     .def("FastForwardSimulation",&PyEnvironmentBase::FastForwardSimulation,FastForwardSimulation_overloads(PY_ARGS("numsteps","timestep","publishinterval") DOXY_FN(EnvironmentBase,FastForwardSimulation)))
+#endif
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
                      .def("StartSimulation", &PyEnvironmentBase::StartSimulation,
                           "timestep"_a,
@@ -3653,6 +3757,9 @@ Because race conditions can pop up when trying to lock the openrave environment
 #endif
                      .def("GetSimulationTime",&PyEnvironmentBase::GetSimulationTime, DOXY_FN(EnvironmentBase,GetSimulationTime))
                      .def("IsSimulationRunning",&PyEnvironmentBase::IsSimulationRunning, DOXY_FN(EnvironmentBase,IsSimulationRunning))
+                     .def("SetSimulationStepThreads",&PyEnvironmentBase::SetSimulationStepThreads, PY_ARGS("numthreads") DOXY_FN(EnvironmentBase,SetSimulationStepThreads))
+                     .def("GetSimulationStepThreads",&PyEnvironmentBase::GetSimulationStepThreads, DOXY_FN(EnvironmentBase,GetSimulationStepThreads))
+                     .def("GetSimulationStepTimes",&PyEnvironmentBase::GetSimulationStepTimes, DOXY_FN(EnvironmentBase,GetSimulationStepTimes))
                      .def("Lock",Lock1,"Locks the environment mutex.")
                      .def("Lock",Lock2,PY_ARGS("timeout") "Locks the environment mutex with a timeout.")
                      .def("Unlock",&PyEnvironmentBase::Unlock,"Unlocks the environment mutex.")
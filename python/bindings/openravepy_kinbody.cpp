@@ -4222,6 +4222,33 @@ object PyKinBody::GetAdjacentLinks() const
     return adjacent;
 }
 
+void PyKinBody::SetNeverCollidingLinksPairs(object olinkpairs)
+{
+    std::vector<std::pair<int, int> > linkIndices(len(olinkpairs));
+    for(size_t i = 0; i < linkIndices.size(); ++i) {
+        object olinkpair = olinkpairs[py::to_object(i)];
+        linkIndices[i].first = py::extract<int>(olinkpair[py::to_object(0)]);
+        linkIndices[i].second = py::extract<int>(olinkpair[py::to_object(1)]);
+    }
+    _pbody->SetNeverCollidingLinksPairs(linkIndices);
+}
+
+object PyKinBody::GetNeverCollidingLinksPairs() const
+{
+    std::vector<std::pair<int, int> > linkIndices;
+    _pbody->GetNeverCollidingLinksPairs(linkIndices);
+    py::list olinkpairs;
+    for(const std::pair<int, int>& linkpair : linkIndices) {
+        olinkpairs.append(py::make_tuple(linkpair.first, linkpair.second));
+    }
+    return olinkpairs;
+}
+
+bool PyKinBody::AreNeverCollidingLinks(int linkindex0, int linkindex1) const
+{
+    return _pbody->AreNeverCollidingLinks(linkindex0, linkindex1);
+}
+
 object PyKinBody::GetManageData() const
 {
     KinBody::ManageDataPtr pdata = _pbody->GetManageData();
@@ -6012,6 +6039,9 @@ void init_openravepy_kinbody()
                          .def("SetAdjacentLinks",&PyKinBody::SetAdjacentLinks, PY_ARGS("linkindex0", "linkindex1") DOXY_FN(KinBody,SetAdjacentLinks))
                          .def("SetAdjacentLinksCombinations",&PyKinBody::SetAdjacentLinksCombinations, PY_ARGS("linkIndices") DOXY_FN(KinBody,SetAdjacentLinksCombinations))
                          .def("GetAdjacentLinks",&PyKinBody::GetAdjacentLinks, DOXY_FN(KinBody,GetAdjacentLinks))
+                         .def("SetNeverCollidingLinksPairs",&PyKinBody::SetNeverCollidingLinksPairs, PY_ARGS("linkpairs") DOXY_FN(KinBody,SetNeverCollidingLinksPairs))
+                         .def("GetNeverCollidingLinksPairs",&PyKinBody::GetNeverCollidingLinksPairs, DOXY_FN(KinBody,GetNeverCollidingLinksPairs))
+                         .def("AreNeverCollidingLinks",&PyKinBody::AreNeverCollidingLinks, PY_ARGS("linkindex0", "linkindex1") DOXY_FN(KinBody,AreNeverCollidingLinks))
                          .def("GetManageData",&PyKinBody::GetManageData, DOXY_FN(KinBody,GetManageData))
                          .def("GetUpdateStamp",&PyKinBody::GetUpdateStamp, DOXY_FN(KinBody,GetUpdateStamp))
                          .def("serialize",&PyKinBody::serialize,PY_ARGS("options") DOXY_FN(KinBody,serialize))
@@ -99,6 +99,15 @@ void pyVerifyTrajectory(object pyparameters, PyTrajectoryBasePtr pytraj, dReal s
     OpenRAVE::planningutils::VerifyTrajectory(openravepy::GetPlannerParametersConst(pyparameters), openravepy::GetTrajectory(pytraj),samplingstep);
 }
 
+void pyVerifyTrajectoryParallel(object pyparameters, PyTrajectoryBasePtr pytraj, dReal samplingstep, int numthreads=0, bool abortonfirstfailure=true, bool releasegil=true)
+{
+    openravepy::PythonThreadSaverPtr statesaver;
+    if( releasegil ) {
+        statesaver.reset(new openravepy::PythonThreadSaver());
+    }
+    OpenRAVE::planningutils::VerifyTrajectoryParallel(openravepy::GetPlannerParametersConst(pyparameters), openravepy::GetTrajectory(pytraj),samplingstep,numthreads,abortonfirstfailure);
+}
+
 // GIL is assumed locked
 object pySmoothActiveDOFTrajectory(PyTrajectoryBasePtr pytraj, PyRobotBasePtr pyrobot, dReal fmaxvelmult=1.0, dReal fmaxaccelmult=1.0, const std::string& plannername="", const std::string& plannerparameters="")
 {
@@ -507,6 +516,43 @@ public:
 
 typedef OPENRAVE_SHARED_PTR<PyManipulatorIKGoalSampler> PyManipulatorIKGoalSamplerPtr;
 
+class PyTrajectoryWaypointStream
+{
+public:
+    PyTrajectoryWaypointStream(PyConfigurationSpecificationPtr pyspec, size_t capacity=1024) : _stream(new OpenRAVE::planningutils::TrajectoryWaypointStream(openravepy::GetConfigurationSpecification(pyspec), capacity)) {
+    }
+    virtual ~PyTrajectoryWaypointStream() {
+    }
+
+    bool Push(object owaypoint)
+    {
+        std::vector<dReal> vwaypoint = ExtractArray<dReal>(owaypoint);
+        if( (int)vwaypoint.size() != _stream->GetConfigurationSpecification().GetDOF() ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("waypoint has %d values, expected %d"), vwaypoint.size()%_stream->GetConfigurationSpecification().GetDOF(), ORE_InvalidArguments);
+        }
+        return _stream->Push(vwaypoint);
+    }
+
+    size_t Flush(PyTrajectoryBasePtr pytraj)
+    {
+        return _stream->Flush(openravepy::GetTrajectory(pytraj));
+    }
+
+    size_t GetNumPending() const
+    {
+        return _stream->GetNumPending();
+    }
+
+    object GetConfigurationSpecification() const
+    {
+        return py::to_object(openravepy::toPyConfigurationSpecification(_stream->GetConfigurationSpecification()));
+    }
+
+    OpenRAVE::planningutils::TrajectoryWaypointStreamPtr _stream;
+};
+
+typedef OPENRAVE_SHARED_PTR<PyTrajectoryWaypointStream> PyTrajectoryWaypointStreamPtr;
+
 
 } // end namespace planningutils
 
@@ -526,6 +572,7 @@ BOOST_PYTHON_FUNCTION_OVERLOADS(ExtendActiveDOFWaypoint_overloads, planningutils
 BOOST_PYTHON_FUNCTION_OVERLOADS(InsertActiveDOFWaypointWithRetiming_overloads, planningutils::pyInsertActiveDOFWaypointWithRetiming, 5, 9)
 BOOST_PYTHON_FUNCTION_OVERLOADS(InsertWaypointWithSmoothing_overloads, planningutils::pyInsertWaypointWithSmoothing, 4, 7)
 BOOST_PYTHON_FUNCTION_OVERLOADS(VerifyTrajectory_overloads, planningutils::pyVerifyTrajectory, 3, 4)
+BOOST_PYTHON_FUNCTION_OVERLOADS(VerifyTrajectoryParallel_overloads, planningutils::pyVerifyTrajectoryParallel, 3, 6)
 
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(Check_overloads, Check, 5, 8)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(CheckWithAccelerations_overloads, CheckWithAccelerations, 7, 10)
@@ -601,6 +648,18 @@ void InitPlanningUtils()
                                .def("VerifyTrajectory",planningutils::pyVerifyTrajectory, PY_ARGS("parameters","trajectory","samplingstep", "releasegil") DOXY_FN1(VerifyTrajectory))
                                .staticmethod("VerifyTrajectory")
 #endif
+#ifdef USE_PYBIND11_PYTHON_BINDINGS
+                               .def_static("VerifyTrajectoryParallel",planningutils::pyVerifyTrajectoryParallel,
+                                           "parameters"_a,
+                                           "trajectory"_a,
+                                           "samplingstep"_a,
+                                           "numthreads"_a=0,
+                                           "abortonfirstfailure"_a=true,
+                                           "releasegil"_a=true, DOXY_FN1(VerifyTrajectoryParallel))
+#else
+                               .def("VerifyTrajectoryParallel",planningutils::pyVerifyTrajectoryParallel, VerifyTrajectoryParallel_overloads(PY_ARGS("parameters","trajectory","samplingstep","numthreads","abortonfirstfailure","releasegil") DOXY_FN1(VerifyTrajectoryParallel)))
+                               .staticmethod("VerifyTrajectoryParallel")
+#endif
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
                                .def_static("SmoothActiveDOFTrajectory", planningutils::pySmoothActiveDOFTrajectory,
                                            "trajectory"_a,
@@ -861,6 +920,22 @@ void InitPlanningUtils()
         .def("GetIkParameterizationIndex", &planningutils::PyManipulatorIKGoalSampler::GetIkParameterizationIndex, PY_ARGS("index") DOXY_FN(planningutils::ManipulatorIKGoalSampler, GetIkParameterizationIndex))
         ;
 
+#ifdef USE_PYBIND11_PYTHON_BINDINGS
+        class_<planningutils::PyTrajectoryWaypointStream, planningutils::PyTrajectoryWaypointStreamPtr >(planningutils, "TrajectoryWaypointStream", DOXY_CLASS(planningutils::TrajectoryWaypointStream))
+        .def(init<PyConfigurationSpecificationPtr, size_t>(),
+             "spec"_a,
+             "capacity"_a = 1024
+             )
+#else
+        class_<planningutils::PyTrajectoryWaypointStream, planningutils::PyTrajectoryWaypointStreamPtr >("TrajectoryWaypointStream", DOXY_CLASS(planningutils::TrajectoryWaypointStream), no_init)
+        .def(init<PyConfigurationSpecificationPtr, optional<size_t> >(py::args("spec", "capacity")))
+#endif
+        .def("Push", &planningutils::PyTrajectoryWaypointStream::Push, PY_ARGS("waypoint") DOXY_FN(planningutils::TrajectoryWaypointStream, Push))
+        .def("Flush", &planningutils::PyTrajectoryWaypointStream::Flush, PY_ARGS("traj") DOXY_FN(planningutils::TrajectoryWaypointStream, Flush))
+        .def("GetNumPending", &planningutils::PyTrajectoryWaypointStream::GetNumPending, DOXY_FN(planningutils::TrajectoryWaypointStream, GetNumPending))
+        .def("GetConfigurationSpecification", &planningutils::PyTrajectoryWaypointStream::GetConfigurationSpecification, DOXY_FN(planningutils::TrajectoryWaypointStream, GetConfigurationSpecification))
+        ;
+
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
         class_<planningutils::PyActiveDOFTrajectorySmoother, planningutils::PyActiveDOFTrajectorySmootherPtr >(planningutils, "ActiveDOFTrajectorySmoother", DOXY_CLASS(planningutils::ActiveDOFTrajectorySmoother))
         .def(init<PyRobotBasePtr, const std::string&, const std::string&>(), "robot"_a, "plannername"_a, "plannerparameters"_a)
@@ -275,6 +275,7 @@ from . import convexdecomposition
 from . import linkstatistics
 from . import kinematicreachability
 from . import inversereachability
+from . import selfcollisionpairs
     
 # python 2.5 raises 'import *' not allowed with 'from .'
 from sys import version_info
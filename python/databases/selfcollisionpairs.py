@@ -0,0 +1,155 @@
+# -*- coding: utf-8 -*-
+# Copyright (C) 2009-2012 Rosen Diankov (rosen.diankov@gmail.com)
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Learns the link pairs of a robot that never collide inside its joint limits.
+
+`[source] <../_modules/openravepy/databases/selfcollisionpairs.html>`_
+
+**Running the Generator**
+
+.. code-block:: bash
+
+  openrave.py --database selfcollisionpairs --robot=robots/barrettwam.robot.xml --numthreads=4
+
+Usage
+-----
+
+Prune the self-collision pairs of a robot:
+
+.. code-block:: python
+
+  scmodel = openravepy.databases.selfcollisionpairs.SelfCollisionPairsModel(robot)
+  if not scmodel.load():
+      scmodel.autogenerate()
+  scmodel.setrobot()
+
+Description
+-----------
+
+The joint limits of the robot are randomly sampled in parallel, every thread using its own clone of the environment. The non-adjacent link pairs that did not collide in any sample are stored with the kinematics and geometry hash of the robot. Setting them with `.KinBody.SetNeverCollidingLinksPairs` removes them from `.KinBody.GetNonAdjacentLinks`, so the collision checkers do not test them during self-collision checking.
+
+Since the pairs are learned from samples, there is a small chance that a pair can collide in a configuration that was never sampled. Increase **numsamples** for robots with many degrees of freedom.
+
+Command-line
+------------
+
+.. shell-block:: python3 -m openravepy --database selfcollisionpairs --help
+
+Class Definitions
+-----------------
+
+"""
+from __future__ import with_statement # for python 2.5
+__author__ = 'Rosen Diankov'
+__copyright__ = 'Copyright (C) 2009-2012 Rosen Diankov (rosen.diankov@gmail.com)'
+__license__ = 'Apache License, Version 2.0'
+
+from ..openravepy_int import RaveFindDatabaseFile, RaveDestroy, Environment
+from . import DatabaseGenerator
+from .. import interfaces
+import time
+import os.path
+
+import logging
+log = logging.getLogger('openravepy.'+__name__.split('.',2)[-1])
+
+class SelfCollisionPairsModel(DatabaseGenerator):
+    """Learns the link pairs of the robot that never collide"""
+
+    linkpairs = None # list of (linkindex0, linkindex1) that never collide
+    def __init__(self,robot):
+        DatabaseGenerator.__init__(self,robot=robot)
+
+    def has(self):
+        return self.linkpairs is not None
+
+    def getversion(self):
+        return 1
+
+    def save(self):
+        DatabaseGenerator.save(self,self.linkpairs)
+
+    def load(self):
+        try:
+            params = DatabaseGenerator.load(self)
+        except Exception as e:
+            log.warn(u'failed to load selfcollisionpairs: %s', e)
+            return False
+
+        if params is None:
+            return False
+        self.linkpairs = params
+        return self.has()
+
+    def getfilename(self,read=False):
+        return RaveFindDatabaseFile(os.path.join('robot.'+self.robot.GetKinematicsGeometryHash(), 'selfcollisionpairs.pp'),read)
+
+    def setrobot(self):
+        """sets the never colliding link pairs on the robot so that they are pruned from the self-collision checks
+        """
+        with self.env:
+            self.robot.SetNeverCollidingLinksPairs(self.linkpairs)
+
+    def autogenerateparams(self,options=None):
+        numsamples = None
+        numthreads = None
+        if options is not None:
+            if options.numsamples is not None:
+                numsamples = options.numsamples
+            numthreads = options.numthreads
+        return numsamples,numthreads
+
+    def generate(self,numsamples=None,numthreads=None,seed=None):
+        """
+        :param numsamples: the number of configurations to sample, by default 10000*DOF
+        :param numthreads: the number of threads to sample with
+        """
+        if numsamples is None:
+            numsamples = 10000*self.robot.GetDOF()
+        starttime = time.time()
+        basemanip = interfaces.BaseManipulation(self.robot)
+        with self.env:
+            numcandidates = len(self.robot.GetNonAdjacentLinks())+len(self.robot.GetNeverCollidingLinksPairs())
+            self.linkpairs = basemanip.ComputeNeverCollidingLinksPairs(numsamples=numsamples,numthreads=numthreads,seed=seed)
+        log.info('robot %s has %d/%d never colliding link pairs, computed in %fs',self.robot.GetName(),len(self.linkpairs),numcandidates,time.time()-starttime)
+
+    def show(self,options=None):
+        for linkindex0,linkindex1 in self.linkpairs:
+            print('%s %s'%(self.robot.GetLinks()[linkindex0].GetName(),self.robot.GetLinks()[linkindex1].GetName()))
+
+    @staticmethod
+    def CreateOptionParser():
+        parser = DatabaseGenerator.CreateOptionParser(useManipulator=False)
+        parser.description='Learns the link pairs of the robot that never collide inside its joint limits'
+        parser.usage='openrave.py --database selfcollisionpairs [options]'
+        parser.add_option('--numsamples',action='store',type='int',dest='numsamples',default=None,
+                          help='number of configurations to sample (default=10000*DOF)')
+        return parser
+
+    @staticmethod
+    def RunFromParser(Model=None,parser=None,**kwargs):
+        if parser is None:
+            parser = SelfCollisionPairsModel.CreateOptionParser()
+        env = Environment()
+        try:
+            if Model is None:
+                Model = lambda robot: SelfCollisionPairsModel(robot=robot)
+            DatabaseGenerator.RunFromParser(env=env,Model=Model,parser=parser,**kwargs)
+        finally:
+            env.Destroy()
+            RaveDestroy()
+
+def run(*args,**kwargs):
+    """Command-line execution of the example. ``args`` specifies a list of the arguments to the script.
+    """
+    SelfCollisionPairsModel.RunFromParser(*args,**kwargs)
@@ -299,6 +299,24 @@ class BaseManipulation:
             traj=newtraj
         return final,traj
     
+    def ComputeNeverCollidingLinksPairs(self,numsamples=None,numthreads=None,seed=None):
+        """See :ref:`module-basemanipulation-computenevercollidinglinkspairs`
+
+        :return: list of (linkindex0, linkindex1) pairs that never collided in the samples
+        """
+        cmd = 'ComputeNeverCollidingLinksPairs '
+        if numsamples is not None:
+            cmd += 'numsamples %d '%numsamples
+        if numthreads is not None:
+            cmd += 'numthreads %d '%numthreads
+        if seed is not None:
+            cmd += 'seed %d '%seed
+        res = self.prob.SendCommand(cmd)
+        if res is None:
+            raise PlanningError('ComputeNeverCollidingLinksPairs')
+        resvalues = [int(s) for s in res.split()]
+        return [(resvalues[1+2*i],resvalues[2+2*i]) for i in range(resvalues[0])]
+    
     def FindIKWithFilters(self,ikparam,cone=None,solveall=None,filteroptions=None):
         """See :ref:`module-basemanipulation-findikwithfilters`
         """
@@ -58,7 +58,7 @@ class Grasper:
         clone.avoidlinks = [clone.robot.GetLink(link.GetName()) for link in self.avoidlinks]
         envother.Add(clone.prob,True,clone.args)
         return clone
-    def Grasp(self, direction=None, roll=None, position=None, standoff=None, target=None, stablecontacts=False, forceclosure=False, transformrobot=True, onlycontacttarget=True, tightgrasp=False, graspingnoise=None, execute=None, translationstepmult=None, outputfinal=False, manipulatordirection=None, coarsestep=None, finestep=None, vintersectplane=None, chuckingdirection=None, ordereddofindices=None, avoidcontact=False):
+    def Grasp(self, direction=None, roll=None, position=None, standoff=None, target=None, stablecontacts=False, forceclosure=False, transformrobot=True, onlycontacttarget=True, tightgrasp=False, graspingnoise=None, execute=None, translationstepmult=None, outputfinal=False, manipulatordirection=None, coarsestep=None, finestep=None, vintersectplane=None, chuckingdirection=None, ordereddofindices=None, avoidcontact=False, targetdistancefield=None):
         """See :ref:`module-grasper-grasp`
         """
         cmd = 'Grasp '
@@ -97,6 +97,8 @@ class Grasper:
                 cmd += '%d '%value
         if avoidcontact:
             cmd += 'avoidcontact '
+        if targetdistancefield is not None:
+            cmd += 'targetdistancefield %.15e '%targetdistancefield
         res = self.prob.SendCommand(cmd)
         if res is None:
             raise PlanningError('Grasp failed')
@@ -119,7 +121,7 @@ class Grasper:
         contacts = reshape(array([float64(s) for s in resvalues],float64),(len(resvalues)//6,6))
         return contacts,finalconfig,mindist,volume
 
-    def GraspThreaded(self,approachrays,standoffs,preshapes,rolls,manipulatordirections=None,target=None,transformrobot=True,onlycontacttarget=True,tightgrasp=False,graspingnoise=None,forceclosurethreshold=None,collisionchecker=None,translationstepmult=None,numthreads=None,startindex=None,maxgrasps=None,finestep=None):
+    def GraspThreaded(self,approachrays,standoffs,preshapes,rolls,manipulatordirections=None,target=None,transformrobot=True,onlycontacttarget=True,tightgrasp=False,graspingnoise=None,forceclosurethreshold=None,collisionchecker=None,translationstepmult=None,numthreads=None,startindex=None,maxgrasps=None,finestep=None,frictionconefacets=None,targetdistancefield=None):
         """See :ref:`module-grasper-graspthreaded`
         """
         cmd = 'GraspThreaded '
@@ -140,6 +142,10 @@ class Grasper:
             cmd += 'translationstepmult %.15e '%translationstepmult
         if finestep is not None:
             cmd += 'finestep %.15e '%finestep
+        if frictionconefacets is not None:
+            cmd += 'frictionconefacets %d '%frictionconefacets
+        if targetdistancefield is not None:
+            cmd += 'targetdistancefield %.15e '%targetdistancefield
         if numthreads is not None:
             cmd += 'numthreads %d '%numthreads
         cmd += 'approachrays %d '%len(approachrays)
@@ -181,6 +187,29 @@ class Grasper:
             resvalues.append([position, direction, roll, standoff, manipulatordirection, mindist, volume, preshape,Tfinal,finalshape,contacts])
         return nextid, resvalues
 
+    def ComputeGraspQualities(self,graspcontacts,frictionconefacets=None,prune=None):
+        """Computes the force closure of many grasps at once.
+
+        :param graspcontacts: list of the contacts of each grasp, each contact is a row of position and normal (Nx6)
+        :param prune: if True, does not compute the volume of grasps that are obviously not force closure
+        :return: array of the mindist and volume of each grasp
+        """
+        cmd = 'ComputeGraspQualities '
+        if self.friction is not None:
+            cmd += 'friction %.15e '%self.friction
+        if frictionconefacets is not None:
+            cmd += 'frictionconefacets %d '%frictionconefacets
+        if prune is not None:
+            cmd += 'prune %d '%prune
+        cmd += 'grasps %d '%len(graspcontacts)
+        for contacts in graspcontacts:
+            contacts = reshape(array(contacts,float64),(-1,6))
+            cmd += '%d '%len(contacts) + ' '.join('%.15e'%f for f in contacts.flat) + ' '
+        res = self.prob.SendCommand(cmd)
+        if res is None:
+            raise PlanningError('ComputeGraspQualities')
+        return reshape(array([float64(s) for s in res.split()],float64),(len(graspcontacts),2))
+
     def ConvexHull(self,points,returnplanes=True,returnfaces=True,returntriangles=True):
         """See :ref:`module-grasper-convexhull`
         """
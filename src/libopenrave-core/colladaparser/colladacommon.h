@@ -139,11 +139,129 @@ public:
         return pNew;
     }
 
+    /// \brief serializes the bindings so that bodies restored from the collada cache can still be written with external references
+    bool SerializeJSON(rapidjson::Value& value, rapidjson::Document::AllocatorType& allocator, dReal fUnitScale, int options) const override {
+        value.SetObject();
+        rapidjson::Value rArticulatedSystemURIs(rapidjson::kArrayType);
+        FOREACHC(it, _articulated_systemURIs) {
+            rapidjson::Value rURI(rapidjson::kObjectType);
+            orjson::SetJsonValueByKey(rURI, "uri", it->first, allocator);
+            orjson::SetJsonValueByKey(rURI, "isExternal", it->second, allocator);
+            rArticulatedSystemURIs.PushBack(rURI, allocator);
+        }
+        value.AddMember("articulatedSystemURIs", rArticulatedSystemURIs, allocator);
+        rapidjson::Value rModelBindings(rapidjson::kArrayType);
+        FOREACHC(it, _bindingModelURIs) {
+            rapidjson::Value rBinding(rapidjson::kObjectType);
+            orjson::SetJsonValueByKey(rBinding, "kmodel", it->kmodel, allocator);
+            orjson::SetJsonValueByKey(rBinding, "pmodel", it->pmodel, allocator);
+            orjson::SetJsonValueByKey(rBinding, "vmodel", it->vmodel, allocator);
+            orjson::SetJsonValueByKey(rBinding, "ikmodelsidref", it->ikmodelsidref, allocator);
+            rModelBindings.PushBack(rBinding, allocator);
+        }
+        value.AddMember("modelBindings", rModelBindings, allocator);
+        rapidjson::Value rAxisBindings(rapidjson::kArrayType), rPassiveAxisBindings(rapidjson::kArrayType);
+        FOREACHC(it, _bindingAxesSIDs) {
+            rapidjson::Value rBinding;
+            _SerializeAxisBinding(*it, rBinding, allocator);
+            rAxisBindings.PushBack(rBinding, allocator);
+        }
+        FOREACHC(it, _bindingPassiveAxesSIDs) {
+            rapidjson::Value rBinding;
+            _SerializeAxisBinding(*it, rBinding, allocator);
+            rPassiveAxisBindings.PushBack(rBinding, allocator);
+        }
+        value.AddMember("axisBindings", rAxisBindings, allocator);
+        value.AddMember("passiveAxisBindings", rPassiveAxisBindings, allocator);
+        rapidjson::Value rLinkBindings(rapidjson::kArrayType);
+        FOREACHC(it, _bindingLinkSIDs) {
+            rapidjson::Value rBinding(rapidjson::kObjectType);
+            orjson::SetJsonValueByKey(rBinding, "kmodel", it->kmodel, allocator);
+            orjson::SetJsonValueByKey(rBinding, "pmodel", it->pmodel, allocator);
+            orjson::SetJsonValueByKey(rBinding, "vmodel", it->vmodel, allocator);
+            orjson::SetJsonValueByKey(rBinding, "index", it->index, allocator);
+            rLinkBindings.PushBack(rBinding, allocator);
+        }
+        value.AddMember("linkBindings", rLinkBindings, allocator);
+        return true;
+    }
+
+    bool DeserializeJSON(const rapidjson::Value& value, dReal fUnitScale) override {
+        if( !value.IsObject() ) {
+            return false;
+        }
+        _articulated_systemURIs.clear();
+        _bindingModelURIs.clear();
+        _bindingAxesSIDs.clear();
+        _bindingPassiveAxesSIDs.clear();
+        _bindingLinkSIDs.clear();
+        rapidjson::Value::ConstMemberIterator it = value.FindMember("articulatedSystemURIs");
+        if( it != value.MemberEnd() && it->value.IsArray() ) {
+            for(rapidjson::Value::ConstValueIterator itURI = it->value.Begin(); itURI != it->value.End(); ++itURI) {
+                std::pair<std::string, bool> uri(std::string(), false);
+                orjson::LoadJsonValueByKey(*itURI, "uri", uri.first);
+                orjson::LoadJsonValueByKey(*itURI, "isExternal", uri.second);
+                _articulated_systemURIs.push_back(uri);
+            }
+        }
+        it = value.FindMember("modelBindings");
+        if( it != value.MemberEnd() && it->value.IsArray() ) {
+            for(rapidjson::Value::ConstValueIterator itBinding = it->value.Begin(); itBinding != it->value.End(); ++itBinding) {
+                ModelBinding binding;
+                orjson::LoadJsonValueByKey(*itBinding, "kmodel", binding.kmodel);
+                orjson::LoadJsonValueByKey(*itBinding, "pmodel", binding.pmodel);
+                orjson::LoadJsonValueByKey(*itBinding, "vmodel", binding.vmodel);
+                orjson::LoadJsonValueByKey(*itBinding, "ikmodelsidref", binding.ikmodelsidref);
+                _bindingModelURIs.push_back(binding);
+            }
+        }
+        it = value.FindMember("axisBindings");
+        if( it != value.MemberEnd() && it->value.IsArray() ) {
+            for(rapidjson::Value::ConstValueIterator itBinding = it->value.Begin(); itBinding != it->value.End(); ++itBinding) {
+                _bindingAxesSIDs.push_back(_DeserializeAxisBinding(*itBinding));
+            }
+        }
+        it = value.FindMember("passiveAxisBindings");
+        if( it != value.MemberEnd() && it->value.IsArray() ) {
+            for(rapidjson::Value::ConstValueIterator itBinding = it->value.Begin(); itBinding != it->value.End(); ++itBinding) {
+                _bindingPassiveAxesSIDs.push_back(_DeserializeAxisBinding(*itBinding));
+            }
+        }
+        it = value.FindMember("linkBindings");
+        if( it != value.MemberEnd() && it->value.IsArray() ) {
+            for(rapidjson::Value::ConstValueIterator itBinding = it->value.Begin(); itBinding != it->value.End(); ++itBinding) {
+                LinkBinding binding;
+                orjson::LoadJsonValueByKey(*itBinding, "kmodel", binding.kmodel);
+                orjson::LoadJsonValueByKey(*itBinding, "pmodel", binding.pmodel);
+                orjson::LoadJsonValueByKey(*itBinding, "vmodel", binding.vmodel);
+                orjson::LoadJsonValueByKey(*itBinding, "index", binding.index);
+                _bindingLinkSIDs.push_back(binding);
+            }
+        }
+        return true;
+    }
+
     std::list< std::pair<std::string, bool> > _articulated_systemURIs; ///< pairs of (urls, isexternal) of the articulated_system, ordered in the same way as they are read. The first is the top-most level
     std::vector<ModelBinding> _bindingModelURIs;
     std::vector<AxisBinding> _bindingAxesSIDs; ///< same order as the body DOF
     std::list<AxisBinding> _bindingPassiveAxesSIDs; ///< same order as body->GetPassiveJoints()
     std::vector<LinkBinding> _bindingLinkSIDs; ///< link bindings, SID for link, rigidbody, but URL for vmodel (node). same order as link indices
+
+private:
+    static void _SerializeAxisBinding(const AxisBinding& binding, rapidjson::Value& value, rapidjson::Document::AllocatorType& allocator) {
+        value.SetObject();
+        orjson::SetJsonValueByKey(value, "kmodelaxissidref", binding.kmodelaxissidref, allocator);
+        orjson::SetJsonValueByKey(value, "nodesid", binding.nodesid, allocator);
+        orjson::SetJsonValueByKey(value, "jointsidref", binding.jointsidref, allocator);
+    }
+
+    static AxisBinding _DeserializeAxisBinding(const rapidjson::Value& value) {
+        AxisBinding binding;
+        orjson::LoadJsonValueByKey(value, "kmodelaxissidref", binding.kmodelaxissidref);
+        orjson::LoadJsonValueByKey(value, "nodesid", binding.nodesid);
+        orjson::LoadJsonValueByKey(value, "jointsidref", binding.jointsidref);
+        return binding;
+    }
 };
 
 typedef boost::shared_ptr<ColladaXMLReadable> ColladaXMLReadablePtr;
@@ -18,13 +18,19 @@
 #include <boost/algorithm/string.hpp>
 #include <openrave/xmlreaders.h>
 #include <openrave/openravejson.h>
+#include <openrave/openravemsgpack.h>
 #include <libxml/xmlversion.h>
+#include <atomic>
+#include <thread>
+#include <boost/filesystem.hpp>
 
 namespace OpenRAVE
 {
 
 using namespace ColladaDOM150;
 
+static const size_t s_nMinParallelMeshVertices = 100000; ///< minimum number of mesh vertices of a node before its meshes are processed in parallel
+
 class ColladaReader : public daeErrorHandler
 {
 public:
@@ -358,6 +364,56 @@ public:
         return _InitPostOpen(atts);
     }
 
+    /// \brief gets the local files of all documents that were opened for the extraction, documents extracted from zae archives are skipped
+    void GetDocumentFilenames(std::vector<std::string>& vfilenames) const
+    {
+        vfilenames.resize(0);
+        daeDatabase* pdatabase = _dae->getDatabase();
+        for(daeUInt idoc = 0; idoc < pdatabase->getDocumentCount(); ++idoc) {
+            daeDocument* pdoc = pdatabase->getDocument(idoc);
+            if( !pdoc || !pdoc->getDocumentURI() || pdoc->getDocumentURI()->scheme() != "file" || pdoc->getExtractedFileURI().str().size() > 0 ) {
+                continue;
+            }
+            std::string filename = cdom::uriToNativePath(pdoc->getDocumentURI()->str());
+            if( filename.size() > 0 && find(vfilenames.begin(), vfilenames.end(), filename) == vfilenames.end() ) {
+                vfilenames.push_back(filename);
+            }
+        }
+    }
+
+    /// \brief serializes the info of a body returned by Extract before it is added to the environment.
+    ///
+    /// ExtractInfo needs the internal information that is computed when adding the body, so compute it here and reset the body back to its uninitialized state. Adding the body computes it again.
+    static void SerializeExtractedBodyInfo(KinBodyPtr pbody, rapidjson::Document& rInfo)
+    {
+        rInfo.SetObject();
+        pbody->KinBody::_ComputeInternalInformation();
+        try {
+            if( pbody->IsRobot() ) {
+                RobotBase::RobotBaseInfo info;
+                RaveInterfaceCast<RobotBase>(pbody)->ExtractInfo(info, EIO_Everything);
+                info.SerializeJSON(rInfo, rInfo.GetAllocator(), 1.0, 0);
+            }
+            else {
+                KinBody::KinBodyInfo info;
+                pbody->ExtractInfo(info, EIO_Everything);
+                info.SerializeJSON(rInfo, rInfo.GetAllocator(), 1.0, 0);
+            }
+            // the info skips the collada bindings, but the writer needs them for external references
+            ColladaXMLReadablePtr pcolladainfo = boost::dynamic_pointer_cast<ColladaXMLReadable>(pbody->GetReadableInterface(ColladaXMLReadable::GetXMLIdStatic()));
+            if( !!pcolladainfo ) {
+                rapidjson::Value rColladaInfo;
+                pcolladainfo->SerializeJSON(rColladaInfo, rInfo.GetAllocator(), 1.0, 0);
+                orjson::SetJsonValueByKey(rInfo, ColladaXMLReadable::GetXMLIdStatic().c_str(), rColladaInfo, rInfo.GetAllocator());
+            }
+        }
+        catch(...) {
+            pbody->_nHierarchyComputed = 0;
+            throw;
+        }
+        pbody->_nHierarchyComputed = 0;
+    }
+
     bool _InitPreOpen(const AttributesList& atts)
     {
         _mapInstantiatedNodes.clear();
@@ -2463,6 +2519,8 @@ public:
         vscale *= _GetUnitScale(pdomnode, _fGlobalScale); // TODO should track the scale per each listGeometryInfos
 
 
+        std::vector< std::pair<TriMesh*, TransformMatrix> > vMeshTransforms; // meshes are transformed after the loop since they can be large
+        size_t nMeshVertices = 0;
         FOREACH(itgeominfo, listGeometryInfos) {
             //  Switch between different type of geometry PRIMITIVES
             Transform toriginal = itgeominfo->GetTransform();
@@ -2492,7 +2550,8 @@ public:
                 itgeominfo->_vGeomData.y *= vscale.z;
                 break;
             case GT_TriMesh:
-                itgeominfo->_meshcollision.ApplyTransform(TransformMatrix(tmnodegeom * toriginal).inverse() * TransformMatrix(toriginal));
+                vMeshTransforms.emplace_back(&itgeominfo->_meshcollision, TransformMatrix(tmnodegeom * toriginal).inverse() * TransformMatrix(toriginal));
+                nMeshVertices += itgeominfo->_meshcollision.vertices.size();
                 break;
             case GT_CalibrationBoard:
                 itgeominfo->_vGeomData *= vscale;
@@ -2503,19 +2562,80 @@ public:
                 RAVELOG_WARN(str(boost::format("unknown geometry type: 0x%x")%itgeominfo->_type));
             }
 
+        }
+
+        // the meshes are independent of each other, so large ones are transformed in parallel
+        const bool bParallel = nMeshVertices >= s_nMinParallelMeshVertices;
+        _ParallelFor(vMeshTransforms.size(), bParallel, [&vMeshTransforms](size_t imesh) {
+            vMeshTransforms[imesh].first->ApplyTransform(vMeshTransforms[imesh].second);
+        });
+
+        std::vector<KinBody::Link::GeometryPtr> vNewGeometries;
+        vNewGeometries.reserve(listGeometryInfos.size());
+        FOREACH(itgeominfo, listGeometryInfos) {
             KinBody::Link::GeometryPtr pgeom(new KinBody::Link::Geometry(plink,*itgeominfo));
-            pgeom->_info._id = str(boost::format("geom%d")%plink->_vGeometries.size());
+            pgeom->_info._id = str(boost::format("geom%d")%(plink->_vGeometries.size()+vNewGeometries.size()));
             pgeom->_info.InitCollisionMesh();
-            plink->_vGeometries.push_back(pgeom);
-            //  Append the collision mesh
-            TriMesh trimesh = pgeom->GetCollisionMesh();
-            trimesh.ApplyTransform(pgeom->_info.GetTransform());
-            plink->_collision.Append(trimesh);
+            vNewGeometries.push_back(pgeom);
+        }
+
+        std::vector<TriMesh> vLinkMeshes(vNewGeometries.size());
+        _ParallelFor(vNewGeometries.size(), bParallel, [&vNewGeometries, &vLinkMeshes](size_t igeom) {
+            vLinkMeshes[igeom] = vNewGeometries[igeom]->GetCollisionMesh();
+            vLinkMeshes[igeom].ApplyTransform(vNewGeometries[igeom]->_info.GetTransform());
+        });
+
+        //  Append the geometries and their collision meshes in order
+        for(size_t igeom = 0; igeom < vNewGeometries.size(); ++igeom) {
+            plink->_vGeometries.push_back(vNewGeometries[igeom]);
+            plink->_collision.Append(vLinkMeshes[igeom]);
         }
 
         return bhasgeometry || listGeometryInfos.size() > 0;
     }
 
+    /// \brief calls fn for every index in [0, num), spreading them over several threads if bParallel is true. Rethrows the first exception after all threads are done.
+    static void _ParallelFor(size_t num, bool bParallel, const std::function<void(size_t)>& fn)
+    {
+        const size_t numthreads = !bParallel || num < 2 ? 1 : std::min(num, (size_t)std::max(1u, std::thread::hardware_concurrency()));
+        if( numthreads <= 1 ) {
+            for(size_t index = 0; index < num; ++index) {
+                fn(index);
+            }
+            return;
+        }
+
+        std::atomic<size_t> nextindex(0);
+        std::mutex mutexException;
+        std::exception_ptr pexception;
+        auto processIndices = [&]() {
+            for(size_t index = nextindex++; index < num; index = nextindex++) {
+                try {
+                    fn(index);
+                }
+                catch(...) {
+                    std::lock_guard<std::mutex> lock(mutexException);
+                    if( !pexception ) {
+                        pexception = std::current_exception();
+                    }
+                    nextindex = num; // stop the other threads
+                }
+            }
+        };
+        std::vector<std::thread> vthreads;
+        vthreads.reserve(numthreads-1);
+        for(size_t ithread = 1; ithread < numthreads; ++ithread) {
+            vthreads.emplace_back(processIndices);
+        }
+        processIndices();
+        for(std::thread& t : vthreads) {
+            t.join();
+        }
+        if( !!pexception ) {
+            std::rethrow_exception(pexception);
+        }
+    }
+
     /// Paint the Geometry with the color material
     /// \param  pmat    Material info of the COLLADA's model
     /// \param  geom    Geometry properties in OpenRAVE
@@ -5918,6 +6038,347 @@ private:
     bool _bMustResolveURI; ///< if true, throw exception if uri does not resolve
 };
 
+static const char s_colladaCacheMagic[8] = {'O','R','C','D','C','0','0','1'};
+
+/// \brief body converted from a collada file
+class ColladaCacheEntry
+{
+public:
+    std::vector< std::pair<std::string, std::string> > vDocumentHashes; ///< local filename and md5 hash of the documents referenced by the file, checked before using the entry
+    rapidjson::Document rInfo; ///< serialized KinBodyInfo or RobotBaseInfo with unit scale 1
+};
+typedef boost::shared_ptr<ColladaCacheEntry> ColladaCacheEntryPtr;
+
+static const size_t s_nColladaCacheMaxEntries = 32; ///< maximum number of entries kept in memory
+static const uint64_t s_nColladaCacheMaxBytes = 1024*1024*1024; ///< maximum size of the cache directory
+
+static std::mutex s_colladaCacheMutex; ///< protects s_mapColladaCacheEntries and s_listColladaCacheKeys
+static std::map<std::string, ColladaCacheEntryPtr> s_mapColladaCacheEntries; ///< entries used by this process indexed by their cache key
+static std::list<std::string> s_listColladaCacheKeys; ///< keys of s_mapColladaCacheEntries from the least to the most recently used
+
+/// \brief converted bodies are only cached in memory and under the openrave home directory if enabled by setting OPENRAVE_COLLADA_CACHE=1
+static bool _IsColladaCacheEnabled()
+{
+    const char* pOPENRAVE_COLLADA_CACHE = std::getenv("OPENRAVE_COLLADA_CACHE");
+    return !!pOPENRAVE_COLLADA_CACHE && std::string(pOPENRAVE_COLLADA_CACHE) == "1";
+}
+
+/// \brief makes the entry of key the most recently used one and removes the least recently used ones beyond s_nColladaCacheMaxEntries. s_colladaCacheMutex should be locked.
+static void _UseColladaCacheEntry(const std::string& key, ColladaCacheEntryPtr pentry)
+{
+    std::map<std::string, ColladaCacheEntryPtr>::iterator it = s_mapColladaCacheEntries.find(key);
+    if( it != s_mapColladaCacheEntries.end() ) {
+        s_listColladaCacheKeys.remove(key);
+        it->second = pentry;
+    }
+    else {
+        s_mapColladaCacheEntries[key] = pentry;
+    }
+    s_listColladaCacheKeys.push_back(key);
+    while( s_listColladaCacheKeys.size() > s_nColladaCacheMaxEntries ) {
+        s_mapColladaCacheEntries.erase(s_listColladaCacheKeys.front());
+        s_listColladaCacheKeys.pop_front();
+    }
+}
+
+static bool _GetColladaFileHash(const std::string& filename, std::string& hash)
+{
+    std::ifstream ifs(filename.c_str(), std::ios::binary);
+    if( !ifs ) {
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    hash = utils::GetMD5HashString(data);
+    return true;
+}
+
+/// \brief the key covers everything that changes the converted body: the file contents, the reader options, the environment unit and the openrave version
+static std::string _GetColladaCacheKey(EnvironmentBasePtr penv, const std::string& filename, const std::string& filehash, bool bRobot, const AttributesList& atts)
+{
+    std::stringstream ss;
+    ss << filename << "\n" << filehash << "\n" << OPENRAVE_VERSION_STRING << "\n" << GetLengthUnitString(penv->GetUnitInfo().lengthUnit) << "\n" << (int)bRobot << "\n";
+    FOREACHC(itatt, atts) {
+        ss << itatt->first << "=" << itatt->second << "\n";
+    }
+    return ss.str();
+}
+
+static std::string _GetColladaCacheFilename(const std::string& key)
+{
+    return RaveGetHomeDirectory() + s_filesep + "colladacache" + s_filesep + utils::GetMD5HashString(key) + ".bin";
+}
+
+/// \brief reads a length prefixed string, failing if the length goes past filesize
+static bool _ReadColladaCacheString(std::istream& is, uint64_t filesize, std::string& value)
+{
+    uint32_t size = 0;
+    is.read(reinterpret_cast<char*>(&size), sizeof(size));
+    if( !is ) {
+        return false;
+    }
+    const std::streamoff pos = is.tellg();
+    if( pos < 0 || (uint64_t)pos + size > filesize ) {
+        return false;
+    }
+    value.resize(size);
+    is.read(&value[0], size);
+    return !!is;
+}
+
+static void _WriteColladaCacheString(std::ostream& os, const std::string& value)
+{
+    const uint32_t size = value.size();
+    os.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    os.write(value.c_str(), size);
+}
+
+/// \brief reads the entry of the key from disk. The info is stored as msgpack if available since it is much faster to parse than json text
+static ColladaCacheEntryPtr _ReadColladaCacheEntry(const std::string& cacheFilename, const std::string& key)
+{
+    std::ifstream ifs(cacheFilename.c_str(), std::ios::binary);
+    if( !ifs ) {
+        return ColladaCacheEntryPtr();
+    }
+    ifs.seekg(0, std::ios::end);
+    const std::streamoff filesizeoff = ifs.tellg();
+    ifs.seekg(0, std::ios::beg);
+    if( !ifs || filesizeoff < 0 ) {
+        return ColladaCacheEntryPtr();
+    }
+    const uint64_t filesize = filesizeoff;
+    char magic[sizeof(s_colladaCacheMagic)];
+    ifs.read(magic, sizeof(magic));
+    std::string storedKey;
+    if( !ifs || std::memcmp(magic, s_colladaCacheMagic, sizeof(magic)) != 0 || !_ReadColladaCacheString(ifs, filesize, storedKey) || storedKey != key ) {
+        // md5 collision or stale file
+        return ColladaCacheEntryPtr();
+    }
+    ColladaCacheEntryPtr pentry(new ColladaCacheEntry());
+    uint32_t numDocuments = 0;
+    ifs.read(reinterpret_cast<char*>(&numDocuments), sizeof(numDocuments));
+    // every document has at least the lengths of its two strings
+    if( !ifs || numDocuments > filesize/(2*sizeof(uint32_t)) ) {
+        return ColladaCacheEntryPtr();
+    }
+    pentry->vDocumentHashes.resize(numDocuments);
+    FOREACH(itdocument, pentry->vDocumentHashes) {
+        if( !_ReadColladaCacheString(ifs, filesize, itdocument->first) || !_ReadColladaCacheString(ifs, filesize, itdocument->second) ) {
+            return ColladaCacheEntryPtr();
+        }
+    }
+    uint8_t isMsgPack = 0;
+    std::string data;
+    ifs.read(reinterpret_cast<char*>(&isMsgPack), sizeof(isMsgPack));
+    if( !ifs || !_ReadColladaCacheString(ifs, filesize, data) ) {
+        return ColladaCacheEntryPtr();
+    }
+    try {
+        if( isMsgPack ) {
+            MsgPack::ParseMsgPack(pentry->rInfo, data.data(), data.size());
+        }
+        else {
+            rapidjson::ParseResult ok = pentry->rInfo.Parse<rapidjson::kParseFullPrecisionFlag>(data.data(), data.size());
+            if( !ok ) {
+                return ColladaCacheEntryPtr();
+            }
+        }
+    }
+    catch(const openrave_exception& ex) {
+        // written by a build with msgpack support
+        RAVELOG_DEBUG_FORMAT("failed to read collada cache %s: %s", cacheFilename%ex.what());
+        return ColladaCacheEntryPtr();
+    }
+    return pentry;
+}
+
+static void _WriteColladaCacheEntry(const std::string& cacheFilename, const std::string& key, const ColladaCacheEntry& entry)
+{
+    std::string data;
+    uint8_t isMsgPack = 0;
+#if OPENRAVE_MSGPACK
+    {
+        std::vector<char> output;
+        MsgPack::DumpMsgPack(entry.rInfo, output, MsgPack::DMO_TypedArrays);
+        data.assign(output.begin(), output.end());
+        isMsgPack = 1;
+    }
+#else
+    {
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        entry.rInfo.Accept(writer);
+        data.assign(buffer.GetString(), buffer.GetSize());
+    }
+#endif
+    const std::string tempFilename = utils::GetTemporaryFilename(cacheFilename);
+    try {
+        boost::filesystem::create_directories(boost::filesystem::path(cacheFilename).parent_path());
+        {
+            std::ofstream ofs(tempFilename.c_str(), std::ios::binary|std::ios::trunc);
+            if( !ofs ) {
+                return;
+            }
+            ofs.write(s_colladaCacheMagic, sizeof(s_colladaCacheMagic));
+            _WriteColladaCacheString(ofs, key);
+            const uint32_t numDocuments = entry.vDocumentHashes.size();
+            ofs.write(reinterpret_cast<const char*>(&numDocuments), sizeof(numDocuments));
+            FOREACHC(itdocument, entry.vDocumentHashes) {
+                _WriteColladaCacheString(ofs, itdocument->first);
+                _WriteColladaCacheString(ofs, itdocument->second);
+            }
+            ofs.write(reinterpret_cast<const char*>(&isMsgPack), sizeof(isMsgPack));
+            _WriteColladaCacheString(ofs, data);
+            if( !ofs ) {
+                ofs.close();
+                boost::filesystem::remove(tempFilename);
+                return;
+            }
+        }
+        // rename is atomic, so concurrent processes never read a partially written file
+        boost::filesystem::rename(tempFilename, cacheFilename);
+    }
+    catch(const boost::filesystem::filesystem_error& ex) {
+        RAVELOG_DEBUG_FORMAT("failed to write collada cache %s: %s", cacheFilename%ex.what());
+    }
+    utils::PruneFileCache(boost::filesystem::path(cacheFilename).parent_path().string(), s_nColladaCacheMaxBytes);
+}
+
+/// \brief looks up the entry of the key in memory and then on disk, returns an empty pointer if there is none or one of the referenced documents changed
+static ColladaCacheEntryPtr _FindColladaCacheEntry(const std::string& key)
+{
+    ColladaCacheEntryPtr pentry;
+    {
+        std::lock_guard<std::mutex> lock(s_colladaCacheMutex);
+        std::map<std::string, ColladaCacheEntryPtr>::const_iterator it = s_mapColladaCacheEntries.find(key);
+        if( it != s_mapColladaCacheEntries.end() ) {
+            pentry = it->second;
+            _UseColladaCacheEntry(key, pentry);
+        }
+    }
+    if( !pentry ) {
+        pentry = _ReadColladaCacheEntry(_GetColladaCacheFilename(key), key);
+        if( !pentry ) {
+            return pentry;
+        }
+        std::lock_guard<std::mutex> lock(s_colladaCacheMutex);
+        _UseColladaCacheEntry(key, pentry);
+    }
+    std::string hash;
+    FOREACHC(itdocument, pentry->vDocumentHashes) {
+        if( !_GetColladaFileHash(itdocument->first, hash) || hash != itdocument->second ) {
+            RAVELOG_DEBUG_FORMAT("collada cache is stale since %s changed", itdocument->first);
+            return ColladaCacheEntryPtr();
+        }
+    }
+    return pentry;
+}
+
+/// \brief returns the id of a readable interface of the container that cannot be serialized to json, or an empty string if there is none
+static std::string _FindUnserializableReadable(const ReadablesContainer& container)
+{
+    boost::shared_lock<boost::shared_mutex> lock(container.GetReadableInterfaceMutex());
+    FOREACHC(itreadable, container.GetReadableInterfaces()) {
+        if( !itreadable->second || itreadable->first == ColladaXMLReadable::GetXMLIdStatic() ) {
+            continue; // the collada bindings are stored separately
+        }
+        rapidjson::Document rReadable;
+        if( !itreadable->second->SerializeJSON(rReadable, rReadable.GetAllocator(), 1.0, 0) ) {
+            return itreadable->first;
+        }
+    }
+    return std::string();
+}
+
+/// \brief caches the body that was just extracted from filename
+static void _AddColladaCacheEntry(const ColladaReader& reader, const std::string& key, const std::string& filename, KinBodyPtr pbody)
+{
+    // the info only keeps the readable interfaces that can be serialized, so a cache hit would silently drop the others
+    std::string unserializable = _FindUnserializableReadable(*pbody);
+    for(size_t ilink = 0; ilink < pbody->GetLinks().size() && unserializable.empty(); ++ilink) {
+        unserializable = _FindUnserializableReadable(*pbody->GetLinks()[ilink]);
+    }
+    for(size_t ijoint = 0; ijoint < pbody->GetJoints().size() && unserializable.empty(); ++ijoint) {
+        unserializable = _FindUnserializableReadable(*pbody->GetJoints()[ijoint]);
+    }
+    for(size_t ijoint = 0; ijoint < pbody->GetPassiveJoints().size() && unserializable.empty(); ++ijoint) {
+        unserializable = _FindUnserializableReadable(*pbody->GetPassiveJoints()[ijoint]);
+    }
+    if( !unserializable.empty() ) {
+        RAVELOG_DEBUG_FORMAT("not caching %s since readable interface '%s' of body '%s' cannot be serialized to json", filename%unserializable%pbody->GetName());
+        return;
+    }
+    ColladaCacheEntryPtr pentry(new ColladaCacheEntry());
+    std::vector<std::string> vfilenames;
+    reader.GetDocumentFilenames(vfilenames);
+    FOREACHC(itfilename, vfilenames) {
+        boost::system::error_code ec;
+        if( boost::filesystem::equivalent(*itfilename, filename, ec) ) {
+            continue; // already part of the key
+        }
+        std::string hash;
+        if( !_GetColladaFileHash(*itfilename, hash) ) {
+            RAVELOG_DEBUG_FORMAT("not caching %s since referenced document %s cannot be read", filename%*itfilename);
+            return;
+        }
+        pentry->vDocumentHashes.emplace_back(*itfilename, hash);
+    }
+    try {
+        ColladaReader::SerializeExtractedBodyInfo(pbody, pentry->rInfo);
+    }
+    catch(const std::exception& ex) {
+        RAVELOG_DEBUG_FORMAT("not caching %s since the info of body '%s' cannot be extracted: %s", filename%pbody->GetName()%ex.what());
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(s_colladaCacheMutex);
+        _UseColladaCacheEntry(key, pentry);
+    }
+    _WriteColladaCacheEntry(_GetColladaCacheFilename(key), key, *pentry);
+}
+
+/// \brief creates a new body from the cached info the same way the json reader does
+static KinBodyPtr _CreateBodyFromColladaCacheEntry(EnvironmentBasePtr penv, const ColladaCacheEntry& entry)
+{
+    bool isRobot = false;
+    orjson::LoadJsonValueByKey(entry.rInfo, "isRobot", isRobot);
+    KinBodyPtr pbody;
+    KinBody::KinBodyInfoPtr pinfo;
+    if( isRobot ) {
+        RobotBase::RobotBaseInfoPtr pRobotBaseInfo(new RobotBase::RobotBaseInfo());
+        pRobotBaseInfo->DeserializeJSON(entry.rInfo, 1.0, 0);
+        RobotBasePtr probot = RaveCreateRobot(penv, pRobotBaseInfo->_interfaceType);
+        if( !probot ) {
+            probot = RaveCreateRobot(penv, "");
+        }
+        if( !probot || !probot->InitFromRobotInfo(*pRobotBaseInfo) ) {
+            return KinBodyPtr();
+        }
+        pbody = probot;
+        pinfo = pRobotBaseInfo;
+    }
+    else {
+        pinfo.reset(new KinBody::KinBodyInfo());
+        pinfo->DeserializeJSON(entry.rInfo, 1.0, 0);
+        pbody = RaveCreateKinBody(penv, pinfo->_interfaceType);
+        if( !pbody ) {
+            pbody = RaveCreateKinBody(penv, "");
+        }
+        if( !pbody || !pbody->InitFromKinBodyInfo(*pinfo) ) {
+            return KinBodyPtr();
+        }
+    }
+    pbody->SetName(pinfo->_name);
+    pbody->SetTransform(pinfo->_transform);
+    rapidjson::Value::ConstMemberIterator itcolladainfo = entry.rInfo.FindMember(ColladaXMLReadable::GetXMLIdStatic().c_str());
+    if( itcolladainfo != entry.rInfo.MemberEnd() ) {
+        ColladaXMLReadablePtr pcolladainfo(new ColladaXMLReadable());
+        if( pcolladainfo->DeserializeJSON(itcolladainfo->value, 1.0) ) {
+            pbody->SetReadableInterface(ColladaXMLReadable::GetXMLIdStatic(), pcolladainfo);
+        }
+    }
+    return pbody;
+}
+
 bool RaveParseColladaURI(EnvironmentBasePtr penv, const std::string& uri,const AttributesList& atts)
 {
     std::lock_guard<std::mutex> lock(GetGlobalDAEMutex());
@@ -5967,24 +6428,62 @@ bool RaveParseColladaFile(EnvironmentBasePtr penv, const string& filename, const
 
 bool RaveParseColladaFile(EnvironmentBasePtr penv, KinBodyPtr& pbody, const string& filename,const AttributesList& atts)
 {
+    string filedata = RaveFindLocalFile(filename);
+    if (filedata.size() == 0) {
+        return false;
+    }
+    // only new bodies are cached, an existing body is updated by the reader
+    std::string cacheKey, filehash;
+    if( !pbody && _IsColladaCacheEnabled() && _GetColladaFileHash(filedata, filehash) ) {
+        cacheKey = _GetColladaCacheKey(penv, filedata, filehash, false, atts);
+        ColladaCacheEntryPtr pentry = _FindColladaCacheEntry(cacheKey);
+        if( !!pentry ) {
+            pbody = _CreateBodyFromColladaCacheEntry(penv, *pentry);
+            if( !!pbody ) {
+                return true;
+            }
+        }
+    }
+
     std::lock_guard<std::mutex> lock(GetGlobalDAEMutex());
     ColladaReader reader(penv);
-    string filedata = RaveFindLocalFile(filename);
-    if (filedata.size() == 0 || !reader.InitFromFile(filedata,atts)) {
+    if (!reader.InitFromFile(filedata,atts) || !reader.Extract(pbody)) {
         return false;
     }
-    return reader.Extract(pbody);
+    if( cacheKey.size() > 0 && !!pbody ) {
+        _AddColladaCacheEntry(reader, cacheKey, filedata, pbody);
+    }
+    return true;
 }
 
 bool RaveParseColladaFile(EnvironmentBasePtr penv, RobotBasePtr& probot, const string& filename,const AttributesList& atts)
 {
+    string filedata = RaveFindLocalFile(filename);
+    if (filedata.size() == 0) {
+        return false;
+    }
+    // only new robots are cached, an existing robot is updated by the reader
+    std::string cacheKey, filehash;
+    if( !probot && _IsColladaCacheEnabled() && _GetColladaFileHash(filedata, filehash) ) {
+        cacheKey = _GetColladaCacheKey(penv, filedata, filehash, true, atts);
+        ColladaCacheEntryPtr pentry = _FindColladaCacheEntry(cacheKey);
+        if( !!pentry ) {
+            probot = RaveInterfaceCast<RobotBase>(_CreateBodyFromColladaCacheEntry(penv, *pentry));
+            if( !!probot ) {
+                return true;
+            }
+        }
+    }
+
     std::lock_guard<std::mutex> lock(GetGlobalDAEMutex());
     ColladaReader reader(penv);
-    string filedata = RaveFindLocalFile(filename);
-    if (filedata.size() == 0 || !reader.InitFromFile(filedata,atts)) {
+    if (!reader.InitFromFile(filedata,atts) || !reader.Extract(probot)) {
         return false;
     }
-    return reader.Extract(probot);
+    if( cacheKey.size() > 0 && !!probot ) {
+        _AddColladaCacheEntry(reader, cacheKey, filedata, probot);
+    }
+    return true;
 }
 
 bool RaveParseColladaData(EnvironmentBasePtr penv, const string& pdata,const AttributesList& atts)
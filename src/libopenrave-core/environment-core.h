@@ -26,7 +26,10 @@
 #include <boost/filesystem/operations.hpp>
 #endif
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <exception>
 #include <mutex>
 #include <shared_mutex>
 #include <thread>
@@ -340,6 +343,7 @@ public:
             RAVELOG_WARN_FORMAT("env=%s, _vecbodies.size():%d, _mapBodyNameIndex.size():%d, _mapBodyIdIndex.size():%d seems large, maybe there is memory leak", GetNameId()%_vecbodies.size()%_mapBodyNameIndex.size());
         }
         _StopSimulationThread();
+        _StopSimulationStepWorkers();
 
         // destroy the modules (their destructors could attempt to lock environment, so have to do it before global lock)
         // however, do not clear the _listModules yet
@@ -382,7 +386,7 @@ public:
                 ExclusiveLock lock874(_mutexInterfaces);
                 vecbodies.swap(_vecbodies);
                 listSensors.swap(_listSensors);
-                _vPublishedBodies.clear();
+                _ClearPublishedBodies();
                 _nBodiesModifiedStamp++;
                 _listModules.clear();
                 _listViewers.clear();
@@ -461,7 +465,7 @@ public:
             _mapBodyNameIndex.clear();
             _mapBodyIdIndex.clear();
 
-            _vPublishedBodies.clear();
+            _ClearPublishedBodies();
             _nBodiesModifiedStamp++;
 
             _environmentIndexRecyclePool.clear();
@@ -711,6 +715,181 @@ public:
         return RaveParseJSON(shared_from_this(), uri, rEnvInfo, updateMode, vCreatedBodies, vModifiedBodies, vRemovedBodies, atts, *_prLoadEnvAlloc);
     }
 
+    bool UpdateFromDelta(const rapidjson::Value& rDelta, std::vector<KinBodyPtr>& vCreatedBodies, std::vector<KinBodyPtr>& vModifiedBodies, std::vector<KinBodyPtr>& vRemovedBodies, const AttributesList& atts) override
+    {
+        vCreatedBodies.clear();
+        vModifiedBodies.clear();
+        vRemovedBodies.clear();
+        if( !rDelta.IsObject() ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("env=%s, the delta needs to be a valid dictionary. Currently it is '%s'", GetNameId()%orjson::DumpJson(rDelta), ORE_InvalidArguments);
+        }
+
+        EnvironmentLock lockenv(GetMutex());
+        rapidjson::Value::ConstMemberIterator itBodies = rDelta.FindMember("bodies");
+        if( itBodies == rDelta.MemberEnd() ) {
+            return true;
+        }
+        if( !itBodies->value.IsArray() ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("env=%s, \"bodies\" of the delta needs to be an array", GetNameId(), ORE_InvalidArguments);
+        }
+
+        // same as JSONReader, delta without units is in meters
+        dReal fUnitScale = 1.0/GetLengthUnitStandardValue<dReal>(LU_Meter);
+        if( rDelta.HasMember("unitInfo") ) {
+            UnitInfo unitInfo;
+            orjson::LoadJsonValueByKey(rDelta, "unitInfo", unitInfo);
+            fUnitScale = 1.0/GetLengthUnitStandardValue<dReal>(unitInfo.lengthUnit);
+        }
+        else if( rDelta.HasMember("unit") ) {
+            std::pair<std::string, dReal> unit = {"", fUnitScale};
+            orjson::LoadJsonValueByKey(rDelta, "unit", unit);
+            fUnitScale = unit.second;
+        }
+        fUnitScale *= GetLengthUnitStandardValue<dReal>(_unitInfo.lengthUnit);
+
+        // consecutive entries that have to go through the json reader are parsed together. they are flushed before any
+        // other entry so that the entries are applied in the order of the delta, for example a full entry of a body
+        // followed by a transform of the same body.
+        std::vector<const rapidjson::Value*> vFullBodyValues;
+        std::set<std::string> setFullBodyKeys; // ids or names of the bodies in vFullBodyValues
+        std::vector<KinBodyPtr> vCreatedFullBodies, vModifiedFullBodies, vRemovedFullBodies;
+        // a body modified by several entries is only reported once, at its first modification. vModifiedBodies holds
+        // the bodies, so their pointers cannot be reused by other bodies while the delta is applied.
+        std::set<const KinBody*> setModifiedBodies;
+        const auto addModifiedBody = [&](const KinBodyPtr& pbody) {
+            if( setModifiedBodies.insert(pbody.get()).second ) {
+                vModifiedBodies.push_back(pbody);
+            }
+        };
+        const auto flushFullBodies = [&]() {
+            if( vFullBodyValues.empty() ) {
+                return true;
+            }
+            rapidjson::Document rEnvInfo;
+            rEnvInfo.SetObject();
+            for(const char* pUnitKey : {"unit", "unitInfo"}) {
+                rapidjson::Value::ConstMemberIterator itUnit = rDelta.FindMember(pUnitKey);
+                if( itUnit != rDelta.MemberEnd() ) {
+                    rEnvInfo.AddMember(rapidjson::Value(pUnitKey, rEnvInfo.GetAllocator()), rapidjson::Value(itUnit->value, rEnvInfo.GetAllocator()), rEnvInfo.GetAllocator());
+                }
+            }
+            rapidjson::Value rFullBodies(rapidjson::kArrayType);
+            rFullBodies.Reserve(vFullBodyValues.size(), rEnvInfo.GetAllocator());
+            for(const rapidjson::Value* pBodyValue : vFullBodyValues) {
+                rFullBodies.PushBack(rapidjson::Value(*pBodyValue, rEnvInfo.GetAllocator()), rEnvInfo.GetAllocator());
+            }
+            rEnvInfo.AddMember("bodies", rFullBodies, rEnvInfo.GetAllocator());
+            vFullBodyValues.clear();
+            setFullBodyKeys.clear();
+
+            _ClearRapidJsonBuffer();
+            if( !RaveParseJSON(shared_from_this(), std::string(), rEnvInfo, UFIM_OnlySpecifiedBodiesExact, vCreatedFullBodies, vModifiedFullBodies, vRemovedFullBodies, atts, *_prLoadEnvAlloc) ) {
+                return false;
+            }
+            vCreatedBodies.insert(vCreatedBodies.end(), vCreatedFullBodies.begin(), vCreatedFullBodies.end());
+            for(const KinBodyPtr& pModifiedBody : vModifiedFullBodies) {
+                addModifiedBody(pModifiedBody);
+            }
+            vRemovedBodies.insert(vRemovedBodies.end(), vRemovedFullBodies.begin(), vRemovedFullBodies.end());
+            return true;
+        };
+
+        std::vector<dReal> vDOFValues;
+        for(rapidjson::Value::ConstValueIterator itBody = itBodies->value.Begin(); itBody != itBodies->value.End(); ++itBody) {
+            const rapidjson::Value& rBody = *itBody;
+            if( !rBody.IsObject() ) {
+                throw OPENRAVE_EXCEPTION_FORMAT("env=%s, body entry of the delta needs to be a dictionary. Currently it is '%s'", GetNameId()%orjson::DumpJson(rBody), ORE_InvalidArguments);
+            }
+
+            const char* pId = orjson::GetCStringJsonValueByKey(rBody, "id", "");
+            const std::string bodyKey = !!pId[0] ? std::string("id:") + pId : std::string("name:") + orjson::GetCStringJsonValueByKey(rBody, "name", "");
+            const bool bDeleted = orjson::GetJsonValueByKey<bool>(rBody, "__deleted__", false);
+            bool bOnlyTransformAndDOFValues = !bDeleted;
+            for(rapidjson::Value::ConstMemberIterator itMember = rBody.MemberBegin(); itMember != rBody.MemberEnd() && bOnlyTransformAndDOFValues; ++itMember) {
+                const char* pMemberName = itMember->name.GetString();
+                bOnlyTransformAndDOFValues = strcmp(pMemberName, "id") == 0 || strcmp(pMemberName, "name") == 0 || strcmp(pMemberName, "transform") == 0 || strcmp(pMemberName, "dofValues") == 0 || strcmp(pMemberName, "__isPartial__") == 0;
+            }
+            if( !bDeleted && !bOnlyTransformAndDOFValues && setFullBodyKeys.count(bodyKey) == 0 ) {
+                vFullBodyValues.push_back(&rBody);
+                setFullBodyKeys.insert(bodyKey);
+                continue;
+            }
+            // the entry has to see the results of the previous entries
+            if( !flushFullBodies() ) {
+                return false;
+            }
+            if( !bDeleted && !bOnlyTransformAndDOFValues ) {
+                vFullBodyValues.push_back(&rBody);
+                setFullBodyKeys.insert(bodyKey);
+                continue;
+            }
+
+            KinBodyPtr pbody;
+            if( !!pId[0] ) {
+                SharedLock lock(_mutexInterfaces);
+                const std::unordered_map<std::string, int>::const_iterator itIndex = _mapBodyIdIndex.find(pId);
+                if( itIndex != _mapBodyIdIndex.end() && !!_vecbodies.at(itIndex->second) && _vecbodies[itIndex->second]->GetId() == pId ) {
+                    pbody = _vecbodies[itIndex->second];
+                }
+            }
+            else {
+                pbody = GetKinBody(orjson::GetCStringJsonValueByKey(rBody, "name", ""));
+            }
+
+            if( bDeleted ) {
+                if( !!pbody && Remove(pbody) ) {
+                    vRemovedBodies.push_back(pbody);
+                }
+                continue;
+            }
+            if( !pbody ) {
+                // the json reader decides what to do with transforms of unknown bodies
+                vFullBodyValues.push_back(&rBody);
+                setFullBodyKeys.insert(bodyKey);
+                continue;
+            }
+
+            Transform tbody = pbody->GetTransform();
+            bool bChanged = false;
+            rapidjson::Value::ConstMemberIterator itTransform = rBody.FindMember("transform");
+            if( itTransform != rBody.MemberEnd() ) {
+                Transform tnew;
+                orjson::LoadJsonValue(itTransform->value, tnew);
+                tnew.trans *= fUnitScale;
+                if( TransformDistanceFast(tbody, tnew) > 1e-7 ) {
+                    tbody = tnew;
+                    bChanged = true;
+                }
+            }
+
+            pbody->GetDOFValues(vDOFValues);
+            rapidjson::Value::ConstMemberIterator itDOFValues = rBody.FindMember("dofValues");
+            if( itDOFValues != rBody.MemberEnd() && itDOFValues->value.IsArray() ) {
+                for(rapidjson::Value::ConstValueIterator itDOFValue = itDOFValues->value.Begin(); itDOFValue != itDOFValues->value.End(); ++itDOFValue) {
+                    const char* pJointName = orjson::GetCStringJsonValueByKey(*itDOFValue, "jointName", "");
+                    KinBody::JointPtr pjoint = pbody->GetJoint(pJointName);
+                    const int jointAxis = orjson::GetJsonValueByKey<int>(*itDOFValue, "jointAxis", 0);
+                    if( !pjoint || pjoint->GetDOFIndex() < 0 || jointAxis < 0 || jointAxis >= pjoint->GetDOF() ) {
+                        RAVELOG_WARN_FORMAT("env=%s, body '%s' has no active joint '%s' with axis %d, ignoring its dof value", GetNameId()%pbody->GetName()%pJointName%jointAxis);
+                        continue;
+                    }
+                    const dReal value = orjson::GetJsonValueByKey<dReal>(*itDOFValue, "value", 0);
+                    dReal& curvalue = vDOFValues.at(pjoint->GetDOFIndex()+jointAxis);
+                    if( RaveFabs(curvalue - value) > 1e-10 ) {
+                        curvalue = value;
+                        bChanged = true;
+                    }
+                }
+            }
+
+            if( bChanged ) {
+                pbody->SetDOFValues(vDOFValues, tbody, KinBody::CLA_Nothing);
+                addModifiedBody(pbody);
+            }
+        }
+        return flushFullBodies();
+    }
+
     virtual void Save(const std::string& filename, SelectionOptions options, const AttributesList& atts) override
     {
         EnvironmentLock lockenv(GetMutex());
@@ -1484,10 +1663,45 @@ public:
         EnvironmentLock lockenv(GetMutex());
 
         uint64_t step = (uint64_t)ceil(1000000.0 * (double)fTimeStep);
-        fTimeStep = (dReal)((double)step * 0.000001);
+        SimulationStepTimes times;
+        _StepSimulation(step, &times);
+        std::lock_guard<std::mutex> lock(_mutexSimulationStepTimes);
+        _simulationStepTimes = times;
+    }
+
+    virtual void FastForwardSimulation(int numsteps, dReal fTimeStep, int publishInterval) override
+    {
+        OPENRAVE_ASSERT_OP(numsteps, >=, 0);
+        EnvironmentLock lockenv(GetMutex());
+
+        uint64_t step = (uint64_t)ceil(1000000.0 * (double)fTimeStep);
+        for(int istep = 1; istep <= numsteps; ++istep) {
+            _StepSimulation(step, NULL);
+            if( publishInterval > 0 && (istep % publishInterval == 0 || istep == numsteps) ) {
+                UpdatePublishedBodies();
+            }
+        }
+        // keep the same offset between simulation and real time so that the simulation thread does not wait for the skipped time
+        _nSimStartTime -= numsteps*step;
+    }
+
+    /// \brief makes one simulation step of step microseconds. Environment should be locked.
+    ///
+    /// \param ptimes if not NULL, filled with the time spent in each phase
+    void _StepSimulation(uint64_t step, SimulationStepTimes* ptimes)
+    {
+        const dReal fTimeStep = (dReal)((double)step * 0.000001);
+        // only measure the phases when requested
+        SimulationStepTimes times;
+        auto gettime = [ptimes]() -> uint64_t {
+            return !ptimes ? 0 : utils::GetMicroTime();
+        };
+        const uint64_t starttime = gettime();
+        uint64_t phasetime = starttime;
 
         // call the physics first to get forces
         _pPhysicsEngine->SimulateStep(fTimeStep);
+        times.physics = gettime() - phasetime;
 
         // make a copy instead of locking the mutex pointer since will be calling into user functions
         vector<KinBodyPtr> vecbodies;
@@ -1500,6 +1714,7 @@ public:
             listModules = _listModules;
         }
 
+        phasetime = gettime();
         for (const KinBodyPtr& pBody : vecbodies) {
             if (!pBody) {
                 continue;
@@ -1508,13 +1723,33 @@ public:
                 pBody->SimulationStep(fTimeStep);
             }
         }
+        times.bodies = gettime() - phasetime;
+
+        // the read-only modules and sensors are deferred and stepped concurrently after all the others
+        const bool bParallel = _nSimulationStepThreads > 1;
+        _vSimulationStepModules.resize(0);
+        _vSimulationStepSensors.resize(0);
+
+        phasetime = gettime();
         FOREACH(itmodule, listModules) {
-            itmodule->first->SimulationStep(fTimeStep);
+            if( bParallel && itmodule->first->IsSimulationStepReadOnly() ) {
+                _vSimulationStepModules.push_back(itmodule->first);
+            }
+            else {
+                itmodule->first->SimulationStep(fTimeStep);
+            }
         }
+        times.modules = gettime() - phasetime;
 
         // simulate the sensors last (ie, they always reflect the most recent bodies
+        phasetime = gettime();
         FOREACH(itsensor, listSensors) {
-            (*itsensor)->SimulationStep(fTimeStep);
+            if( bParallel && (*itsensor)->IsSimulationStepReadOnly() ) {
+                _vSimulationStepSensors.push_back(*itsensor);
+            }
+            else {
+                (*itsensor)->SimulationStep(fTimeStep);
+            }
         }
         for (const KinBodyPtr& pBody : vecbodies) {
             if (!pBody) {
@@ -1525,12 +1760,55 @@ public:
             }
             const RobotBasePtr& probot = RaveInterfaceCast<RobotBase>(pBody);
             FOREACHC(itsensor, probot->GetAttachedSensors()) {
-                if( !!(*itsensor)->GetSensor() ) {
-                    (*itsensor)->GetSensor()->SimulationStep(fTimeStep);
+                const SensorBasePtr& psensor = (*itsensor)->GetSensor();
+                if( !!psensor ) {
+                    if( bParallel && psensor->IsSimulationStepReadOnly() ) {
+                        _vSimulationStepSensors.push_back(psensor);
+                    }
+                    else {
+                        psensor->SimulationStep(fTimeStep);
+                    }
                 }
             }
         }
+        times.sensors = gettime() - phasetime;
+
+        if( _vSimulationStepModules.size() + _vSimulationStepSensors.size() > 0 ) {
+            phasetime = gettime();
+            _StepReadOnlyInterfaces(fTimeStep);
+            times.readonly = gettime() - phasetime;
+        }
         _nCurSimTime += step;
+
+        if( !!ptimes ) {
+            times.total = gettime() - starttime;
+            *ptimes = times;
+        }
+    }
+
+    virtual void SetSimulationStepThreads(int numthreads) override
+    {
+        EnvironmentLock lockenv(GetMutex());
+        if( numthreads < 1 ) {
+            numthreads = 1;
+        }
+        if( numthreads != _nSimulationStepThreads ) {
+            // workers are restarted with the new count on the next step
+            _StopSimulationStepWorkers();
+            _nSimulationStepThreads = numthreads;
+        }
+    }
+
+    virtual int GetSimulationStepThreads() const override
+    {
+        EnvironmentLock lockenv(GetMutex());
+        return _nSimulationStepThreads;
+    }
+
+    virtual void GetSimulationStepTimes(SimulationStepTimes& times) const override
+    {
+        std::lock_guard<std::mutex> lock(_mutexSimulationStepTimes);
+        times = _simulationStepTimes;
     }
 
     virtual EnvironmentMutex& GetMutex() const override {
@@ -2634,23 +2912,29 @@ public:
     }
 
     virtual void GetPublishedBodies(std::vector<KinBody::BodyState>& vbodies, uint64_t timeout)
+    {
+        PublishedBodiesConstPtr pbodies = GetPublishedBodiesSnapshot(timeout);
+        vbodies.resize(pbodies->size());
+        for(size_t ibody = 0; ibody < pbodies->size(); ++ibody) {
+            vbodies[ibody] = *pbodies->at(ibody);
+        }
+    }
+
+    virtual PublishedBodiesConstPtr GetPublishedBodiesSnapshot(uint64_t timeout)
     {
         TimedSharedLock lock452(_mutexInterfaces, timeout);
         if (!lock452) {
             throw OPENRAVE_EXCEPTION_FORMAT(_("timeout of %f s failed"),(1e-6*static_cast<double>(timeout)),ORE_Timeout);
         }
-        vbodies = _vPublishedBodies;
+        return _pPublishedBodies;
     }
 
     virtual bool GetPublishedBody(const std::string &name, KinBody::BodyState& bodystate, uint64_t timeout=0)
     {
-        TimedSharedLock lock306(_mutexInterfaces, timeout);
-        if (!lock306) {
-            throw OPENRAVE_EXCEPTION_FORMAT(_("timeout of %f s failed"),(1e-6*static_cast<double>(timeout)),ORE_Timeout);
-        }
-        for ( size_t ibody = 0; ibody < _vPublishedBodies.size(); ++ibody) {
-            if ( _vPublishedBodies[ibody].strname == name) {
-                bodystate = _vPublishedBodies[ibody];
+        PublishedBodiesConstPtr pbodies = GetPublishedBodiesSnapshot(timeout);
+        for ( size_t ibody = 0; ibody < pbodies->size(); ++ibody) {
+            if ( pbodies->at(ibody)->strname == name) {
+                bodystate = *pbodies->at(ibody);
                 return true;
             }
         }
@@ -2660,13 +2944,10 @@ public:
 
     virtual bool GetPublishedBodyJointValues(const std::string& name, std::vector<dReal> &jointValues, uint64_t timeout=0)
     {
-        TimedSharedLock lock118(_mutexInterfaces, timeout);
-        if (!lock118) {
-            throw OPENRAVE_EXCEPTION_FORMAT(_("timeout of %f s failed"),(1e-6*static_cast<double>(timeout)),ORE_Timeout);
-        }
-        for ( size_t ibody = 0; ibody < _vPublishedBodies.size(); ++ibody) {
-            if ( _vPublishedBodies[ibody].strname == name) {
-                jointValues = _vPublishedBodies[ibody].jointvalues;
+        PublishedBodiesConstPtr pbodies = GetPublishedBodiesSnapshot(timeout);
+        for ( size_t ibody = 0; ibody < pbodies->size(); ++ibody) {
+            if ( pbodies->at(ibody)->strname == name) {
+                jointValues = pbodies->at(ibody)->jointvalues;
                 return true;
             }
         }
@@ -2676,18 +2957,16 @@ public:
 
     void GetPublishedBodyTransformsMatchingPrefix(const std::string& prefix, std::vector<std::pair<std::string, Transform> >& nameTransfPairs, uint64_t timeout = 0)
     {
-        TimedSharedLock lock079(_mutexInterfaces, timeout);
-        if (!lock079) {
-            throw OPENRAVE_EXCEPTION_FORMAT(_("timeout of %f s failed"),(1e-6*static_cast<double>(timeout)),ORE_Timeout);
-        }
+        PublishedBodiesConstPtr pbodies = GetPublishedBodiesSnapshot(timeout);
 
         nameTransfPairs.resize(0);
-        if( nameTransfPairs.capacity() < _vPublishedBodies.size() ) {
-            nameTransfPairs.reserve(_vPublishedBodies.size());
+        if( nameTransfPairs.capacity() < pbodies->size() ) {
+            nameTransfPairs.reserve(pbodies->size());
         }
-        for ( size_t ibody = 0; ibody < _vPublishedBodies.size(); ++ibody) {
-            if ( strncmp(_vPublishedBodies[ibody].strname.c_str(), prefix.c_str(), prefix.size()) == 0 ) {
-                nameTransfPairs.emplace_back(_vPublishedBodies[ibody].strname,  _vPublishedBodies[ibody].vectrans.at(0));
+        for ( size_t ibody = 0; ibody < pbodies->size(); ++ibody) {
+            const KinBody::BodyState& state = *pbodies->at(ibody);
+            if ( strncmp(state.strname.c_str(), prefix.c_str(), prefix.size()) == 0 ) {
+                nameTransfPairs.emplace_back(state.strname,  state.vectrans.at(0));
             }
         }
     }
@@ -2695,59 +2974,118 @@ public:
     virtual void UpdatePublishedBodies(uint64_t timeout=0)
     {
         EnvironmentLock lockenv(GetMutex());
+        // the bodies cannot change while the environment is locked, so only the swap needs _mutexInterfaces
+        boost::shared_ptr< std::vector<KinBody::BodyStateConstPtr> > pnewbodies = _UpdatePublishedBodies();
+        if( !pnewbodies ) {
+            return;
+        }
         TimedExclusiveLock lock152(_mutexInterfaces, timeout);
         if (!lock152) {
             throw OPENRAVE_EXCEPTION_FORMAT(_("timeout of %f s failed"),(1e-6*static_cast<double>(timeout)),ORE_Timeout);
         }
-        _UpdatePublishedBodies();
+        _pPublishedBodiesBack.swap(_pPublishedBodies);
+        _pPublishedBodies = pnewbodies;
     }
 
-    /// assumes GetMutex() and _mutexInterfaces are both exclusively locked
-    virtual void _UpdatePublishedBodies()
-    {
-        // updated the published bodies, resize dynamically in case an exception occurs
-        // when creating an item and bad data is left inside _vPublishedBodies
-        _vPublishedBodies.resize(_GetNumBodies());
-        int iwritten = 0;
+    /// \brief builds the next published bodies snapshot. Only the states of bodies whose update stamp changed are refreshed.
+    ///
+    /// assumes GetMutex() is locked
+    /// \return the new snapshot, or null if nothing changed since the last published one
+    virtual boost::shared_ptr< std::vector<KinBody::BodyStateConstPtr> > _UpdatePublishedBodies()
+    {
+        // Reuse the storage of the previous snapshot if no reader holds it anymore. _pPublishedBodiesBack is not reachable
+        // from outside, so once its count is 1 no reader can get a new reference to it. The fence orders the readers'
+        // accesses, which happen before they release their references, before the overwrite.
+        boost::shared_ptr< std::vector<KinBody::BodyStateConstPtr> > pnewbodies;
+        if( !!_pPublishedBodiesBack && _pPublishedBodiesBack.unique() ) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            pnewbodies.swap(_pPublishedBodiesBack);
+            pnewbodies->resize(0);
+        }
+        else {
+            pnewbodies.reset(new std::vector<KinBody::BodyStateConstPtr>());
+        }
+        pnewbodies->reserve(_GetNumBodies());
+        _vPublishedBodyStates.resize(_vecbodies.size());
+        _vPublishedBodyStatesBack.resize(_vecbodies.size());
 
+        const std::vector<KinBody::BodyStateConstPtr>& vprevbodies = *_pPublishedBodies;
+        bool bChanged = false;
         std::vector<dReal> vdoflastsetvalues;
-        for(const KinBodyPtr& pbody : _vecbodies) {
-            if (!pbody || pbody->GetEnvironmentBodyIndex() == 0) {
-                continue;
-            }
-            if( pbody->_nHierarchyComputed != 2 ) {
-                // skip
+        for(size_t ibody = 0; ibody < _vecbodies.size(); ++ibody) {
+            const KinBodyPtr& pbody = _vecbodies[ibody];
+            if (!pbody || pbody->GetEnvironmentBodyIndex() == 0 || pbody->_nHierarchyComputed != 2 ) {
+                // skip, and release the states so that removed bodies are not kept alive
+                _vPublishedBodyStates[ibody].reset();
+                _vPublishedBodyStatesBack[ibody].reset();
                 continue;
             }
 
-            KinBody::BodyState& state = _vPublishedBodies.at(iwritten);
-            state.Reset();
-            state.pbody = pbody;
-            pbody->GetLinkTransformations(state.vectrans, vdoflastsetvalues);
-            pbody->GetLinkEnableStates(state.vLinkEnableStates);
-            pbody->GetDOFValues(state.jointvalues);
-            pbody->GetGrabbedInfo(state.vGrabbedInfos);
-            state.strname =pbody->GetName();
-            state.uri = pbody->GetURI();
-            state.updatestamp = pbody->GetUpdateStamp();
-            state.environmentid = pbody->GetEnvironmentBodyIndex();
+            RobotBase::ManipulatorPtr pmanip;
             if( pbody->IsRobot() ) {
                 RobotBasePtr probot = RaveInterfaceCast<RobotBase>(pbody);
                 if( !!probot ) {
-                    RobotBase::ManipulatorPtr pmanip = probot->GetActiveManipulator();
-                    if( !!pmanip ) {
-                        state.activeManipulatorName = pmanip->GetName();
-                        state.activeManipulatorTransform = pmanip->GetTransform();
+                    pmanip = probot->GetActiveManipulator();
+                }
+            }
+
+            KinBody::BodyStatePtr& pstate = _vPublishedBodyStates[ibody];
+            if( !pstate || pstate->pbody != pbody || pstate->updatestamp != pbody->GetUpdateStamp() || pstate->activeManipulatorName != (!!pmanip ? pmanip->GetName() : std::string()) ) {
+                // swap with the back buffer, which can be overwritten only if no snapshot references it anymore
+                // same as the snapshots, a state is only reachable through the snapshots that contain it
+                KinBody::BodyStatePtr& pbackstate = _vPublishedBodyStatesBack[ibody];
+                pbackstate.swap(pstate);
+                if( !pstate || !pstate.unique() ) {
+                    pstate.reset(new KinBody::BodyState());
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                KinBody::BodyState& state = *pstate;
+                state.Reset();
+                state.pbody = pbody;
+                pbody->GetLinkTransformations(state.vectrans, vdoflastsetvalues);
+                pbody->GetLinkEnableStates(state.vLinkEnableStates);
+                pbody->GetDOFValues(state.jointvalues);
+                pbody->GetGrabbedInfo(state.vGrabbedInfos);
+                state.strname =pbody->GetName();
+                state.uri = pbody->GetURI();
+                state.updatestamp = pbody->GetUpdateStamp();
+                state.environmentid = pbody->GetEnvironmentBodyIndex();
+                if( pbody->IsRobot() ) {
+                    RobotBasePtr probot = RaveInterfaceCast<RobotBase>(pbody);
+                    if( !!probot ) {
+                        if( !!pmanip ) {
+                            state.activeManipulatorName = pmanip->GetName();
+                            state.activeManipulatorTransform = pmanip->GetTransform();
+                        }
+                        probot->GetConnectedBodyActiveStates(state.vConnectedBodyActiveStates);
                     }
-                    probot->GetConnectedBodyActiveStates(state.vConnectedBodyActiveStates);
                 }
             }
-            ++iwritten;
+
+            if( !bChanged && (pnewbodies->size() >= vprevbodies.size() || vprevbodies[pnewbodies->size()] != pstate) ) {
+                bChanged = true;
+            }
+            pnewbodies->push_back(pstate);
         }
 
-        if( iwritten < (int)_vPublishedBodies.size() ) {
-            _vPublishedBodies.resize(iwritten);
+        if( !bChanged && pnewbodies->size() == vprevbodies.size() ) {
+            // nothing changed, so keep the current snapshot
+            _pPublishedBodiesBack.swap(pnewbodies);
+            return boost::shared_ptr< std::vector<KinBody::BodyStateConstPtr> >();
         }
+        return pnewbodies;
+    }
+
+    /// \brief clears the published bodies and the state buffers.
+    ///
+    /// assumes GetMutex() and _mutexInterfaces are both exclusively locked
+    void _ClearPublishedBodies()
+    {
+        _pPublishedBodies.reset(new std::vector<KinBody::BodyStateConstPtr>());
+        _pPublishedBodiesBack.reset();
+        _vPublishedBodyStates.clear();
+        _vPublishedBodyStatesBack.clear();
     }
 
     virtual std::pair<std::string, dReal> GetUnit() const
@@ -3337,6 +3675,7 @@ protected:
         _unitInfo = UnitInfo();
         _unitInfo.lengthUnit = LU_Meter; // default unit settings
         _unitInfo.angleUnit = AU_Radian; // default unit settings
+        _pPublishedBodies.reset(new std::vector<KinBody::BodyStateConstPtr>());
 
         _vRapidJsonLoadBuffer.resize(4000000);
         _prLoadEnvAlloc.reset(new rapidjson::MemoryPoolAllocator<>(&_vRapidJsonLoadBuffer[0], _vRapidJsonLoadBuffer.size()));
@@ -3481,7 +3820,7 @@ protected:
                 _mapBodyIdIndex.clear();
                 _environmentIndexRecyclePool.clear();
 
-                _vPublishedBodies.clear();
+                _ClearPublishedBodies();
             }
         }
 
@@ -4091,6 +4430,110 @@ protected:
         }
     }
 
+    /// \brief steps _vSimulationStepModules and _vSimulationStepSensors with the calling thread and the simulation step workers.
+    ///
+    /// assumes GetMutex() is locked. Rethrows the first exception thrown by a step once all of them are done.
+    void _StepReadOnlyInterfaces(dReal fTimeStep)
+    {
+        const int numworkers = _nSimulationStepThreads - 1;
+        while( (int)_vSimulationStepWorkers.size() < numworkers ) {
+            _vSimulationStepWorkers.push_back(boost::make_shared<std::thread>(std::bind(&Environment::_SimulationStepWorkerThread, this, _nSimulationStepGeneration)));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutexSimulationStepWorkers);
+            _fSimulationStepTime = fTimeStep;
+            _nextSimulationStepTask = 0;
+            _simulationStepException = std::exception_ptr();
+            _nSimulationStepWorkersBusy = _vSimulationStepWorkers.size();
+            ++_nSimulationStepGeneration;
+        }
+        _condSimulationStepWorkers.notify_all();
+
+        _RunSimulationStepTasks();
+
+        std::exception_ptr pexception;
+        {
+            std::unique_lock<std::mutex> lock(_mutexSimulationStepWorkers);
+            _condSimulationStepDone.wait(lock, [this]() {
+                return _nSimulationStepWorkersBusy == 0;
+            });
+            pexception = _simulationStepException;
+            _simulationStepException = std::exception_ptr();
+        }
+        _vSimulationStepModules.resize(0);
+        _vSimulationStepSensors.resize(0);
+        if( !!pexception ) {
+            std::rethrow_exception(pexception);
+        }
+    }
+
+    /// \brief claims and runs the read-only steps of the current generation until none are left
+    void _RunSimulationStepTasks()
+    {
+        const size_t nummodules = _vSimulationStepModules.size();
+        const size_t numtasks = nummodules + _vSimulationStepSensors.size();
+        while(true) {
+            const size_t itask = _nextSimulationStepTask.fetch_add(1);
+            if( itask >= numtasks ) {
+                break;
+            }
+            try {
+                if( itask < nummodules ) {
+                    _vSimulationStepModules[itask]->SimulationStep(_fSimulationStepTime);
+                }
+                else {
+                    _vSimulationStepSensors[itask - nummodules]->SimulationStep(_fSimulationStepTime);
+                }
+            }
+            catch(...) {
+                std::lock_guard<std::mutex> lock(_mutexSimulationStepWorkers);
+                if( !_simulationStepException ) {
+                    _simulationStepException = std::current_exception();
+                }
+            }
+        }
+    }
+
+    /// \param generation the generation when the worker was started, the worker only runs the ones after it
+    void _SimulationStepWorkerThread(uint64_t generation)
+    {
+        std::unique_lock<std::mutex> lock(_mutexSimulationStepWorkers);
+        while( true ) {
+            _condSimulationStepWorkers.wait(lock, [this, &generation]() {
+                return _bShutdownSimulationStepWorkers || _nSimulationStepGeneration != generation;
+            });
+            if( _bShutdownSimulationStepWorkers ) {
+                break;
+            }
+            generation = _nSimulationStepGeneration;
+            lock.unlock();
+            _RunSimulationStepTasks();
+            lock.lock();
+            if( --_nSimulationStepWorkersBusy == 0 ) {
+                _condSimulationStepDone.notify_all();
+            }
+        }
+    }
+
+    /// \brief assumes GetMutex() is locked or no simulation step can be running
+    void _StopSimulationStepWorkers()
+    {
+        if( _vSimulationStepWorkers.empty() ) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutexSimulationStepWorkers);
+            _bShutdownSimulationStepWorkers = true;
+        }
+        _condSimulationStepWorkers.notify_all();
+        for(const boost::shared_ptr<std::thread>& pworker : _vSimulationStepWorkers) {
+            pworker->join();
+        }
+        _vSimulationStepWorkers.clear();
+        _bShutdownSimulationStepWorkers = false;
+    }
+
     void _SimulationThread()
     {
         int environmentid = RaveGetEnvironmentId(shared_from_this());
@@ -4315,6 +4758,23 @@ protected:
 
     boost::shared_ptr<std::thread> _threadSimulation;                      ///< main loop for environment simulation
 
+    int _nSimulationStepThreads = 1; ///< number of threads stepping the read-only modules and sensors, including the one calling StepSimulation. protected by GetMutex()
+    std::vector< boost::shared_ptr<std::thread> > _vSimulationStepWorkers; ///< started on demand by StepSimulation. protected by GetMutex()
+    std::vector<ModuleBasePtr> _vSimulationStepModules; ///< read-only modules of the current step. protected by GetMutex()
+    std::vector<SensorBasePtr> _vSimulationStepSensors; ///< read-only sensors of the current step. protected by GetMutex()
+    dReal _fSimulationStepTime = 0; ///< time step of the current step
+    std::atomic<size_t> _nextSimulationStepTask{0}; ///< next index into the read-only modules then sensors to step
+    std::mutex _mutexSimulationStepWorkers; ///< protects the worker synchronization members below
+    std::condition_variable _condSimulationStepWorkers; ///< notified when a new generation of steps starts or the workers shut down
+    std::condition_variable _condSimulationStepDone; ///< notified when all workers finished the current generation
+    uint64_t _nSimulationStepGeneration = 0; ///< incremented for every batch of read-only steps
+    size_t _nSimulationStepWorkersBusy = 0; ///< workers that have not finished the current generation
+    bool _bShutdownSimulationStepWorkers = false;
+    std::exception_ptr _simulationStepException; ///< first exception thrown by a read-only step of the current generation
+
+    SimulationStepTimes _simulationStepTimes; ///< timing of the last StepSimulation call. protected by _mutexSimulationStepTimes
+    mutable std::mutex _mutexSimulationStepTimes;
+
     mutable EnvironmentMutex _mutexEnvironment;          ///< protects internal data from multithreading issues
     mutable std::shared_timed_mutex _mutexInterfaces;     ///< lock when managing interfaces like _listOwnedInterfaces, _listModules as well as _vecbodies and supporting data such as _mapBodyNameIndex, _mapBodyIdIndex and _environmentIndexRecyclePool
 
@@ -4323,7 +4783,10 @@ protected:
 
     mutable std::mutex _mutexInit;     ///< lock for destroying the environment
 
-    vector<KinBody::BodyState> _vPublishedBodies; ///< protected by _mutexInterfaces
+    boost::shared_ptr< std::vector<KinBody::BodyStateConstPtr> > _pPublishedBodies; ///< the current published snapshot, never null. Its contents are never modified once published. Readers copy it with _mutexInterfaces shared, so it is only replaced with both GetMutex() and _mutexInterfaces exclusively locked
+    boost::shared_ptr< std::vector<KinBody::BodyStateConstPtr> > _pPublishedBodiesBack; ///< the previously published snapshot, reused for the next one if no reader holds it. Never handed out, so it is protected by GetMutex() alone
+    std::vector<KinBody::BodyStatePtr> _vPublishedBodyStates; ///< latest published state of each body indexed by environment body index. protected by GetMutex()
+    std::vector<KinBody::BodyStatePtr> _vPublishedBodyStatesBack; ///< previous state of each body, overwritten in place when no snapshot references it. protected by GetMutex()
     string _homedirectory;
     std::pair<std::string, dReal> _unit; ///< unit name mm, cm, inches, m and the conversion for meters
     UnitInfo _unitInfo; ///< unitInfo that describes length unit, mass unit, time unit and angle unit
@@ -19,6 +19,7 @@
 #include <boost/lambda/lambda.hpp>
 #include <boost/lexical_cast.hpp>
 #include <openrave/xmlreaders.h>
+#include <atomic>
 
 using namespace boost::placeholders;
 
@@ -27,6 +28,7 @@ namespace OpenRAVE {
 // To distinguish between binary and XML trajectory files
 static const uint16_t BINARY_TRAJECTORY_MAGIC_NUMBER = 0x62ff;
 static const uint16_t BINARY_TRAJECTORY_VERSION_NUMBER = 0x0003;  // Version number for serialization
+static const uint16_t BINARY_TRAJECTORY_COMPRESSED_VERSION_NUMBER = 0x0004;  // Version number for serialization of compressed waypoints, otherwise same as 0x0003
 
 static const dReal g_fEpsilonLinear = RavePow(g_fEpsilon,0.9);
 static const dReal g_fEpsilonQuadratic = RavePow(g_fEpsilon,0.45); // should be 0.6...perhaps this is related to parabolic smoother epsilons?
@@ -167,9 +169,122 @@ inline void ReadBinaryVector(const uint8_t*& f, std::vector<dReal>& v)
     f += vectorLengthBytes;
 }
 
+/* Helper functions for the compressed waypoint blocks */
+
+inline void WriteBinaryBytes(std::ostream& f, const std::vector<uint8_t>& v)
+{
+    const uint64_t numBytes = v.size();
+    f.write((const char*) &numBytes, sizeof(numBytes));
+    if( numBytes > 0 ) {
+        f.write((const char*) &v[0], numBytes);
+    }
+}
+
+inline bool ReadBinaryBytes(std::istream& f, std::vector<uint8_t>& v)
+{
+    uint64_t numBytes = 0;
+    f.read((char*) &numBytes, sizeof(numBytes));
+    v.resize(numBytes);
+    if( numBytes > 0 ) {
+        f.read((char*) &v[0], numBytes);
+    }
+    return !!f;
+}
+
+inline void ReadBinaryBytes(const uint8_t*& f, std::vector<uint8_t>& v)
+{
+    uint64_t numBytes = 0;
+    std::copy(f, f+sizeof(numBytes), (uint8_t*)&numBytes);
+    f += sizeof(numBytes);
+    v.assign(f, f+numBytes);
+    f += numBytes;
+}
+
+/// \brief returns the number of bytes left to read in the stream, or the maximum value if the stream cannot seek
+inline uint64_t GetBinaryBytesLeft(std::istream& f)
+{
+    const std::streampos pos = f.tellg();
+    if( pos < 0 ) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    f.seekg(0, std::ios::end);
+    const std::streampos endpos = f.tellg();
+    f.seekg(pos);
+    return endpos > pos ? static_cast<uint64_t>(endpos - pos) : 0;
+}
+
+/// \brief subtracts numbytes from numbytesleft, throws if the serialized data is shorter
+inline void ConsumeBinaryBytes(uint64_t& numbytesleft, uint64_t numbytes, const char* name)
+{
+    if( numbytes > numbytesleft ) {
+        throw OPENRAVE_EXCEPTION_FORMAT(_("compressed trajectory is truncated, %s needs %d bytes but only %d are left"), name%numbytes%numbytesleft, ORE_InvalidArguments);
+    }
+    numbytesleft -= numbytes;
+}
+
+/// \brief appends a signed integer with zigzag + varint encoding, small magnitudes take one byte
+inline void WriteVarInt(std::vector<uint8_t>& v, int64_t value)
+{
+    uint64_t zigzag = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    while( zigzag >= 0x80 ) {
+        v.push_back(static_cast<uint8_t>(zigzag | 0x80));
+        zigzag >>= 7;
+    }
+    v.push_back(static_cast<uint8_t>(zigzag));
+}
+
+inline int64_t ReadVarInt(const uint8_t*& f, const uint8_t* pend)
+{
+    uint64_t zigzag = 0;
+    int shift = 0;
+    while( f < pend && (*f & 0x80) && shift < 63 ) {
+        zigzag |= static_cast<uint64_t>(*f & 0x7f) << shift;
+        shift += 7;
+        ++f;
+    }
+    if( f >= pend || (*f & 0x80) ) {
+        throw OPENRAVE_EXCEPTION_FORMAT0(_("compressed trajectory block is corrupted, a value does not end inside its block"), ORE_InvalidArguments);
+    }
+    zigzag |= static_cast<uint64_t>(*f) << shift;
+    ++f;
+    return static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+}
+
+inline void WriteRawValues(std::vector<uint8_t>& v, const dReal* pvalues, size_t num)
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(pvalues);
+    v.insert(v.end(), p, p + num*sizeof(dReal));
+}
+
+inline void ReadRawValues(const uint8_t*& f, const uint8_t* pend, dReal* pvalues, size_t num)
+{
+    if( num*sizeof(dReal) > static_cast<size_t>(pend - f) ) {
+        throw OPENRAVE_EXCEPTION_FORMAT0(_("compressed trajectory block is corrupted, a value does not end inside its block"), ORE_InvalidArguments);
+    }
+    std::copy(f, f + num*sizeof(dReal), reinterpret_cast<uint8_t*>(pvalues));
+    f += num*sizeof(dReal);
+}
+
 class GenericTrajectory : public TrajectoryBase
 {
     std::map<string,int> _maporder;
+
+    /// \brief location of one sample time inside the trajectory, used for batch sampling
+    struct SampleLocation
+    {
+        size_t sampleindex; ///< index of the sample in the output buffer
+        size_t ipoint; ///< index of the waypoint starting the segment
+        dReal deltatime; ///< time from waypoint ipoint
+    };
+
+    /// \brief decoded waypoints of one block of compressed data
+    struct DecodedBlockCache
+    {
+        uint64_t compressionid = 0; ///< GenericTrajectory::_nCompressionId of the decoded data, 0 if nothing is decoded
+        size_t iblock = 0;
+        std::vector<dReal> vwaypoints;
+        std::vector<int64_t> vprev, vprevprev; ///< used by _DecodeBlock
+    };
 public:
     GenericTrajectory(EnvironmentBasePtr penv, std::istream& sinput) : TrajectoryBase(penv), _timeoffset(-1)
     {
@@ -187,6 +302,15 @@ public:
         _maporder["joint_torques"] = 11;
         _bInit = false;
         _bSamplingVerified = false;
+        _nAccumWaypoints = 0;
+        _bCompressed = false;
+        _nCompressedWaypoints = 0;
+        _nCompressionBlockSize = 0;
+        _nCompressionId = 0;
+        RegisterCommand("Compress",boost::bind(&GenericTrajectory::_CompressCommand,this,_1,_2),
+                        "Compresses the waypoints in memory into blocks of delta encoded values. Any modification of the trajectory decompresses it again. Format is:\n\n  blocksize [groupname quantization]*\n\nValues of groups whose name starts with groupname are quantized to multiples of quantization, all other groups are stored with full precision.");
+        RegisterCommand("Decompress",boost::bind(&GenericTrajectory::_DecompressCommand,this,_1,_2),
+                        "Restores the uncompressed waypoint storage.");
     }
 
     bool SortGroups(const ConfigurationSpecification::Group& g1, const ConfigurationSpecification::Group& g2)
@@ -226,6 +350,7 @@ public:
             //BOOST_ASSERT(spec.GetDOF()>0 && spec.IsValid()); // when deserializing, can sometimes get invalid spec, but that's ok
             _bInit = false;
             _vgroupinterpolators.resize(0);
+            _vgroupbatchinterpolators.resize(0);
             _vgroupvalidators.resize(0);
             _vderivoffsets.resize(0);
             _vddoffsets.resize(0);
@@ -244,8 +369,10 @@ public:
             _InitializeGroupFunctions();
         }
         _vtrajdata.clear();
+        _ClearCompressed();
         _vaccumtime.clear();
         _vdeltainvtime.clear();
+        _nAccumWaypoints = 0;
         _bChanged = true;
         _bSamplingVerified = false;
         _bInit = true;
@@ -254,10 +381,11 @@ public:
     void ClearWaypoints() override
     {
         if( _bInit ) {
-            if( _vtrajdata.size() > 0 ) {
+            if( GetNumWaypoints() > 0 ) {
                 _bSamplingVerified = false;
-                _bChanged = true;
+                _SetChangedFrom(0);
                 _vtrajdata.clear();
+                _ClearCompressed();
             }
         }
     }
@@ -276,6 +404,7 @@ public:
         }
         BOOST_ASSERT(_spec.GetDOF()>0);
         OPENRAVE_ASSERT_FORMAT((nDataElements%_spec.GetDOF()) == 0, "%d does not divide dof %d", nDataElements%_spec.GetDOF(), ORE_InvalidArguments);
+        _Decompress();
         OPENRAVE_ASSERT_OP(index*_spec.GetDOF(),<=,_vtrajdata.size());
         if( bOverwrite && index*_spec.GetDOF() < _vtrajdata.size() ) {
             const size_t copysize = min(nDataElements, _vtrajdata.size()-index*_spec.GetDOF());
@@ -287,7 +416,7 @@ public:
         else {
             _vtrajdata.insert(_vtrajdata.begin()+index*_spec.GetDOF(), pdata, pdata+nDataElements);
         }
-        _bChanged = true;
+        _SetChangedFrom(index);
     }
 
     void Insert(size_t index, const std::vector<dReal>& data, const ConfigurationSpecification& spec, bool bOverwrite) override
@@ -303,6 +432,7 @@ public:
         }
         BOOST_ASSERT(spec.GetDOF()>0);
         OPENRAVE_ASSERT_FORMAT((nDataElements%spec.GetDOF()) == 0, "%d does not divide dof %d", nDataElements%spec.GetDOF(), ORE_InvalidArguments);
+        _Decompress();
         OPENRAVE_ASSERT_OP(index*_spec.GetDOF(),<=,_vtrajdata.size());
         if( _spec == spec ) {
             Insert(index, pdata, nDataElements, bOverwrite);
@@ -312,6 +442,7 @@ public:
             for(size_t i = 0; i < vconvertgroups.size(); ++i) {
                 vconvertgroups[i] = spec.FindCompatibleGroup(_spec._vgroups[i]);
             }
+            _SetChangedFrom(index);
             size_t numpoints = nDataElements/spec.GetDOF();
             size_t sourceindex = 0;
             std::vector<dReal>::iterator ittargetdata;
@@ -324,12 +455,19 @@ public:
             }
             if( sourceindex < nDataElements ) {
                 size_t numelements = (nDataElements-sourceindex)/spec.GetDOF();
-                std::vector<dReal> vtemp(numelements*_spec.GetDOF());
-                ittargetdata = vtemp.begin();
-                _ConvertData(ittargetdata, pdata+sourceindex, vconvertgroups, spec, numelements, true);
-                _vtrajdata.insert(_vtrajdata.begin()+index*_spec.GetDOF(),vtemp.begin(),vtemp.end());
+                if( index*_spec.GetDOF() == _vtrajdata.size() ) {
+                    // appending, so convert directly at the end without a temporary buffer
+                    _vtrajdata.resize(_vtrajdata.size()+numelements*_spec.GetDOF());
+                    ittargetdata = _vtrajdata.begin()+index*_spec.GetDOF();
+                    _ConvertData(ittargetdata, pdata+sourceindex, vconvertgroups, spec, numelements, true);
+                }
+                else {
+                    std::vector<dReal> vtemp(numelements*_spec.GetDOF());
+                    ittargetdata = vtemp.begin();
+                    _ConvertData(ittargetdata, pdata+sourceindex, vconvertgroups, spec, numelements, true);
+                    _vtrajdata.insert(_vtrajdata.begin()+index*_spec.GetDOF(),vtemp.begin(),vtemp.end());
+                }
             }
-            _bChanged = true;
         }
     }
 
@@ -339,10 +477,11 @@ public:
         if( startindex == endindex ) {
             return;
         }
+        _Decompress();
         BOOST_ASSERT(startindex*_spec.GetDOF() <= _vtrajdata.size() && endindex*_spec.GetDOF() <= _vtrajdata.size());
         OPENRAVE_ASSERT_OP(startindex,<,endindex);
         _vtrajdata.erase(_vtrajdata.begin()+startindex*_spec.GetDOF(),_vtrajdata.begin()+endindex*_spec.GetDOF());
-        _bChanged = true;
+        _SetChangedFrom(startindex);
     }
 
     void Sample(std::vector<dReal>& data, dReal time) const override
@@ -351,25 +490,28 @@ public:
         BOOST_ASSERT(_timeoffset>=0);
         BOOST_ASSERT(time >= 0);
         _ComputeInternal();
-        OPENRAVE_ASSERT_OP_FORMAT0((int)_vtrajdata.size(),>=,_spec.GetDOF(), "trajectory needs at least one point to sample from", ORE_InvalidArguments);
+        OPENRAVE_ASSERT_OP_FORMAT0((int)GetNumWaypoints(),>,0, "trajectory needs at least one point to sample from", ORE_InvalidArguments);
         if( IS_DEBUGLEVEL(Level_Verbose) || (RaveGetDebugLevel() & Level_VerifyPlans) ) {
             _VerifySampling();
         }
         data.resize(0);
         data.resize(_spec.GetDOF(),0);
         if( time >= GetDuration() ) {
-            std::copy(_vtrajdata.end()-_spec.GetDOF(),_vtrajdata.end(),data.begin());
+            const dReal* pwaypoint = _GetWaypointData(GetNumWaypoints()-1);
+            std::copy(pwaypoint,pwaypoint+_spec.GetDOF(),data.begin());
         }
         else {
-            std::vector<dReal>::iterator it = std::lower_bound(_vaccumtime.begin(),_vaccumtime.end(),time);
+            size_t hintindex = _vaccumtime.size()-1; // online trajectories are usually sampled at their last segment
+            std::vector<dReal>::iterator it = _vaccumtime.begin() + _FindAccumTimeIndex(time, hintindex);
             if( it == _vaccumtime.begin() ) {
-                std::copy(_vtrajdata.begin(),_vtrajdata.begin()+_spec.GetDOF(),data.begin());
+                const dReal* pwaypoint = _GetWaypointData(0);
+                std::copy(pwaypoint,pwaypoint+_spec.GetDOF(),data.begin());
                 data.at(_timeoffset) = time;
             }
             else {
                 size_t index = it-_vaccumtime.begin();
                 dReal deltatime = time-_vaccumtime.at(index-1);
-                dReal waypointdeltatime = _vtrajdata.at(_spec.GetDOF()*index + _timeoffset);
+                dReal waypointdeltatime = _GetWaypointData(index)[_timeoffset];
                 // unfortunately due to floating-point error deltatime might not be in the range [0, waypointdeltatime], so double check!
                 if( deltatime < 0 ) {
                     // most likely small epsilon
@@ -395,7 +537,7 @@ public:
         OPENRAVE_ASSERT_OP(_timeoffset,>=,0);
         OPENRAVE_ASSERT_OP(time, >=, -g_fEpsilon);
         _ComputeInternal();
-        OPENRAVE_ASSERT_OP_FORMAT0((int)_vtrajdata.size(),>=,_spec.GetDOF(), "trajectory needs at least one point to sample from", ORE_InvalidArguments);
+        OPENRAVE_ASSERT_OP_FORMAT0((int)GetNumWaypoints(),>,0, "trajectory needs at least one point to sample from", ORE_InvalidArguments);
         if( IS_DEBUGLEVEL(Level_Verbose) || (RaveGetDebugLevel() & Level_VerifyPlans) ) {
             _VerifySampling();
         }
@@ -404,19 +546,34 @@ public:
         }
         data.resize(spec.GetDOF(),0);
         if( time >= GetDuration() ) {
-            ConfigurationSpecification::ConvertData(data.begin(),spec,_vtrajdata.end()-_spec.GetDOF(),_spec,1,GetEnv());
+            if( _bCompressed ) {
+                const dReal* pwaypoint = _GetWaypointData(GetNumWaypoints()-1);
+                vector<dReal> vinternaldata(pwaypoint,pwaypoint+_spec.GetDOF());
+                ConfigurationSpecification::ConvertData(data.begin(),spec,vinternaldata.begin(),_spec,1,GetEnv());
+            }
+            else {
+                ConfigurationSpecification::ConvertData(data.begin(),spec,_vtrajdata.end()-_spec.GetDOF(),_spec,1,GetEnv());
+            }
         }
         else {
-            std::vector<dReal>::iterator it = std::lower_bound(_vaccumtime.begin(),_vaccumtime.end(),time);
+            size_t hintindex = _vaccumtime.size()-1; // online trajectories are usually sampled at their last segment
+            std::vector<dReal>::iterator it = _vaccumtime.begin() + _FindAccumTimeIndex(time, hintindex);
             if( it == _vaccumtime.begin() ) {
-                ConfigurationSpecification::ConvertData(data.begin(),spec,_vtrajdata.begin(),_spec,1,GetEnv());
+                if( _bCompressed ) {
+                    const dReal* pwaypoint = _GetWaypointData(0);
+                    vector<dReal> vinternaldata(pwaypoint,pwaypoint+_spec.GetDOF());
+                    ConfigurationSpecification::ConvertData(data.begin(),spec,vinternaldata.begin(),_spec,1,GetEnv());
+                }
+                else {
+                    ConfigurationSpecification::ConvertData(data.begin(),spec,_vtrajdata.begin(),_spec,1,GetEnv());
+                }
             }
             else {
                 // could be faster
                 vector<dReal> vinternaldata(_spec.GetDOF(),0);
                 size_t index = it-_vaccumtime.begin();
                 dReal deltatime = time-_vaccumtime.at(index-1);
-                dReal waypointdeltatime = _vtrajdata.at(_spec.GetDOF()*index + _timeoffset);
+                dReal waypointdeltatime = _GetWaypointData(index)[_timeoffset];
                 // unfortunately due to floating-point error deltatime might not be in the range [0, waypointdeltatime], so double check!
                 if( deltatime < 0 ) {
                     // most likely small epsilon
@@ -438,12 +595,41 @@ public:
         }
     }
 
+    void SamplePoints(std::vector<dReal>& data, const std::vector<dReal>& times) const override
+    {
+        BOOST_ASSERT(_bInit);
+        BOOST_ASSERT(_timeoffset>=0);
+        _ComputeInternal();
+        OPENRAVE_ASSERT_OP_FORMAT0((int)GetNumWaypoints(),>,0, "trajectory needs at least one point to sample from", ORE_InvalidArguments);
+        if( IS_DEBUGLEVEL(Level_Verbose) || (RaveGetDebugLevel() & Level_VerifyPlans) ) {
+            _VerifySampling();
+        }
+        data.resize(_spec.GetDOF()*times.size());
+        if( times.size() > 0 ) {
+            _SamplePointsBatch(data.begin(), times.data(), times.size());
+        }
+    }
+
+    void SamplePoints(std::vector<dReal>& data, const std::vector<dReal>& times, const ConfigurationSpecification& spec) const override
+    {
+        if( spec == _spec ) {
+            return SamplePoints(data, times);
+        }
+
+        std::vector<dReal> dataInSourceSpec;
+        SamplePoints(dataInSourceSpec, times);
+        data.resize(spec.GetDOF()*times.size());
+        if( times.size() > 0 ) {
+            ConfigurationSpecification::ConvertData(data.begin(), spec, dataInSourceSpec.begin(), _spec, times.size(), GetEnv());
+        }
+    }
+
     void SamplePointsSameDeltaTime(std::vector<dReal>& data, dReal deltatime, bool ensureLastPoint) const override
     {
         BOOST_ASSERT(_bInit);
         BOOST_ASSERT(_timeoffset>=0);
         _ComputeInternal();
-        OPENRAVE_ASSERT_OP_FORMAT0((int)_vtrajdata.size(),>=,_spec.GetDOF(), "trajectory needs at least one point to sample from", ORE_InvalidArguments);
+        OPENRAVE_ASSERT_OP_FORMAT0((int)GetNumWaypoints(),>,0, "trajectory needs at least one point to sample from", ORE_InvalidArguments);
         if( IS_DEBUGLEVEL(Level_Verbose) || (RaveGetDebugLevel() & Level_VerifyPlans) ) {
             _VerifySampling();
         }
@@ -454,54 +640,25 @@ public:
             numPoints++;
         }
 
-        int dof = GetConfigurationSpecification().GetDOF();
-        //std::vector<dReal> dataPerTimestep(dof,0);
+        const int dof = _spec.GetDOF();
         data.resize(dof*numPoints);
+        if( numPoints == 0 ) {
+            return;
+        }
 
-        const std::vector<dReal>::const_iterator begin = _vaccumtime.begin();
-        std::vector<dReal>::const_iterator it = begin;
-
-        std::vector<dReal>::iterator itdata = data.begin();
-
-        for(int i = 0; i < (ensureLastPoint ? numPoints-1 : numPoints); ++i, itdata += dof) {
-            dReal sampletime = i * deltatime;
-            if( sampletime >= duration ) {
-                std::copy(_vtrajdata.end() - _spec.GetDOF(), _vtrajdata.end(), itdata);
-            }
-            else {
-                // knowing time always increases, it is safe to search in [it, end] instead of [begin, end]
-                it = std::lower_bound(it, _vaccumtime.cend(), sampletime);
-
-                if( it == begin ) {
-                    std::copy(_vtrajdata.begin(),_vtrajdata.begin()+_spec.GetDOF(),itdata);
-                    *(itdata + _timeoffset) = sampletime;
-                }
-                else {
-                    size_t index = it - begin;
-                    dReal timeFromLowerWaypoint = sampletime - _vaccumtime.at(index-1);
-                    dReal waypointdeltatime = _vtrajdata.at(_spec.GetDOF()*index + _timeoffset);
-                    // unfortunately due to floating-point error timeFromLowerWaypoint might not be in the range [0, waypointdeltatime], so double check!
-                    if( timeFromLowerWaypoint < 0 ) {
-                        // most likely small epsilon
-                        timeFromLowerWaypoint = 0;
-                    }
-                    else if( timeFromLowerWaypoint > waypointdeltatime ) {
-                        timeFromLowerWaypoint = waypointdeltatime;
-                    }
-                    for(size_t j = 0; j < _vgroupinterpolators.size(); ++j) {
-                        if( !!_vgroupinterpolators[j] ) {
-                            _vgroupinterpolators[j](index-1, timeFromLowerWaypoint, itdata);
-                        }
-                    }
-                    // should return the sample time relative to the last endpoint so it is easier to re-insert in the trajectory
-                    *(itdata + _timeoffset) = timeFromLowerWaypoint;
-                }
-            }
+        const int numSampledPoints = ensureLastPoint ? numPoints-1 : numPoints;
+        std::vector<dReal> vtimes(numSampledPoints);
+        for(int i = 0; i < numSampledPoints; ++i) {
+            vtimes[i] = i * deltatime;
+        }
+        if( numSampledPoints > 0 ) {
+            _SamplePointsBatch(data.begin(), vtimes.data(), vtimes.size());
         }
 
         if (ensureLastPoint) {
-            // copy the last point, itdata should point to that
-            std::copy(_vtrajdata.end() - _spec.GetDOF(), _vtrajdata.end(), itdata);
+            // copy the last point
+            const dReal* pwaypoint = _GetWaypointData(GetNumWaypoints()-1);
+            std::copy(pwaypoint, pwaypoint+dof, data.begin() + dof*numSampledPoints);
         }
     }
 
@@ -537,21 +694,41 @@ public:
     size_t GetNumWaypoints() const override
     {
         BOOST_ASSERT(_bInit);
+        if( _bCompressed ) {
+            return _nCompressedWaypoints;
+        }
         return _vtrajdata.size()/_spec.GetDOF();
     }
 
     void GetWaypoints(size_t startindex, size_t endindex, std::vector<dReal>& data) const override
     {
         BOOST_ASSERT(_bInit);
-        BOOST_ASSERT(startindex<=endindex && startindex*_spec.GetDOF() <= _vtrajdata.size() && endindex*_spec.GetDOF() <= _vtrajdata.size());
+        BOOST_ASSERT(startindex<=endindex && endindex <= GetNumWaypoints());
         data.resize((endindex-startindex)*_spec.GetDOF(),0);
+        if( _bCompressed ) {
+            std::vector<dReal>::iterator itdata = data.begin();
+            for(size_t index = startindex; index < endindex; ++index, itdata += _spec.GetDOF()) {
+                const dReal* pwaypoint = _GetWaypointData(index);
+                std::copy(pwaypoint, pwaypoint+_spec.GetDOF(), itdata);
+            }
+            return;
+        }
         std::copy(_vtrajdata.begin()+startindex*_spec.GetDOF(),_vtrajdata.begin()+endindex*_spec.GetDOF(),data.begin());
     }
 
     void GetWaypoints(size_t startindex, size_t endindex, std::vector<dReal>& data, const ConfigurationSpecification& spec) const override
     {
         BOOST_ASSERT(_bInit);
-        BOOST_ASSERT(startindex<=endindex && startindex*_spec.GetDOF() <= _vtrajdata.size() && endindex*_spec.GetDOF() <= _vtrajdata.size());
+        BOOST_ASSERT(startindex<=endindex && endindex <= GetNumWaypoints());
+        if( _bCompressed ) {
+            std::vector<dReal> vinternaldata;
+            GetWaypoints(startindex, endindex, vinternaldata);
+            data.resize(spec.GetDOF()*(endindex-startindex),0);
+            if( startindex < endindex ) {
+                ConfigurationSpecification::ConvertData(data.begin(),spec,vinternaldata.begin(),_spec,endindex-startindex,GetEnv());
+            }
+            return;
+        }
         data.resize(spec.GetDOF()*(endindex-startindex),0);
         if( startindex < endindex ) {
             ConfigurationSpecification::ConvertData(data.begin(),spec,_vtrajdata.begin()+startindex*_spec.GetDOF(),_spec,endindex-startindex,GetEnv());
@@ -595,7 +772,7 @@ public:
 
             // Write binary file header
             WriteBinaryUInt16(O, BINARY_TRAJECTORY_MAGIC_NUMBER);
-            WriteBinaryUInt16(O, BINARY_TRAJECTORY_VERSION_NUMBER);
+            WriteBinaryUInt16(O, _bCompressed ? BINARY_TRAJECTORY_COMPRESSED_VERSION_NUMBER : BINARY_TRAJECTORY_VERSION_NUMBER);
 
             /* Store meta-data */
 
@@ -613,7 +790,12 @@ public:
             }
 
             /* Store data waypoints */
-            WriteBinaryVector(O, this->_vtrajdata);
+            if( _bCompressed ) {
+                _WriteCompressedWaypoints(O);
+            }
+            else {
+                WriteBinaryVector(O, this->_vtrajdata);
+            }
 
             WriteBinaryString(O, GetDescription());
 
@@ -687,8 +869,8 @@ public:
             uint16_t versionNumber = 0;
             ReadBinaryUInt16(I, versionNumber);
 
-            // currently supported versions: 0x0001, 0x0002
-            if (versionNumber > BINARY_TRAJECTORY_VERSION_NUMBER || versionNumber < 0x0001)
+            // currently supported versions: 0x0001, 0x0002, 0x0003, 0x0004
+            if (versionNumber > BINARY_TRAJECTORY_COMPRESSED_VERSION_NUMBER || versionNumber < 0x0001)
             {
                 throw OPENRAVE_EXCEPTION_FORMAT(_("unsupported trajectory format version %d "),versionNumber,ORE_InvalidArguments);
             }
@@ -711,7 +893,12 @@ public:
             this->Init(_spec);
 
             /* Read trajectory data */
-            ReadBinaryVector(I, this->_vtrajdata);
+            if( versionNumber >= BINARY_TRAJECTORY_COMPRESSED_VERSION_NUMBER ) {
+                _ReadCompressedWaypoints(I);
+            }
+            else {
+                ReadBinaryVector(I, this->_vtrajdata);
+            }
             ReadBinaryString(I, __description);
 
             // clear out existing readable interfaces
@@ -779,8 +966,8 @@ public:
             uint16_t versionNumber = 0;
             ReadBinaryUInt16(I, versionNumber);
 
-            // currently supported versions: 0x0001, 0x0002
-            if (versionNumber > BINARY_TRAJECTORY_VERSION_NUMBER || versionNumber < 0x0001)
+            // currently supported versions: 0x0001, 0x0002, 0x0003, 0x0004
+            if (versionNumber > BINARY_TRAJECTORY_COMPRESSED_VERSION_NUMBER || versionNumber < 0x0001)
             {
                 throw OPENRAVE_EXCEPTION_FORMAT(_("unsupported trajectory format version %d "),versionNumber,ORE_InvalidArguments);
             }
@@ -803,7 +990,12 @@ public:
             this->Init(_spec);
 
             /* Read trajectory data */
-            ReadBinaryVector(I, this->_vtrajdata);
+            if( versionNumber >= BINARY_TRAJECTORY_COMPRESSED_VERSION_NUMBER ) {
+                _ReadCompressedWaypoints(I, pdata+nDataSize);
+            }
+            else {
+                ReadBinaryVector(I, this->_vtrajdata);
+            }
             ReadBinaryString(I, __description);
 
             // clear out existing readable interfaces
@@ -863,7 +1055,7 @@ public:
         TrajectoryBaseConstPtr r = RaveInterfaceConstCast<TrajectoryBase>(preference);
         Init(r->GetConfigurationSpecification());
         r->GetWaypoints(0,r->GetNumWaypoints(),_vtrajdata);
-        _bChanged = true;
+        _SetChangedFrom(0);
     }
 
     void Swap(TrajectoryBasePtr rawtraj) override
@@ -881,6 +1073,14 @@ public:
         std::swap(_vtrajdata, traj->_vtrajdata);
         std::swap(_vaccumtime, traj->_vaccumtime);
         std::swap(_vdeltainvtime, traj->_vdeltainvtime);
+        std::swap(_nAccumWaypoints, traj->_nAccumWaypoints);
+        std::swap(_bCompressed, traj->_bCompressed);
+        std::swap(_nCompressedWaypoints, traj->_nCompressedWaypoints);
+        std::swap(_nCompressionBlockSize, traj->_nCompressionBlockSize);
+        _vquantization.swap(traj->_vquantization);
+        _vcompresseddata.swap(traj->_vcompresseddata);
+        _vcompressedblockoffsets.swap(traj->_vcompressedblockoffsets);
+        std::swap(_nCompressionId, traj->_nCompressionId);
         std::swap(_bChanged, traj->_bChanged);
         std::swap(_bSamplingVerified, traj->_bSamplingVerified);
         _InitializeGroupFunctions();
@@ -919,6 +1119,337 @@ protected:
         }
     }
 
+    /// \brief marks all waypoints starting at index as modified
+    inline void _SetChangedFrom(size_t index)
+    {
+        _nAccumWaypoints = min(_nAccumWaypoints, index);
+        _bChanged = true;
+    }
+
+    /// \brief returns a pointer to the values of waypoint ipoint. The values of waypoint ipoint+1 (if it exists) directly follow.
+    ///
+    /// If the trajectory is compressed, the block containing ipoint is decoded into the cache of the calling thread, so the pointer is only valid until the next call from the same thread.
+    inline const dReal* _GetWaypointData(size_t ipoint) const
+    {
+        if( !_bCompressed ) {
+            return &_vtrajdata[ipoint*_spec.GetDOF()];
+        }
+        const size_t iblock = ipoint/_nCompressionBlockSize;
+        DecodedBlockCache& cache = _GetDecodedBlockCache();
+        if( cache.compressionid != _nCompressionId || cache.iblock != iblock ) {
+            _DecodeBlock(iblock, cache);
+        }
+        return &cache.vwaypoints[(ipoint - iblock*_nCompressionBlockSize)*_spec.GetDOF()];
+    }
+
+    /// \brief every thread decodes into its own cache, so concurrent const sampling of a compressed trajectory does not share any mutable state
+    static DecodedBlockCache& _GetDecodedBlockCache()
+    {
+        static thread_local DecodedBlockCache s_cache;
+        return s_cache;
+    }
+
+    /// \brief returns a new id for compressed data, never 0
+    static uint64_t _GetNewCompressionId()
+    {
+        static std::atomic<uint64_t> s_nextCompressionId(1);
+        return s_nextCompressionId++;
+    }
+
+    bool _CompressCommand(std::ostream& sout, std::istream& sinput)
+    {
+        int blocksize = 0;
+        sinput >> blocksize;
+        if( !sinput || blocksize <= 0 ) {
+            return false;
+        }
+        std::vector<dReal> vquantization(_spec.GetDOF(), 0);
+        std::string groupname;
+        dReal quantization = 0;
+        while( sinput >> groupname >> quantization ) {
+            bool bFound = false;
+            FOREACHC(itgroup, _spec._vgroups) {
+                if( itgroup->name.size() >= groupname.size() && itgroup->name.substr(0, groupname.size()) == groupname ) {
+                    std::fill(vquantization.begin()+itgroup->offset, vquantization.begin()+itgroup->offset+itgroup->dof, quantization);
+                    bFound = true;
+                }
+            }
+            if( !bFound ) {
+                RAVELOG_WARN_FORMAT("trajectory does not have group '%s' for compression", groupname);
+            }
+        }
+        _Compress(blocksize, vquantization);
+        return true;
+    }
+
+    bool _DecompressCommand(std::ostream& sout, std::istream& sinput)
+    {
+        _Decompress();
+        return true;
+    }
+
+    /** \brief compresses _vtrajdata into blocks of blocksize waypoints.
+
+        Every block starts with a full precision waypoint so it can be decoded independently, _vcompressedblockoffsets indexes the blocks. In the rest of the block, values with a quantization > 0 are stored as the difference of the quantized value to a linear prediction from the two previous waypoints (a zigzag varint, usually one or two bytes for smooth high-rate data). Values without quantization are stored with full precision. The deltatime values are always stored with full precision.
+        _vaccumtime and _vdeltainvtime are kept uncompressed so that sampling can directly find the block of a time.
+     */
+    void _Compress(int blocksize, const std::vector<dReal>& vquantization)
+    {
+        BOOST_ASSERT(_bInit);
+        _Decompress();
+        _ComputeInternal();
+        const int dof = _spec.GetDOF();
+        OPENRAVE_ASSERT_OP((int)vquantization.size(),==,dof);
+        _vquantization = vquantization;
+        if( _timeoffset >= 0 ) {
+            _vquantization.at(_timeoffset) = 0;
+        }
+        _nCompressionBlockSize = blocksize;
+        _nCompressedWaypoints = _vtrajdata.size()/dof;
+        _vcompresseddata.resize(0);
+        _vcompressedblockoffsets.resize(0);
+        std::vector<int64_t> vprev(dof,0), vprevprev(dof,0);
+        for(size_t startindex = 0; startindex < _nCompressedWaypoints; startindex += blocksize) {
+            _vcompressedblockoffsets.push_back(_vcompresseddata.size());
+            const size_t endindex = min(startindex+blocksize, _nCompressedWaypoints);
+            const dReal* pwaypoint = &_vtrajdata[startindex*dof];
+            WriteRawValues(_vcompresseddata, pwaypoint, dof);
+            for(int j = 0; j < dof; ++j) {
+                if( _vquantization[j] > 0 ) {
+                    vprev[j] = vprevprev[j] = llround(pwaypoint[j]/_vquantization[j]);
+                }
+            }
+            for(size_t index = startindex+1; index < endindex; ++index) {
+                pwaypoint = &_vtrajdata[index*dof];
+                for(int j = 0; j < dof; ++j) {
+                    if( _vquantization[j] > 0 ) {
+                        const int64_t value = llround(pwaypoint[j]/_vquantization[j]);
+                        WriteVarInt(_vcompresseddata, value - (2*vprev[j] - vprevprev[j]));
+                        vprevprev[j] = vprev[j];
+                        vprev[j] = value;
+                    }
+                    else {
+                        WriteRawValues(_vcompresseddata, pwaypoint+j, 1);
+                    }
+                }
+            }
+        }
+        std::vector<uint8_t>(_vcompresseddata).swap(_vcompresseddata); // release the unused capacity
+        std::vector<dReal>().swap(_vtrajdata);
+        _nCompressionId = _GetNewCompressionId();
+        _bCompressed = true;
+    }
+
+    /// \brief decodes block iblock into cache, also decodes the first waypoint of the next block so that segments crossing blocks can be interpolated.
+    void _DecodeBlock(size_t iblock, DecodedBlockCache& cache) const
+    {
+        const int dof = _spec.GetDOF();
+        const size_t startindex = iblock*_nCompressionBlockSize;
+        const size_t endindex = min(startindex+_nCompressionBlockSize, _nCompressedWaypoints);
+        const bool bHasNextBlock = endindex < _nCompressedWaypoints;
+        cache.vwaypoints.resize((endindex-startindex+(bHasNextBlock ? 1 : 0))*dof);
+        std::vector<int64_t>& vprev = cache.vprev, &vprevprev = cache.vprevprev;
+        vprev.resize(dof);
+        vprevprev.resize(dof);
+        const uint8_t* f = &_vcompresseddata.at(_vcompressedblockoffsets.at(iblock));
+        const uint8_t* pend = &_vcompresseddata[0] + (bHasNextBlock ? _vcompressedblockoffsets.at(iblock+1) : _vcompresseddata.size());
+        dReal* pwaypoint = &cache.vwaypoints[0];
+        ReadRawValues(f, pend, pwaypoint, dof);
+        for(int j = 0; j < dof; ++j) {
+            if( _vquantization[j] > 0 ) {
+                vprev[j] = vprevprev[j] = llround(pwaypoint[j]/_vquantization[j]);
+            }
+        }
+        for(size_t index = startindex+1; index < endindex; ++index) {
+            pwaypoint += dof;
+            for(int j = 0; j < dof; ++j) {
+                if( _vquantization[j] > 0 ) {
+                    const int64_t value = ReadVarInt(f, pend) + 2*vprev[j] - vprevprev[j];
+                    pwaypoint[j] = value*_vquantization[j];
+                    vprevprev[j] = vprev[j];
+                    vprev[j] = value;
+                }
+                else {
+                    ReadRawValues(f, pend, pwaypoint+j, 1);
+                }
+            }
+        }
+        if( bHasNextBlock ) {
+            f = &_vcompresseddata.at(_vcompressedblockoffsets.at(iblock+1));
+            pend = &_vcompresseddata[0] + _vcompresseddata.size();
+            ReadRawValues(f, pend, pwaypoint+dof, dof);
+        }
+        cache.compressionid = _nCompressionId;
+        cache.iblock = iblock;
+    }
+
+    /// \brief if compressed, restores _vtrajdata from the compressed blocks
+    void _Decompress()
+    {
+        if( !_bCompressed ) {
+            return;
+        }
+        const int dof = _spec.GetDOF();
+        std::vector<dReal> vtrajdata(_nCompressedWaypoints*dof);
+        DecodedBlockCache& cache = _GetDecodedBlockCache();
+        for(size_t iblock = 0; iblock < _vcompressedblockoffsets.size(); ++iblock) {
+            _DecodeBlock(iblock, cache);
+            const size_t startindex = iblock*_nCompressionBlockSize;
+            const size_t numwaypoints = min((size_t)_nCompressionBlockSize, _nCompressedWaypoints-startindex);
+            std::copy(cache.vwaypoints.begin(), cache.vwaypoints.begin()+numwaypoints*dof, vtrajdata.begin()+startindex*dof);
+        }
+        _ClearCompressed();
+        _vtrajdata.swap(vtrajdata);
+        // the decoded values are not exactly the same as the original ones, so the time values have to be recomputed
+        _SetChangedFrom(0);
+    }
+
+    void _ClearCompressed()
+    {
+        _bCompressed = false;
+        _nCompressedWaypoints = 0;
+        _vcompresseddata.clear();
+        _vcompressedblockoffsets.clear();
+        _nCompressionId = 0;
+    }
+
+    void _WriteCompressedWaypoints(std::ostream& O) const
+    {
+        WriteBinaryUInt32(O, _nCompressedWaypoints);
+        WriteBinaryUInt32(O, _nCompressionBlockSize);
+        WriteBinaryVector(O, _vquantization);
+        WriteBinaryUInt32(O, _vcompressedblockoffsets.size());
+        FOREACHC(itoffset, _vcompressedblockoffsets) {
+            const uint64_t offset = *itoffset;
+            O.write((const char*) &offset, sizeof(offset));
+        }
+        WriteBinaryBytes(O, _vcompresseddata);
+    }
+
+    /// \brief every size is checked against the bytes left in the stream before anything is allocated or read
+    void _ReadCompressedWaypoints(std::istream& I)
+    {
+        uint64_t numbytesleft = GetBinaryBytesLeft(I);
+        uint32_t numwaypoints = 0, blocksize = 0, numquantization = 0, numblocks = 0;
+        uint64_t numdatabytes = 0;
+        ConsumeBinaryBytes(numbytesleft, 3*sizeof(uint32_t), "header");
+        ReadBinaryUInt32(I, numwaypoints);
+        ReadBinaryUInt32(I, blocksize);
+        ReadBinaryUInt32(I, numquantization);
+        _CheckCompressedHeader(blocksize, numquantization);
+        ConsumeBinaryBytes(numbytesleft, numquantization*sizeof(dReal), "quantization");
+        _vquantization.resize(numquantization);
+        if( numquantization > 0 ) {
+            I.read((char*) &_vquantization[0], numquantization*sizeof(dReal));
+        }
+        ConsumeBinaryBytes(numbytesleft, sizeof(numblocks), "block count");
+        ReadBinaryUInt32(I, numblocks);
+        _CheckCompressedBlockCount(numwaypoints, blocksize, numblocks);
+        ConsumeBinaryBytes(numbytesleft, numblocks*sizeof(uint64_t), "block offsets");
+        _vcompressedblockoffsets.resize(numblocks);
+        for(size_t iblock = 0; iblock < numblocks; ++iblock) {
+            uint64_t offset = 0;
+            I.read((char*) &offset, sizeof(offset));
+            _vcompressedblockoffsets[iblock] = offset;
+        }
+        ConsumeBinaryBytes(numbytesleft, sizeof(numdatabytes), "block size");
+        I.read((char*) &numdatabytes, sizeof(numdatabytes));
+        ConsumeBinaryBytes(numbytesleft, numdatabytes, "blocks");
+        _vcompresseddata.resize(numdatabytes);
+        if( numdatabytes > 0 ) {
+            I.read((char*) &_vcompresseddata[0], numdatabytes);
+        }
+        if( !I ) {
+            throw OPENRAVE_EXCEPTION_FORMAT0(_("compressed trajectory is truncated"), ORE_InvalidArguments);
+        }
+        _SetCompressedData(numwaypoints, blocksize);
+    }
+
+    /// \brief every size is checked against the bytes left before pend before anything is allocated or read
+    void _ReadCompressedWaypoints(const uint8_t*& I, const uint8_t* pend)
+    {
+        uint64_t numbytesleft = pend > I ? pend - I : 0;
+        uint32_t numwaypoints = 0, blocksize = 0, numquantization = 0, numblocks = 0;
+        uint64_t numdatabytes = 0;
+        ConsumeBinaryBytes(numbytesleft, 3*sizeof(uint32_t), "header");
+        ReadBinaryUInt32(I, numwaypoints);
+        ReadBinaryUInt32(I, blocksize);
+        ReadBinaryUInt32(I, numquantization);
+        _CheckCompressedHeader(blocksize, numquantization);
+        ConsumeBinaryBytes(numbytesleft, numquantization*sizeof(dReal), "quantization");
+        _vquantization.resize(numquantization);
+        if( numquantization > 0 ) {
+            std::copy(I, I+numquantization*sizeof(dReal), (uint8_t*)&_vquantization[0]);
+            I += numquantization*sizeof(dReal);
+        }
+        ConsumeBinaryBytes(numbytesleft, sizeof(numblocks), "block count");
+        ReadBinaryUInt32(I, numblocks);
+        _CheckCompressedBlockCount(numwaypoints, blocksize, numblocks);
+        ConsumeBinaryBytes(numbytesleft, numblocks*sizeof(uint64_t), "block offsets");
+        _vcompressedblockoffsets.resize(numblocks);
+        for(size_t iblock = 0; iblock < numblocks; ++iblock) {
+            uint64_t offset = 0;
+            std::copy(I, I+sizeof(offset), (uint8_t*)&offset);
+            I += sizeof(offset);
+            _vcompressedblockoffsets[iblock] = offset;
+        }
+        ConsumeBinaryBytes(numbytesleft, sizeof(numdatabytes), "block size");
+        std::copy(I, I+sizeof(numdatabytes), (uint8_t*)&numdatabytes);
+        I += sizeof(numdatabytes);
+        ConsumeBinaryBytes(numbytesleft, numdatabytes, "blocks");
+        _vcompresseddata.assign(I, I+numdatabytes);
+        I += numdatabytes;
+        _SetCompressedData(numwaypoints, blocksize);
+    }
+
+    void _CheckCompressedHeader(uint32_t blocksize, uint32_t numquantization) const
+    {
+        if( (int)numquantization != _spec.GetDOF() ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("compressed trajectory has %d quantization values, but its dof is %d"), numquantization%_spec.GetDOF(), ORE_InvalidArguments);
+        }
+        if( blocksize == 0 || blocksize > (uint32_t)std::numeric_limits<int>::max() ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("compressed trajectory has invalid block size %d"), blocksize, ORE_InvalidArguments);
+        }
+    }
+
+    void _CheckCompressedBlockCount(uint32_t numwaypoints, uint32_t blocksize, uint32_t numblocks) const
+    {
+        const uint64_t expectednumblocks = (static_cast<uint64_t>(numwaypoints)+blocksize-1)/blocksize;
+        if( numblocks != expectednumblocks ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("compressed trajectory has %d blocks, but %d waypoints with block size %d need %d"), numblocks%numwaypoints%blocksize%expectednumblocks, ORE_InvalidArguments);
+        }
+    }
+
+    /// \brief called after the compressed data has been read, checks that every block starts at its offset and is at least as large as its waypoints with the shortest encoding
+    void _SetCompressedData(size_t numwaypoints, int blocksize)
+    {
+        const int dof = _spec.GetDOF();
+        size_t numquantized = 0;
+        for(int j = 0; j < dof; ++j) {
+            if( _vquantization[j] > 0 ) {
+                ++numquantized;
+            }
+        }
+        // a quantized value takes at least one byte, the others are always full precision
+        const uint64_t minwaypointbytes = numquantized + (dof-numquantized)*sizeof(dReal);
+        for(size_t iblock = 0; iblock < _vcompressedblockoffsets.size(); ++iblock) {
+            const uint64_t offset = _vcompressedblockoffsets[iblock];
+            const uint64_t endoffset = iblock+1 < _vcompressedblockoffsets.size() ? _vcompressedblockoffsets[iblock+1] : _vcompresseddata.size();
+            const size_t numblockwaypoints = min(numwaypoints - iblock*blocksize, (size_t)blocksize);
+            const uint64_t minblockbytes = dof*sizeof(dReal) + (numblockwaypoints-1)*minwaypointbytes;
+            if( (iblock == 0 && offset != 0) || endoffset > _vcompresseddata.size() || endoffset < offset || endoffset - offset < minblockbytes ) {
+                throw OPENRAVE_EXCEPTION_FORMAT(_("compressed trajectory block %d/%d at offset %d with end %d is not inside the %d bytes of the blocks or is shorter than %d bytes"), iblock%_vcompressedblockoffsets.size()%offset%endoffset%_vcompresseddata.size()%minblockbytes, ORE_InvalidArguments);
+            }
+        }
+        _vtrajdata.clear();
+        _nCompressedWaypoints = numwaypoints;
+        _nCompressionBlockSize = blocksize;
+        _nCompressionId = _GetNewCompressionId();
+        _bCompressed = true;
+        _SetChangedFrom(0);
+    }
+
+    /// \brief computes _vaccumtime and _vdeltainvtime. Only the waypoints starting at _nAccumWaypoints are recomputed, so appending to the trajectory does not go through all the waypoints again.
     void _ComputeInternal() const
     {
         if( !_bChanged ) {
@@ -927,28 +1458,57 @@ protected:
         if( _timeoffset < 0 ) {
             _vaccumtime.resize(0);
             _vdeltainvtime.resize(0);
+            _nAccumWaypoints = 0;
         }
         else {
             _vaccumtime.resize(GetNumWaypoints());
             _vdeltainvtime.resize(_vaccumtime.size());
             if( _vaccumtime.size() == 0 ) {
+                _nAccumWaypoints = 0;
                 return;
             }
-            _vaccumtime.at(0) = _vtrajdata.at(_timeoffset);
-            _vdeltainvtime.at(0) = 1/_vtrajdata.at(_timeoffset);
-            for(size_t i = 1; i < _vaccumtime.size(); ++i) {
-                dReal deltatime = _vtrajdata[_spec.GetDOF()*i+_timeoffset];
+            size_t startindex = min(_nAccumWaypoints, _vaccumtime.size());
+            if( startindex == 0 ) {
+                _vaccumtime.at(0) = _GetWaypointData(0)[_timeoffset];
+                _vdeltainvtime.at(0) = 1/_vaccumtime.at(0);
+                startindex = 1;
+            }
+            for(size_t i = startindex; i < _vaccumtime.size(); ++i) {
+                dReal deltatime = _GetWaypointData(i)[_timeoffset];
                 if( deltatime < 0 ) {
                     throw OPENRAVE_EXCEPTION_FORMAT("deltatime (%.15e) is < 0 at point %d/%d", deltatime%i%_vaccumtime.size(), ORE_InvalidState);
                 }
                 _vdeltainvtime[i] = 1/deltatime;
                 _vaccumtime[i] = _vaccumtime[i-1] + deltatime;
             }
+            _nAccumWaypoints = _vaccumtime.size();
         }
         _bChanged = false;
         _bSamplingVerified = false;
     }
 
+    /// \brief returns the index of the first element in _vaccumtime that is >= time (same as std::lower_bound). Assumes _ComputeInternal has finished.
+    ///
+    /// Consecutive samples usually fall in the same or next segment as the previous sample (for example when sampling near the end of a trajectory that is being appended to), so the segments at hintindex are checked first before doing a binary search.
+    /// \param[inout] hintindex the index to check first, set to the returned index. Owned by the caller so that const sampling does not write any shared state.
+    size_t _FindAccumTimeIndex(dReal time, size_t& hintindex) const
+    {
+        const size_t numaccum = _vaccumtime.size();
+        size_t index = hintindex;
+        if( index > 0 && index < numaccum && _vaccumtime[index-1] < time ) {
+            if( _vaccumtime[index] >= time ) {
+                return index;
+            }
+            if( index+1 < numaccum && _vaccumtime[index+1] >= time ) {
+                hintindex = index+1;
+                return index+1;
+            }
+        }
+        index = std::lower_bound(_vaccumtime.begin(), _vaccumtime.end(), time) - _vaccumtime.begin();
+        hintindex = index;
+        return index;
+    }
+
     /// \brief assumes _ComputeInternal has finished
     void _VerifySampling() const
     {
@@ -989,11 +1549,88 @@ protected:
         _bSamplingVerified = true;
     }
 
+    /// \brief samples numtimes points into itdata (must already hold numtimes*_spec.GetDOF() elements). Assumes _ComputeInternal has finished.
+    ///
+    /// First the waypoint segment of every time is located by walking _vaccumtime forward (times are usually increasing, so no repeated binary search is necessary), then every group is evaluated for all the located samples at once.
+    void _SamplePointsBatch(std::vector<dReal>::iterator itdata, const dReal* ptimes, size_t numtimes) const
+    {
+        const int dof = _spec.GetDOF();
+        const dReal duration = _vaccumtime.size() > 0 ? _vaccumtime.back() : 0;
+        const size_t numaccum = _vaccumtime.size();
+        std::vector<SampleLocation> vlocations; // local so that concurrent const sampling does not share state
+        vlocations.reserve(numtimes);
+        size_t ipoint = 0; // first index with _vaccumtime[ipoint] >= time
+        dReal prevtime = -std::numeric_limits<dReal>::infinity();
+        for(size_t isample = 0; isample < numtimes; ++isample) {
+            const dReal time = ptimes[isample];
+            std::vector<dReal>::iterator itsample = itdata + isample*dof;
+            if( time >= duration ) {
+                const dReal* pwaypoint = _GetWaypointData(numaccum-1);
+                std::copy(pwaypoint, pwaypoint+dof, itsample);
+                continue;
+            }
+            if( time < prevtime ) {
+                // times are not monotonic, so have to restart the search
+                ipoint = std::lower_bound(_vaccumtime.begin(), _vaccumtime.end(), time) - _vaccumtime.begin();
+            }
+            else if( ipoint < numaccum && _vaccumtime[ipoint] < time ) {
+                // usually the time is in the same or in the next segment
+                ++ipoint;
+                if( ipoint < numaccum && _vaccumtime[ipoint] < time ) {
+                    ipoint = std::lower_bound(_vaccumtime.begin()+ipoint, _vaccumtime.end(), time) - _vaccumtime.begin();
+                }
+            }
+            prevtime = time;
+
+            if( ipoint == 0 ) {
+                const dReal* pwaypoint = _GetWaypointData(0);
+                std::copy(pwaypoint, pwaypoint+dof, itsample);
+                *(itsample + _timeoffset) = time;
+                continue;
+            }
+
+            SampleLocation location;
+            location.sampleindex = isample;
+            location.ipoint = ipoint-1;
+            location.deltatime = time-_vaccumtime[ipoint-1];
+            const dReal waypointdeltatime = _GetWaypointData(ipoint)[_timeoffset];
+            // unfortunately due to floating-point error deltatime might not be in the range [0, waypointdeltatime], so double check!
+            if( location.deltatime < 0 ) {
+                // most likely small epsilon
+                location.deltatime = 0;
+            }
+            else if( location.deltatime > waypointdeltatime ) {
+                location.deltatime = waypointdeltatime;
+            }
+            vlocations.push_back(location);
+        }
+
+        if( vlocations.size() == 0 ) {
+            return;
+        }
+
+        for(size_t igroup = 0; igroup < _vgroupinterpolators.size(); ++igroup) {
+            if( !!_vgroupbatchinterpolators[igroup] ) {
+                _vgroupbatchinterpolators[igroup](vlocations, itdata);
+            }
+            else if( !!_vgroupinterpolators[igroup] ) {
+                FOREACHC(itlocation, vlocations) {
+                    _vgroupinterpolators[igroup](itlocation->ipoint, itlocation->deltatime, itdata + itlocation->sampleindex*dof);
+                }
+            }
+        }
+        // should return the sample time relative to the last endpoint so it is easier to re-insert in the trajectory
+        FOREACHC(itlocation, vlocations) {
+            *(itdata + itlocation->sampleindex*dof + _timeoffset) = itlocation->deltatime;
+        }
+    }
+
     /// \brief called in order to initialize _vgroupinterpolators and _vgroupvalidators, _vderivoffsets, _vintegraloffsets
     void _InitializeGroupFunctions()
     {
         // first set sizes to 0
         _vgroupinterpolators.resize(0);
+        _vgroupbatchinterpolators.resize(0);
         _vgroupvalidators.resize(0);
         _vderivoffsets.resize(0);
         _vddoffsets.resize(0);
@@ -1001,6 +1638,7 @@ protected:
         _vintegraloffsets.resize(0);
         _viioffsets.resize(0);
         _vgroupinterpolators.resize(_spec._vgroups.size());
+        _vgroupbatchinterpolators.resize(_spec._vgroups.size());
         _vgroupvalidators.resize(_spec._vgroups.size());
         _vderivoffsets.resize(_spec.GetDOF(),-1);
         _vddoffsets.resize(_spec.GetDOF(),-1);
@@ -1029,6 +1667,7 @@ protected:
                 }
                 else {
                     _vgroupinterpolators[i] = boost::bind(&GenericTrajectory::_InterpolateLinear,this,boost::ref(_spec._vgroups[i]),_1,_2,_3);
+                    _vgroupbatchinterpolators[i] = boost::bind(&GenericTrajectory::_InterpolateLinearBatch,this,boost::ref(_spec._vgroups[i]),_1,_2);
                     _vgroupvalidators[i] = boost::bind(&GenericTrajectory::_ValidateLinear,this,boost::ref(_spec._vgroups[i]),_1,_2);
                 }
                 nNeedNeighboringInfo = 2;
@@ -1045,6 +1684,7 @@ protected:
                 }
                 else {
                     _vgroupinterpolators[i] = boost::bind(&GenericTrajectory::_InterpolateQuadratic,this,boost::ref(_spec._vgroups[i]),_1,_2,_3);
+                    _vgroupbatchinterpolators[i] = boost::bind(&GenericTrajectory::_InterpolateQuadraticBatch,this,boost::ref(_spec._vgroups[i]),_1,_2);
                     _vgroupvalidators[i] = boost::bind(&GenericTrajectory::_ValidateQuadratic,this,boost::ref(_spec._vgroups[i]),_1,_2);
                 }
                 nNeedNeighboringInfo = 3;
@@ -1059,6 +1699,7 @@ protected:
                 }
                 else {
                     _vgroupinterpolators[i] = boost::bind(&GenericTrajectory::_InterpolateCubic,this,boost::ref(_spec._vgroups[i]),_1,_2,_3);
+                    _vgroupbatchinterpolators[i] = boost::bind(&GenericTrajectory::_InterpolateCubicBatch,this,boost::ref(_spec._vgroups[i]),_1,_2);
                     _vgroupvalidators[i] = boost::bind(&GenericTrajectory::_ValidateCubic,this,boost::ref(_spec._vgroups[i]),_1,_2);
                 }
                 nNeedNeighboringInfo = 3;
@@ -1070,6 +1711,7 @@ protected:
             }
             else if( interpolation == "quintic" ) {
                 _vgroupinterpolators[i] = boost::bind(&GenericTrajectory::_InterpolateQuintic,this,boost::ref(_spec._vgroups[i]),_1,_2,_3);
+                _vgroupbatchinterpolators[i] = boost::bind(&GenericTrajectory::_InterpolateQuinticBatch,this,boost::ref(_spec._vgroups[i]),_1,_2);
                 _vgroupvalidators[i] = boost::bind(&GenericTrajectory::_ValidateQuintic,this,boost::ref(_spec._vgroups[i]),_1,_2);
                 nNeedNeighboringInfo = 3;
             }
@@ -1190,45 +1832,45 @@ protected:
 
     void _InterpolatePrevious(const ConfigurationSpecification::Group& g, size_t ipoint, dReal deltatime, const std::vector<dReal>::iterator& itdata)
     {
-        size_t offset = ipoint*_spec.GetDOF()+g.offset;
-        if( (ipoint+1)*_spec.GetDOF() < _vtrajdata.size() ) {
+        if( ipoint+1 < GetNumWaypoints() ) {
             // if point is so close the previous, then choose the next
             dReal f = _vdeltainvtime.at(ipoint+1)*deltatime;
             if( f > 1-g_fEpsilon ) {
-                offset += _spec.GetDOF();
+                ipoint += 1;
             }
         }
-        std::copy(_vtrajdata.begin()+offset,_vtrajdata.begin()+offset+g.dof,itdata+g.offset);
+        const dReal* pwaypoint = _GetWaypointData(ipoint);
+        std::copy(pwaypoint+g.offset,pwaypoint+g.offset+g.dof,itdata+g.offset);
     }
 
     void _InterpolateNext(const ConfigurationSpecification::Group& g, size_t ipoint, dReal deltatime, const std::vector<dReal>::iterator& itdata)
     {
-        if( (ipoint+1)*_spec.GetDOF() < _vtrajdata.size() ) {
+        if( ipoint+1 < GetNumWaypoints() ) {
             ipoint += 1;
         }
-        size_t offset = ipoint*_spec.GetDOF() + g.offset;
         if( deltatime <= g_fEpsilon && ipoint > 0 ) {
             // if point is so close the previous, then choose the previous
-            offset -= _spec.GetDOF();
+            ipoint -= 1;
         }
-        std::copy(_vtrajdata.begin()+offset,_vtrajdata.begin()+offset+g.dof,itdata+g.offset);
+        const dReal* pwaypoint = _GetWaypointData(ipoint);
+        std::copy(pwaypoint+g.offset,pwaypoint+g.offset+g.dof,itdata+g.offset);
     }
 
     void _InterpolateLinear(const ConfigurationSpecification::Group& g, size_t ipoint, dReal deltatime, const std::vector<dReal>::iterator& itdata)
     {
-        size_t offset = ipoint*_spec.GetDOF();
+        const dReal* pwaypoint = _GetWaypointData(ipoint);
         int derivoffset = _vderivoffsets[g.offset];
         if( derivoffset < 0 ) {
             // expected derivative offset, interpolation can be wrong for circular joints
             dReal f = _vdeltainvtime.at(ipoint+1)*deltatime;
             for(int i = 0; i < g.dof; ++i) {
-                *(itdata + g.offset+i) = _vtrajdata[offset+g.offset+i]*(1-f) + f*_vtrajdata[_spec.GetDOF()+offset+g.offset+i];
+                *(itdata + g.offset+i) = pwaypoint[g.offset+i]*(1-f) + f*pwaypoint[_spec.GetDOF()+g.offset+i];
             }
         }
         else {
             for(int i = 0; i < g.dof; ++i) {
-                dReal deriv0 = _vtrajdata[_spec.GetDOF()+offset+derivoffset+i];
-                *(itdata + g.offset+i) = _vtrajdata[offset+g.offset+i] + deltatime*deriv0;
+                dReal deriv0 = pwaypoint[_spec.GetDOF()+derivoffset+i];
+                *(itdata + g.offset+i) = pwaypoint[g.offset+i] + deltatime*deriv0;
             }
         }
     }
@@ -1237,14 +1879,14 @@ protected:
     {
         _InterpolateLinear(g,ipoint,deltatime,itdata);
         if( deltatime > g_fEpsilon ) {
-            size_t offset = ipoint*_spec.GetDOF();
+            const dReal* pwaypoint = _GetWaypointData(ipoint);
             dReal f = _vdeltainvtime.at(ipoint+1)*deltatime;
             switch(iktype) {
             case IKP_Rotation3D:
             case IKP_Transform6D: {
                 Vector q0, q1;
-                q0.Set4(&_vtrajdata[offset+g.offset]);
-                q1.Set4(&_vtrajdata[_spec.GetDOF()+offset+g.offset]);
+                q0.Set4(&pwaypoint[g.offset]);
+                q1.Set4(&pwaypoint[_spec.GetDOF()+g.offset]);
                 Vector q = quatSlerp(q0,q1,f);
                 *(itdata + g.offset+0) = q[0];
                 *(itdata + g.offset+1) = q[1];
@@ -1253,8 +1895,8 @@ protected:
                 break;
             }
             case IKP_TranslationDirection5D: {
-                Vector dir0(_vtrajdata[offset+g.offset+0],_vtrajdata[offset+g.offset+1],_vtrajdata[offset+g.offset+2]);
-                Vector dir1(_vtrajdata[_spec.GetDOF()+offset+g.offset+0],_vtrajdata[_spec.GetDOF()+offset+g.offset+1],_vtrajdata[_spec.GetDOF()+offset+g.offset+2]);
+                Vector dir0(pwaypoint[g.offset+0],pwaypoint[g.offset+1],pwaypoint[g.offset+2]);
+                Vector dir1(pwaypoint[_spec.GetDOF()+g.offset+0],pwaypoint[_spec.GetDOF()+g.offset+1],pwaypoint[_spec.GetDOF()+g.offset+2]);
                 Vector axisangle = dir0.cross(dir1);
                 dReal fsinangle = RaveSqrt(axisangle.lengthsqr3());
                 if( fsinangle > g_fEpsilon ) {
@@ -1274,16 +1916,16 @@ protected:
 
     void _InterpolateQuadratic(const ConfigurationSpecification::Group& g, size_t ipoint, dReal deltatime, const std::vector<dReal>::iterator& itdata)
     {
-        size_t offset = ipoint*_spec.GetDOF();
+        const dReal* pwaypoint = _GetWaypointData(ipoint);
         if( deltatime > g_fEpsilon ) {
             int derivoffset = _vderivoffsets[g.offset];
             if( derivoffset >= 0 ) {
                 for(int i = 0; i < g.dof; ++i) {
                     // coeff*t^2 + deriv0*t + pos0
-                    dReal deriv0 = _vtrajdata[offset+derivoffset+i];
-                    dReal deriv1 = _vtrajdata[_spec.GetDOF()+offset+derivoffset+i];
+                    dReal deriv0 = pwaypoint[derivoffset+i];
+                    dReal deriv1 = pwaypoint[_spec.GetDOF()+derivoffset+i];
                     dReal coeff = 0.5*_vdeltainvtime.at(ipoint+1)*(deriv1-deriv0);
-                    *(itdata + g.offset+i) = _vtrajdata[offset+g.offset+i] + deltatime*(deriv0 + deltatime*coeff);
+                    *(itdata + g.offset+i) = pwaypoint[g.offset+i] + deltatime*(deriv0 + deltatime*coeff);
                 }
             }
             else {
@@ -1297,10 +1939,10 @@ protected:
                     // mult by (3/deltatime): c2*deltatime**2 + 3/2*c1*deltatime + 3*v0 = 3*(p1-p0)/deltatime
                     // subtract by original: 0.5*c1*deltatime + 2*v0 - 3*(p1-p0)/deltatime + v1 = 0
                     // c1*deltatime = 6*(p1-p0)/deltatime - 4*v0 - 2*v1
-                    dReal integral0 = _vtrajdata[offset+integraloffset+i];
-                    dReal integral1 = _vtrajdata[_spec.GetDOF()+offset+integraloffset+i];
-                    dReal value0 = _vtrajdata[offset+g.offset+i];
-                    dReal value1 = _vtrajdata[_spec.GetDOF()+offset+g.offset+i];
+                    dReal integral0 = pwaypoint[integraloffset+i];
+                    dReal integral1 = pwaypoint[_spec.GetDOF()+integraloffset+i];
+                    dReal value0 = pwaypoint[g.offset+i];
+                    dReal value1 = pwaypoint[_spec.GetDOF()+g.offset+i];
                     dReal c1TimesDelta = 6*(integral1-integral0)*ideltatime - 4*value0 - 2*value1;
                     dReal c1 = c1TimesDelta*ideltatime;
                     dReal c2 = (value1 - value0 - c1TimesDelta)*ideltatime2;
@@ -1310,7 +1952,7 @@ protected:
         }
         else {
             for(int i = 0; i < g.dof; ++i) {
-                *(itdata + g.offset+i) = _vtrajdata[offset+g.offset+i];
+                *(itdata + g.offset+i) = pwaypoint[g.offset+i];
             }
         }
     }
@@ -1320,15 +1962,15 @@ protected:
         _InterpolateQuadratic(g, ipoint, deltatime, itdata);
         if( deltatime > g_fEpsilon ) {
             int derivoffset = _vderivoffsets[g.offset];
-            size_t offset = ipoint*_spec.GetDOF();
+            const dReal* pwaypoint = _GetWaypointData(ipoint);
             Vector q0, q0vel, q1, q1vel;
             switch(iktype) {
             case IKP_Rotation3D:
             case IKP_Transform6D: {
-                q0.Set4(&_vtrajdata[offset+g.offset]);
-                q0vel.Set4(&_vtrajdata[offset+derivoffset]);
-                q1.Set4(&_vtrajdata[_spec.GetDOF()+offset+g.offset]);
-                q1vel.Set4(&_vtrajdata[_spec.GetDOF()+offset+derivoffset]);
+                q0.Set4(&pwaypoint[g.offset]);
+                q0vel.Set4(&pwaypoint[derivoffset]);
+                q1.Set4(&pwaypoint[_spec.GetDOF()+g.offset]);
+                q1vel.Set4(&pwaypoint[_spec.GetDOF()+derivoffset]);
                 Vector angularvelocity0 = quatMultiply(q0vel,quatInverse(q0))*2;
                 Vector angularvelocity1 = quatMultiply(q1vel,quatInverse(q1))*2;
                 Vector coeff = (angularvelocity1-angularvelocity0)*(0.5*_vdeltainvtime.at(ipoint+1));
@@ -1342,12 +1984,12 @@ protected:
             }
             case IKP_TranslationDirection5D: {
                 Vector dir0, dir1, angularvelocity0, angularvelocity1;
-                dir0.Set3(&_vtrajdata[offset+g.offset]);
-                dir1.Set3(&_vtrajdata[_spec.GetDOF()+offset+g.offset]);
+                dir0.Set3(&pwaypoint[g.offset]);
+                dir1.Set3(&pwaypoint[_spec.GetDOF()+g.offset]);
                 Vector axisangle = dir0.cross(dir1);
                 if( axisangle.lengthsqr3() > g_fEpsilon ) {
-                    angularvelocity0.Set3(&_vtrajdata[offset+derivoffset]);
-                    angularvelocity1.Set3(&_vtrajdata[_spec.GetDOF()+offset+derivoffset]);
+                    angularvelocity0.Set3(&pwaypoint[derivoffset]);
+                    angularvelocity1.Set3(&pwaypoint[_spec.GetDOF()+derivoffset]);
                     Vector coeff = (angularvelocity1-angularvelocity0)*(0.5*_vdeltainvtime.at(ipoint+1));
                     Vector vtotaldelta = angularvelocity0*deltatime + coeff*(deltatime*deltatime);
                     Vector newdir = quatRotate(quatFromAxisAngle(vtotaldelta),dir0);
@@ -1365,7 +2007,7 @@ protected:
 
     void _InterpolateCubic(const ConfigurationSpecification::Group& g, size_t ipoint, dReal deltatime, const std::vector<dReal>::iterator& itdata)
     {
-        size_t offset = ipoint*_spec.GetDOF();
+        const dReal* pwaypoint = _GetWaypointData(ipoint);
         if( deltatime > g_fEpsilon ) {
             int derivoffset = _vderivoffsets[g.offset];
             int integoffset = _vintegraloffsets[g.offset];
@@ -1385,12 +2027,12 @@ protected:
                 dReal ideltatime3 = ideltatime2*ideltatime;
                 for(int i = 0; i < g.dof; ++i) {
                     // coeff*t^2 + deriv0*t + pos0
-                    dReal deriv0 = _vtrajdata[offset+derivoffset+i];
-                    dReal deriv1 = _vtrajdata[_spec.GetDOF()+offset+derivoffset+i];
-                    dReal px = _vtrajdata.at(_spec.GetDOF()+offset+g.offset+i) - _vtrajdata[offset+g.offset+i];
+                    dReal deriv0 = pwaypoint[derivoffset+i];
+                    dReal deriv1 = pwaypoint[_spec.GetDOF()+derivoffset+i];
+                    dReal px = pwaypoint[_spec.GetDOF()+g.offset+i] - pwaypoint[g.offset+i];
                     dReal c3 = (deriv1+deriv0)*ideltatime2 - 2*px*ideltatime3;
                     dReal c2 = 3*px*ideltatime2 - (2*deriv0+deriv1)*ideltatime;
-                    *(itdata + g.offset+i) = _vtrajdata[offset+g.offset+i] + deltatime*(deriv0 + deltatime*(c2 + deltatime*c3));
+                    *(itdata + g.offset+i) = pwaypoint[g.offset+i] + deltatime*(deriv0 + deltatime*(c2 + deltatime*c3));
                 }
             }
             else if( integoffset >= 0 && iioffset >= 0 ) {
@@ -1415,13 +2057,13 @@ protected:
                 dReal ideltatime4 = ideltatime3*ideltatime;
                 dReal ideltatime5 = ideltatime4*ideltatime;
                 for(int i = 0; i < g.dof; ++i) {
-                    dReal integ0 = _vtrajdata[offset + integoffset + i];
-                    dReal idiff = _vtrajdata[_spec.GetDOF() + offset + integoffset + i] - integ0; // i1 - i0
-                    dReal temp = _vtrajdata[_spec.GetDOF() + offset + iioffset + i] - _vtrajdata[offset + iioffset + i] - integ0*deltatime; // ii1 - ii0 - i0*dt
-                    dReal c3 =    10*(_vtrajdata.at(_spec.GetDOF() + offset + g.offset + i) - _vtrajdata[offset + g.offset + i])*ideltatime3 - 60*idiff*ideltatime4 + 120*temp*ideltatime5;
-                    dReal c2 = (18*_vtrajdata[offset + g.offset + i] - 12*_vtrajdata.at(_spec.GetDOF() + offset + g.offset + i))*ideltatime2 + 84*idiff*ideltatime3 - 180*temp*ideltatime4;
-                    dReal c1 = ( -9*_vtrajdata[offset + g.offset + i] + 3*_vtrajdata.at(_spec.GetDOF() + offset + g.offset + i))*ideltatime  - 24*idiff*ideltatime2 +  60*temp*ideltatime3;
-                    *(itdata + g.offset+i) = _vtrajdata[offset+g.offset+i] + deltatime*(c1 + deltatime*(c2 + deltatime*c3));
+                    dReal integ0 = pwaypoint[integoffset + i];
+                    dReal idiff = pwaypoint[_spec.GetDOF() + integoffset + i] - integ0; // i1 - i0
+                    dReal temp = pwaypoint[_spec.GetDOF() + iioffset + i] - pwaypoint[iioffset + i] - integ0*deltatime; // ii1 - ii0 - i0*dt
+                    dReal c3 =    10*(pwaypoint[_spec.GetDOF() + g.offset + i] - pwaypoint[g.offset + i])*ideltatime3 - 60*idiff*ideltatime4 + 120*temp*ideltatime5;
+                    dReal c2 = (18*pwaypoint[g.offset + i] - 12*pwaypoint[_spec.GetDOF() + g.offset + i])*ideltatime2 + 84*idiff*ideltatime3 - 180*temp*ideltatime4;
+                    dReal c1 = ( -9*pwaypoint[g.offset + i] + 3*pwaypoint[_spec.GetDOF() + g.offset + i])*ideltatime  - 24*idiff*ideltatime2 +  60*temp*ideltatime3;
+                    *(itdata + g.offset+i) = pwaypoint[g.offset+i] + deltatime*(c1 + deltatime*(c2 + deltatime*c3));
                 }
             }
             else {
@@ -1430,7 +2072,7 @@ protected:
         }
         else {
             for(int i = 0; i < g.dof; ++i) {
-                *(itdata + g.offset+i) = _vtrajdata[offset+g.offset+i];
+                *(itdata + g.offset+i) = pwaypoint[g.offset+i];
             }
         }
     }
@@ -1445,19 +2087,19 @@ protected:
             int iioffset = _viioffsets[g.offset];
 
             if( derivoffset >= 0 && ddoffset >= 0 ) {
-                size_t offset = ipoint*_spec.GetDOF();
-                size_t nextoffset = offset + _spec.GetDOF();
+                const dReal* pwaypoint = _GetWaypointData(ipoint);
+                const dReal* pnextwaypoint = pwaypoint + _spec.GetDOF();
                 Vector q0, q0vel, q0acc, q1, q1vel, q1acc;
                 switch( iktype ) {
                 case IKP_Rotation3D:
                 case IKP_Transform6D: {
-                    q0.Set4(&_vtrajdata[offset + g.offset]);
-                    q0vel.Set4(&_vtrajdata[offset + derivoffset]);
-                    q0acc.Set4(&_vtrajdata[offset + ddoffset]);
+                    q0.Set4(&pwaypoint[g.offset]);
+                    q0vel.Set4(&pwaypoint[derivoffset]);
+                    q0acc.Set4(&pwaypoint[ddoffset]);
 
-                    q1.Set4(&_vtrajdata[nextoffset + g.offset]);
-                    q1vel.Set4(&_vtrajdata[nextoffset + derivoffset]);
-                    q1acc.Set4(&_vtrajdata[nextoffset + ddoffset]);
+                    q1.Set4(&pnextwaypoint[g.offset]);
+                    q1vel.Set4(&pnextwaypoint[derivoffset]);
+                    q1acc.Set4(&pnextwaypoint[ddoffset]);
 
                     const Vector angularVelocityPrev = 2.0*quatMultiply(q0vel, quatInverse(q0));
                     // const Vector angularVelocity = 2.0*quatMultiply(q1vel, quatInverse(q1)); // not used
@@ -1491,7 +2133,7 @@ protected:
 
     void _InterpolateQuartic(const ConfigurationSpecification::Group& g, size_t ipoint, dReal deltatime, const std::vector<dReal>::iterator& itdata)
     {
-        size_t offset = ipoint*_spec.GetDOF();
+        const dReal* pwaypoint = _GetWaypointData(ipoint);
         if( deltatime > g_fEpsilon ) {
             int derivoffset = _vderivoffsets[g.offset];
             int ddoffset = _vddoffsets[g.offset];
@@ -1515,13 +2157,13 @@ protected:
                 dReal ideltatime2 = ideltatime*ideltatime;
                 dReal ideltatime3 = ideltatime2*ideltatime;
                 for(int i = 0; i < g.dof; ++i) {
-                    dReal deriv0 = _vtrajdata[offset+derivoffset+i];
-                    dReal deriv1 = _vtrajdata[_spec.GetDOF()+offset+derivoffset+i];
-                    dReal dd0 = _vtrajdata[offset+ddoffset+i];
-                    dReal dd1 = _vtrajdata[_spec.GetDOF()+offset+ddoffset+i];
+                    dReal deriv0 = pwaypoint[derivoffset+i];
+                    dReal deriv1 = pwaypoint[_spec.GetDOF()+derivoffset+i];
+                    dReal dd0 = pwaypoint[ddoffset+i];
+                    dReal dd1 = pwaypoint[_spec.GetDOF()+ddoffset+i];
                     dReal c4 = -0.5*(deriv1-deriv0)*ideltatime3 + (dd0 + dd1)*ideltatime2*0.25;
                     dReal c3 = (deriv1-deriv0)*ideltatime2 - (2*dd0+dd1)*ideltatime/3.0;
-                    *(itdata + g.offset+i) = _vtrajdata[offset+g.offset+i] + deltatime*(deriv0 + deltatime*(0.5*dd0 + deltatime*(c3 + deltatime*c4)));
+                    *(itdata + g.offset+i) = pwaypoint[g.offset+i] + deltatime*(deriv0 + deltatime*(0.5*dd0 + deltatime*(c3 + deltatime*c4)));
                 }
             }
             else if( derivoffset >= 0 && integoffset >= 0 ) {
@@ -1546,11 +2188,11 @@ protected:
                 dReal ideltatime4 = ideltatime3*ideltatime;
                 dReal ideltatime5 = ideltatime4*ideltatime;
                 for(int i = 0; i < g.dof; ++i) {
-                    dReal deriv0 = _vtrajdata[offset + derivoffset + i];
-                    dReal deriv1 = _vtrajdata[_spec.GetDOF() + offset + derivoffset + i];
-                    dReal pos0 = _vtrajdata[offset + g.offset + i];
-                    dReal pos1 = _vtrajdata[_spec.GetDOF() + offset + g.offset + i];
-                    dReal idiff = _vtrajdata[_spec.GetDOF() + offset + integoffset + i] - _vtrajdata[offset + integoffset + i];
+                    dReal deriv0 = pwaypoint[derivoffset + i];
+                    dReal deriv1 = pwaypoint[_spec.GetDOF() + derivoffset + i];
+                    dReal pos0 = pwaypoint[g.offset + i];
+                    dReal pos1 = pwaypoint[_spec.GetDOF() + g.offset + i];
+                    dReal idiff = pwaypoint[_spec.GetDOF() + integoffset + i] - pwaypoint[integoffset + i];
                     dReal c4 = 2.5*(deriv1 - deriv0)*ideltatime3     - 15*(pos0 + pos1)*ideltatime4    + 30*idiff*ideltatime5;
                     dReal c3 = (6*deriv0 - 4*deriv1)*ideltatime2     + (32*pos0 + 28*pos1)*ideltatime3 - 60*idiff*ideltatime4;
                     dReal c2 = (-4.5*deriv0 + 1.5*deriv1)*ideltatime - (18*pos0 + 12*pos1)*ideltatime2 + 30*idiff*ideltatime3;
@@ -1563,7 +2205,7 @@ protected:
         }
         else {
             for(int i = 0; i < g.dof; ++i) {
-                *(itdata + g.offset+i) = _vtrajdata[offset+g.offset+i];
+                *(itdata + g.offset+i) = pwaypoint[g.offset+i];
             }
         }
     }
@@ -1585,7 +2227,7 @@ protected:
         // c2 = a0/2
         // c1 = v0
         // c0 = p0
-        size_t offset = ipoint*_spec.GetDOF();
+        const dReal* pwaypoint = _GetWaypointData(ipoint);
         if( deltatime > g_fEpsilon ) {
             int derivoffset = _vderivoffsets[g.offset];
             int ddoffset = _vddoffsets[g.offset];
@@ -1596,12 +2238,12 @@ protected:
                 dReal ideltatime4 = ideltatime2*ideltatime2;
                 dReal ideltatime5 = ideltatime4*ideltatime;
                 for(int i = 0; i < g.dof; ++i) {
-                    dReal p0 = _vtrajdata[offset+g.offset+i];
-                    dReal px = _vtrajdata[_spec.GetDOF()+offset+g.offset+i] - p0;
-                    dReal deriv0 = _vtrajdata[offset+derivoffset+i];
-                    dReal deriv1 = _vtrajdata[_spec.GetDOF()+offset+derivoffset+i];
-                    dReal dd0 = _vtrajdata[offset+ddoffset+i];
-                    dReal dd1 = _vtrajdata[_spec.GetDOF()+offset+ddoffset+i];
+                    dReal p0 = pwaypoint[g.offset+i];
+                    dReal px = pwaypoint[_spec.GetDOF()+g.offset+i] - p0;
+                    dReal deriv0 = pwaypoint[derivoffset+i];
+                    dReal deriv1 = pwaypoint[_spec.GetDOF()+derivoffset+i];
+                    dReal dd0 = pwaypoint[ddoffset+i];
+                    dReal dd1 = pwaypoint[_spec.GetDOF()+ddoffset+i];
                     dReal c5 = (-0.5*dd0 + dd1*0.5)*ideltatime3 - (3*deriv0 + 3*deriv1)*ideltatime4 + px*6*ideltatime5;
                     dReal c4 = (1.5*dd0 - dd1)*ideltatime2 + (8*deriv0 + 7*deriv1)*ideltatime3 - px*15*ideltatime4;
                     dReal c3 = (-1.5*dd0 + dd1*0.5)*ideltatime + (-6*deriv0 - 4*deriv1)*ideltatime2 + px*10*ideltatime3;
@@ -1614,7 +2256,7 @@ protected:
         }
         else {
             for(int i = 0; i < g.dof; ++i) {
-                *(itdata + g.offset+i) = _vtrajdata[offset+g.offset+i];
+                *(itdata + g.offset+i) = pwaypoint[g.offset+i];
             }
         }
     }
@@ -1634,7 +2276,7 @@ protected:
         // c2 = a0/2
         // c1 = v0
         // c0 = p0
-        size_t offset = ipoint*_spec.GetDOF();
+        const dReal* pwaypoint = _GetWaypointData(ipoint);
         if( deltatime > g_fEpsilon ) {
             int derivoffset = _vderivoffsets[g.offset];
             int ddoffset = _vddoffsets[g.offset];
@@ -1650,14 +2292,14 @@ protected:
                 //dReal deltatime4 = deltatime2*deltatime2;
                 //dReal deltatime5 = deltatime4*deltatime;
                 for(int i = 0; i < g.dof; ++i) {
-                    dReal p0 = _vtrajdata[offset+g.offset+i];
-                    //dReal px = _vtrajdata[_spec.GetDOF()+offset+g.offset+i] - p0;
-                    dReal deriv0 = _vtrajdata[offset+derivoffset+i];
-                    dReal deriv1 = _vtrajdata[_spec.GetDOF()+offset+derivoffset+i];
-                    dReal dd0 = _vtrajdata[offset+ddoffset+i];
-                    dReal dd1 = _vtrajdata[_spec.GetDOF()+offset+ddoffset+i];
-                    dReal ddd0 = _vtrajdata[offset+dddoffset+i];
-                    dReal ddd1 = _vtrajdata[_spec.GetDOF()+offset+dddoffset+i];
+                    dReal p0 = pwaypoint[g.offset+i];
+                    //dReal px = pwaypoint[_spec.GetDOF()+g.offset+i] - p0;
+                    dReal deriv0 = pwaypoint[derivoffset+i];
+                    dReal deriv1 = pwaypoint[_spec.GetDOF()+derivoffset+i];
+                    dReal dd0 = pwaypoint[ddoffset+i];
+                    dReal dd1 = pwaypoint[_spec.GetDOF()+ddoffset+i];
+                    dReal ddd0 = pwaypoint[dddoffset+i];
+                    dReal ddd1 = pwaypoint[_spec.GetDOF()+dddoffset+i];
                     // matrix inverse is slow but at least it will work for now
                     // A=Matrix(3,3,[6*dt**5, 5*dt**4, 4*dt**3, 30*dt**4, 20*dt**3, 12*dt**2, 120*dt**3, 60*dt**2, 24*dt])
                     // A.inv() = [   dt**(-5), -1/(2*dt**4), 1/(12*dt**3)]
@@ -1684,20 +2326,155 @@ protected:
         }
         else {
             for(int i = 0; i < g.dof; ++i) {
-                *(itdata + g.offset+i) = _vtrajdata[offset+g.offset+i];
+                *(itdata + g.offset+i) = pwaypoint[g.offset+i];
+            }
+        }
+    }
+
+    /// \brief batch version of _InterpolateLinear when the derivatives are present, otherwise falls back to per-sample interpolation
+    void _InterpolateLinearBatch(const ConfigurationSpecification::Group& g, const std::vector<SampleLocation>& vlocations, const std::vector<dReal>::iterator& itdata)
+    {
+        const int dof = _spec.GetDOF();
+        const int derivoffset = _vderivoffsets[g.offset];
+        if( derivoffset < 0 ) {
+            FOREACHC(itlocation, vlocations) {
+                _InterpolateLinear(g, itlocation->ipoint, itlocation->deltatime, itdata + itlocation->sampleindex*dof);
+            }
+            return;
+        }
+        const int gdof = g.dof;
+        FOREACHC(itlocation, vlocations) {
+            const dReal* pwaypoint = _GetWaypointData(itlocation->ipoint);
+            const dReal* p0 = pwaypoint + g.offset;
+            const dReal* v1 = pwaypoint + dof + derivoffset;
+            dReal* pout = &*(itdata + itlocation->sampleindex*dof + g.offset);
+            const dReal t = itlocation->deltatime;
+            for(int i = 0; i < gdof; ++i) {
+                pout[i] = p0[i] + t*v1[i];
+            }
+        }
+    }
+
+    /// \brief batch version of _InterpolateQuadratic when the derivatives are present, otherwise falls back to per-sample interpolation
+    void _InterpolateQuadraticBatch(const ConfigurationSpecification::Group& g, const std::vector<SampleLocation>& vlocations, const std::vector<dReal>::iterator& itdata)
+    {
+        const int dof = _spec.GetDOF();
+        const int derivoffset = _vderivoffsets[g.offset];
+        if( derivoffset < 0 ) {
+            FOREACHC(itlocation, vlocations) {
+                _InterpolateQuadratic(g, itlocation->ipoint, itlocation->deltatime, itdata + itlocation->sampleindex*dof);
+            }
+            return;
+        }
+        const int gdof = g.dof;
+        FOREACHC(itlocation, vlocations) {
+            const dReal* pwaypoint = _GetWaypointData(itlocation->ipoint);
+            const dReal* p0 = pwaypoint + g.offset;
+            dReal* pout = &*(itdata + itlocation->sampleindex*dof + g.offset);
+            const dReal t = itlocation->deltatime;
+            if( t <= g_fEpsilon ) {
+                std::copy(p0, p0+gdof, pout);
+                continue;
+            }
+            const dReal* v0 = pwaypoint + derivoffset;
+            const dReal* v1 = v0 + dof;
+            const dReal halfideltatime = 0.5*_vdeltainvtime[itlocation->ipoint+1];
+            for(int i = 0; i < gdof; ++i) {
+                // coeff*t^2 + deriv0*t + pos0
+                pout[i] = p0[i] + t*(v0[i] + t*halfideltatime*(v1[i]-v0[i]));
+            }
+        }
+    }
+
+    /// \brief batch version of _InterpolateCubic when the derivatives are present, otherwise falls back to per-sample interpolation
+    void _InterpolateCubicBatch(const ConfigurationSpecification::Group& g, const std::vector<SampleLocation>& vlocations, const std::vector<dReal>::iterator& itdata)
+    {
+        const int dof = _spec.GetDOF();
+        const int derivoffset = _vderivoffsets[g.offset];
+        if( derivoffset < 0 ) {
+            FOREACHC(itlocation, vlocations) {
+                _InterpolateCubic(g, itlocation->ipoint, itlocation->deltatime, itdata + itlocation->sampleindex*dof);
+            }
+            return;
+        }
+        const int gdof = g.dof;
+        FOREACHC(itlocation, vlocations) {
+            const dReal* pwaypoint = _GetWaypointData(itlocation->ipoint);
+            const dReal* p0 = pwaypoint + g.offset;
+            dReal* pout = &*(itdata + itlocation->sampleindex*dof + g.offset);
+            const dReal t = itlocation->deltatime;
+            if( t <= g_fEpsilon ) {
+                std::copy(p0, p0+gdof, pout);
+                continue;
+            }
+            const dReal* p1 = p0 + dof;
+            const dReal* v0 = pwaypoint + derivoffset;
+            const dReal* v1 = v0 + dof;
+            const dReal ideltatime = _vdeltainvtime[itlocation->ipoint+1];
+            const dReal ideltatime2 = ideltatime*ideltatime;
+            const dReal ideltatime3 = ideltatime2*ideltatime;
+            for(int i = 0; i < gdof; ++i) {
+                // see _InterpolateCubic for the derivation of the coefficients
+                const dReal px = p1[i] - p0[i];
+                const dReal c3 = (v1[i]+v0[i])*ideltatime2 - 2*px*ideltatime3;
+                const dReal c2 = 3*px*ideltatime2 - (2*v0[i]+v1[i])*ideltatime;
+                pout[i] = p0[i] + t*(v0[i] + t*(c2 + t*c3));
+            }
+        }
+    }
+
+    /// \brief batch version of _InterpolateQuintic, the derivatives have to be present
+    void _InterpolateQuinticBatch(const ConfigurationSpecification::Group& g, const std::vector<SampleLocation>& vlocations, const std::vector<dReal>::iterator& itdata)
+    {
+        const int dof = _spec.GetDOF();
+        const int derivoffset = _vderivoffsets[g.offset];
+        const int ddoffset = _vddoffsets[g.offset];
+        if( derivoffset < 0 || ddoffset < 0 ) {
+            FOREACHC(itlocation, vlocations) {
+                _InterpolateQuintic(g, itlocation->ipoint, itlocation->deltatime, itdata + itlocation->sampleindex*dof);
+            }
+            return;
+        }
+        const int gdof = g.dof;
+        FOREACHC(itlocation, vlocations) {
+            const dReal* pwaypoint = _GetWaypointData(itlocation->ipoint);
+            const dReal* p0 = pwaypoint + g.offset;
+            dReal* pout = &*(itdata + itlocation->sampleindex*dof + g.offset);
+            const dReal t = itlocation->deltatime;
+            if( t <= g_fEpsilon ) {
+                std::copy(p0, p0+gdof, pout);
+                continue;
+            }
+            const dReal* p1 = p0 + dof;
+            const dReal* v0 = pwaypoint + derivoffset;
+            const dReal* v1 = v0 + dof;
+            const dReal* a0 = pwaypoint + ddoffset;
+            const dReal* a1 = a0 + dof;
+            const dReal ideltatime = _vdeltainvtime[itlocation->ipoint+1];
+            const dReal ideltatime2 = ideltatime*ideltatime;
+            const dReal ideltatime3 = ideltatime2*ideltatime;
+            const dReal ideltatime4 = ideltatime2*ideltatime2;
+            const dReal ideltatime5 = ideltatime4*ideltatime;
+            for(int i = 0; i < gdof; ++i) {
+                // see _InterpolateQuintic for the derivation of the coefficients
+                const dReal px = p1[i] - p0[i];
+                const dReal c5 = (-0.5*a0[i] + a1[i]*0.5)*ideltatime3 - (3*v0[i] + 3*v1[i])*ideltatime4 + px*6*ideltatime5;
+                const dReal c4 = (1.5*a0[i] - a1[i])*ideltatime2 + (8*v0[i] + 7*v1[i])*ideltatime3 - px*15*ideltatime4;
+                const dReal c3 = (-1.5*a0[i] + a1[i]*0.5)*ideltatime + (-6*v0[i] - 4*v1[i])*ideltatime2 + px*10*ideltatime3;
+                pout[i] = p0[i] + t*(v0[i] + t*(0.5*a0[i] + t*(c3 + t*(c4 + t*c5))));
             }
         }
     }
 
     void _ValidateLinear(const ConfigurationSpecification::Group& g, size_t ipoint, dReal deltatime)
     {
-        size_t offset = ipoint*_spec.GetDOF();
+        const dReal* pwaypoint = _GetWaypointData(ipoint);
         int derivoffset = _vderivoffsets[g.offset];
         if( derivoffset >= 0 ) {
             for(int i = 0; i < g.dof; ++i) {
-                dReal deriv0 = _vtrajdata[_spec.GetDOF()+offset+derivoffset+i];
-                dReal expected = _vtrajdata[offset+g.offset+i] + deltatime*deriv0;
-                dReal error = RaveFabs(_vtrajdata[_spec.GetDOF()+offset+g.offset+i] - expected);
+                dReal deriv0 = pwaypoint[_spec.GetDOF()+derivoffset+i];
+                dReal expected = pwaypoint[g.offset+i] + deltatime*deriv0;
+                dReal error = RaveFabs(pwaypoint[_spec.GetDOF()+g.offset+i] - expected);
                 if( RaveFabs(error-2*PI) > g_fEpsilonLinear ) { // TODO, officially track circular joints
                     OPENRAVE_ASSERT_OP_FORMAT(error,<=,g_fEpsilonLinear, "trajectory segment for group %s interpolation %s points %d-%d dof %d is invalid", g.name%g.interpolation%ipoint%(ipoint+1)%i, ORE_InvalidState);
                 }
@@ -1708,15 +2485,15 @@ protected:
     void _ValidateQuadratic(const ConfigurationSpecification::Group& g, size_t ipoint, dReal deltatime)
     {
         if( deltatime > g_fEpsilon ) {
-            size_t offset = ipoint*_spec.GetDOF();
+            const dReal* pwaypoint = _GetWaypointData(ipoint);
             int derivoffset = _vderivoffsets[g.offset];
             if( derivoffset >= 0 ) {
                 for(int i = 0; i < g.dof; ++i) {
                     // coeff*t^2 + deriv0*t + pos0
-                    dReal deriv0 = _vtrajdata[offset+derivoffset+i];
-                    dReal coeff = 0.5*_vdeltainvtime.at(ipoint+1)*(_vtrajdata[_spec.GetDOF()+offset+derivoffset+i]-deriv0);
-                    dReal expected = _vtrajdata[offset+g.offset+i] + deltatime*(deriv0 + deltatime*coeff);
-                    dReal error = RaveFabs(_vtrajdata.at(_spec.GetDOF()+offset+g.offset+i)-expected);
+                    dReal deriv0 = pwaypoint[derivoffset+i];
+                    dReal coeff = 0.5*_vdeltainvtime.at(ipoint+1)*(pwaypoint[_spec.GetDOF()+derivoffset+i]-deriv0);
+                    dReal expected = pwaypoint[g.offset+i] + deltatime*(deriv0 + deltatime*coeff);
+                    dReal error = RaveFabs(pwaypoint[_spec.GetDOF()+g.offset+i]-expected);
                     if( RaveFabs(error-2*PI) > 1e-5 ) { // TODO, officially track circular joints
                         OPENRAVE_ASSERT_OP_FORMAT(error,<=,1e-4, "trajectory segment for group %s interpolation %s time %f points %d-%d dof %d is invalid", g.name%g.interpolation%deltatime%ipoint%(ipoint+1)%i, ORE_InvalidState);
                     }
@@ -1749,6 +2526,7 @@ protected:
 
     ConfigurationSpecification _spec;
     std::vector< boost::function<void(size_t,dReal,const std::vector<dReal>::iterator&)> > _vgroupinterpolators;
+    std::vector< boost::function<void(const std::vector<SampleLocation>&,const std::vector<dReal>::iterator&)> > _vgroupbatchinterpolators; ///< for every group, optional interpolator that evaluates all located samples at once. If empty, _vgroupinterpolators is called per sample.
     std::vector< boost::function<void(size_t,dReal)> > _vgroupvalidators;
     std::vector<int> _vderivoffsets, _vddoffsets, _vdddoffsets; ///< for every group that relies on other info to compute its position, this will point to the derivative offset. -1 if invalid and not needed, -2 if invalid and needed
     std::vector<int> _vintegraloffsets, _viioffsets; ///< for every group that relies on other info to compute its position, this will point to the integral offset (ie the position for a velocity group). -1 if invalid and not needed, -2 if invalid and needed
@@ -1756,6 +2534,16 @@ protected:
 
     std::vector<dReal> _vtrajdata;
     mutable std::vector<dReal> _vaccumtime, _vdeltainvtime;
+    mutable size_t _nAccumWaypoints; ///< number of waypoints from the start whose _vaccumtime and _vdeltainvtime are still valid
+
+    // compressed storage, see _Compress. If _bCompressed is true, _vtrajdata is empty.
+    bool _bCompressed;
+    size_t _nCompressedWaypoints;
+    int _nCompressionBlockSize; ///< number of waypoints in every block
+    std::vector<dReal> _vquantization; ///< for every value of a waypoint, the quantization step. 0 if stored with full precision.
+    std::vector<uint8_t> _vcompresseddata;
+    std::vector<size_t> _vcompressedblockoffsets; ///< block index, the byte offset of every block in _vcompresseddata
+    uint64_t _nCompressionId; ///< unique id of the current compressed data, identifies it in the DecodedBlockCache of every thread. 0 if not compressed.
     bool _bInit;
     mutable bool _bChanged; ///< if true, then _ComputeInternal() has to be called in order to compute _vaccumtime and _vdeltainvtime
     mutable bool _bSamplingVerified; ///< if false, then _VerifySampling() has not be called yet to verify that all points can be sampled.
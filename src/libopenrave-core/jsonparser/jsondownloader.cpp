@@ -22,8 +22,18 @@
 
 #include <openrave/openravemsgpack.h>
 
+#include <fstream>
+#include <mutex>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+
 namespace OpenRAVE {
 
+static const char s_jsonDownloadCacheMagic[8] = {'O','R','J','D','C','0','0','1'};
+static const uint64_t s_nJSONDownloadCacheMaxBytes = 1024*1024*1024; ///< maximum size of the cache directory
+static std::mutex s_mutexJSONDownloadCacheBytes; ///< protects s_nJSONDownloadCacheBytes
+static int64_t s_nJSONDownloadCacheBytes = -1; ///< size of the cache directory after it was last pruned plus the size of the files written since, -1 if it was never pruned
+
 // Need to forward declare this
 static void _ParseDocument(OpenRAVE::JSONDownloadContextPtr pContext);
 
@@ -60,6 +70,168 @@ static void _ParseDocument(OpenRAVE::JSONDownloadContextPtr pContext)
     }
 }
 
+/// \brief the on-disk cache is only stored under the openrave home directory if enabled by setting OPENRAVE_JSON_DOWNLOAD_CACHE=1
+static std::string _GetJSONDownloadCacheDirectory()
+{
+    const char* pOPENRAVE_JSON_DOWNLOAD_CACHE = std::getenv("OPENRAVE_JSON_DOWNLOAD_CACHE");
+    if (!pOPENRAVE_JSON_DOWNLOAD_CACHE || std::string(pOPENRAVE_JSON_DOWNLOAD_CACHE) != "1") {
+        return std::string();
+    }
+    return RaveGetHomeDirectory() + s_filesep + "jsondownloadcache";
+}
+
+/// \brief reads a length prefixed string, failing if the length goes past filesize
+static bool _ReadJSONDownloadCacheString(std::istream& is, uint64_t filesize, std::string& value)
+{
+    uint32_t size = 0;
+    is.read(reinterpret_cast<char*>(&size), sizeof(size));
+    if (!is) {
+        return false;
+    }
+    const std::streamoff pos = is.tellg();
+    if (pos < 0 || (uint64_t)pos + size > filesize) {
+        return false;
+    }
+    value.resize(size);
+    is.read(&value[0], size);
+    return !!is;
+}
+
+static void _WriteJSONDownloadCacheString(std::ostream& os, const std::string& value)
+{
+    const uint32_t size = value.size();
+    os.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    os.write(value.c_str(), size);
+}
+
+/// \brief reads the header of a cache file, returns false if there is no valid cache for the url
+static bool _ReadJSONDownloadCacheHeader(std::istream& is, uint64_t& filesize, const std::string& url, std::string& etag, std::string& lastModified)
+{
+    is.seekg(0, std::ios::end);
+    const std::streamoff filesizeoff = is.tellg();
+    is.seekg(0, std::ios::beg);
+    if (!is || filesizeoff < 0) {
+        return false;
+    }
+    filesize = filesizeoff;
+    char magic[sizeof(s_jsonDownloadCacheMagic)];
+    is.read(magic, sizeof(magic));
+    if (!is || std::memcmp(magic, s_jsonDownloadCacheMagic, sizeof(magic)) != 0) {
+        return false;
+    }
+    std::string storedUrl;
+    if (!_ReadJSONDownloadCacheString(is, filesize, storedUrl) || storedUrl != url) {
+        // md5 collision or stale file
+        return false;
+    }
+    return _ReadJSONDownloadCacheString(is, filesize, etag) && _ReadJSONDownloadCacheString(is, filesize, lastModified);
+}
+
+/// \brief reads the validators of the cached document of the url
+static bool _ReadJSONDownloadCacheValidators(const std::string& cacheFilename, const std::string& url, std::string& etag, std::string& lastModified)
+{
+    std::ifstream ifs(cacheFilename.c_str(), std::ios::binary);
+    uint64_t filesize = 0;
+    return !!ifs && _ReadJSONDownloadCacheHeader(ifs, filesize, url, etag, lastModified);
+}
+
+/// \brief reads the cached document of the url. The document is stored as msgpack if available since it is much faster to parse than json text
+static bool _ReadJSONDownloadCacheDocument(const std::string& cacheFilename, const std::string& url, rapidjson::Document& doc)
+{
+    std::ifstream ifs(cacheFilename.c_str(), std::ios::binary);
+    uint64_t filesize = 0;
+    std::string etag, lastModified;
+    if (!ifs || !_ReadJSONDownloadCacheHeader(ifs, filesize, url, etag, lastModified)) {
+        return false;
+    }
+    uint8_t isMsgPack = 0;
+    std::string data;
+    ifs.read(reinterpret_cast<char*>(&isMsgPack), sizeof(isMsgPack));
+    if (!ifs || !_ReadJSONDownloadCacheString(ifs, filesize, data)) {
+        return false;
+    }
+    if (isMsgPack) {
+        try {
+            MsgPack::ParseMsgPack(doc, data.data(), data.size());
+        }
+        catch (const std::exception& ex) {
+            RAVELOG_DEBUG_FORMAT("failed to parse download cache %s: %s", cacheFilename%ex.what());
+            return false;
+        }
+    }
+    else {
+        rapidjson::ParseResult ok = doc.Parse<rapidjson::kParseFullPrecisionFlag>(data.data(), data.size());
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void _WriteJSONDownloadCache(const JSONDownloadContext& context)
+{
+    std::string data;
+    uint8_t isMsgPack = 0;
+#if OPENRAVE_MSGPACK
+    {
+        std::vector<char> output;
+        MsgPack::DumpMsgPack(*context.pDoc, output, MsgPack::DMO_TypedArrays);
+        data.assign(output.begin(), output.end());
+        isMsgPack = 1;
+    }
+#else
+    {
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        context.pDoc->Accept(writer);
+        data.assign(buffer.GetString(), buffer.GetSize());
+    }
+#endif
+    const std::string tempFilename = utils::GetTemporaryFilename(context.cacheFilename);
+    try {
+        boost::filesystem::create_directories(boost::filesystem::path(context.cacheFilename).parent_path());
+        {
+            std::ofstream ofs(tempFilename.c_str(), std::ios::binary|std::ios::trunc);
+            if (!ofs) {
+                return;
+            }
+            ofs.write(s_jsonDownloadCacheMagic, sizeof(s_jsonDownloadCacheMagic));
+            _WriteJSONDownloadCacheString(ofs, context.url);
+            _WriteJSONDownloadCacheString(ofs, context.etag);
+            _WriteJSONDownloadCacheString(ofs, context.lastModified);
+            ofs.write(reinterpret_cast<const char*>(&isMsgPack), sizeof(isMsgPack));
+            _WriteJSONDownloadCacheString(ofs, data);
+            if (!ofs) {
+                ofs.close();
+                boost::filesystem::remove(tempFilename);
+                return;
+            }
+        }
+        // rename is atomic, so concurrent processes never read a partially written file
+        boost::filesystem::rename(tempFilename, context.cacheFilename);
+    }
+    catch (const boost::filesystem::filesystem_error& ex) {
+        RAVELOG_DEBUG_FORMAT("failed to write download cache %s for uri \"%s\": %s", context.cacheFilename%context.uri%ex.what());
+        return;
+    }
+
+    // pruning reads the whole directory, so only prune once the running total can be over the limit. Replaced files are counted
+    // again and the files of other processes are not counted, so the total is only corrected by the next pruning.
+    bool bPrune = false;
+    {
+        std::lock_guard<std::mutex> lock(s_mutexJSONDownloadCacheBytes);
+        if (s_nJSONDownloadCacheBytes >= 0) {
+            s_nJSONDownloadCacheBytes += sizeof(s_jsonDownloadCacheMagic) + 4*sizeof(uint32_t) + sizeof(isMsgPack) + context.url.size() + context.etag.size() + context.lastModified.size() + data.size();
+        }
+        bPrune = s_nJSONDownloadCacheBytes < 0 || s_nJSONDownloadCacheBytes > (int64_t)s_nJSONDownloadCacheMaxBytes;
+    }
+    if (bPrune) {
+        const uint64_t totalbytes = utils::PruneFileCache(boost::filesystem::path(context.cacheFilename).parent_path().string(), s_nJSONDownloadCacheMaxBytes);
+        std::lock_guard<std::mutex> lock(s_mutexJSONDownloadCacheBytes);
+        s_nJSONDownloadCacheBytes = totalbytes;
+    }
+}
+
 JSONDownloadContext::JSONDownloadContext()
 {
     curl = curl_easy_init();
@@ -70,6 +242,10 @@ JSONDownloadContext::JSONDownloadContext()
 
 JSONDownloadContext::~JSONDownloadContext()
 {
+    if (!!pRequestHeaders) {
+        curl_slist_free_all(pRequestHeaders);
+        pRequestHeaders = nullptr;
+    }
     if (!!curl) {
         curl_easy_cleanup(curl);
         curl = nullptr;
@@ -88,6 +264,7 @@ JSONDownloader::JSONDownloader(std::map<std::string, boost::shared_ptr<const rap
     }
 
     _userAgent = boost::str(boost::format("OpenRAVE/%s")%OPENRAVE_VERSION_STRING);
+    _cacheDirectory = _GetJSONDownloadCacheDirectory();
 }
 
 JSONDownloader::~JSONDownloader()
@@ -185,15 +362,32 @@ void JSONDownloaderScope::WaitForDownloads(uint64_t timeoutUS)
             if (getInfoCode != CURLE_OK) {
                 throw OPENRAVE_EXCEPTION_FORMAT("failed to get response status code for uri \"%s\": %s", pContext->uri%curl_easy_strerror(getInfoCode), ORE_CurlInvalidHandle);
             }
-            if (responseCode != 0 && responseCode != 200) {
-                // file scheme downloads have a zero response code
-                throw OPENRAVE_EXCEPTION_FORMAT("failed to download uri \"%s\", received http %d response", pContext->uri%responseCode, ORE_CurlInvalidResponse);
+            if (responseCode == 304 && !!pContext->pRequestHeaders) {
+                // not modified since it was cached, so skip both the transfer and the json parse
+                if (!_ReadJSONDownloadCacheDocument(pContext->cacheFilename, pContext->url, *pContext->pDoc)) {
+                    // the cache was removed or corrupted after its validators were sent, so download again without them
+                    RAVELOG_DEBUG_FORMAT("failed to read download cache %s for uri \"%s\", downloading again", pContext->cacheFilename%pContext->uri);
+                    _RequeueUnconditionalDownload(pContext);
+                    continue;
+                }
+                RAVELOG_DEBUG_FORMAT("uri \"%s\" is not modified, loaded from download cache, took %d[us]", pContext->uri%(currentTimestampUS-pContext->startTimestampUS));
             }
+            else {
+                if (responseCode != 0 && responseCode != 200) {
+                    // file scheme downloads have a zero response code
+                    throw OPENRAVE_EXCEPTION_FORMAT("failed to download uri \"%s\", received http %d response", pContext->uri%responseCode, ORE_CurlInvalidResponse);
+                }
 
-            // parse data
-            _ParseDocument(pContext);
+                // parse data
+                _ParseDocument(pContext);
 
-            RAVELOG_DEBUG_FORMAT("successfully downloaded \"%s\", took %d[us]", pContext->uri%(currentTimestampUS-pContext->startTimestampUS));
+                // without validators the cache could never be used
+                if (!pContext->cacheFilename.empty() && (!pContext->etag.empty() || !pContext->lastModified.empty())) {
+                    _WriteJSONDownloadCache(*pContext);
+                }
+
+                RAVELOG_DEBUG_FORMAT("successfully downloaded \"%s\", took %d[us]", pContext->uri%(currentTimestampUS-pContext->startTimestampUS));
+            }
             ++numDownloads;
 
             // reuse the context object later
@@ -214,6 +408,28 @@ void JSONDownloaderScope::WaitForDownloads(uint64_t timeoutUS)
     RAVELOG_DEBUG_FORMAT("downloaded %d files, took %d[us]", numDownloads%(stopTimestampUS-startTimestampUS));
 }
 
+void JSONDownloaderScope::_RequeueUnconditionalDownload(JSONDownloadContextPtr& pContext)
+{
+    boost::system::error_code ec;
+    boost::filesystem::remove(pContext->cacheFilename, ec);
+    if (!!pContext->pRequestHeaders) {
+        curl_slist_free_all(pContext->pRequestHeaders);
+        pContext->pRequestHeaders = nullptr;
+    }
+    pContext->buffer.clear();
+    pContext->etag.clear();
+    pContext->lastModified.clear();
+    const CURLcode curlCode = curl_easy_setopt(pContext->curl, CURLOPT_HTTPHEADER, pContext->pRequestHeaders);
+    if (curlCode != CURLE_OK) {
+        throw OPENRAVE_EXCEPTION_FORMAT("failed to curl_easy_setopt(CURLOPT_HTTPHEADER) for uri \"%s\": %s", pContext->uri%curl_easy_strerror(curlCode), ORE_CurlInvalidHandle);
+    }
+    const CURLMcode addHandleCode = curl_multi_add_handle(_downloader._curlm, pContext->curl);
+    if (!!addHandleCode) {
+        throw OPENRAVE_EXCEPTION_FORMAT("failed to download uri \"%s\", curl_multi_add_handle() failed with code %d", pContext->uri%(int)addHandleCode, ORE_CurlInvalidHandle);
+    }
+    _mapDownloadContexts[pContext->curl].swap(pContext);
+}
+
 static size_t _WriteBackDataFromCurl(const char *data, size_t size, size_t dataSize, JSONDownloadContext* pContext)
 {
     const size_t numBytes = size * dataSize;
@@ -221,6 +437,24 @@ static size_t _WriteBackDataFromCurl(const char *data, size_t size, size_t dataS
     return numBytes;
 }
 
+static size_t _ReadHeaderFromCurl(const char *data, size_t size, size_t dataSize, JSONDownloadContext* pContext)
+{
+    const size_t numBytes = size * dataSize;
+    std::string header(data, numBytes);
+    if (StringStartsWith(header, "HTTP/")) {
+        // status line of a new response, for example after a redirect
+        pContext->etag.clear();
+        pContext->lastModified.clear();
+    }
+    else if (RemovePrefix(header, "ETag:")) {
+        pContext->etag = boost::trim_copy(header);
+    }
+    else if (RemovePrefix(header, "Last-Modified:")) {
+        pContext->lastModified = boost::trim_copy(header);
+    }
+    return numBytes;
+}
+
 void JSONDownloaderScope::_QueueDownloadURI(const char* pUri, rapidjson::Document* pDoc)
 {
     if( !pUri[0] ) {
@@ -274,8 +508,30 @@ void JSONDownloaderScope::_QueueDownloadURI(const char* pUri, rapidjson::Documen
         pContext = boost::make_shared<JSONDownloadContext>();
     }
     pContext->uri = canonicalUri;
+    pContext->url = url;
     pContext->pDoc = pDoc;
     pContext->startTimestampUS = utils::GetMonotonicTime();
+    pContext->etag.clear();
+    pContext->lastModified.clear();
+    pContext->cacheFilename.clear();
+    if (!!pContext->pRequestHeaders) {
+        curl_slist_free_all(pContext->pRequestHeaders);
+        pContext->pRequestHeaders = nullptr;
+    }
+
+    // remote documents are revalidated against the on-disk cache with a conditional request. encrypted documents are never cached decrypted
+    if (!_downloader._cacheDirectory.empty() && scheme != "file" && !StringEndsWith(canonicalUri, ".gpg")) {
+        pContext->cacheFilename = _downloader._cacheDirectory + s_filesep + utils::GetMD5HashString(url) + ".bin";
+        std::string etag, lastModified;
+        if (_ReadJSONDownloadCacheValidators(pContext->cacheFilename, url, etag, lastModified)) {
+            if (!etag.empty()) {
+                pContext->pRequestHeaders = curl_slist_append(pContext->pRequestHeaders, ("If-None-Match: " + etag).c_str());
+            }
+            if (!lastModified.empty()) {
+                pContext->pRequestHeaders = curl_slist_append(pContext->pRequestHeaders, ("If-Modified-Since: " + lastModified).c_str());
+            }
+        }
+    }
 
     // set curl options
     CURLcode curlCode;
@@ -311,6 +567,19 @@ void JSONDownloaderScope::_QueueDownloadURI(const char* pUri, rapidjson::Documen
     if (curlCode != CURLE_OK) {
         throw OPENRAVE_EXCEPTION_FORMAT("failed to curl_easy_setopt(CURLOPT_WRITEDATA) for uri \"%s\": %s", canonicalUri%curl_easy_strerror(curlCode), ORE_CurlInvalidHandle);
     }
+    // always set, since handles from the pool keep the headers of their previous download
+    curlCode = curl_easy_setopt(pContext->curl, CURLOPT_HTTPHEADER, pContext->pRequestHeaders);
+    if (curlCode != CURLE_OK) {
+        throw OPENRAVE_EXCEPTION_FORMAT("failed to curl_easy_setopt(CURLOPT_HTTPHEADER) for uri \"%s\": %s", canonicalUri%curl_easy_strerror(curlCode), ORE_CurlInvalidHandle);
+    }
+    curlCode = curl_easy_setopt(pContext->curl, CURLOPT_HEADERFUNCTION, _ReadHeaderFromCurl);
+    if (curlCode != CURLE_OK) {
+        throw OPENRAVE_EXCEPTION_FORMAT("failed to curl_easy_setopt(CURLOPT_HEADERFUNCTION) for uri \"%s\": %s", canonicalUri%curl_easy_strerror(curlCode), ORE_CurlInvalidHandle);
+    }
+    curlCode = curl_easy_setopt(pContext->curl, CURLOPT_HEADERDATA, pContext.get());
+    if (curlCode != CURLE_OK) {
+        throw OPENRAVE_EXCEPTION_FORMAT("failed to curl_easy_setopt(CURLOPT_HEADERDATA) for uri \"%s\": %s", canonicalUri%curl_easy_strerror(curlCode), ORE_CurlInvalidHandle);
+    }
     if (!_downloader._unixEndpoint.empty()) {
         curlCode = curl_easy_setopt(pContext->curl, CURLOPT_UNIX_SOCKET_PATH, _downloader._unixEndpoint.c_str());
         if (curlCode != CURLE_OK) {
@@ -37,10 +37,16 @@ public:
     ~JSONDownloadContext();
 
     std::string uri; ///< canonicalized uri of the download
+    std::string url; ///< url the document is downloaded from
     CURL* curl = nullptr; ///< the curl handle for this download
     std::string buffer; ///< buffer used to receive downloaded data
     rapidjson::Document* pDoc = nullptr; ///< if non-null, the caller-supplied document to put results into
     uint64_t startTimestampUS = 0; ///< start timestamp in microseconds
+
+    std::string cacheFilename; ///< if non-empty, the on-disk cache file for this download
+    std::string etag; ///< ETag header of the response, used to validate the on-disk cache later
+    std::string lastModified; ///< Last-Modified header of the response, used to validate the on-disk cache later
+    curl_slist* pRequestHeaders = nullptr; ///< conditional request headers built from the on-disk cache, owned by this context
 };
 typedef boost::shared_ptr<JSONDownloadContext> JSONDownloadContextPtr;
 
@@ -61,6 +67,8 @@ protected:
 
     std::vector<JSONDownloadContextPtr> _vDownloadContextPool; ///< pool of JSONDownloadContext objects to be reused
 
+    std::string _cacheDirectory; ///< directory of the on-disk cache of downloaded documents, empty unless the cache is enabled with OPENRAVE_JSON_DOWNLOAD_CACHE=1
+
     friend class JSONDownloaderScope;
 };
 typedef boost::shared_ptr<JSONDownloader> JSONDownloaderPtr;
@@ -98,6 +106,9 @@ protected:
     /// \brief Queue uri to be downloaded, optionally supply a rapidjson document to be used to store result
     void _QueueDownloadURI(const char* pUri, rapidjson::Document* pDoc);
 
+    /// \brief Removes the cache file of the finished context and downloads its url again without the validators of the cache
+    void _RequeueUnconditionalDownload(JSONDownloadContextPtr& pContext);
+
     /// \brief Returns true if the referenceUri is a valid URI that can be loaded
     bool _IsExpandableReferenceUri(const char* pReferenceUri) const;
 
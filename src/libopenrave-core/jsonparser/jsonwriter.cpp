@@ -195,6 +195,20 @@ protected:
     rapidjson::Document::AllocatorType& _allocator;
 };
 
+/// \brief returns the OpenRAVE::MsgPack::DumpMsgPackOptions requested by the writer attributes
+static int _GetDumpMsgPackOptions(const AttributesList& atts)
+{
+    int options = 0;
+    FOREACHC(itatt,atts) {
+        if( itatt->first == "typedArrays" ) {
+            if( itatt->second == "1" ) {
+                options |= OpenRAVE::MsgPack::DMO_TypedArrays;
+            }
+        }
+    }
+    return options;
+}
+
 void RaveWriteJSONFile(EnvironmentBasePtr penv, const std::string& filename, const AttributesList& atts, rapidjson::Document::AllocatorType& alloc)
 {
     std::ofstream ofstream(filename.c_str());
@@ -269,7 +283,7 @@ void RaveWriteMsgPackStream(EnvironmentBasePtr penv, ostream& os, const Attribut
 
     EnvironmentJSONWriter jsonwriter(atts, doc, doc.GetAllocator());
     jsonwriter.Write(penv);
-    OpenRAVE::MsgPack::DumpMsgPack(doc, os);
+    OpenRAVE::MsgPack::DumpMsgPack(doc, os, _GetDumpMsgPackOptions(atts));
 }
 
 void RaveWriteMsgPackStream(const std::list<KinBodyPtr>& listbodies, ostream& os, const AttributesList& atts, rapidjson::Document::AllocatorType& alloc)
@@ -278,7 +292,7 @@ void RaveWriteMsgPackStream(const std::list<KinBodyPtr>& listbodies, ostream& os
 
     EnvironmentJSONWriter jsonwriter(atts, doc, doc.GetAllocator());
     jsonwriter.Write(listbodies);
-    OpenRAVE::MsgPack::DumpMsgPack(doc, os);
+    OpenRAVE::MsgPack::DumpMsgPack(doc, os, _GetDumpMsgPackOptions(atts));
 }
 
 void RaveWriteMsgPackMemory(EnvironmentBasePtr penv, std::vector<char>& output, const AttributesList& atts, rapidjson::Document::AllocatorType& alloc)
@@ -286,7 +300,7 @@ void RaveWriteMsgPackMemory(EnvironmentBasePtr penv, std::vector<char>& output,
     rapidjson::Document doc(&alloc);
     EnvironmentJSONWriter jsonwriter(atts, doc, doc.GetAllocator());
     jsonwriter.Write(penv);
-    OpenRAVE::MsgPack::DumpMsgPack(doc, output);
+    OpenRAVE::MsgPack::DumpMsgPack(doc, output, _GetDumpMsgPackOptions(atts));
 }
 
 void RaveWriteMsgPackMemory(const std::list<KinBodyPtr>& listbodies, std::vector<char>& output, const AttributesList& atts, rapidjson::Document::AllocatorType& alloc)
@@ -295,7 +309,7 @@ void RaveWriteMsgPackMemory(const std::list<KinBodyPtr>& listbodies, std::vector
 
     EnvironmentJSONWriter jsonwriter(atts, doc, doc.GetAllocator());
     jsonwriter.Write(listbodies);
-    OpenRAVE::MsgPack::DumpMsgPack(doc, output);
+    OpenRAVE::MsgPack::DumpMsgPack(doc, output, _GetDumpMsgPackOptions(atts));
 }
 
 void RaveWriteEncryptedJSONFile(EnvironmentBasePtr penv, const std::string& filename, const AttributesList& atts, rapidjson::Document::AllocatorType& alloc)
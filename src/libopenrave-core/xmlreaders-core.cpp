@@ -378,7 +378,7 @@ static bool _ParseSpecialSTLFile(EnvironmentBasePtr penv, const std::string& fil
 
 #endif
 
-bool CreateTriMeshFromFile(EnvironmentBasePtr penv, const std::string& filename, const Vector& vscale, TriMesh& trimesh, RaveVector<float>& diffuseColor, RaveVector<float>& ambientColor, float& ftransparency)
+static bool _CreateTriMeshFromFileNoCache(EnvironmentBasePtr penv, const std::string& filename, const Vector& vscale, TriMesh& trimesh, RaveVector<float>& diffuseColor, RaveVector<float>& ambientColor, float& ftransparency)
 {
     string extension;
     if( filename.find_last_of('.') != string::npos ) {
@@ -480,6 +480,245 @@ bool CreateTriMeshFromFile(EnvironmentBasePtr penv, const std::string& filename,
     return false;
 }
 
+/// \brief mesh loaded from a file, shared by all environments of the process
+///
+/// Loaders only overwrite the colors the file specifies, so only those are cached and applied over the defaults of each caller.
+struct CachedTriMesh
+{
+    /// \brief overwrites the colors that the file specifies
+    void ApplyColors(RaveVector<float>& diffuseColor, RaveVector<float>& ambientColor, float& ftransparency) const
+    {
+        if( bDiffuseColor ) {
+            diffuseColor = vDiffuseColor;
+        }
+        if( bAmbientColor ) {
+            ambientColor = vAmbientColor;
+        }
+        if( bTransparency ) {
+            ftransparency = fTransparency;
+        }
+    }
+
+    boost::shared_ptr<const TriMesh> ptrimesh;
+    RaveVector<float> vDiffuseColor, vAmbientColor;
+    float fTransparency = 0;
+    bool bDiffuseColor = false, bAmbientColor = false, bTransparency = false; ///< true if the file specifies the color
+};
+
+static std::mutex s_mutexTriMeshCache;
+static std::map<std::string, CachedTriMesh> s_mapTriMeshCache; ///< key is from _GetTriMeshCacheKey
+static std::list<std::string> s_listTriMeshCacheKeys; ///< keys of s_mapTriMeshCache in the order they were added, for eviction
+static size_t s_nTriMeshCacheBytes = 0;
+static const size_t s_nTriMeshCacheMaxBytes = 1<<30;
+static const uint64_t s_nTriMeshDiskCacheMaxBytes = uint64_t(4)<<30;
+static const char s_trimeshCacheMagic[8] = {'O','R','T','M','C','0','0','2'};
+
+/// \brief returns a key that changes whenever the content of the file might have changed, or empty if the file cannot be accessed
+static std::string _GetTriMeshCacheKey(const std::string& filename, const Vector& vscale)
+{
+    boost::system::error_code ec;
+    const boost::uintmax_t filesize = boost::filesystem::file_size(filename, ec);
+    if( !!ec ) {
+        return std::string();
+    }
+    const std::time_t mtime = boost::filesystem::last_write_time(filename, ec);
+    if( !!ec ) {
+        return std::string();
+    }
+    std::stringstream ss;
+    ss << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+    ss << filename << "|" << filesize << "|" << mtime << "|" << vscale.x << " " << vscale.y << " " << vscale.z;
+    return ss.str();
+}
+
+/// \brief meshes are only cached in memory and under the openrave home directory if enabled by setting OPENRAVE_TRIMESH_CACHE=1
+static bool _IsTriMeshCacheEnabled()
+{
+    const char* pOPENRAVE_TRIMESH_CACHE = std::getenv("OPENRAVE_TRIMESH_CACHE");
+    return !!pOPENRAVE_TRIMESH_CACHE && std::string(pOPENRAVE_TRIMESH_CACHE) == "1";
+}
+
+static std::string _GetTriMeshDiskCacheDirectory()
+{
+    return RaveGetHomeDirectory() + s_filesep + "trimeshcache";
+}
+
+static std::string _GetTriMeshDiskCacheFilename(const std::string& key)
+{
+    return _GetTriMeshDiskCacheDirectory() + s_filesep + utils::GetMD5HashString(key) + ".bin";
+}
+
+static bool _ReadTriMeshDiskCache(const std::string& key, CachedTriMesh& cached)
+{
+    const std::string filename = _GetTriMeshDiskCacheFilename(key);
+    boost::system::error_code ec;
+    const boost::uintmax_t filesize = boost::filesystem::file_size(filename, ec);
+    if( !!ec ) {
+        return false;
+    }
+    std::ifstream f(filename.c_str(), std::ios::binary);
+    if( !f ) {
+        return false;
+    }
+    char magic[sizeof(s_trimeshCacheMagic)];
+    uint32_t keysize = 0;
+    f.read(magic, sizeof(magic));
+    f.read(reinterpret_cast<char*>(&keysize), sizeof(keysize));
+    if( !f || std::memcmp(magic, s_trimeshCacheMagic, sizeof(magic)) != 0 || keysize != key.size() ) {
+        return false;
+    }
+    std::string storedkey(keysize, '\0');
+    f.read(&storedkey[0], keysize);
+    if( !f || storedkey != key ) {
+        // md5 collision or stale file
+        return false;
+    }
+    float colors[9];
+    uint8_t colorflags = 0;
+    uint64_t numvertices = 0, numindices = 0;
+    f.read(reinterpret_cast<char*>(colors), sizeof(colors));
+    f.read(reinterpret_cast<char*>(&colorflags), sizeof(colorflags));
+    f.read(reinterpret_cast<char*>(&numvertices), sizeof(numvertices));
+    f.read(reinterpret_cast<char*>(&numindices), sizeof(numindices));
+    if( !f ) {
+        return false;
+    }
+    // the counts are not trusted, they have to match the rest of the file exactly
+    const uint64_t remainingbytes = filesize - static_cast<uint64_t>(f.tellg());
+    if( numvertices > remainingbytes/(3*sizeof(double)) || numindices > remainingbytes/sizeof(int32_t) || numvertices*3*sizeof(double) + numindices*sizeof(int32_t) != remainingbytes ) {
+        RAVELOG_DEBUG_FORMAT("trimesh cache %s is corrupted", filename);
+        return false;
+    }
+    boost::shared_ptr<TriMesh> ptrimesh(new TriMesh());
+    std::vector<double> vertexdata(3*numvertices);
+    ptrimesh->indices.resize(numindices);
+    f.read(reinterpret_cast<char*>(vertexdata.data()), vertexdata.size()*sizeof(double));
+    f.read(reinterpret_cast<char*>(ptrimesh->indices.data()), numindices*sizeof(int32_t));
+    if( !f ) {
+        return false;
+    }
+    ptrimesh->vertices.resize(numvertices);
+    for(size_t ivertex = 0; ivertex < numvertices; ++ivertex) {
+        ptrimesh->vertices[ivertex] = Vector(vertexdata[3*ivertex], vertexdata[3*ivertex+1], vertexdata[3*ivertex+2]);
+    }
+    cached.ptrimesh = ptrimesh;
+    cached.vDiffuseColor = RaveVector<float>(colors[0], colors[1], colors[2], colors[3]);
+    cached.vAmbientColor = RaveVector<float>(colors[4], colors[5], colors[6], colors[7]);
+    cached.fTransparency = colors[8];
+    cached.bDiffuseColor = !!(colorflags & 1);
+    cached.bAmbientColor = !!(colorflags & 2);
+    cached.bTransparency = !!(colorflags & 4);
+    return true;
+}
+
+static void _WriteTriMeshDiskCache(const std::string& key, const CachedTriMesh& cached)
+{
+    const std::string filename = _GetTriMeshDiskCacheFilename(key);
+    const std::string tempfilename = utils::GetTemporaryFilename(filename);
+    try {
+        boost::filesystem::create_directories(boost::filesystem::path(filename).parent_path());
+        {
+            std::ofstream f(tempfilename.c_str(), std::ios::binary|std::ios::trunc);
+            if( !f ) {
+                return;
+            }
+            const TriMesh& trimesh = *cached.ptrimesh;
+            const uint32_t keysize = key.size();
+            const float colors[9] = {cached.vDiffuseColor.x, cached.vDiffuseColor.y, cached.vDiffuseColor.z, cached.vDiffuseColor.w, cached.vAmbientColor.x, cached.vAmbientColor.y, cached.vAmbientColor.z, cached.vAmbientColor.w, cached.fTransparency};
+            const uint8_t colorflags = (cached.bDiffuseColor ? 1 : 0) | (cached.bAmbientColor ? 2 : 0) | (cached.bTransparency ? 4 : 0);
+            const uint64_t numvertices = trimesh.vertices.size(), numindices = trimesh.indices.size();
+            std::vector<double> vertexdata(3*numvertices);
+            for(size_t ivertex = 0; ivertex < numvertices; ++ivertex) {
+                vertexdata[3*ivertex] = trimesh.vertices[ivertex].x;
+                vertexdata[3*ivertex+1] = trimesh.vertices[ivertex].y;
+                vertexdata[3*ivertex+2] = trimesh.vertices[ivertex].z;
+            }
+            f.write(s_trimeshCacheMagic, sizeof(s_trimeshCacheMagic));
+            f.write(reinterpret_cast<const char*>(&keysize), sizeof(keysize));
+            f.write(key.c_str(), keysize);
+            f.write(reinterpret_cast<const char*>(colors), sizeof(colors));
+            f.write(reinterpret_cast<const char*>(&colorflags), sizeof(colorflags));
+            f.write(reinterpret_cast<const char*>(&numvertices), sizeof(numvertices));
+            f.write(reinterpret_cast<const char*>(&numindices), sizeof(numindices));
+            f.write(reinterpret_cast<const char*>(vertexdata.data()), vertexdata.size()*sizeof(double));
+            f.write(reinterpret_cast<const char*>(trimesh.indices.data()), numindices*sizeof(int32_t));
+            if( !f ) {
+                f.close();
+                boost::filesystem::remove(tempfilename);
+                return;
+            }
+        }
+        // rename is atomic, so concurrent processes never read a partially written file
+        boost::filesystem::rename(tempfilename, filename);
+    }
+    catch(const boost::filesystem::filesystem_error& ex) {
+        RAVELOG_DEBUG_FORMAT("failed to write trimesh cache %s: %s", filename%ex.what());
+        return;
+    }
+    utils::PruneFileCache(_GetTriMeshDiskCacheDirectory(), s_nTriMeshDiskCacheMaxBytes);
+}
+
+static void _AddToTriMeshCache(const std::string& key, const CachedTriMesh& cached)
+{
+    const size_t nbytes = cached.ptrimesh->vertices.size()*sizeof(Vector) + cached.ptrimesh->indices.size()*sizeof(int32_t);
+    std::lock_guard<std::mutex> lock(s_mutexTriMeshCache);
+    if( !s_mapTriMeshCache.emplace(key, cached).second ) {
+        return;
+    }
+    s_listTriMeshCacheKeys.push_back(key);
+    s_nTriMeshCacheBytes += nbytes;
+    while( s_nTriMeshCacheBytes > s_nTriMeshCacheMaxBytes && s_listTriMeshCacheKeys.size() > 1 ) {
+        std::map<std::string, CachedTriMesh>::iterator itcached = s_mapTriMeshCache.find(s_listTriMeshCacheKeys.front());
+        s_nTriMeshCacheBytes -= itcached->second.ptrimesh->vertices.size()*sizeof(Vector) + itcached->second.ptrimesh->indices.size()*sizeof(int32_t);
+        s_mapTriMeshCache.erase(itcached);
+        s_listTriMeshCacheKeys.pop_front();
+    }
+}
+
+bool CreateTriMeshFromFile(EnvironmentBasePtr penv, const std::string& filename, const Vector& vscale, TriMesh& trimesh, RaveVector<float>& diffuseColor, RaveVector<float>& ambientColor, float& ftransparency)
+{
+    // meshes are cached by file, modification time, and scale so that loading the same file in other environments or later processes skips parsing
+    const std::string key = _IsTriMeshCacheEnabled() ? _GetTriMeshCacheKey(filename, vscale) : std::string();
+    if( key.empty() ) {
+        return _CreateTriMeshFromFileNoCache(penv, filename, vscale, trimesh, diffuseColor, ambientColor, ftransparency);
+    }
+
+    CachedTriMesh cached;
+    bool bFound = false;
+    {
+        std::lock_guard<std::mutex> lock(s_mutexTriMeshCache);
+        std::map<std::string, CachedTriMesh>::const_iterator itcached = s_mapTriMeshCache.find(key);
+        if( itcached != s_mapTriMeshCache.end() ) {
+            cached = itcached->second;
+            bFound = true;
+        }
+    }
+    if( !bFound && _ReadTriMeshDiskCache(key, cached) ) {
+        _AddToTriMeshCache(key, cached);
+        bFound = true;
+    }
+    if( !bFound ) {
+        // start from NaN so that the colors the loader leaves alone can be told apart from the ones the file specifies
+        const float fNaN = std::numeric_limits<float>::quiet_NaN();
+        cached.vDiffuseColor = cached.vAmbientColor = RaveVector<float>(fNaN, fNaN, fNaN, fNaN);
+        cached.fTransparency = fNaN;
+        boost::shared_ptr<TriMesh> ptrimesh(new TriMesh());
+        if( !_CreateTriMeshFromFileNoCache(penv, filename, vscale, *ptrimesh, cached.vDiffuseColor, cached.vAmbientColor, cached.fTransparency) ) {
+            return false;
+        }
+        cached.ptrimesh = ptrimesh;
+        cached.bDiffuseColor = !std::isnan(cached.vDiffuseColor.x) && !std::isnan(cached.vDiffuseColor.y) && !std::isnan(cached.vDiffuseColor.z) && !std::isnan(cached.vDiffuseColor.w);
+        cached.bAmbientColor = !std::isnan(cached.vAmbientColor.x) && !std::isnan(cached.vAmbientColor.y) && !std::isnan(cached.vAmbientColor.z) && !std::isnan(cached.vAmbientColor.w);
+        cached.bTransparency = !std::isnan(cached.fTransparency);
+        _AddToTriMeshCache(key, cached);
+        _WriteTriMeshDiskCache(key, cached);
+    }
+
+    trimesh = *cached.ptrimesh;
+    cached.ApplyColors(diffuseColor, ambientColor, ftransparency);
+    return true;
+}
+
 bool CreateTriMeshFromData(const std::string& data, const std::string& formathint, const Vector& vscale, TriMesh& trimesh, RaveVector<float>& diffuseColor, RaveVector<float>& ambientColor, float& ftransparency)
 {
 #ifdef OPENRAVE_ASSIMP
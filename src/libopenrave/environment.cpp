@@ -16,6 +16,9 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "libopenrave.h"
 
+#include <atomic>
+#include <thread>
+
 EnvironmentBase::EnvironmentBaseInfo::EnvironmentBaseInfo()
 {
     _gravity = Vector(0,0,-9.797930195020351);
@@ -109,6 +112,82 @@ void EnvironmentBase::EnvironmentBaseInfo::DeserializeJSON(const rapidjson::Valu
     DeserializeJSONWithMapping(rEnvInfo, fUnitScale, options, vInputToBodyInfoMapping);
 }
 
+namespace {
+
+/// \brief a body info whose DeserializeJSON is postponed so that many bodies can be deserialized in parallel
+struct PendingBodyInfoDeserialization
+{
+    KinBody::KinBodyInfoPtr pinfo;
+    const rapidjson::Value* pvalue;
+    std::string id; ///< id to set after deserializing
+};
+
+} // end namespace
+
+/// \brief minimum number of different infos before deserializing them in parallel, fewer are not worth starting threads
+static const int s_nMinParallelBodyInfos = 8;
+
+/// \brief deserializes all pending infos and clears vPendingDeserializations.
+///
+/// Different infos are deserialized in parallel if there are at least s_nMinParallelBodyInfos of them. Multiple entries of the same info are applied in order by the same thread.
+/// The registered JSON readers of the readable interfaces are called under GetJSONReaderMutex().
+static void _DeserializePendingBodyInfos(std::vector<PendingBodyInfoDeserialization>& vPendingDeserializations, dReal fUnitScale, int options)
+{
+    if( vPendingDeserializations.empty() ) {
+        return;
+    }
+
+    // group the entries by info, keeping the input order
+    std::vector< std::vector<int> > vGroups;
+    {
+        std::map<KinBody::KinBodyInfo*, int> mapInfoToGroup;
+        for(int ipending = 0; ipending < (int)vPendingDeserializations.size(); ++ipending) {
+            std::pair<std::map<KinBody::KinBodyInfo*, int>::iterator, bool> itinserted = mapInfoToGroup.emplace(vPendingDeserializations[ipending].pinfo.get(), (int)vGroups.size());
+            if( itinserted.second ) {
+                vGroups.emplace_back();
+            }
+            vGroups[itinserted.first->second].push_back(ipending);
+        }
+    }
+
+    std::atomic<int> nextgroup(0);
+    std::mutex mutexException;
+    std::exception_ptr pexception;
+    auto deserializeGroups = [&]() {
+        for(int igroup = nextgroup++; igroup < (int)vGroups.size(); igroup = nextgroup++) {
+            try {
+                for(int ipending : vGroups[igroup]) {
+                    PendingBodyInfoDeserialization& pending = vPendingDeserializations[ipending];
+                    pending.pinfo->DeserializeJSON(*pending.pvalue, fUnitScale, options);
+                    pending.pinfo->_id = pending.id;
+                }
+            }
+            catch(...) {
+                std::lock_guard<std::mutex> lock(mutexException);
+                if( !pexception ) {
+                    pexception = std::current_exception();
+                }
+                nextgroup = (int)vGroups.size(); // stop the other threads
+            }
+        }
+    };
+
+    const int numthreads = (int)vGroups.size() < s_nMinParallelBodyInfos ? 1 : std::min((int)vGroups.size(), std::max(1, (int)std::thread::hardware_concurrency()));
+    std::vector<std::thread> vthreads;
+    vthreads.reserve(numthreads-1);
+    for(int ithread = 1; ithread < numthreads; ++ithread) {
+        vthreads.emplace_back(deserializeGroups);
+    }
+    deserializeGroups();
+    for(std::thread& t : vthreads) {
+        t.join();
+    }
+    vPendingDeserializations.clear();
+    if( !!pexception ) {
+        std::rethrow_exception(pexception);
+    }
+}
+
 void EnvironmentBase::EnvironmentBaseInfo::DeserializeJSONWithMapping(const rapidjson::Value& rEnvInfo, dReal fUnitScale, int options, const std::vector<int>& vInputToBodyInfoMapping)
 {
     if( !rEnvInfo.IsObject() ) {
@@ -185,6 +264,9 @@ void EnvironmentBase::EnvironmentBaseInfo::DeserializeJSONWithMapping(const rapi
     if (rEnvInfo.HasMember("bodies")) {
         _vBodyInfos.reserve(_vBodyInfos.size() + rEnvInfo["bodies"].Size());
         const rapidjson::Value& rBodies = rEnvInfo["bodies"];
+        // the deserialization of the body infos is postponed and done in parallel, so have to flush it whenever a decision depends on the deserialized infos
+        std::vector<PendingBodyInfoDeserialization> vPendingDeserializations;
+        vPendingDeserializations.reserve(rBodies.Size());
         for(int iInputBodyIndex = 0; iInputBodyIndex < (int)rBodies.Size(); ++iInputBodyIndex) {
             const rapidjson::Value& rKinBodyInfo = rBodies[iInputBodyIndex];
 
@@ -209,6 +291,7 @@ void EnvironmentBase::EnvironmentBaseInfo::DeserializeJSONWithMapping(const rapi
             }
             else {
                 // id is empty, try finding the existing one from a matching name
+                _DeserializePendingBodyInfos(vPendingDeserializations, fUnitScale, options);
                 rapidjson::Value::ConstMemberIterator itName = rKinBodyInfo.FindMember("name");
                 if( itName != rKinBodyInfo.MemberEnd() && itName->value.IsString() ) {
                     FOREACH(itBodyInfo, _vBodyInfos) {
@@ -234,10 +317,11 @@ void EnvironmentBase::EnvironmentBaseInfo::DeserializeJSONWithMapping(const rapi
                 if (itExistingBodyInfo == _vBodyInfos.end()) {
                     // in case no such id
                     if (!isDeleted) {
-                        RobotBase::RobotBaseInfoPtr pRobotBaseInfo(new RobotBase::RobotBaseInfo());
-                        pRobotBaseInfo->DeserializeJSON(rKinBodyInfo, fUnitScale, options);
-                        if (!pRobotBaseInfo->_name.empty()) {
+                        // a new info only gets its name from the json, so can skip it before deserializing
+                        if (!orjson::GetStringJsonValueByKey(rKinBodyInfo, "name").empty()) {
+                            RobotBase::RobotBaseInfoPtr pRobotBaseInfo(new RobotBase::RobotBaseInfo());
                             pRobotBaseInfo->_id = id;
+                            vPendingDeserializations.push_back({pRobotBaseInfo, &rKinBodyInfo, id});
                             _vBodyInfos.push_back(pRobotBaseInfo);
                             RAVELOG_VERBOSE_FORMAT("created new robot id='%s'", id);
                         } else {
@@ -257,23 +341,24 @@ void EnvironmentBase::EnvironmentBaseInfo::DeserializeJSONWithMapping(const rapi
                 if (!pRobotBaseInfo) {
                     // previous body was not a robot
                     // need to replace with a new RobotBaseInfo
+                    _DeserializePendingBodyInfos(vPendingDeserializations, fUnitScale, options);
                     pRobotBaseInfo.reset(new RobotBase::RobotBaseInfo());
                     *itExistingBodyInfo = pRobotBaseInfo;
                     *((KinBody::KinBodyInfo*)pRobotBaseInfo.get()) = *pKinBodyInfo;
                     RAVELOG_VERBOSE_FORMAT("replaced body as a robot id='%s'", id);
                 }
-                pRobotBaseInfo->DeserializeJSON(rKinBodyInfo, fUnitScale, options);
                 pRobotBaseInfo->_id = id;
+                vPendingDeserializations.push_back({pRobotBaseInfo, &rKinBodyInfo, id});
             }
             else {
                 // not a robot
                 if (itExistingBodyInfo == _vBodyInfos.end()) {
                     // in case no such id
                     if (!isDeleted) {
-                        KinBody::KinBodyInfoPtr pKinBodyInfo(new KinBody::KinBodyInfo());
-                        pKinBodyInfo->DeserializeJSON(rKinBodyInfo, fUnitScale, options);
-                        if (!pKinBodyInfo->_name.empty()) {
+                        if (!orjson::GetStringJsonValueByKey(rKinBodyInfo, "name").empty()) {
+                            KinBody::KinBodyInfoPtr pKinBodyInfo(new KinBody::KinBodyInfo());
                             pKinBodyInfo->_id = id;
+                            vPendingDeserializations.push_back({pKinBodyInfo, &rKinBodyInfo, id});
                             _vBodyInfos.push_back(pKinBodyInfo);
                             RAVELOG_VERBOSE_FORMAT("created new body id='%s'", id);
                         } else {
@@ -293,14 +378,16 @@ void EnvironmentBase::EnvironmentBaseInfo::DeserializeJSONWithMapping(const rapi
                 if (!!pRobotBaseInfo) {
                     // previous body was a robot
                     // need to replace with a new KinBodyInfo
+                    _DeserializePendingBodyInfos(vPendingDeserializations, fUnitScale, options);
                     pKinBodyInfo.reset(new KinBody::KinBodyInfo());
                     *itExistingBodyInfo = pKinBodyInfo;
                     *pKinBodyInfo = *((KinBody::KinBodyInfo*)pRobotBaseInfo.get());
                     RAVELOG_VERBOSE_FORMAT("replaced robot as a body id='%s'", id);
                 }
-                pKinBodyInfo->DeserializeJSON(rKinBodyInfo, fUnitScale, options);
                 pKinBodyInfo->_id = id;
+                vPendingDeserializations.push_back({pKinBodyInfo, &rKinBodyInfo, id});
             }
         }
+        _DeserializePendingBodyInfos(vPendingDeserializations, fUnitScale, options);
     }
 }
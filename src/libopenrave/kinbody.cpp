@@ -16,6 +16,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "libopenrave.h"
 #include <algorithm>
+#include <thread>
 
 // used for functions that are also used internally
 #define CHECK_NO_INTERNAL_COMPUTATION OPENRAVE_ASSERT_FORMAT(_nHierarchyComputed == 0, "env=%s, body %s cannot be added to environment when doing this operation, current value is %d", GetEnv()->GetNameId()%GetName()%_nHierarchyComputed, ORE_InvalidState);
@@ -417,6 +418,8 @@ void KinBody::KinBodyInfo::_DeserializeReadableInterface(const std::string& id,
     if(itReadable != _mReadableInterfaces.end()) {
         pReadable = itReadable->second;
     }
+    // infos can be deserialized in parallel, but the registered readers do not have to be thread-safe
+    std::lock_guard<std::recursive_mutex> lock(GetJSONReaderMutex());
     BaseJSONReaderPtr pReader = RaveCallJSONReader(PT_KinBody, id, pReadable, AttributesList());
     if (!!pReader) {
         pReader->DeserializeJSON(rReadable, fUnitScale);
@@ -487,6 +490,7 @@ void KinBody::Destroy()
     _vClosedLoops.clear();
     _vClosedLoopIndices.clear();
     _vForcedAdjacentLinks.clear();
+    _vNeverCollidingLinks.clear();
     _nHierarchyComputed = 0;
     _nParametersChanged = 0;
     _pManageData.reset();
@@ -732,7 +736,7 @@ void KinBody::SetLinkGeometriesFromGroup(const std::string& geomname)
         for(size_t i = 0; i < pvinfos->size(); ++i) {
             (*itlink)->_vGeometries[i].reset(new Link::Geometry(*itlink,*pvinfos->at(i)));
             if( (*itlink)->_vGeometries[i]->GetCollisionMesh().vertices.size() == 0 ) { // try to avoid recomputing
-                (*itlink)->_vGeometries[i]->InitCollisionMesh();
+                (*itlink)->_vGeometries[i]->_InitCollisionMeshOrDefer();
             }
         }
         (*itlink)->_Update(false);
@@ -4107,217 +4111,302 @@ CollisionCheckerBasePtr KinBody::GetSelfCollisionChecker() const
 }
 
 
-void KinBody::_ComputeInternalInformation()
-{
-    uint64_t starttime = utils::GetMicroTime();
-    _nHierarchyComputed = 1;
+static const char s_hierarchySnapshotMagic[8] = {'O','R','K','H','S','0','0','1'};
+static const size_t s_nHierarchySnapshotMemoryCacheMaxEntries = 256;
+static const uint64_t s_nHierarchySnapshotDiskCacheMaxBytes = 256*1024*1024;
 
-    _vLinkTransformPointers.clear();
-    if( !!_pCurrentKinematicsFunctions ) {
-        RAVELOG_DEBUG_FORMAT("env=%d, resetting custom kinematics functions for body %s", GetEnv()->GetId()%GetName());
-        _pCurrentKinematicsFunctions.reset();
+class KinBody::HierarchySnapshot
+{
+public:
+    /// \brief returns true if the snapshot can be applied to a body with numlinks links and numjoints active and passive joints
+    bool IsValid(size_t numlinks, size_t numjoints) const
+    {
+        if( vAllPairsShortestPaths.size() != numlinks*numlinks || vLinkParentLinks.size() != numlinks || vLinkPathLinks.size() != numlinks || vLinkDepths.size() != numlinks || vTopologicallySortedJointIndicesAll.size() != numjoints ) {
+            return false;
+        }
+        FOREACHC(itpair, vAllPairsShortestPaths) {
+            if( itpair->first >= (int)numlinks || itpair->second >= (int)numjoints ) {
+                return false;
+            }
+        }
+        for(size_t ilink = 0; ilink < numlinks; ++ilink) {
+            if( !_IsInRange(vLinkParentLinks[ilink], numlinks) || !_IsInRange(vLinkPathLinks[ilink], numlinks) ) {
+                return false;
+            }
+        }
+        FOREACHC(itclosedloop, vClosedLoops) {
+            if( !_IsInRange(*itclosedloop, numlinks) ) {
+                return false;
+            }
+        }
+        return _IsInRange(vTopologicallySortedJointIndicesAll, numjoints);
     }
 
-    int lindex=0;
-    FOREACH(itlink,_veclinks) {
-        (*itlink)->_index = lindex; // always reset, necessary since index cannot be initialized by custom links
-        (*itlink)->_vParentLinks.clear();
-        if((_veclinks.size() > 1)&&((*itlink)->GetName().size() == 0)) {
-            RAVELOG_WARN(str(boost::format("%s link index %d has no name")%GetName()%lindex));
-        }
-        lindex++;
+    /// \brief snapshots are only kept in memory and under the openrave home directory if enabled by setting OPENRAVE_KINBODY_HIERARCHY_CACHE=1.
+    ///
+    /// Computing the key serializes the kinematics of the body, and a miss reads and writes a file, so it only pays off for bodies with large kinematic graphs loaded many times.
+    static bool IsCacheEnabled()
+    {
+        static const bool bCacheEnabled = []() {
+            const char* pOPENRAVE_KINBODY_HIERARCHY_CACHE = std::getenv("OPENRAVE_KINBODY_HIERARCHY_CACHE");
+            return !!pOPENRAVE_KINBODY_HIERARCHY_CACHE && std::string(pOPENRAVE_KINBODY_HIERARCHY_CACHE) == "1";
+        }();
+        return bCacheEnabled;
     }
 
+    /// \brief looks up the snapshot of the key in memory and then on disk, returns an empty pointer if there is none valid for the body
+    static HierarchySnapshotPtr Find(const std::string& key, size_t numlinks, size_t numjoints)
     {
-        // move any enabled passive joints to the regular joints list
-        vector<JointPtr>::iterator itjoint = _vPassiveJoints.begin();
-        while(itjoint != _vPassiveJoints.end()) {
-            bool bmimic = false;
-            for(int idof = 0; idof < (*itjoint)->GetDOF(); ++idof) {
-                if( !!(*itjoint)->_vmimic[idof] ) {
-                    bmimic = true;
-                }
-            }
-            if( !bmimic && (*itjoint)->_info._bIsActive ) {
-                _vecjoints.push_back(*itjoint);
-                itjoint = _vPassiveJoints.erase(itjoint);
-            }
-            else {
-                ++itjoint;
+        HierarchySnapshotPtr psnapshot;
+        {
+            std::lock_guard<std::mutex> lock(_GetCacheMutex());
+            std::map<std::string, HierarchySnapshotPtr>::const_iterator it = _GetCache().find(key);
+            if( it != _GetCache().end() ) {
+                psnapshot = it->second;
             }
         }
-        // move any mimic joints to the passive joints
-        itjoint = _vecjoints.begin();
-        while(itjoint != _vecjoints.end()) {
-            bool bmimic = false;
-            for(int idof = 0; idof < (*itjoint)->GetDOF(); ++idof) {
-                if( !!(*itjoint)->_vmimic[idof] ) {
-                    bmimic = true;
-                    break;
-                }
+#ifdef HAVE_BOOST_FILESYSTEM
+        if( !psnapshot ) {
+            psnapshot = _Read(_GetFilename(key), key);
+            if( !!psnapshot ) {
+                _AddToMemory(key, psnapshot);
             }
-            if( bmimic || !(*itjoint)->_info._bIsActive ) {
-                _vPassiveJoints.push_back(*itjoint);
-                itjoint = _vecjoints.erase(itjoint);
-            }
-            else {
-                ++itjoint;
-            }
-        }
-        int jointindex=0;
-        int dofindex=0;
-        FOREACH(itvjoint,_vecjoints) {
-            (*itvjoint)->jointindex = jointindex++;
-            (*itvjoint)->dofindex = dofindex;
-            (*itvjoint)->_info._bIsActive = true;
-            dofindex += (*itvjoint)->GetDOF();
         }
-        FOREACH(passive,_vPassiveJoints) {
-            (*passive)->jointindex = -1;
-            (*passive)->dofindex = -1;
-            (*passive)->_info._bIsActive = false;
+#endif
+        if( !!psnapshot && !psnapshot->IsValid(numlinks, numjoints) ) {
+            RAVELOG_DEBUG_FORMAT("ignoring kinbody hierarchy snapshot %s since it does not match the body", key);
+            return HierarchySnapshotPtr();
         }
+        return psnapshot;
     }
 
-    vector<size_t> vorder(_vecjoints.size());
-    vector<int> vJointIndices(_vecjoints.size());
-    _vDOFIndices.resize(GetDOF());
-    for(size_t i = 0; i < _vecjoints.size(); ++i) {
-        vJointIndices[i] = _vecjoints[i]->dofindex;
-        for(int idof = 0; idof < _vecjoints[i]->GetDOF(); ++idof) {
-            _vDOFIndices.at(vJointIndices[i]+idof) = i;
-        }
-        vorder[i] = i;
-    }
-    sort(vorder.begin(), vorder.end(), utils::index_cmp<vector<int>&>(vJointIndices));
-    _vDOFOrderedJoints.resize(0);
-    FOREACH(index,vorder) {
-        _vDOFOrderedJoints.push_back(_vecjoints.at(*index));
+    static void Add(const std::string& key, HierarchySnapshotPtr psnapshot)
+    {
+        _AddToMemory(key, psnapshot);
+#ifdef HAVE_BOOST_FILESYSTEM
+        _Write(_GetFilename(key), key, *psnapshot);
+        utils::PruneFileCache(boost::filesystem::path(_GetFilename(key)).parent_path().string(), s_nHierarchySnapshotDiskCacheMaxBytes);
+#endif
     }
 
-    try {
-        // initialize all the mimic equations
-        for(int bPassiveJoints = 0; bPassiveJoints < 2; ++bPassiveJoints) { // simulate false/true
-            const std::vector<JointPtr>& vjoints = bPassiveJoints ? _vPassiveJoints : _vecjoints;
-            for(const JointPtr& pjoint : vjoints) {
-                const int ndof = pjoint->GetDOF();
-                const boost::array<MimicPtr, 3>& vmimic = pjoint->_vmimic;
-                for(int idof = 0; idof < ndof; ++idof) {
-                    const MimicPtr& pmimic = vmimic[idof];
-                    if( !!pmimic ) {
-                        const std::string poseq = pmimic->_equations[0];
-                        const std::string veleq = pmimic->_equations[1];
-                        const std::string acceleq = pmimic->_equations[2]; // have to copy since memory can become invalidated
-                        pjoint->SetMimicEquations(idof, poseq, veleq, acceleq);
-                    }
-                }
+    std::vector< std::pair<int16_t, int16_t> > vAllPairsShortestPaths; ///< \see KinBody::_vAllPairsShortestPaths
+    std::vector< std::vector<int> > vLinkParentLinks; ///< for every link, \see Link::_vParentLinks
+    std::vector< std::vector<int> > vLinkPathLinks; ///< for every link, the sorted indices of the links on all unique paths from the root to it. Empty if the link is not connected to the root
+    std::vector<int> vLinkDepths; ///< for every link, the minimum path length to the root or to a static link
+    std::vector<int> vTopologicallySortedJointIndicesAll; ///< \see KinBody::_vTopologicallySortedJointIndicesAll
+    std::vector< std::vector<int> > vClosedLoops; ///< link indices of every closed loop
+
+private:
+    static bool _IsInRange(const std::vector<int>& vindices, size_t num)
+    {
+        FOREACHC(itindex, vindices) {
+            if( *itindex < 0 || *itindex >= (int)num ) {
+                return false;
             }
         }
+        return true;
+    }
 
-        // fill Mimic::_vmimicdofs, check that there are no circular dependencies between the mimic joints
-        const int nActiveJoints = _vecjoints.size();
-        std::map<Mimic::DOFFormat, MimicPtr> mapmimic; ///< collects if thisdofformat.jointaxis depends on a mimic joint
-        for(int bPassiveJoints = 0; bPassiveJoints < 2; ++bPassiveJoints) { // simulate false/true
-            const std::vector<JointPtr>& vjoints = bPassiveJoints ? _vPassiveJoints : _vecjoints;
-            const int njoints = vjoints.size();
-            for(int ijoint = 0; ijoint < njoints; ++ijoint) {
-                const JointPtr& pjoint = vjoints[ijoint];
+    static std::mutex& _GetCacheMutex()
+    {
+        static std::mutex s_mutexCache;
+        return s_mutexCache;
+    }
 
-                Mimic::DOFFormat thisdofformat; ///< construct for pjoint
-                if( bPassiveJoints ) {
-                    thisdofformat.dofindex   = -1; ///< mimic dofindex = -1, ...
-                    thisdofformat.jointindex = ijoint + nActiveJoints; ///< but has a generalized joint index
-                }
-                else {
-                    thisdofformat.dofindex   = pjoint->GetDOFIndex();  ///< >= 0
-                    thisdofformat.jointindex = pjoint->GetJointIndex(); ///< in [0, nActiveJoints)
-                }
+    /// \brief snapshots used by this process indexed by their key, protected by _GetCacheMutex
+    static std::map<std::string, HierarchySnapshotPtr>& _GetCache()
+    {
+        static std::map<std::string, HierarchySnapshotPtr> s_mapSnapshots;
+        return s_mapSnapshots;
+    }
 
-                const int ndof = pjoint->GetDOF();
-                const boost::array<MimicPtr, 3>& vmimic = pjoint->_vmimic;
-                for(int idof = 0; idof < ndof; ++idof) {
-                    const MimicPtr& pmimic = vmimic[idof]; // enumerate
-                    thisdofformat.axis = idof;
-                    if( !!pmimic ) {
-                        // only add if pjoint depends on mimic joints
-                        // TGN: Can an active joint depend on mimic joints??? If not, why need vjoints = _vecjoints?
-                        for(const Mimic::DOFFormat& dofformat : pmimic->_vdofformat) {
-                            const JointPtr pjointDepended = dofformat.GetJoint(*this);
-                            if( pjointDepended->IsMimic(dofformat.axis) ) {
-                                mapmimic[thisdofformat] = pmimic; ///< pjoint depends on pjointDepended
-                                RAVELOG_VERBOSE_FORMAT("mimic joint %s depends on mimic joint %s", pjoint->GetName() % pjointDepended->GetName());
-                                break;
-                            }
-                        }
-                    }
-                }
+    /// \brief keys of _GetCache in the order they were added, protected by _GetCacheMutex
+    static std::list<std::string>& _GetCacheOrder()
+    {
+        static std::list<std::string> s_listKeys;
+        return s_listKeys;
+    }
+
+    /// \brief adds the snapshot to the memory cache, removing the oldest ones beyond s_nHierarchySnapshotMemoryCacheMaxEntries
+    static void _AddToMemory(const std::string& key, HierarchySnapshotPtr psnapshot)
+    {
+        std::lock_guard<std::mutex> lock(_GetCacheMutex());
+        if( _GetCache().emplace(key, psnapshot).second ) {
+            _GetCacheOrder().push_back(key);
+            while( _GetCacheOrder().size() > s_nHierarchySnapshotMemoryCacheMaxEntries ) {
+                _GetCache().erase(_GetCacheOrder().front());
+                _GetCacheOrder().pop_front();
             }
         }
+    }
 
-        bool bchanged = true;
-        while(bchanged) {
-            bchanged = false;
-            for(const std::pair<const Mimic::DOFFormat, MimicPtr>& keyvalue : mapmimic) {
-                const Mimic::DOFFormat& thisdofformat = keyvalue.first;
-                const MimicPtr& pmimic = keyvalue.second;
-                std::vector<Mimic::DOFHierarchy>& vmimicdofs = pmimic->_vmimicdofs; ///< to collect information of active joints on which pmimic depends on
-                const std::vector<Mimic::DOFFormat>& vdofformat = pmimic->_vdofformat; ///<  collected information of all joints on which pmimic depends on
+#ifdef HAVE_BOOST_FILESYSTEM
+    static std::string _GetFilename(const std::string& key)
+    {
+        return (boost::filesystem::path(RaveGetHomeDirectory()) / "kinbodyhierarchy" / (key + ".bin")).string();
+    }
 
-                const JointPtr pjoint = thisdofformat.GetJoint(*this); ///< pjoint depends on all [dofformat.GetJoint(*this) for dofformat in vdofformat]
-                const int ndofformat = vdofformat.size();
-                for(int idofformat = 0; idofformat < ndofformat; ++idofformat) {
-                    const Mimic::DOFFormat& dofformat = vdofformat[idofformat];
-                    const JointPtr pjointDepended = dofformat.GetJoint(*this);
-                    if( !mapmimic.count(dofformat) ) {
-                        continue; // this means pjointDepended depends on active joints only
-                    }
+    /// \brief returns the number of bytes left in the file
+    static uint64_t _GetRemainingBytes(std::istream& is, uint64_t filesize)
+    {
+        const std::streamoff pos = is.tellg();
+        return pos < 0 || (uint64_t)pos > filesize ? 0 : filesize - pos;
+    }
 
-                    const MimicPtr& pmimicDepended = mapmimic.at(dofformat); // dofformat.jointindex depends on pmimicDepended
-                    const std::vector<Mimic::DOFHierarchy>&   vmimicdofsDepended = pmimicDepended->_vmimicdofs;
-                    const std::vector<Mimic::DOFFormat>& vmimicdofformatDepended = pmimicDepended->_vdofformat;
+    static bool _ReadIndices(std::istream& is, uint64_t filesize, std::vector<int>& vindices)
+    {
+        uint32_t size = 0;
+        is.read(reinterpret_cast<char*>(&size), sizeof(size));
+        if( !is || size > _GetRemainingBytes(is, filesize)/sizeof(int32_t) ) {
+            return false;
+        }
+        std::vector<int32_t> vdata(size);
+        if( size > 0 ) {
+            is.read(reinterpret_cast<char*>(&vdata[0]), size*sizeof(int32_t));
+        }
+        vindices.assign(vdata.begin(), vdata.end());
+        return !!is;
+    }
 
-                    for(const Mimic::DOFHierarchy& mimicdofDepended : vmimicdofsDepended) {
-                        if( vmimicdofformatDepended[mimicdofDepended.dofformatindex] == thisdofformat ) {
-                            throw OPENRAVE_EXCEPTION_FORMAT(_("joint %s depends on a mimic joint %s that also depends on %s; circular dependency!!!"),
-                                                            pjoint->GetName() % pjointDepended->GetName() % pjoint->GetName(), ORE_Failed);
-                        }
+    static void _WriteIndices(std::ostream& os, const std::vector<int>& vindices)
+    {
+        const uint32_t size = vindices.size();
+        const std::vector<int32_t> vdata(vindices.begin(), vindices.end());
+        os.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        if( size > 0 ) {
+            os.write(reinterpret_cast<const char*>(&vdata[0]), size*sizeof(int32_t));
+        }
+    }
 
-                        // TGN: Since Mimic::_vmimicdofs only contains active joints (c.f. KinBody::Joint::SetMimicEquations),
-                        // when computing partial/total derivatives by chain rule, we shall use Mimic::_vdofformat
-                        Mimic::DOFHierarchy h;
-                        h.dofformatindex = idofformat; ///< index in vdofformat
-                        h.dofindex = mimicdofDepended.dofindex; // >= 0, dofindex of active joint
-                        if( find(vmimicdofs.begin(), vmimicdofs.end(), h) == vmimicdofs.end() ) {
-                            vmimicdofs.push_back(h);
-                            bchanged = true;
-                        }
-                    }
-                }
+    static bool _ReadIndexLists(std::istream& is, uint64_t filesize, std::vector< std::vector<int> >& vlists)
+    {
+        uint32_t size = 0;
+        is.read(reinterpret_cast<char*>(&size), sizeof(size));
+        // every list has at least its size
+        if( !is || size > _GetRemainingBytes(is, filesize)/sizeof(uint32_t) ) {
+            return false;
+        }
+        vlists.resize(size);
+        FOREACH(itlist, vlists) {
+            if( !_ReadIndices(is, filesize, *itlist) ) {
+                return false;
             }
         }
+        return true;
     }
-    catch(const std::exception& ex) {
-        RAVELOG_ERROR(str(boost::format("failed to set mimic equations on kinematics body %s: %s\n")%GetName()%ex.what()));
-        for(int bPassiveJoints = 0; bPassiveJoints < 2; ++bPassiveJoints) { // simulate false/true
-            const std::vector<JointPtr>& vjoints = bPassiveJoints ? _vPassiveJoints : _vecjoints;
-            for(const JointPtr& pjoint : vjoints) {
-                const int ndof = pjoint->GetDOF();
-                for(int idof = 0; idof < ndof; ++idof) {
-                    pjoint->_vmimic[idof].reset();
+
+    static void _WriteIndexLists(std::ostream& os, const std::vector< std::vector<int> >& vlists)
+    {
+        const uint32_t size = vlists.size();
+        os.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        FOREACHC(itlist, vlists) {
+            _WriteIndices(os, *itlist);
+        }
+    }
+
+    /// \brief the file holds the magic, the key and the raw index arrays, so reading it is only a few memory copies. The sizes of the arrays are checked against the file size.
+    static HierarchySnapshotPtr _Read(const std::string& filename, const std::string& key)
+    {
+        std::ifstream ifs(filename.c_str(), std::ios::binary);
+        if( !ifs ) {
+            return HierarchySnapshotPtr();
+        }
+        ifs.seekg(0, std::ios::end);
+        const std::streamoff filesizeoff = ifs.tellg();
+        ifs.seekg(0, std::ios::beg);
+        if( !ifs || filesizeoff < 0 ) {
+            return HierarchySnapshotPtr();
+        }
+        const uint64_t filesize = filesizeoff;
+        char magic[sizeof(s_hierarchySnapshotMagic)];
+        ifs.read(magic, sizeof(magic));
+        std::string storedkey(key.size(), '\0');
+        if( !!ifs && storedkey.size() > 0 ) {
+            ifs.read(&storedkey[0], storedkey.size());
+        }
+        if( !ifs || std::memcmp(magic, s_hierarchySnapshotMagic, sizeof(magic)) != 0 || storedkey != key ) {
+            return HierarchySnapshotPtr();
+        }
+        HierarchySnapshotPtr psnapshot(new HierarchySnapshot());
+        std::vector<int> vshortestpaths;
+        if( !_ReadIndices(ifs, filesize, vshortestpaths) || (vshortestpaths.size()%2) != 0 ) {
+            return HierarchySnapshotPtr();
+        }
+        psnapshot->vAllPairsShortestPaths.resize(vshortestpaths.size()/2);
+        for(size_t i = 0; i < psnapshot->vAllPairsShortestPaths.size(); ++i) {
+            psnapshot->vAllPairsShortestPaths[i] = std::pair<int16_t,int16_t>(vshortestpaths[2*i], vshortestpaths[2*i+1]);
+        }
+        if( !_ReadIndexLists(ifs, filesize, psnapshot->vLinkParentLinks) || !_ReadIndexLists(ifs, filesize, psnapshot->vLinkPathLinks) || !_ReadIndices(ifs, filesize, psnapshot->vLinkDepths) || !_ReadIndices(ifs, filesize, psnapshot->vTopologicallySortedJointIndicesAll) || !_ReadIndexLists(ifs, filesize, psnapshot->vClosedLoops) ) {
+            return HierarchySnapshotPtr();
+        }
+        return psnapshot;
+    }
+
+    static void _Write(const std::string& filename, const std::string& key, const HierarchySnapshot& snapshot)
+    {
+        std::vector<int> vshortestpaths;
+        vshortestpaths.reserve(2*snapshot.vAllPairsShortestPaths.size());
+        FOREACHC(itpair, snapshot.vAllPairsShortestPaths) {
+            vshortestpaths.push_back(itpair->first);
+            vshortestpaths.push_back(itpair->second);
+        }
+        const std::string tempfilename = utils::GetTemporaryFilename(filename);
+        try {
+            boost::filesystem::create_directories(boost::filesystem::path(filename).parent_path());
+            {
+                std::ofstream ofs(tempfilename.c_str(), std::ios::binary|std::ios::trunc);
+                if( !ofs ) {
+                    return;
+                }
+                ofs.write(s_hierarchySnapshotMagic, sizeof(s_hierarchySnapshotMagic));
+                ofs.write(key.c_str(), key.size());
+                _WriteIndices(ofs, vshortestpaths);
+                _WriteIndexLists(ofs, snapshot.vLinkParentLinks);
+                _WriteIndexLists(ofs, snapshot.vLinkPathLinks);
+                _WriteIndices(ofs, snapshot.vLinkDepths);
+                _WriteIndices(ofs, snapshot.vTopologicallySortedJointIndicesAll);
+                _WriteIndexLists(ofs, snapshot.vClosedLoops);
+                if( !ofs ) {
+                    ofs.close();
+                    boost::filesystem::remove(tempfilename);
+                    return;
                 }
             }
+            // rename is atomic, so concurrent processes never read a partially written file
+            boost::filesystem::rename(tempfilename, filename);
+        }
+        catch(const boost::filesystem::filesystem_error& ex) {
+            RAVELOG_DEBUG_FORMAT("failed to write kinbody hierarchy snapshot %s: %s", filename%ex.what());
         }
     }
+#endif
+};
 
-    _vTopologicallySortedJoints.resize(0);
-    _vTopologicallySortedJointsAll.resize(0);
-    _vTopologicallySortedJointIndicesAll.resize(0);
-    _vJointsAffectingLinks.resize(_vecjoints.size()*_veclinks.size());
+std::string KinBody::_GetHierarchySnapshotKey() const
+{
+    // the joint transforms are part of the kinematics serialization, so the key is stricter than the topology that the snapshot depends on
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(SERIALIZATION_PRECISION);
+    ss << OPENRAVE_VERSION_STRING << " ";
+    serialize(ss, SO_Kinematics);
+    FOREACHC(itlink, _veclinks) {
+        ss << (*itlink)->GetName() << " " << (int)(*itlink)->IsStatic() << " ";
+    }
+    FOREACHC(itjoint, _vecjoints) {
+        ss << (*itjoint)->GetName() << " ";
+    }
+    FOREACHC(itpassive, _vPassiveJoints) {
+        ss << (*itpassive)->GetName() << " ";
+    }
+    return utils::GetMD5HashString(ss.str());
+}
 
+void KinBody::_ComputeHierarchySnapshot(HierarchySnapshot& snapshot) const
+{
     // compute the all-pairs shortest paths
     {
-        _vAllPairsShortestPaths.resize(_veclinks.size()*_veclinks.size());
-        FOREACH(it,_vAllPairsShortestPaths) {
+        snapshot.vAllPairsShortestPaths.resize(_veclinks.size()*_veclinks.size());
+        FOREACH(it,snapshot.vAllPairsShortestPaths) {
             it->first = -1;
             it->second = -1;
         }
@@ -4328,10 +4417,10 @@ void KinBody::_ComputeInternalInformation()
         FOREACHC(itjoint,_vecjoints) {
             if( !!(*itjoint)->GetFirstAttached() && !!(*itjoint)->GetSecondAttached() ) {
                 int index = (*itjoint)->GetFirstAttached()->GetIndex()*_veclinks.size()+(*itjoint)->GetSecondAttached()->GetIndex();
-                _vAllPairsShortestPaths[index] = std::pair<int16_t,int16_t>((*itjoint)->GetFirstAttached()->GetIndex(),(*itjoint)->GetJointIndex());
+                snapshot.vAllPairsShortestPaths[index] = std::pair<int16_t,int16_t>((*itjoint)->GetFirstAttached()->GetIndex(),(*itjoint)->GetJointIndex());
                 vcosts[index] = 1;
                 index = (*itjoint)->GetSecondAttached()->GetIndex()*_veclinks.size()+(*itjoint)->GetFirstAttached()->GetIndex();
-                _vAllPairsShortestPaths[index] = std::pair<int16_t,int16_t>((*itjoint)->GetSecondAttached()->GetIndex(),(*itjoint)->GetJointIndex());
+                snapshot.vAllPairsShortestPaths[index] = std::pair<int16_t,int16_t>((*itjoint)->GetSecondAttached()->GetIndex(),(*itjoint)->GetJointIndex());
                 vcosts[index] = 1;
             }
         }
@@ -4339,10 +4428,10 @@ void KinBody::_ComputeInternalInformation()
         FOREACHC(passive,_vPassiveJoints) {
             if( !!(*passive)->GetFirstAttached() && !!(*passive)->GetSecondAttached() ) {
                 int index = (*passive)->GetFirstAttached()->GetIndex()*_veclinks.size()+(*passive)->GetSecondAttached()->GetIndex();
-                _vAllPairsShortestPaths[index] = std::pair<int16_t,int16_t>((*passive)->GetFirstAttached()->GetIndex(),jointindex);
+                snapshot.vAllPairsShortestPaths[index] = std::pair<int16_t,int16_t>((*passive)->GetFirstAttached()->GetIndex(),jointindex);
                 vcosts[index] = 1;
                 index = (*passive)->GetSecondAttached()->GetIndex()*_veclinks.size()+(*passive)->GetFirstAttached()->GetIndex();
-                _vAllPairsShortestPaths[index] = std::pair<int16_t,int16_t>((*passive)->GetSecondAttached()->GetIndex(),jointindex);
+                snapshot.vAllPairsShortestPaths[index] = std::pair<int16_t,int16_t>((*passive)->GetSecondAttached()->GetIndex(),jointindex);
                 vcosts[index] = 1;
             }
             ++jointindex;
@@ -4359,15 +4448,20 @@ void KinBody::_ComputeInternalInformation()
                     uint32_t kcost = vcosts[k*_veclinks.size()+i] + vcosts[j*_veclinks.size()+k];
                     if( vcosts[j*_veclinks.size()+i] > kcost ) {
                         vcosts[j*_veclinks.size()+i] = kcost;
-                        _vAllPairsShortestPaths[j*_veclinks.size()+i] = _vAllPairsShortestPaths[k*_veclinks.size()+i];
+                        snapshot.vAllPairsShortestPaths[j*_veclinks.size()+i] = snapshot.vAllPairsShortestPaths[k*_veclinks.size()+i];
                     }
                 }
             }
         }
     }
 
-    // Use the APAC algorithm to initialize the kinematics hierarchy: _vTopologicallySortedJoints, _vJointsAffectingLinks, Link::_vParentLinks.
+    // Use the APAC algorithm to initialize the kinematics hierarchy: snapshot.vTopologicallySortedJointIndicesAll, snapshot.vLinkPathLinks, snapshot.vLinkParentLinks.
     // SIMOES, Ricardo. APAC: An exact algorithm for retrieving cycles and paths in all kinds of graphs. Tékhne, Dec. 2009, no.12, p.39-55. ISSN 1654-9911.
+    snapshot.vLinkParentLinks.resize(0); snapshot.vLinkParentLinks.resize(_veclinks.size());
+    snapshot.vLinkDepths.resize(0);
+    snapshot.vLinkPathLinks.resize(0); snapshot.vLinkPathLinks.resize(_veclinks.size());
+    snapshot.vTopologicallySortedJointIndicesAll.resize(0);
+    snapshot.vClosedLoops.resize(0);
     if((_veclinks.size() > 0)&&(_vecjoints.size() > 0)) {
         std::vector< std::vector<int> > vlinkadjacency(_veclinks.size());
         // joints with only one attachment are attached to a static link, which is attached to link 0
@@ -4440,21 +4534,28 @@ void KinBody::_ComputeInternalInformation()
             }
             S.pop_front();
         }
-        // fill each link's parent links
+        // fill each link's parent links and the links on its unique paths
         FOREACH(itlink,_veclinks) {
-            if( (*itlink)->GetIndex() > 0 && vuniquepaths.at((*itlink)->GetIndex()).size() == 0 ) {
-                RAVELOG_WARN(str(boost::format("_ComputeInternalInformation: %s has incomplete kinematics! link %s not connected to root %s")%GetName()%(*itlink)->GetName()%_veclinks.at(0)->GetName()));
-            }
+            std::vector<int>& vparentlinks = snapshot.vLinkParentLinks.at((*itlink)->GetIndex());
+            std::vector<int>& vpathlinks = snapshot.vLinkPathLinks.at((*itlink)->GetIndex());
             FOREACH(itpath, vuniquepaths.at((*itlink)->GetIndex())) {
                 OPENRAVE_ASSERT_OP(itpath->back(),==,(*itlink)->GetIndex());
                 int parentindex = *---- itpath->end();
-                if( find((*itlink)->_vParentLinks.begin(),(*itlink)->_vParentLinks.end(),parentindex) == (*itlink)->_vParentLinks.end() ) {
-                    (*itlink)->_vParentLinks.push_back(parentindex);
+                if( find(vparentlinks.begin(),vparentlinks.end(),parentindex) == vparentlinks.end() ) {
+                    vparentlinks.push_back(parentindex);
                 }
+                vpathlinks.insert(vpathlinks.end(), itpath->begin(), itpath->end());
             }
+            std::sort(vpathlinks.begin(), vpathlinks.end());
+            vpathlinks.erase(std::unique(vpathlinks.begin(), vpathlinks.end()), vpathlinks.end());
+        }
+        snapshot.vClosedLoops.reserve(closedloops.size());
+        FOREACHC(itclosedloop,closedloops) {
+            snapshot.vClosedLoops.emplace_back(itclosedloop->begin(), itclosedloop->end());
         }
         // find the link depths (minimum path length to the root)
-        vector<int> vlinkdepths(_veclinks.size(),-1);
+        std::vector<int>& vlinkdepths = snapshot.vLinkDepths;
+        vlinkdepths.resize(_veclinks.size(),-1);
         vlinkdepths.at(0) = 0;
         for(size_t i = 0; i < _veclinks.size(); ++i) {
             if( _veclinks[i]->IsStatic() ) {
@@ -4467,7 +4568,7 @@ void KinBody::_ComputeInternalInformation()
             FOREACH(itlink,_veclinks) {
                 if( vlinkdepths[(*itlink)->GetIndex()] == -1 ) {
                     int bestindex = -1;
-                    FOREACH(itparent, (*itlink)->_vParentLinks) {
+                    FOREACH(itparent, snapshot.vLinkParentLinks.at((*itlink)->GetIndex())) {
                         if( vlinkdepths[*itparent] >= 0 ) {
                             if( bestindex == -1 || (bestindex >= 0 && vlinkdepths[*itparent] < bestindex) ) {
                                 bestindex = vlinkdepths[*itparent]+1;
@@ -4482,150 +4583,390 @@ void KinBody::_ComputeInternalInformation()
             }
         }
 
+        // build up a directed graph of joint dependencies
+        int numjoints = (int)(_vecjoints.size()+_vPassiveJoints.size());
+        // build the adjacency list
+        vector<int> vjointadjacency(numjoints*numjoints,0);
+        for(int ij0 = 0; ij0 < numjoints; ++ij0) {
+            JointPtr j0 = ij0 < (int)_vecjoints.size() ? _vecjoints[ij0] : _vPassiveJoints[ij0-_vecjoints.size()];
+            bool bj0hasstatic = (!j0->GetFirstAttached() || j0->GetFirstAttached()->IsStatic()) || (!j0->GetSecondAttached() || j0->GetSecondAttached()->IsStatic());
+            // mimic joint sorting is the hardest limit
+            if( j0->IsMimic() ) {
+                for(int i = 0; i < j0->GetDOF(); ++i) {
+                    if(j0->IsMimic(i)) {
+                        FOREACH(itdofformat, j0->_vmimic[i]->_vdofformat) {
+                            if( itdofformat->dofindex < 0 ) {
+                                vjointadjacency[itdofformat->jointindex*numjoints+ij0] = 1;
+                            }
+                        }
+                    }
+                }
+            }
+
+            for(int ij1 = ij0+1; ij1 < numjoints; ++ij1) {
+                JointPtr j1 = ij1 < (int)_vecjoints.size() ? _vecjoints[ij1] : _vPassiveJoints[ij1-_vecjoints.size()];
+                bool bj1hasstatic = (!j1->GetFirstAttached() || j1->GetFirstAttached()->IsStatic()) || (!j1->GetSecondAttached() || j1->GetSecondAttached()->IsStatic());
+
+                // test if connected to world, next in priority to mimic joints
+                if( bj0hasstatic && bj1hasstatic ) {
+                    continue;
+                }
+                if( vjointadjacency[ij1*numjoints+ij0] || vjointadjacency[ij0*numjoints+ij1] ) {
+                    // already have an edge, so no reason to add any more
+                    continue;
+                }
+
+                // sort by link depth
+                int j0l0 = vlinkdepths[j0->GetFirstAttached()->GetIndex()];
+                int j0l1 = vlinkdepths[j0->GetSecondAttached()->GetIndex()];
+                int j1l0 = vlinkdepths[j1->GetFirstAttached()->GetIndex()];
+                int j1l1 = vlinkdepths[j1->GetSecondAttached()->GetIndex()];
+                int diff = min(j0l0,j0l1) - min(j1l0,j1l1);
+                if( diff < 0 ) {
+                    OPENRAVE_ASSERT_OP(min(j0l0,j0l1),<,100);
+                    vjointadjacency[ij0*numjoints+ij1] = 100-min(j0l0,j0l1);
+                    continue;
+                }
+                if( diff > 0 ) {
+                    OPENRAVE_ASSERT_OP(min(j1l0,j1l1),<,100);
+                    vjointadjacency[ij1*numjoints+ij0] = 100-min(j1l0,j1l1);
+                    continue;
+                }
+                diff = max(j0l0,j0l1) - max(j1l0,j1l1);
+                if( diff < 0 ) {
+                    OPENRAVE_ASSERT_OP(max(j0l0,j0l1),<,100);
+                    vjointadjacency[ij0*numjoints+ij1] = 100-max(j0l0,j0l1);
+                    continue;
+                }
+                if( diff > 0 ) {
+                    OPENRAVE_ASSERT_OP(max(j1l0,j1l1),<,100);
+                    vjointadjacency[ij1*numjoints+ij0] = 100-max(j1l0,j1l1);
+                    continue;
+                }
+            }
+        }
+        // topologically sort the joints
+        snapshot.vTopologicallySortedJointIndicesAll.resize(0); snapshot.vTopologicallySortedJointIndicesAll.reserve(numjoints);
+        std::list<int> noincomingedges;
+        for(int i = 0; i < numjoints; ++i) {
+            bool hasincoming = false;
+            for(int j = 0; j < numjoints; ++j) {
+                if( vjointadjacency[j*numjoints+i] ) {
+                    hasincoming = true;
+                    break;
+                }
+            }
+            if( !hasincoming ) {
+                noincomingedges.push_back(i);
+            }
+        }
+        bool bcontinuesorting = true;
+        while(bcontinuesorting) {
+            bcontinuesorting = false;
+            while(!noincomingedges.empty()) {
+                int n = noincomingedges.front();
+                noincomingedges.pop_front();
+                snapshot.vTopologicallySortedJointIndicesAll.push_back(n);
+                for(int i = 0; i < numjoints; ++i) {
+                    if( vjointadjacency[n*numjoints+i] ) {
+                        vjointadjacency[n*numjoints+i] = 0;
+                        bool hasincoming = false;
+                        for(int j = 0; j < numjoints; ++j) {
+                            if( vjointadjacency[j*numjoints+i] ) {
+                                hasincoming = true;
+                                break;
+                            }
+                        }
+                        if( !hasincoming ) {
+                            noincomingedges.push_back(i);
+                        }
+                    }
+                }
+            }
+
+            // go backwards so we prioritize moving joints towards the end rather than the beginning (not a formal heurstic)
+            int imaxadjind = vjointadjacency[numjoints*numjoints-1];
+            for(int ijoint = numjoints*numjoints-1; ijoint >= 0; --ijoint) {
+                if( vjointadjacency[ijoint] > vjointadjacency[imaxadjind] ) {
+                    imaxadjind = ijoint;
+                }
+            }
+            if( vjointadjacency[imaxadjind] != 0 ) {
+                bcontinuesorting = true;
+                int ifirst = imaxadjind/numjoints;
+                int isecond = imaxadjind%numjoints;
+                if( vjointadjacency[imaxadjind] <= 2 ) { // level 1 - static constraint violated, level 2 - mimic constraint
+                    JointPtr pji = ifirst < (int)_vecjoints.size() ? _vecjoints[ifirst] : _vPassiveJoints.at(ifirst-_vecjoints.size());
+                    JointPtr pjj = isecond < (int)_vecjoints.size() ? _vecjoints[isecond] : _vPassiveJoints.at(isecond-_vecjoints.size());
+                    RAVELOG_WARN(str(boost::format("cannot sort joints topologically %d for robot %s joints %s:%s!! forward kinematics might be buggy\n")%vjointadjacency[imaxadjind]%GetName()%pji->GetName()%pjj->GetName()));
+                }
+                // remove this edge
+                vjointadjacency[imaxadjind] = 0;
+                bool hasincoming = false;
+                for(int j = 0; j < numjoints; ++j) {
+                    if( vjointadjacency[j*numjoints+isecond] ) {
+                        hasincoming = true;
+                        break;
+                    }
+                }
+                if( !hasincoming ) {
+                    noincomingedges.push_back(isecond);
+                }
+            }
+        }
+        OPENRAVE_ASSERT_OP((int)snapshot.vTopologicallySortedJointIndicesAll.size(),==,numjoints);
+    }
+}
+
+void KinBody::_ComputeInternalInformation()
+{
+    uint64_t starttime = utils::GetMicroTime();
+    _nHierarchyComputed = 1;
+
+    _vLinkTransformPointers.clear();
+    if( !!_pCurrentKinematicsFunctions ) {
+        RAVELOG_DEBUG_FORMAT("env=%d, resetting custom kinematics functions for body %s", GetEnv()->GetId()%GetName());
+        _pCurrentKinematicsFunctions.reset();
+    }
+
+    int lindex=0;
+    FOREACH(itlink,_veclinks) {
+        (*itlink)->_index = lindex; // always reset, necessary since index cannot be initialized by custom links
+        (*itlink)->_vParentLinks.clear();
+        if((_veclinks.size() > 1)&&((*itlink)->GetName().size() == 0)) {
+            RAVELOG_WARN(str(boost::format("%s link index %d has no name")%GetName()%lindex));
+        }
+        lindex++;
+    }
+
+    {
+        // move any enabled passive joints to the regular joints list
+        vector<JointPtr>::iterator itjoint = _vPassiveJoints.begin();
+        while(itjoint != _vPassiveJoints.end()) {
+            bool bmimic = false;
+            for(int idof = 0; idof < (*itjoint)->GetDOF(); ++idof) {
+                if( !!(*itjoint)->_vmimic[idof] ) {
+                    bmimic = true;
+                }
+            }
+            if( !bmimic && (*itjoint)->_info._bIsActive ) {
+                _vecjoints.push_back(*itjoint);
+                itjoint = _vPassiveJoints.erase(itjoint);
+            }
+            else {
+                ++itjoint;
+            }
+        }
+        // move any mimic joints to the passive joints
+        itjoint = _vecjoints.begin();
+        while(itjoint != _vecjoints.end()) {
+            bool bmimic = false;
+            for(int idof = 0; idof < (*itjoint)->GetDOF(); ++idof) {
+                if( !!(*itjoint)->_vmimic[idof] ) {
+                    bmimic = true;
+                    break;
+                }
+            }
+            if( bmimic || !(*itjoint)->_info._bIsActive ) {
+                _vPassiveJoints.push_back(*itjoint);
+                itjoint = _vecjoints.erase(itjoint);
+            }
+            else {
+                ++itjoint;
+            }
+        }
+        int jointindex=0;
+        int dofindex=0;
+        FOREACH(itvjoint,_vecjoints) {
+            (*itvjoint)->jointindex = jointindex++;
+            (*itvjoint)->dofindex = dofindex;
+            (*itvjoint)->_info._bIsActive = true;
+            dofindex += (*itvjoint)->GetDOF();
+        }
+        FOREACH(passive,_vPassiveJoints) {
+            (*passive)->jointindex = -1;
+            (*passive)->dofindex = -1;
+            (*passive)->_info._bIsActive = false;
+        }
+    }
+
+    vector<size_t> vorder(_vecjoints.size());
+    vector<int> vJointIndices(_vecjoints.size());
+    _vDOFIndices.resize(GetDOF());
+    for(size_t i = 0; i < _vecjoints.size(); ++i) {
+        vJointIndices[i] = _vecjoints[i]->dofindex;
+        for(int idof = 0; idof < _vecjoints[i]->GetDOF(); ++idof) {
+            _vDOFIndices.at(vJointIndices[i]+idof) = i;
+        }
+        vorder[i] = i;
+    }
+    sort(vorder.begin(), vorder.end(), utils::index_cmp<vector<int>&>(vJointIndices));
+    _vDOFOrderedJoints.resize(0);
+    FOREACH(index,vorder) {
+        _vDOFOrderedJoints.push_back(_vecjoints.at(*index));
+    }
+
+    try {
+        // initialize all the mimic equations
+        for(int bPassiveJoints = 0; bPassiveJoints < 2; ++bPassiveJoints) { // simulate false/true
+            const std::vector<JointPtr>& vjoints = bPassiveJoints ? _vPassiveJoints : _vecjoints;
+            for(const JointPtr& pjoint : vjoints) {
+                const int ndof = pjoint->GetDOF();
+                const boost::array<MimicPtr, 3>& vmimic = pjoint->_vmimic;
+                for(int idof = 0; idof < ndof; ++idof) {
+                    const MimicPtr& pmimic = vmimic[idof];
+                    if( !!pmimic ) {
+                        const std::string poseq = pmimic->_equations[0];
+                        const std::string veleq = pmimic->_equations[1];
+                        const std::string acceleq = pmimic->_equations[2]; // have to copy since memory can become invalidated
+                        pjoint->SetMimicEquations(idof, poseq, veleq, acceleq);
+                    }
+                }
+            }
+        }
+
+        // fill Mimic::_vmimicdofs, check that there are no circular dependencies between the mimic joints
+        const int nActiveJoints = _vecjoints.size();
+        std::map<Mimic::DOFFormat, MimicPtr> mapmimic; ///< collects if thisdofformat.jointaxis depends on a mimic joint
+        for(int bPassiveJoints = 0; bPassiveJoints < 2; ++bPassiveJoints) { // simulate false/true
+            const std::vector<JointPtr>& vjoints = bPassiveJoints ? _vPassiveJoints : _vecjoints;
+            const int njoints = vjoints.size();
+            for(int ijoint = 0; ijoint < njoints; ++ijoint) {
+                const JointPtr& pjoint = vjoints[ijoint];
 
-        if( IS_DEBUGLEVEL(Level_Verbose) ) {
-            FOREACH(itlink, _veclinks) {
-                std::stringstream ss; ss << GetName() << ":" << (*itlink)->GetName() << " depth=" << vlinkdepths.at((*itlink)->GetIndex()) << ", parents=[";
-                FOREACHC(itparentlink, (*itlink)->_vParentLinks) {
-                    ss << _veclinks.at(*itparentlink)->GetName() << ", ";
+                Mimic::DOFFormat thisdofformat; ///< construct for pjoint
+                if( bPassiveJoints ) {
+                    thisdofformat.dofindex   = -1; ///< mimic dofindex = -1, ...
+                    thisdofformat.jointindex = ijoint + nActiveJoints; ///< but has a generalized joint index
+                }
+                else {
+                    thisdofformat.dofindex   = pjoint->GetDOFIndex();  ///< >= 0
+                    thisdofformat.jointindex = pjoint->GetJointIndex(); ///< in [0, nActiveJoints)
                 }
-                ss << "]";
-                RAVELOG_VERBOSE(ss.str());
-            }
-        }
 
-        // build up a directed graph of joint dependencies
-        int numjoints = (int)(_vecjoints.size()+_vPassiveJoints.size());
-        // build the adjacency list
-        vector<int> vjointadjacency(numjoints*numjoints,0);
-        for(int ij0 = 0; ij0 < numjoints; ++ij0) {
-            JointPtr j0 = ij0 < (int)_vecjoints.size() ? _vecjoints[ij0] : _vPassiveJoints[ij0-_vecjoints.size()];
-            bool bj0hasstatic = (!j0->GetFirstAttached() || j0->GetFirstAttached()->IsStatic()) || (!j0->GetSecondAttached() || j0->GetSecondAttached()->IsStatic());
-            // mimic joint sorting is the hardest limit
-            if( j0->IsMimic() ) {
-                for(int i = 0; i < j0->GetDOF(); ++i) {
-                    if(j0->IsMimic(i)) {
-                        FOREACH(itdofformat, j0->_vmimic[i]->_vdofformat) {
-                            if( itdofformat->dofindex < 0 ) {
-                                vjointadjacency[itdofformat->jointindex*numjoints+ij0] = 1;
+                const int ndof = pjoint->GetDOF();
+                const boost::array<MimicPtr, 3>& vmimic = pjoint->_vmimic;
+                for(int idof = 0; idof < ndof; ++idof) {
+                    const MimicPtr& pmimic = vmimic[idof]; // enumerate
+                    thisdofformat.axis = idof;
+                    if( !!pmimic ) {
+                        // only add if pjoint depends on mimic joints
+                        // TGN: Can an active joint depend on mimic joints??? If not, why need vjoints = _vecjoints?
+                        for(const Mimic::DOFFormat& dofformat : pmimic->_vdofformat) {
+                            const JointPtr pjointDepended = dofformat.GetJoint(*this);
+                            if( pjointDepended->IsMimic(dofformat.axis) ) {
+                                mapmimic[thisdofformat] = pmimic; ///< pjoint depends on pjointDepended
+                                RAVELOG_VERBOSE_FORMAT("mimic joint %s depends on mimic joint %s", pjoint->GetName() % pjointDepended->GetName());
+                                break;
                             }
                         }
                     }
                 }
             }
+        }
 
-            for(int ij1 = ij0+1; ij1 < numjoints; ++ij1) {
-                JointPtr j1 = ij1 < (int)_vecjoints.size() ? _vecjoints[ij1] : _vPassiveJoints[ij1-_vecjoints.size()];
-                bool bj1hasstatic = (!j1->GetFirstAttached() || j1->GetFirstAttached()->IsStatic()) || (!j1->GetSecondAttached() || j1->GetSecondAttached()->IsStatic());
+        bool bchanged = true;
+        while(bchanged) {
+            bchanged = false;
+            for(const std::pair<const Mimic::DOFFormat, MimicPtr>& keyvalue : mapmimic) {
+                const Mimic::DOFFormat& thisdofformat = keyvalue.first;
+                const MimicPtr& pmimic = keyvalue.second;
+                std::vector<Mimic::DOFHierarchy>& vmimicdofs = pmimic->_vmimicdofs; ///< to collect information of active joints on which pmimic depends on
+                const std::vector<Mimic::DOFFormat>& vdofformat = pmimic->_vdofformat; ///<  collected information of all joints on which pmimic depends on
 
-                // test if connected to world, next in priority to mimic joints
-                if( bj0hasstatic && bj1hasstatic ) {
-                    continue;
-                }
-                if( vjointadjacency[ij1*numjoints+ij0] || vjointadjacency[ij0*numjoints+ij1] ) {
-                    // already have an edge, so no reason to add any more
-                    continue;
-                }
+                const JointPtr pjoint = thisdofformat.GetJoint(*this); ///< pjoint depends on all [dofformat.GetJoint(*this) for dofformat in vdofformat]
+                const int ndofformat = vdofformat.size();
+                for(int idofformat = 0; idofformat < ndofformat; ++idofformat) {
+                    const Mimic::DOFFormat& dofformat = vdofformat[idofformat];
+                    const JointPtr pjointDepended = dofformat.GetJoint(*this);
+                    if( !mapmimic.count(dofformat) ) {
+                        continue; // this means pjointDepended depends on active joints only
+                    }
 
-                // sort by link depth
-                int j0l0 = vlinkdepths[j0->GetFirstAttached()->GetIndex()];
-                int j0l1 = vlinkdepths[j0->GetSecondAttached()->GetIndex()];
-                int j1l0 = vlinkdepths[j1->GetFirstAttached()->GetIndex()];
-                int j1l1 = vlinkdepths[j1->GetSecondAttached()->GetIndex()];
-                int diff = min(j0l0,j0l1) - min(j1l0,j1l1);
-                if( diff < 0 ) {
-                    OPENRAVE_ASSERT_OP(min(j0l0,j0l1),<,100);
-                    vjointadjacency[ij0*numjoints+ij1] = 100-min(j0l0,j0l1);
-                    continue;
-                }
-                if( diff > 0 ) {
-                    OPENRAVE_ASSERT_OP(min(j1l0,j1l1),<,100);
-                    vjointadjacency[ij1*numjoints+ij0] = 100-min(j1l0,j1l1);
-                    continue;
-                }
-                diff = max(j0l0,j0l1) - max(j1l0,j1l1);
-                if( diff < 0 ) {
-                    OPENRAVE_ASSERT_OP(max(j0l0,j0l1),<,100);
-                    vjointadjacency[ij0*numjoints+ij1] = 100-max(j0l0,j0l1);
-                    continue;
-                }
-                if( diff > 0 ) {
-                    OPENRAVE_ASSERT_OP(max(j1l0,j1l1),<,100);
-                    vjointadjacency[ij1*numjoints+ij0] = 100-max(j1l0,j1l1);
-                    continue;
+                    const MimicPtr& pmimicDepended = mapmimic.at(dofformat); // dofformat.jointindex depends on pmimicDepended
+                    const std::vector<Mimic::DOFHierarchy>&   vmimicdofsDepended = pmimicDepended->_vmimicdofs;
+                    const std::vector<Mimic::DOFFormat>& vmimicdofformatDepended = pmimicDepended->_vdofformat;
+
+                    for(const Mimic::DOFHierarchy& mimicdofDepended : vmimicdofsDepended) {
+                        if( vmimicdofformatDepended[mimicdofDepended.dofformatindex] == thisdofformat ) {
+                            throw OPENRAVE_EXCEPTION_FORMAT(_("joint %s depends on a mimic joint %s that also depends on %s; circular dependency!!!"),
+                                                            pjoint->GetName() % pjointDepended->GetName() % pjoint->GetName(), ORE_Failed);
+                        }
+
+                        // TGN: Since Mimic::_vmimicdofs only contains active joints (c.f. KinBody::Joint::SetMimicEquations),
+                        // when computing partial/total derivatives by chain rule, we shall use Mimic::_vdofformat
+                        Mimic::DOFHierarchy h;
+                        h.dofformatindex = idofformat; ///< index in vdofformat
+                        h.dofindex = mimicdofDepended.dofindex; // >= 0, dofindex of active joint
+                        if( find(vmimicdofs.begin(), vmimicdofs.end(), h) == vmimicdofs.end() ) {
+                            vmimicdofs.push_back(h);
+                            bchanged = true;
+                        }
+                    }
                 }
             }
         }
-        // topologically sort the joints
-        _vTopologicallySortedJointIndicesAll.resize(0); _vTopologicallySortedJointIndicesAll.reserve(numjoints);
-        std::list<int> noincomingedges;
-        for(int i = 0; i < numjoints; ++i) {
-            bool hasincoming = false;
-            for(int j = 0; j < numjoints; ++j) {
-                if( vjointadjacency[j*numjoints+i] ) {
-                    hasincoming = true;
-                    break;
+    }
+    catch(const std::exception& ex) {
+        RAVELOG_ERROR(str(boost::format("failed to set mimic equations on kinematics body %s: %s\n")%GetName()%ex.what()));
+        for(int bPassiveJoints = 0; bPassiveJoints < 2; ++bPassiveJoints) { // simulate false/true
+            const std::vector<JointPtr>& vjoints = bPassiveJoints ? _vPassiveJoints : _vecjoints;
+            for(const JointPtr& pjoint : vjoints) {
+                const int ndof = pjoint->GetDOF();
+                for(int idof = 0; idof < ndof; ++idof) {
+                    pjoint->_vmimic[idof].reset();
                 }
             }
-            if( !hasincoming ) {
-                noincomingedges.push_back(i);
-            }
         }
-        bool bcontinuesorting = true;
-        while(bcontinuesorting) {
-            bcontinuesorting = false;
-            while(!noincomingedges.empty()) {
-                int n = noincomingedges.front();
-                noincomingedges.pop_front();
-                _vTopologicallySortedJointIndicesAll.push_back(n);
-                for(int i = 0; i < numjoints; ++i) {
-                    if( vjointadjacency[n*numjoints+i] ) {
-                        vjointadjacency[n*numjoints+i] = 0;
-                        bool hasincoming = false;
-                        for(int j = 0; j < numjoints; ++j) {
-                            if( vjointadjacency[j*numjoints+i] ) {
-                                hasincoming = true;
-                                break;
-                            }
-                        }
-                        if( !hasincoming ) {
-                            noincomingedges.push_back(i);
-                        }
-                    }
-                }
-            }
+    }
 
-            // go backwards so we prioritize moving joints towards the end rather than the beginning (not a formal heurstic)
-            int imaxadjind = vjointadjacency[numjoints*numjoints-1];
-            for(int ijoint = numjoints*numjoints-1; ijoint >= 0; --ijoint) {
-                if( vjointadjacency[ijoint] > vjointadjacency[imaxadjind] ) {
-                    imaxadjind = ijoint;
-                }
+    _vTopologicallySortedJoints.resize(0);
+    _vTopologicallySortedJointsAll.resize(0);
+    _vTopologicallySortedJointIndicesAll.resize(0);
+    _vJointsAffectingLinks.resize(_vecjoints.size()*_veclinks.size());
+
+    // the topology dependent part of the hierarchy is shared between bodies with the same kinematics
+    HierarchySnapshotPtr psnapshot;
+    std::string snapshotkey;
+    uint64_t snapshotstarttime = utils::GetMicroTime();
+    if( _vecjoints.size() > 0 && HierarchySnapshot::IsCacheEnabled() ) {
+        snapshotkey = _GetHierarchySnapshotKey();
+        psnapshot = HierarchySnapshot::Find(snapshotkey, _veclinks.size(), _vecjoints.size()+_vPassiveJoints.size());
+        if( !!psnapshot ) {
+            RAVELOG_VERBOSE_FORMAT("env=%d, loaded hierarchy of %s in %f[s]", GetEnv()->GetId()%GetName()%(1e-6*(utils::GetMicroTime()-snapshotstarttime)));
+        }
+    }
+    if( !psnapshot ) {
+        psnapshot.reset(new HierarchySnapshot());
+        _ComputeHierarchySnapshot(*psnapshot);
+        RAVELOG_VERBOSE_FORMAT("env=%d, computed hierarchy of %s in %f[s]", GetEnv()->GetId()%GetName()%(1e-6*(utils::GetMicroTime()-snapshotstarttime)));
+        if( snapshotkey.size() > 0 ) {
+            HierarchySnapshot::Add(snapshotkey, psnapshot);
+        }
+    }
+    const HierarchySnapshot& snapshot = *psnapshot;
+    _vAllPairsShortestPaths = snapshot.vAllPairsShortestPaths;
+
+    if((_veclinks.size() > 0)&&(_vecjoints.size() > 0)) {
+        FOREACH(itlink,_veclinks) {
+            if( (*itlink)->GetIndex() > 0 && snapshot.vLinkPathLinks.at((*itlink)->GetIndex()).size() == 0 ) {
+                RAVELOG_WARN(str(boost::format("_ComputeInternalInformation: %s has incomplete kinematics! link %s not connected to root %s")%GetName()%(*itlink)->GetName()%_veclinks.at(0)->GetName()));
             }
-            if( vjointadjacency[imaxadjind] != 0 ) {
-                bcontinuesorting = true;
-                int ifirst = imaxadjind/numjoints;
-                int isecond = imaxadjind%numjoints;
-                if( vjointadjacency[imaxadjind] <= 2 ) { // level 1 - static constraint violated, level 2 - mimic constraint
-                    JointPtr pji = ifirst < (int)_vecjoints.size() ? _vecjoints[ifirst] : _vPassiveJoints.at(ifirst-_vecjoints.size());
-                    JointPtr pjj = isecond < (int)_vecjoints.size() ? _vecjoints[isecond] : _vPassiveJoints.at(isecond-_vecjoints.size());
-                    RAVELOG_WARN(str(boost::format("cannot sort joints topologically %d for robot %s joints %s:%s!! forward kinematics might be buggy\n")%vjointadjacency[imaxadjind]%GetName()%pji->GetName()%pjj->GetName()));
-                }
-                // remove this edge
-                vjointadjacency[imaxadjind] = 0;
-                bool hasincoming = false;
-                for(int j = 0; j < numjoints; ++j) {
-                    if( vjointadjacency[j*numjoints+isecond] ) {
-                        hasincoming = true;
-                        break;
-                    }
-                }
-                if( !hasincoming ) {
-                    noincomingedges.push_back(isecond);
+            (*itlink)->_vParentLinks = snapshot.vLinkParentLinks.at((*itlink)->GetIndex());
+        }
+        const std::vector<int>& vlinkdepths = snapshot.vLinkDepths;
+
+        if( IS_DEBUGLEVEL(Level_Verbose) ) {
+            FOREACH(itlink, _veclinks) {
+                std::stringstream ss; ss << GetName() << ":" << (*itlink)->GetName() << " depth=" << vlinkdepths.at((*itlink)->GetIndex()) << ", parents=[";
+                FOREACHC(itparentlink, (*itlink)->_vParentLinks) {
+                    ss << _veclinks.at(*itparentlink)->GetName() << ", ";
                 }
+                ss << "]";
+                RAVELOG_VERBOSE(ss.str());
             }
         }
-        OPENRAVE_ASSERT_OP((int)_vTopologicallySortedJointIndicesAll.size(),==,numjoints);
+        _vTopologicallySortedJointIndicesAll = snapshot.vTopologicallySortedJointIndicesAll;
         FOREACH(itindex,_vTopologicallySortedJointIndicesAll) {
             JointPtr pj = *itindex < (int)_vecjoints.size() ? _vecjoints[*itindex] : _vPassiveJoints.at(*itindex-_vecjoints.size());
             if( *itindex < (int)_vecjoints.size() ) {
@@ -4712,16 +5053,10 @@ void KinBody::_ComputeInternalInformation()
         // find out what links are affected by what joints.
         _vJointsAffectingLinks.assign( _vJointsAffectingLinks.size(), 0);
 
-        vector<int8_t> vusedlinks;
         for(int i = 0; i < (int)_veclinks.size(); ++i) {
-            vusedlinks.resize(0); vusedlinks.resize(_veclinks.size());
-            FOREACH(itpath,vuniquepaths[i]) {
-                FOREACH(itlink,*itpath) {
-                    vusedlinks[*itlink] = 1;
-                }
-            }
-            for(int j = 0; j < (int)_veclinks.size(); ++j) {
-                if( vusedlinks[j] &&(i != j)) {
+            FOREACHC(itpathlink,snapshot.vLinkPathLinks[i]) {
+                int j = *itpathlink;
+                if( i != j ) {
                     int jointindex = _vAllPairsShortestPaths[i*_veclinks.size()+j].second;
                     OPENRAVE_ASSERT_OP( jointindex, >=, 0 );
                     JointPtr pjoint = jointindex < (int)_vecjoints.size() ? _vecjoints[jointindex] : _vPassiveJoints.at(jointindex-_vecjoints.size());
@@ -4743,9 +5078,9 @@ void KinBody::_ComputeInternalInformation()
         }
 
         // process the closed loops, note that determining 'degrees of freedom' of the loop is very difficult and should be left to the 'fkfast' tool
-        _vClosedLoopIndices.resize(0); _vClosedLoopIndices.reserve(closedloops.size());
-        _vClosedLoops.resize(0); _vClosedLoops.reserve(closedloops.size());
-        FOREACH(itclosedloop,closedloops) {
+        _vClosedLoopIndices.resize(0); _vClosedLoopIndices.reserve(snapshot.vClosedLoops.size());
+        _vClosedLoops.resize(0); _vClosedLoops.reserve(snapshot.vClosedLoops.size());
+        FOREACHC(itclosedloop,snapshot.vClosedLoops) {
             _vClosedLoopIndices.push_back(vector< std::pair<int16_t, int16_t> >());
             _vClosedLoopIndices.back().reserve(itclosedloop->size());
             _vClosedLoops.push_back(vector< std::pair<LinkPtr, JointPtr> >());
@@ -5493,7 +5828,7 @@ private:
         for(size_t ind0 = 0; ind0 < _veclinks.size(); ++ind0) {
             for(size_t ind1 = ind0+1; ind1 < _veclinks.size(); ++ind1) {
                 const bool bAdjacent = AreAdjacentLinks(ind0, ind1);
-                if(!bAdjacent && !collisionchecker->CheckCollision(LinkConstPtr(_veclinks[ind0]), LinkConstPtr(_veclinks[ind1])) ) {
+                if(!bAdjacent && !AreNeverCollidingLinks(ind0, ind1) && !collisionchecker->CheckCollision(LinkConstPtr(_veclinks[ind0]), LinkConstPtr(_veclinks[ind1])) ) {
                     _vNonAdjacentLinks[0].push_back(ind0|(ind1<<16));
                 }
             }
@@ -5557,6 +5892,37 @@ void KinBody::SetAdjacentLinksPairs(const std::vector<std::pair<int, int> >& lin
     _ResetInternalCollisionCache();
 }
 
+void KinBody::SetNeverCollidingLinksPairs(const std::vector<std::pair<int, int> >& linkIndices)
+{
+    const int numLinks = GetLinks().size();
+    _vNeverCollidingLinks.clear();
+    _ResizeVectorFor2DTable(_vNeverCollidingLinks, numLinks);
+    for ( const std::pair<int, int>& link01 : linkIndices) {
+        OPENRAVE_ASSERT_OP(link01.first, !=, link01.second);
+        OPENRAVE_ASSERT_FORMAT(link01.first >= 0 && link01.first < numLinks && link01.second >= 0 && link01.second < numLinks, "body %s link pair (%d, %d) invalid (num links %d)", GetName()%link01.first%link01.second%numLinks, ORE_InvalidArguments);
+        _vNeverCollidingLinks.at(_GetIndex1d(link01.first, link01.second)) = 1;
+    }
+    _ResetInternalCollisionCache();
+}
+
+void KinBody::GetNeverCollidingLinksPairs(std::vector<std::pair<int, int> >& linkIndices) const
+{
+    linkIndices.clear();
+    for(int ind1 = 1; ind1 < (int)_veclinks.size(); ++ind1) {
+        for(int ind0 = 0; ind0 < ind1; ++ind0) {
+            if( AreNeverCollidingLinks(ind0, ind1) ) {
+                linkIndices.emplace_back(ind0, ind1);
+            }
+        }
+    }
+}
+
+bool KinBody::AreNeverCollidingLinks(int linkindex0, int linkindex1) const
+{
+    const size_t index = _GetIndex1d(linkindex0, linkindex1);
+    return index < _vNeverCollidingLinks.size() && _vNeverCollidingLinks[index];
+}
+
 void KinBody::SetAdjacentLinks(int linkindex0, int linkindex1)
 {
     OPENRAVE_ASSERT_OP(linkindex0,!=,linkindex1);
@@ -5598,18 +5964,48 @@ void KinBody::Clone(InterfaceBaseConstPtr preference, int cloningoptions)
     for (const LinkPtr& origLinkPtr : r->_veclinks) {
         LinkPtr pnewlink(new Link(shared_kinbody()));
         Link& newlink = *pnewlink;
-        // TODO should create a Link::Clone method
-        newlink = *origLinkPtr; // be careful of copying pointers
-        newlink._parent = shared_kinbody();
+
+        // trimeshes are immutable once cloned, so the clone keeps the same buffer instead of its own copy of the mesh
+        std::vector<TriMeshBufferConstPtr> vmeshbuffers(origLinkPtr->_vGeometries.size());
+        bool bSharedMesh = false;
+        for(size_t igeom = 0; igeom < vmeshbuffers.size(); ++igeom) {
+            const Link::Geometry& origgeometry = *origLinkPtr->_vGeometries[igeom];
+            if( origgeometry.GetType() == GT_TriMesh ) {
+                TriMeshBufferConstPtr pmeshbuffer = origgeometry._GetCollisionMeshBufferForClone();
+                if( pmeshbuffer->GetNumVertices() > 0 ) {
+                    vmeshbuffers[igeom] = pmeshbuffer;
+                    bSharedMesh = true;
+                }
+            }
+        }
 
         {
+            // pending meshes of the original are only filled while holding this mutex
+            std::lock_guard<std::mutex> lock(GetLazyGeometryMutex());
+            // TODO should create a Link::Clone method
+            newlink = *origLinkPtr; // be careful of copying pointers
+            newlink._parent = shared_kinbody();
+
             // have to copy all the geometries too!
             std::vector<Link::GeometryPtr> vnewgeometries(newlink._vGeometries.size());
             for(size_t igeom = 0; igeom < vnewgeometries.size(); ++igeom) {
                 vnewgeometries[igeom].reset(new Link::Geometry(pnewlink, newlink._vGeometries[igeom]->_info));
+                if( !!vmeshbuffers[igeom] ) {
+                    vnewgeometries[igeom]->_info._meshcollision = TriMesh();
+                    vnewgeometries[igeom]->_pmeshcollisionbuffer = vmeshbuffers[igeom];
+                    vnewgeometries[igeom]->_bCollisionMeshShared = true;
+                }
+                else {
+                    vnewgeometries[igeom]->_bCollisionMeshPending = newlink._vGeometries[igeom]->_bCollisionMeshPending;
+                }
             }
             newlink._vGeometries = vnewgeometries;
         }
+        if( bSharedMesh ) {
+            // the combined mesh would duplicate the shared meshes, so only build it when someone asks for it
+            newlink._collision = TriMesh();
+            newlink._bCollisionDataPending = true;
+        }
         {
             // deep copy extra geometries as well, otherwise changing value of map in original map affects value of cloned map
             std::map< std::string, std::vector<GeometryInfoPtr> > newMapExtraGeometries;
@@ -5676,6 +6072,7 @@ void KinBody::Clone(InterfaceBaseConstPtr preference, int cloningoptions)
     _vAdjacentLinks = r->_vAdjacentLinks;
     _vInitialLinkTransformations = r->_vInitialLinkTransformations;
     _vForcedAdjacentLinks = r->_vForcedAdjacentLinks;
+    _vNeverCollidingLinks = r->_vNeverCollidingLinks;
     _vAllPairsShortestPaths = r->_vAllPairsShortestPaths;
     _vClosedLoopIndices = r->_vClosedLoopIndices;
     _vClosedLoops.resize(0); _vClosedLoops.reserve(r->_vClosedLoops.size());
@@ -5811,6 +6208,16 @@ void KinBody::Clone(InterfaceBaseConstPtr preference, int cloningoptions)
 void KinBody::_PostprocessChangedParameters(uint32_t parameters)
 {
     _nUpdateStampId++;
+    if( !!(parameters & Prop_LinkGeometry) ) {
+        for(const LinkPtr& plink : _veclinks) {
+            for(const Link::GeometryPtr& pgeometry : plink->_vGeometries) {
+                if( !pgeometry->_bCollisionMeshShared ) {
+                    // only a cache for cloning, the geometry owns its mesh
+                    boost::atomic_store(&pgeometry->_pmeshcollisionbuffer, TriMeshBufferConstPtr());
+                }
+            }
+        }
+    }
     if( _nHierarchyComputed == 1 ) {
         _nParametersChanged |= parameters;
         return;
@@ -5995,15 +6402,19 @@ void KinBody::_InitAndAddLink(LinkPtr plink)
 
     plink->_index = static_cast<int>(_veclinks.size());
     plink->_vGeometries.clear();
-    plink->_collision.vertices.clear();
-    plink->_collision.indices.clear();
     FOREACHC(itgeominfo,info._vgeometryinfos) {
         Link::GeometryPtr geom(new Link::Geometry(plink,**itgeominfo));
         if( geom->_info._meshcollision.vertices.size() == 0 ) { // try to avoid recomputing
-            geom->_info.InitCollisionMesh();
+            geom->_InitCollisionMeshOrDefer();
         }
         plink->_vGeometries.push_back(geom);
-        plink->_collision.Append(geom->GetCollisionMesh(),geom->GetTransform());
+    }
+    if( IsLazyGeometryEnabled() ) {
+        plink->_collision = TriMesh();
+        plink->_bCollisionDataPending = true;
+    }
+    else {
+        plink->_UpdateCollisionData();
     }
 
     FOREACH(it, info._mReadableInterfaces) {
@@ -154,7 +154,10 @@ bool KinBody::CheckSelfCollision(CollisionReportPtr report, CollisionCheckerBase
 
                 _vGrabbedBodies[indexGrabbed2]->ComputeListNonCollidingLinks();
 
-                const std::list<KinBody::LinkConstPtr>& nonCollidingLinks2 = _vGrabbedBodies[indexGrabbed2]->_listNonCollidingLinksWhenGrabbed;
+                const Grabbed& grabbed1 = *_vGrabbedBodies[indexGrabbed1];
+                const Grabbed& grabbed2 = *_vGrabbedBodies[indexGrabbed2];
+                const int envBodyIndex1 = grabbedBody1.GetEnvironmentBodyIndex();
+                const int envBodyIndex2 = grabbedBody2.GetEnvironmentBodyIndex();
 
                 for( const KinBody::LinkPtr& pGrabbedBody2Link : grabbedBody2.GetLinks() ) {
                     if( !pGrabbedBody2Link->IsEnabled() ) {
@@ -163,14 +166,14 @@ bool KinBody::CheckSelfCollision(CollisionReportPtr report, CollisionCheckerBase
                     // See if these two links were initially colliding. If they are, then no further
                     // check is need (as this link pair should be skipped).
                     // if the link is in nonCollidingLinks1, collision has already been checked.
-                    if( std::find(nonCollidingLinks1.begin(), nonCollidingLinks1.end(), pGrabbedBody2Link) != nonCollidingLinks1.end() ) {
+                    if( grabbed1.IsNonCollidingOtherGrabbedLink(envBodyIndex2, pGrabbedBody2Link->GetIndex()) ) {
                         continue;
                     }
                     for( const KinBody::LinkPtr& pGrabbedBody1Link : grabbedBody1.GetLinks() ) {
                         if( !pGrabbedBody1Link->IsEnabled() ) {
                             continue;
                         }
-                        if( std::find(nonCollidingLinks2.begin(), nonCollidingLinks2.end(), pGrabbedBody1Link) != nonCollidingLinks2.end() ) {
+                        if( grabbed2.IsNonCollidingOtherGrabbedLink(envBodyIndex1, pGrabbedBody1Link->GetIndex()) ) {
                             if( collisionchecker->CheckCollision(KinBody::LinkConstPtr(pGrabbedBody1Link),
                                                                  KinBody::LinkConstPtr(pGrabbedBody2Link),
                                                                  pusereport) ) {
@@ -1759,15 +1759,81 @@ uint8_t KinBody::GeometryInfo::GetSideWallExists() const
     return mask;
 }
 
+bool IsLazyGeometryEnabled()
+{
+    static const bool bLazyGeometry = []() {
+        const char* pOPENRAVE_LAZY_GEOMETRY = std::getenv("OPENRAVE_LAZY_GEOMETRY");
+        return !!pOPENRAVE_LAZY_GEOMETRY && std::string(pOPENRAVE_LAZY_GEOMETRY) == "1";
+    }();
+    return bLazyGeometry;
+}
+
+std::mutex& GetLazyGeometryMutex()
+{
+    static std::mutex s_mutexLazyGeometry;
+    return s_mutexLazyGeometry;
+}
+
 KinBody::Geometry::Geometry(KinBody::LinkPtr parent, const KinBody::GeometryInfo& info) : _parent(parent), _info(info)
 {
 }
 
+TriMeshBufferConstPtr KinBody::Geometry::GetCollisionMeshBuffer() const
+{
+    if( !_bCollisionMeshShared ) {
+        return TriMeshBufferConstPtr();
+    }
+    // the buffer is kept after the mesh is copied out of it, so it is valid even if another thread just did that
+    return boost::atomic_load(&_pmeshcollisionbuffer);
+}
+
+TriMeshBufferConstPtr KinBody::Geometry::_GetCollisionMeshBufferForClone() const
+{
+    TriMeshBufferConstPtr pmeshbuffer = boost::atomic_load(&_pmeshcollisionbuffer);
+    if( _bCollisionMeshShared ) {
+        return pmeshbuffer;
+    }
+    // the buffer of a geometry that owns its mesh is a cache, rebuild it if the mesh was replaced without notifying the body
+    if( !pmeshbuffer || pmeshbuffer->GetNumVertices() != _info._meshcollision.vertices.size() || pmeshbuffer->GetNumIndices() != _info._meshcollision.indices.size() ) {
+        pmeshbuffer.reset(new TriMeshBuffer(_info._meshcollision));
+        boost::atomic_store(&_pmeshcollisionbuffer, pmeshbuffer);
+    }
+    return pmeshbuffer;
+}
+
 bool KinBody::Geometry::InitCollisionMesh(float fTessellation)
 {
+    _bCollisionMeshPending = false;
     return _info.InitCollisionMesh(fTessellation);
 }
 
+void KinBody::Geometry::_InitCollisionMeshOrDefer()
+{
+    if( IsLazyGeometryEnabled() && _info._type != GT_TriMesh && _info._type != GT_None ) {
+        // most primitives are checked without their tessellation, so only build it when someone asks for the mesh
+        _info._meshcollision = TriMesh();
+        _bCollisionMeshPending = true;
+    }
+    else {
+        InitCollisionMesh();
+    }
+}
+
+void KinBody::Geometry::_InitPendingCollisionMesh() const
+{
+    std::lock_guard<std::mutex> lock(GetLazyGeometryMutex());
+    if( _bCollisionMeshShared ) {
+        // someone needs the editable mesh, so the clone stops relying on the shared buffer
+        boost::atomic_load(&_pmeshcollisionbuffer)->GetTriMesh(const_cast<TriMesh&>(_info._meshcollision));
+        _bCollisionMeshShared = false;
+    }
+    if( _bCollisionMeshPending ) {
+        // the tessellation is a cache of the primitive parameters, so building it does not change the geometry
+        const_cast<KinBody::GeometryInfo&>(_info).InitCollisionMesh();
+        _bCollisionMeshPending = false;
+    }
+}
+
 bool KinBody::Geometry::ComputeInnerEmptyVolume(Transform& tInnerEmptyVolume, Vector& abInnerEmptyExtents) const
 {
     return _info.ComputeInnerEmptyVolume(tInnerEmptyVolume, abInnerEmptyExtents);
@@ -1775,6 +1841,10 @@ bool KinBody::Geometry::ComputeInnerEmptyVolume(Transform& tInnerEmptyVolume, Ve
 
 AABB KinBody::Geometry::ComputeAABB(const Transform& t) const
 {
+    TriMeshBufferConstPtr pmeshbuffer = GetCollisionMeshBuffer();
+    if( !!pmeshbuffer ) {
+        return pmeshbuffer->ComputeAABB(t*_info._t);
+    }
     return _info.ComputeAABB(t);
 }
 
@@ -1784,7 +1854,13 @@ void KinBody::Geometry::serialize(std::ostream& o, int options) const
     o << (int)_info._type << " ";
     SerializeRound3(o,_info._vRenderScale);
     if( _info._type == GT_TriMesh ) {
-        _info._meshcollision.serialize(o,options);
+        TriMeshBufferConstPtr pmeshbuffer = GetCollisionMeshBuffer();
+        if( !!pmeshbuffer ) {
+            pmeshbuffer->serialize(o,options);
+        }
+        else {
+            _info._meshcollision.serialize(o,options);
+        }
     }
     else {
         SerializeRound3(o,_info._vGeomData);
@@ -1810,6 +1886,9 @@ void KinBody::Geometry::SetCollisionMesh(const TriMesh& mesh)
     OPENRAVE_ASSERT_FORMAT0(_info._bModifiable, "geometry cannot be modified", ORE_Failed);
     LinkPtr parent(_parent);
     _info._meshcollision = mesh;
+    _bCollisionMeshPending = false;
+    _bCollisionMeshShared = false;
+    boost::atomic_store(&_pmeshcollisionbuffer, TriMeshBufferConstPtr());
     // _info._modifiedFields; change??
     parent->_Update();
 }
@@ -2001,6 +2080,7 @@ void KinBody::Geometry::UpdateInfo()
 
 void KinBody::Geometry::ExtractInfo(KinBody::GeometryInfo& info) const
 {
+    GetCollisionMesh(); // extracted infos always have the tessellation
     info = _info;
     info._modifiedFields = 0;
 }
@@ -2073,7 +2153,7 @@ UpdateFromInfoResult KinBody::Geometry::UpdateFromInfo(const KinBody::GeometryIn
         }
     }
     else if (GetType() == GT_TriMesh) {
-        if( info.IsModifiedField(KinBody::GeometryInfo::GIF_Mesh) && info._meshcollision != _info._meshcollision ) {
+        if( info.IsModifiedField(KinBody::GeometryInfo::GIF_Mesh) && info._meshcollision != GetCollisionMesh() ) {
             RAVELOG_VERBOSE_FORMAT("geometry %s trimesh changed", _info._id);
             return UFIR_RequireReinitialize;
         }
@@ -60,6 +60,45 @@ void Grabbed::AddMoreIgnoreLinks(const std::set<int>& setAdditionalGrabberLinksT
     }
 }
 
+void Grabbed::_SetLinkNonCollidingIsValid(bool bIsValid)
+{
+    _listNonCollidingIsValid = bIsValid;
+    if( bIsValid ) {
+        _UpdateNonCollidingLinksMasks();
+    }
+}
+
+void Grabbed::_UpdateNonCollidingLinksMasks()
+{
+    const KinBody* pGrabber = _pGrabbingLink->GetParent(true).get();
+    _mapNonCollidingOtherGrabbedLinksMask.clear();
+    for( const KinBody::LinkConstPtr& pLink : _listNonCollidingLinksWhenGrabbed ) {
+        KinBodyPtr pLinkParent = pLink->GetParent(true);
+        if( !pLinkParent ) {
+            continue;
+        }
+        if( pLinkParent.get() != pGrabber && pLinkParent->GetEnvironmentBodyIndex() > 0 ) {
+            _SetLinkInMask(_mapNonCollidingOtherGrabbedLinksMask[pLinkParent->GetEnvironmentBodyIndex()], pLink->GetIndex());
+        }
+    }
+}
+
+void Grabbed::_RemoveNonCollidingOtherGrabbedLinks(KinBodyConstPtr pOtherGrabbedBody)
+{
+    if( !!pOtherGrabbedBody && _listNonCollidingIsValid && _mapNonCollidingOtherGrabbedLinksMask.erase(pOtherGrabbedBody->GetEnvironmentBodyIndex()) == 0 ) {
+        // none of its links are in the list
+        return;
+    }
+    for (std::list<KinBody::LinkConstPtr>::iterator itlink = _listNonCollidingLinksWhenGrabbed.begin(); itlink != _listNonCollidingLinksWhenGrabbed.end();) {
+        if( (*itlink)->GetParent() == pOtherGrabbedBody ) {
+            itlink = _listNonCollidingLinksWhenGrabbed.erase(itlink);
+        }
+        else {
+            ++itlink;
+        }
+    }
+}
+
 void Grabbed::ComputeListNonCollidingLinks()
 {
     if( _listNonCollidingIsValid ) {
@@ -185,7 +224,7 @@ void Grabbed::ComputeListNonCollidingLinks()
         }
     }
 
-    _listNonCollidingIsValid = true;
+    _SetLinkNonCollidingIsValid(true);
     // if( 1 ) {
     //     std::stringstream ssdebug;
     //     ssdebug << "grabbedBody='" << pGrabbedBody->GetName() << "'; listNonCollidingLinks=[";
@@ -866,15 +905,7 @@ std::vector<GrabbedPtr>::iterator KinBody::_RemoveGrabbedBody(std::vector<Grabbe
     itGrabbed = _vGrabbedBodies.erase(itGrabbed);
     for( const GrabbedPtr& pOtherGrabbed : _vGrabbedBodies) {
         // _listNonCollidingLinksWhenGrabbed in other grabbed bodies might contain the body
-        std::list<LinkConstPtr>& listNonCollidingLinksWhenGrabbed = pOtherGrabbed->_listNonCollidingLinksWhenGrabbed;
-        for (std::list<LinkConstPtr>::iterator itlink = listNonCollidingLinksWhenGrabbed.begin(); itlink != listNonCollidingLinksWhenGrabbed.end();) {
-            if( (*itlink)->GetParent() == pgrabbedbody ) {
-                itlink = listNonCollidingLinksWhenGrabbed.erase(itlink);
-            }
-            else {
-                ++itlink;
-            }
-        }
+        pOtherGrabbed->_RemoveNonCollidingOtherGrabbedLinks(pgrabbedbody);
     }
     return itGrabbed;
 }
@@ -646,6 +646,8 @@ void KinBody::JointInfo::_DeserializeReadableInterface(const std::string& id, co
     if(itReadable != _mReadableInterfaces.end()) {
         pReadable = itReadable->second;
     }
+    // infos can be deserialized in parallel, but the registered readers do not have to be thread-safe
+    std::lock_guard<std::recursive_mutex> lock(GetJSONReaderMutex());
     BaseJSONReaderPtr pReader = RaveCallJSONReader(PT_KinBody, id, pReadable, AttributesList());
     if (!!pReader) {
         pReader->DeserializeJSON(rReadable, fUnitScale);
@@ -367,6 +367,8 @@ void KinBody::LinkInfo::_DeserializeReadableInterface(const std::string& id, con
     // NOTE: we use PT_KinBody (for now) for the following reasons:
     // 1. Link shares the same set of readable plugins as KinBody
     // 2. It might be confusing to add PT_Link since it is not an interface type
+    // infos can be deserialized in parallel, but the registered readers do not have to be thread-safe
+    std::lock_guard<std::recursive_mutex> lock(GetJSONReaderMutex());
     BaseJSONReaderPtr pReader = RaveCallJSONReader(PT_KinBody, id, pReadable, AttributesList());
     if (!!pReader) {
         pReader->DeserializeJSON(rReadable, fUnitScale);
@@ -742,7 +744,7 @@ void KinBody::Link::InitGeometries(std::vector<KinBody::GeometryInfoConstPtr>& g
             if( !bForceRecomputeMeshCollision ) {
                 RAVELOG_VERBOSE("geometry has empty collision mesh\n");
             }
-            _vGeometries[i]->InitCollisionMesh(); // have to initialize the mesh since some plugins might not understand all geometry types
+            _vGeometries[i]->_InitCollisionMeshOrDefer(); // have to initialize the mesh since some plugins might not understand all geometry types
         }
     }
     _info._mapExtraGeometries.clear();
@@ -767,7 +769,7 @@ void KinBody::Link::InitGeometries(std::list<KinBody::GeometryInfo>& geometries,
             if( !bForceRecomputeMeshCollision ) {
                 RAVELOG_VERBOSE("geometry has empty collision mesh\n");
             }
-            _vGeometries[i]->InitCollisionMesh(); // have to initialize the mesh since some plugins might not understand all geometry types
+            _vGeometries[i]->_InitCollisionMeshOrDefer(); // have to initialize the mesh since some plugins might not understand all geometry types
         }
         ++i;
     }
@@ -801,7 +803,7 @@ void KinBody::Link::SetGeometriesFromGroup(const std::string& groupname)
         _vGeometries[i].reset(new Geometry(shared_from_this(),*pvinfos->at(i)));
         if( _vGeometries[i]->GetCollisionMesh().vertices.size() == 0 ) {
             RAVELOG_VERBOSE("geometry has empty collision mesh\n");
-            _vGeometries[i]->InitCollisionMesh();
+            _vGeometries[i]->_InitCollisionMeshOrDefer();
         }
     }
     _Update();
@@ -871,7 +873,7 @@ void KinBody::Link::AddGeometry(KinBody::GeometryInfoPtr pginfo, bool addToGroup
     }
 
     _vGeometries.push_back(GeometryPtr(new Geometry(shared_from_this(),*pginfo)));
-    _vGeometries.back()->InitCollisionMesh();
+    _vGeometries.back()->_InitCollisionMeshOrDefer();
     _info._vgeometryinfos.push_back(pginfo);
     if( addToGroups ) {
         FOREACH(itgeometrygroup, _info._mapExtraGeometries) {
@@ -1180,6 +1182,21 @@ UpdateFromInfoResult KinBody::Link::UpdateFromInfo(const KinBody::LinkInfo& info
 }
 
 void KinBody::Link::_Update(bool parameterschanged, uint32_t extraParametersChanged)
+{
+    if( IsLazyGeometryEnabled() ) {
+        // the combined mesh duplicates all geometry meshes, so only build it when someone asks for it
+        _collision = TriMesh();
+        _bCollisionDataPending = true;
+    }
+    else {
+        _UpdateCollisionData();
+    }
+    if( parameterschanged || extraParametersChanged ) {
+        GetParent()->_PostprocessChangedParameters(Prop_LinkGeometry|extraParametersChanged);
+    }
+}
+
+void KinBody::Link::_UpdateCollisionData() const
 {
     // if there's only one trimesh geometry and it has identity offset, then copy it directly
     if( _vGeometries.size() == 1 && _vGeometries.at(0)->GetType() == GT_TriMesh && TransformDistanceFast(Transform(), _vGeometries.at(0)->GetTransform()) <= g_fEpsilonLinear ) {
@@ -1188,12 +1205,22 @@ void KinBody::Link::_Update(bool parameterschanged, uint32_t extraParametersChan
     else {
         _collision.vertices.resize(0);
         _collision.indices.resize(0);
-        FOREACH(itgeom,_vGeometries) {
+        FOREACHC(itgeom,_vGeometries) {
             _collision.Append((*itgeom)->GetCollisionMesh(),(*itgeom)->GetTransform());
         }
     }
-    if( parameterschanged || extraParametersChanged ) {
-        GetParent()->_PostprocessChangedParameters(Prop_LinkGeometry|extraParametersChanged);
+}
+
+void KinBody::Link::_InitPendingCollisionData() const
+{
+    // tessellate the geometries first since they take the same mutex
+    FOREACHC(itgeom,_vGeometries) {
+        (*itgeom)->GetCollisionMesh();
+    }
+    std::lock_guard<std::mutex> lock(GetLazyGeometryMutex());
+    if( _bCollisionDataPending ) {
+        _UpdateCollisionData();
+        _bCollisionDataPending = false;
     }
 }
 
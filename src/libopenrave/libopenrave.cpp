@@ -1397,6 +1397,12 @@ BaseJSONReaderPtr RaveCallJSONReader(InterfaceType type, const std::string& id,
     return RaveGlobal::instance()->CallJSONReader(type, id, pReadable, atts);
 }
 
+std::recursive_mutex& GetJSONReaderMutex()
+{
+    static std::recursive_mutex s_mutexJSONReader;
+    return s_mutexJSONReader;
+}
+
 std::string RaveFindLocalFile(const std::string& filename, const std::string& curdir)
 {
     return RaveGlobal::instance()->FindLocalFile(filename,curdir);
@@ -2368,6 +2374,91 @@ void TriMesh::serialize(std::ostream& o, int options) const
     }
 }
 
+TriMeshBuffer::TriMeshBuffer(const TriMesh& trimesh)
+{
+    _vertices.resize(3*trimesh.vertices.size());
+    for(size_t ivertex = 0; ivertex < trimesh.vertices.size(); ++ivertex) {
+        const Vector& v = trimesh.vertices[ivertex];
+        _vertices[3*ivertex+0] = v.x;
+        _vertices[3*ivertex+1] = v.y;
+        _vertices[3*ivertex+2] = v.z;
+    }
+    // the layout depends on the indices actually present, a mesh can list more vertices than it uses or have invalid indices
+    bool bIndices16 = true;
+    FOREACHC(itindex, trimesh.indices) {
+        if( *itindex < 0 || *itindex > 0xffff ) {
+            bIndices16 = false;
+            break;
+        }
+    }
+    if( bIndices16 ) {
+        _indices16.resize(trimesh.indices.size());
+        for(size_t iindex = 0; iindex < trimesh.indices.size(); ++iindex) {
+            _indices16[iindex] = (uint16_t)trimesh.indices[iindex];
+        }
+    }
+    else {
+        _indices32 = trimesh.indices;
+    }
+}
+
+void TriMeshBuffer::GetTriMesh(TriMesh& trimesh) const
+{
+    trimesh.vertices.resize(GetNumVertices());
+    for(size_t ivertex = 0; ivertex < trimesh.vertices.size(); ++ivertex) {
+        trimesh.vertices[ivertex] = GetVertex(ivertex);
+    }
+    if( HasIndices16() ) {
+        trimesh.indices.resize(_indices16.size());
+        for(size_t iindex = 0; iindex < _indices16.size(); ++iindex) {
+            trimesh.indices[iindex] = _indices16[iindex];
+        }
+    }
+    else {
+        trimesh.indices = _indices32;
+    }
+}
+
+AABB TriMeshBuffer::ComputeAABB(const Transform& t) const
+{
+    AABB ab;
+    if( _vertices.size() == 0 ) {
+        ab.pos = t.trans;
+        return ab;
+    }
+    Vector vmin, vmax;
+    vmin = vmax = t*GetVertex(0);
+    for(size_t ivertex = 1; ivertex < GetNumVertices(); ++ivertex) {
+        const Vector v = t*GetVertex(ivertex);
+        vmin.x = std::min(vmin.x, v.x);
+        vmin.y = std::min(vmin.y, v.y);
+        vmin.z = std::min(vmin.z, v.z);
+        vmax.x = std::max(vmax.x, v.x);
+        vmax.y = std::max(vmax.y, v.y);
+        vmax.z = std::max(vmax.z, v.z);
+    }
+    ab.extents = (dReal)0.5*(vmax-vmin);
+    ab.pos = (dReal)0.5*(vmax+vmin);
+    return ab;
+}
+
+size_t TriMeshBuffer::GetMemoryUsage() const
+{
+    return _vertices.size()*sizeof(dReal) + _indices16.size()*sizeof(uint16_t) + _indices32.size()*sizeof(int32_t);
+}
+
+void TriMeshBuffer::serialize(std::ostream& o, int options) const
+{
+    o << GetNumVertices() << " ";
+    for(size_t ivertex = 0; ivertex < GetNumVertices(); ++ivertex) {
+        SerializeRound3(o, GetVertex(ivertex));
+    }
+    o << GetNumIndices() << " ";
+    for(size_t iindex = 0; iindex < GetNumIndices(); ++iindex) {
+        o << GetIndex(iindex) << " ";
+    }
+}
+
 std::ostream& operator<<(std::ostream& O, const TriMesh& trimesh)
 {
     trimesh.serialize(O,0);
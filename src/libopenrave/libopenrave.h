@@ -52,6 +52,7 @@
 #include <string>
 #include <algorithm>
 #include <complex>
+#include <mutex>
 
 #define _MAKEDATA(n) __itend__ ## n
 #define MAKEDATA(n) _MAKEDATA(n)
@@ -308,6 +309,16 @@ int CallSetStateValuesFns(const std::vector< std::pair<PlannerBase::PlannerParam
 void CallGetStateFns(const std::vector< std::pair<PlannerBase::PlannerParameters::GetStateFn, int> >& vfunctions, int nDOF, int nMaxDOFForGroup, std::vector<dReal>& v);
 
 void subtractstates(std::vector<dReal>& q1, const std::vector<dReal>& q2);
+
+/// \brief true if OPENRAVE_LAZY_GEOMETRY=1, then collision meshes of primitive geometries and the collision data of links are only built when first requested
+bool IsLazyGeometryEnabled();
+
+/// \brief serializes building the meshes deferred by lazy geometry
+std::mutex& GetLazyGeometryMutex();
+
+/// \brief serializes calling the registered JSON readers, since infos can be deserialized in parallel
+std::recursive_mutex& GetJSONReaderMutex();
+
 /// -1 v1 is smaller than v2
 // 0 two vectors are equivalent
 /// +1 v1 is greater than v2
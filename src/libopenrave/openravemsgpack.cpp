@@ -22,6 +22,42 @@
 #include <msgpack.hpp>
 #include <rapidjson/document.h>
 
+/// \brief formats a msgpack timestamp extension as RFC 3339
+static std::string _FormatMsgPackTimestamp(const msgpack::object& o)
+{
+    const std::chrono::system_clock::time_point tp = o.as<std::chrono::system_clock::time_point>();
+    const std::time_t parsedTime = std::chrono::system_clock::to_time_t(tp);
+
+    // RFC 3339 Nano format
+    char formatted[sizeof("2006-01-02T15:04:05.999999999Z07:00")];
+
+    // The extension does not include timezone information. By convention, we format to local time.
+    struct tm datetime = {0};
+    std::size_t size = std::strftime(formatted, sizeof(formatted), "%FT%T", localtime_r(&parsedTime, &datetime));
+
+    // Add nanoseconds portion if present
+    const long nanoseconds = (std::chrono::duration_cast<chrono::nanoseconds>(tp.time_since_epoch()).count() % 1000000000 + 1000000000) % 1000000000;
+    if (nanoseconds != 0) {
+        size += sprintf(formatted + size, ".%09lu", nanoseconds);
+        // remove trailing zeros
+        while (formatted[size - 1] == '0') {
+            --size;
+        }
+    }
+    if (datetime.tm_gmtoff == 0) {
+        formatted[size] = 'Z';
+    } else {
+        size += std::strftime(formatted + size, sizeof(formatted) - size, "%z", &datetime);
+        // fix timezone format (0000 -> 00:00)
+        formatted[size] = formatted[size - 1];
+        formatted[size - 1] = formatted[size - 2];
+        formatted[size - 2] = ':';
+    }
+    formatted[++size] = '\0';
+
+    return std::string(formatted, size);
+}
+
 namespace msgpack {
 
 MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS) {
@@ -68,37 +104,8 @@ struct convert< rapidjson::GenericDocument<Encoding, Allocator, StackAllocator>
                 break;
             case msgpack::type::EXT: {
                 if (o.via.ext.type() == -1) {
-                    const std::chrono::system_clock::time_point tp = o.as<std::chrono::system_clock::time_point>();
-                    const std::time_t parsedTime = std::chrono::system_clock::to_time_t(tp);
-
-                    // RFC 3339 Nano format
-                    char formatted[sizeof("2006-01-02T15:04:05.999999999Z07:00")];
-
-                    // The extension does not include timezone information. By convention, we format to local time.
-                    struct tm datetime = {0};
-                    std::size_t size = std::strftime(formatted, sizeof(formatted), "%FT%T", localtime_r(&parsedTime, &datetime));
-
-                    // Add nanoseconds portion if present
-                    const long nanoseconds = (std::chrono::duration_cast<chrono::nanoseconds>(tp.time_since_epoch()).count() % 1000000000 + 1000000000) % 1000000000;
-                    if (nanoseconds != 0) {
-                        size += sprintf(formatted + size, ".%09lu", nanoseconds);
-                        // remove trailing zeros
-                        while (formatted[size - 1] == '0') {
-                            --size;
-                        }
-                    }
-                    if (datetime.tm_gmtoff == 0) {
-                        formatted[size] = 'Z';
-                    } else {
-                        size += std::strftime(formatted + size, sizeof(formatted) - size, "%z", &datetime);
-                        // fix timezone format (0000 -> 00:00)
-                        formatted[size] = formatted[size - 1];
-                        formatted[size - 1] = formatted[size - 2];
-                        formatted[size - 2] = ':';
-                    }
-                    formatted[++size] = '\0';
-
-                    v.SetString(formatted, size, v.GetAllocator());
+                    const std::string formatted = _FormatMsgPackTimestamp(o);
+                    v.SetString(formatted.c_str(), formatted.size(), v.GetAllocator());
                 } else {
                     RAVELOG_WARN("Unrecognized msgpack extension type.");
                 }
@@ -319,30 +326,379 @@ private:
 
 } // namespace msgpack
 
-void OpenRAVE::MsgPack::DumpMsgPack(const rapidjson::Value& value, std::ostream& os)
+namespace {
+
+/// \brief msgpack parser visitor that feeds the values into a rapidjson SAX handler.
+///
+/// Parsing through this visitor builds the rapidjson document directly from the buffer, without first unpacking the whole msgpack::object tree into a zone.
+template <typename Handler>
+class RapidJsonSaxVisitor : public msgpack::null_visitor
+{
+public:
+    RapidJsonSaxVisitor(Handler& handler) : _handler(handler) {
+    }
+
+    bool visit_nil() {
+        return _CheckNotKey("nil") && _handler.Null();
+    }
+    bool visit_boolean(bool v) {
+        return _CheckNotKey("boolean") && _handler.Bool(v);
+    }
+    bool visit_positive_integer(uint64_t v) {
+        if( _bInKey ) {
+            const std::string key = boost::lexical_cast<std::string>(v);
+            return _handler.Key(key.c_str(), key.size(), true);
+        }
+        return _handler.Uint64(v);
+    }
+    bool visit_negative_integer(int64_t v) {
+        if( _bInKey ) {
+            const std::string key = boost::lexical_cast<std::string>(v);
+            return _handler.Key(key.c_str(), key.size(), true);
+        }
+        return _handler.Int64(v);
+    }
+    bool visit_float32(float v) {
+        return _CheckNotKey("float") && _handler.Double(v);
+    }
+    bool visit_float64(double v) {
+        return _CheckNotKey("float") && _handler.Double(v);
+    }
+    bool visit_str(const char* v, uint32_t size) {
+        if( _bInKey ) {
+            return _handler.Key(v, size, true);
+        }
+        return _handler.String(v, size, true);
+    }
+    bool visit_bin(const char* v, uint32_t size) {
+        return visit_str(v, size);
+    }
+    bool visit_ext(const char* v, uint32_t size) {
+        // v[0] is the extension type followed by the data
+        if( size > 0 && static_cast<int8_t>(v[0]) == OpenRAVE::MsgPack::MSGPACK_EXT_TYPEDARRAY ) {
+            return _CheckNotKey("typed array") && _VisitTypedArray(v + 1, size - 1);
+        }
+        if( size > 0 && static_cast<int8_t>(v[0]) == -1 ) {
+            msgpack::object o;
+            o.type = msgpack::type::EXT;
+            o.via.ext.ptr = v;
+            o.via.ext.size = size - 1;
+            const std::string formatted = _FormatMsgPackTimestamp(o);
+            return visit_str(formatted.c_str(), formatted.size());
+        }
+        RAVELOG_WARN("Unrecognized msgpack extension type.");
+        return visit_nil();
+    }
+    bool start_array(uint32_t num_elements) {
+        _vContainerSizes.push_back(num_elements);
+        return _CheckNotKey("array") && _handler.StartArray();
+    }
+    bool end_array() {
+        const uint32_t num_elements = _vContainerSizes.back();
+        _vContainerSizes.pop_back();
+        return _handler.EndArray(num_elements);
+    }
+    bool start_map(uint32_t num_kv_pairs) {
+        _vContainerSizes.push_back(num_kv_pairs);
+        return _CheckNotKey("map") && _handler.StartObject();
+    }
+    bool start_map_key() {
+        _bInKey = true;
+        return true;
+    }
+    bool end_map_key() {
+        _bInKey = false;
+        return true;
+    }
+    bool end_map() {
+        const uint32_t num_kv_pairs = _vContainerSizes.back();
+        _vContainerSizes.pop_back();
+        return _handler.EndObject(num_kv_pairs);
+    }
+    void parse_error(size_t parsed_offset, size_t error_offset) {
+        throw OPENRAVE_EXCEPTION_FORMAT("failed to parse msgpack data at offset %d", error_offset, ORE_InvalidArguments);
+    }
+    void insufficient_bytes(size_t parsed_offset, size_t error_offset) {
+        throw OPENRAVE_EXCEPTION_FORMAT("msgpack data is truncated at offset %d", error_offset, ORE_InvalidArguments);
+    }
+
+private:
+    /// \brief emits the elements of a MSGPACK_EXT_TYPEDARRAY payload as nested json arrays
+    bool _VisitTypedArray(const char* pdata, uint32_t size) {
+        if( size < 2 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT0("msgpack typed array is missing its header", ORE_InvalidArguments);
+        }
+        const char dtype = pdata[0];
+        const int ndim = static_cast<uint8_t>(pdata[1]);
+        size_t elementsize = 0;
+        switch(dtype) {
+        case 'B': elementsize = 1; break;
+        case 'H': elementsize = 2; break;
+        case 'i': case 'f': elementsize = 4; break;
+        case 'q': case 'd': elementsize = 8; break;
+        default:
+            throw OPENRAVE_EXCEPTION_FORMAT("msgpack typed array has unsupported dtype '%c'", dtype, ORE_InvalidArguments);
+        }
+        if( ndim == 0 || size < 2 + 4*(size_t)ndim ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("msgpack typed array has an invalid shape with %d dimensions", ndim, ORE_InvalidArguments);
+        }
+        std::vector<uint32_t> vshape(ndim);
+        std::memcpy(vshape.data(), pdata + 2, 4*ndim);
+        // a crafted shape can overflow the element count, so bound it by the payload before every multiplication
+        const size_t maxelements = (size - 2 - 4*(size_t)ndim)/elementsize;
+        size_t numelements = 1;
+        size_t numarrays = 1; // number of arrays of the current dimension, empty ones are emitted too
+        for(int idim = 0; idim < ndim; ++idim) {
+            const uint32_t dim = vshape[idim];
+            if( idim+1 < ndim && dim != 0 && numarrays > (size_t)size/dim ) {
+                throw OPENRAVE_EXCEPTION_FORMAT("msgpack typed array has too many nested arrays for its %d bytes", size, ORE_InvalidArguments);
+            }
+            if( dim != 0 && numelements > maxelements/dim ) {
+                throw OPENRAVE_EXCEPTION_FORMAT("msgpack typed array shape does not fit in its %d bytes", size, ORE_InvalidArguments);
+            }
+            numelements *= dim;
+            numarrays *= dim;
+        }
+        if( size != 2 + 4*(size_t)ndim + numelements*elementsize ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("msgpack typed array of %d elements has %d bytes", numelements%size, ORE_InvalidArguments);
+        }
+        const char* pelements = pdata + 2 + 4*ndim;
+        return _VisitTypedArrayDimension(dtype, elementsize, vshape, 0, pelements);
+    }
+
+    bool _VisitTypedArrayDimension(char dtype, size_t elementsize, const std::vector<uint32_t>& vshape, int idim, const char*& pelements) {
+        if( !_handler.StartArray() ) {
+            return false;
+        }
+        const uint32_t numelements = vshape[idim];
+        if( idim+1 < (int)vshape.size() ) {
+            for(uint32_t ielement = 0; ielement < numelements; ++ielement) {
+                if( !_VisitTypedArrayDimension(dtype, elementsize, vshape, idim+1, pelements) ) {
+                    return false;
+                }
+            }
+            return _handler.EndArray(numelements);
+        }
+
+        // integers are emitted like visit_positive_integer/visit_negative_integer would
+        bool bSuccess = true;
+        for(uint32_t ielement = 0; ielement < numelements && bSuccess; ++ielement, pelements += elementsize) {
+            switch(dtype) {
+            case 'B': bSuccess = _handler.Uint64(*reinterpret_cast<const uint8_t*>(pelements)); break;
+            case 'H': {
+                uint16_t value;
+                std::memcpy(&value, pelements, sizeof(value));
+                bSuccess = _handler.Uint64(value);
+                break;
+            }
+            case 'i': {
+                int32_t value;
+                std::memcpy(&value, pelements, sizeof(value));
+                bSuccess = value >= 0 ? _handler.Uint64(value) : _handler.Int64(value);
+                break;
+            }
+            case 'q': {
+                int64_t value;
+                std::memcpy(&value, pelements, sizeof(value));
+                bSuccess = value >= 0 ? _handler.Uint64(value) : _handler.Int64(value);
+                break;
+            }
+            case 'f': {
+                float value;
+                std::memcpy(&value, pelements, sizeof(value));
+                bSuccess = _handler.Double(value);
+                break;
+            }
+            case 'd': {
+                double value;
+                std::memcpy(&value, pelements, sizeof(value));
+                bSuccess = _handler.Double(value);
+                break;
+            }
+            }
+        }
+        return bSuccess && _handler.EndArray(numelements);
+    }
+
+    bool _CheckNotKey(const char* type) const {
+        if( _bInKey ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("msgpack map key of type %s cannot be converted to json", type, ORE_InvalidArguments);
+        }
+        return true;
+    }
+
+    Handler& _handler;
+    std::vector<uint32_t> _vContainerSizes; ///< number of elements of the arrays and maps being parsed, rapidjson needs them when closing
+    bool _bInKey = false;
+};
+
+/// \brief generator for rapidjson::Document::Populate that parses msgpack data
+class MsgPackDocumentGenerator
+{
+public:
+    MsgPackDocumentGenerator(const char* data, size_t size) : _data(data), _size(size) {
+    }
+
+    template <typename Handler>
+    bool operator()(Handler& handler) {
+        RapidJsonSaxVisitor<Handler> visitor(handler);
+        std::size_t offset = 0;
+        _bParsed = msgpack::parse(_data, _size, offset, visitor);
+        return _bParsed;
+    }
+
+    /// \brief true if the last call produced a complete document. Populate does not report a failed generator.
+    bool IsParsed() const {
+        return _bParsed;
+    }
+
+private:
+    const char* _data;
+    size_t _size;
+    bool _bParsed = false;
+};
+
+/// \brief returns the dtype that can represent all the elements of the array exactly, or 0 if the array should be packed element by element
+///
+/// Arrays of only integers get an integer dtype. Arrays mixing integers and doubles, like vertices parsed from json with values such as 0 and 1, get a float dtype, so their integers are read back as doubles.
+static char _GetTypedArrayType(const rapidjson::Value& rArray)
+{
+    // short arrays like transforms are not worth the header
+    if( rArray.Size() < 16 ) {
+        return 0;
+    }
+    bool bAllInt64 = true;
+    int64_t minvalue = std::numeric_limits<int64_t>::max(), maxvalue = std::numeric_limits<int64_t>::min();
+    for(rapidjson::Value::ConstValueIterator it = rArray.Begin(); it != rArray.End(); ++it) {
+        if( it->IsInt64() ) {
+            minvalue = std::min(minvalue, it->GetInt64());
+            maxvalue = std::max(maxvalue, it->GetInt64());
+        }
+        else if( it->IsDouble() ) {
+            bAllInt64 = false;
+        }
+        else {
+            // not a number, or an uint64 above the int64 range
+            return 0;
+        }
+    }
+    if( bAllInt64 ) {
+        if( minvalue >= 0 && maxvalue <= std::numeric_limits<uint8_t>::max() ) {
+            return 'B';
+        }
+        if( minvalue >= 0 && maxvalue <= std::numeric_limits<uint16_t>::max() ) {
+            return 'H';
+        }
+        if( minvalue >= std::numeric_limits<int32_t>::min() && maxvalue <= std::numeric_limits<int32_t>::max() ) {
+            return 'i';
+        }
+        return 'q';
+    }
+    // the integers have to be exact as doubles
+    const int64_t nMaxExactInt64 = int64_t(1) << std::numeric_limits<double>::digits;
+    if( minvalue < -nMaxExactInt64 || maxvalue > nMaxExactInt64 ) {
+        return 0;
+    }
+    // use float32 when it does not lose anything, meshes often come from float data
+    bool bFloat32 = true;
+    for(rapidjson::Value::ConstValueIterator it = rArray.Begin(); it != rArray.End() && bFloat32; ++it) {
+        const double value = it->GetDouble();
+        bFloat32 = (double)(float)value == value;
+    }
+    return bFloat32 ? 'f' : 'd';
+}
+
+template <typename T>
+static void _AppendTypedArrayElement(std::vector<char>& vpayload, T value)
+{
+    const char* pvalue = reinterpret_cast<const char*>(&value);
+    vpayload.insert(vpayload.end(), pvalue, pvalue + sizeof(value));
+}
+
+/// \brief packs like the rapidjson adaptor, except that arrays with a common type are packed as MSGPACK_EXT_TYPEDARRAY
+template <typename Stream>
+static void _PackWithTypedArrays(msgpack::packer<Stream>& o, const rapidjson::Value& v, std::vector<char>& vpayload)
+{
+    if( v.IsObject() ) {
+        o.pack_map(v.MemberCount());
+        for(rapidjson::Value::ConstMemberIterator it = v.MemberBegin(); it != v.MemberEnd(); ++it) {
+            o.pack_str(it->name.GetStringLength()).pack_str_body(it->name.GetString(), it->name.GetStringLength());
+            _PackWithTypedArrays(o, it->value, vpayload);
+        }
+        return;
+    }
+    if( !v.IsArray() ) {
+        o.pack(v);
+        return;
+    }
+
+    const char dtype = _GetTypedArrayType(v);
+    if( dtype == 0 ) {
+        o.pack_array(v.Size());
+        for(rapidjson::Value::ConstValueIterator it = v.Begin(); it != v.End(); ++it) {
+            _PackWithTypedArrays(o, *it, vpayload);
+        }
+        return;
+    }
+
+    // elements are written in the host byte order, which is little-endian on all supported platforms
+    vpayload.clear();
+    vpayload.push_back(dtype);
+    vpayload.push_back(1); // ndim
+    _AppendTypedArrayElement<uint32_t>(vpayload, v.Size());
+    for(rapidjson::Value::ConstValueIterator it = v.Begin(); it != v.End(); ++it) {
+        switch(dtype) {
+        case 'B': _AppendTypedArrayElement<uint8_t>(vpayload, it->GetInt64()); break;
+        case 'H': _AppendTypedArrayElement<uint16_t>(vpayload, it->GetInt64()); break;
+        case 'i': _AppendTypedArrayElement<int32_t>(vpayload, it->GetInt64()); break;
+        case 'q': _AppendTypedArrayElement<int64_t>(vpayload, it->GetInt64()); break;
+        case 'f': _AppendTypedArrayElement<float>(vpayload, it->GetDouble()); break;
+        case 'd': _AppendTypedArrayElement<double>(vpayload, it->GetDouble()); break;
+        }
+    }
+    o.pack_ext(vpayload.size(), OpenRAVE::MsgPack::MSGPACK_EXT_TYPEDARRAY);
+    o.pack_ext_body(vpayload.data(), vpayload.size());
+}
+
+template <typename Stream>
+static void _DumpMsgPack(Stream& stream, const rapidjson::Value& value, int options)
+{
+    if( options & OpenRAVE::MsgPack::DMO_TypedArrays ) {
+        msgpack::packer<Stream> packer(stream);
+        std::vector<char> vpayload; // reused by all typed arrays
+        _PackWithTypedArrays(packer, value, vpayload);
+    }
+    else {
+        msgpack::pack(stream, value);
+    }
+}
+
+} // end namespace
+
+void OpenRAVE::MsgPack::DumpMsgPack(const rapidjson::Value& value, std::ostream& os, int options)
 {
     msgpack::osbuffer buf(os);
-    msgpack::pack(buf, value);
+    _DumpMsgPack(buf, value, options);
 }
 
-void OpenRAVE::MsgPack::DumpMsgPack(const rapidjson::Value& value, std::vector<char>& output)
-{   
+void OpenRAVE::MsgPack::DumpMsgPack(const rapidjson::Value& value, std::vector<char>& output, int options)
+{
     msgpack::vbuffer buf(output);
-    msgpack::pack(buf, value);
+    _DumpMsgPack(buf, value, options);
 }
 
 void OpenRAVE::MsgPack::ParseMsgPack(rapidjson::Document& d, const std::string& str)
 {
-    msgpack::unpacked unpacked;
-    msgpack::unpack(unpacked, str.data(), str.size());
-    unpacked.get().convert(d);
+    OpenRAVE::MsgPack::ParseMsgPack(d, str.data(), str.size());
 }
 
 void OpenRAVE::MsgPack::ParseMsgPack(rapidjson::Document& d, const void* data, size_t size)
 {
-    msgpack::unpacked unpacked;
-    msgpack::unpack(unpacked, (const char*) data, size);
-    unpacked.get().convert(d);
+    MsgPackDocumentGenerator generator((const char*) data, size);
+    d.Populate(generator);
+    if( !generator.IsParsed() || d.HasParseError() ) {
+        throw OPENRAVE_EXCEPTION_FORMAT("failed to parse msgpack data of %d bytes", size, ORE_InvalidArguments);
+    }
 }
 
 void OpenRAVE::MsgPack::ParseMsgPack(rapidjson::Document& d, std::istream& is)
@@ -356,12 +712,12 @@ void OpenRAVE::MsgPack::ParseMsgPack(rapidjson::Document& d, std::istream& is)
 
 #else
 
-void OpenRAVE::MsgPack::DumpMsgPack(const rapidjson::Value& value, std::ostream& os)
+void OpenRAVE::MsgPack::DumpMsgPack(const rapidjson::Value& value, std::ostream& os, int options)
 {
     throw OPENRAVE_EXCEPTION_FORMAT0("MsgPack support is not enabled", ORE_NotImplemented);
 }
 
-void OpenRAVE::MsgPack::DumpMsgPack(const rapidjson::Value& value, std::vector<char>& output)
+void OpenRAVE::MsgPack::DumpMsgPack(const rapidjson::Value& value, std::vector<char>& output, int options)
 {
     throw OPENRAVE_EXCEPTION_FORMAT0("MsgPack support is not enabled", ORE_NotImplemented);
 }
@@ -24,6 +24,9 @@
 //#include <boost/version.hpp>
 
 #include <boost/bind/bind.hpp>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 using namespace boost::placeholders;
 
@@ -399,8 +402,14 @@ int JitterCurrentConfiguration(PlannerBase::PlannerParametersConstPtr parameters
 class TrajectoryVerifier
 {
 public:
-    TrajectoryVerifier(PlannerBase::PlannerParametersConstPtr parameters) : _parameters(parameters) {
+    TrajectoryVerifier(PlannerBase::PlannerParametersConstPtr parameters) : _parameters(parameters), _ichecked(0) {
         VerifyParameters();
+        _velspec = _parameters->_configurationspecification.ConvertToVelocitySpecification();
+        _fresolutionmean = 0;
+        FOREACHC(it,_parameters->_vConfigResolution) {
+            _fresolutionmean += *it;
+        }
+        _fresolutionmean /= _parameters->_vConfigResolution.size();
     }
 
     void VerifyParameters() {
@@ -413,21 +422,28 @@ public:
     void VerifyTrajectory(TrajectoryBaseConstPtr trajectory, dReal samplingstep)
     {
         OPENRAVE_ASSERT_FORMAT0(!!trajectory,"need valid trajectory",ORE_InvalidArguments);
-
-        ConfigurationSpecification velspec =  _parameters->_configurationspecification.ConvertToVelocitySpecification();
-
-        dReal fresolutionmean = 0;
-        FOREACHC(it,_parameters->_vConfigResolution) {
-            fresolutionmean += *it;
+        VerifyWaypoints(trajectory, 0, trajectory->GetNumWaypoints());
+        if( !!_parameters->_checkpathvelocityconstraintsfn && trajectory->GetNumWaypoints() >= 2 ) {
+            if( trajectory->GetDuration() > 0 && samplingstep > 0 ) {
+                std::vector<dReal> vsampletimes;
+                IntervalType interval = ComputeSampleTimes(trajectory, samplingstep, vsampletimes);
+                VerifySampledSegments(trajectory, vsampletimes, interval, 1, vsampletimes.size());
+            }
+            else {
+                VerifyWaypointConstraints(trajectory, 0, trajectory->GetNumWaypoints());
+            }
         }
-        fresolutionmean /= _parameters->_vConfigResolution.size();
+    }
 
+    /// \brief checks limits and state consistency of the waypoints [istart, iend)
+    void VerifyWaypoints(TrajectoryBaseConstPtr trajectory, size_t istart, size_t iend)
+    {
         dReal fthresh = 5e-5f;
-        vector<dReal> deltaq(_parameters->GetDOF(),0);
         std::vector<dReal> vdata, vdatavel, vdiff;
-        for(size_t ipoint = 0; ipoint < trajectory->GetNumWaypoints(); ++ipoint) {
+        for(size_t ipoint = istart; ipoint < iend; ++ipoint) {
+            _ichecked = ipoint;
             trajectory->GetWaypoint(ipoint,vdata,_parameters->_configurationspecification);
-            trajectory->GetWaypoint(ipoint,vdatavel,velspec);
+            trajectory->GetWaypoint(ipoint,vdatavel,_velspec);
             BOOST_ASSERT((int)vdata.size()==_parameters->GetDOF());
             BOOST_ASSERT((int)vdatavel.size()==_parameters->GetDOF());
             for(size_t i = 0; i < vdata.size(); ++i) {
@@ -459,110 +475,137 @@ public:
                     throw OPENRAVE_EXCEPTION_FORMAT(_("neighstatefn is rejecting configuration %d, wrote trajectory %s"),ipoint%DumpTrajectory(trajectory),ORE_InconsistentConstraints);
                 }
                 dReal fdist = _parameters->_distmetricfn(newq,vdata);
-                OPENRAVE_ASSERT_OP_FORMAT(fdist,<=,0.01 * fresolutionmean, "neighstatefn is rejecting configuration %d, wrote trajectory %s",ipoint%DumpTrajectory(trajectory),ORE_InconsistentConstraints);
+                OPENRAVE_ASSERT_OP_FORMAT(fdist,<=,0.01 * _fresolutionmean, "neighstatefn is rejecting configuration %d, wrote trajectory %s",ipoint%DumpTrajectory(trajectory),ORE_InconsistentConstraints);
             }
         }
+    }
 
-        if( !!_parameters->_checkpathvelocityconstraintsfn && trajectory->GetNumWaypoints() >= 2 ) {
+    /// \brief computes the times at which the trajectory is sampled for checking segment constraints.
+    ///
+    /// The times are the merged waypoint times and the uniform samples with the ones too close to their predecessor removed, so every consecutive pair forms an independent segment.
+    /// \return the interval type to check the segments with
+    IntervalType ComputeSampleTimes(TrajectoryBaseConstPtr trajectory, dReal samplingstep, std::vector<dReal>& vsampletimes)
+    {
+        // have to make sure that sampling interval doesn't include a waypoint. otherwise interpolation could become inconsistent!
+        std::vector<dReal> vabstimes;
+        vabstimes.reserve(trajectory->GetNumWaypoints() + (trajectory->GetDuration()/samplingstep) + 1);
+        ConfigurationSpecification deltatimespec;
+        deltatimespec.AddDeltaTimeGroup();
+        trajectory->GetWaypoints(0, trajectory->GetNumWaypoints(), vabstimes, deltatimespec);
+        dReal totaltime = 0;
+        FOREACH(ittime, vabstimes) {
+            totaltime += *ittime;
+            *ittime = totaltime;
+        }
+        for(dReal ftime = 0; ftime < trajectory->GetDuration(); ftime += samplingstep ) {
+            vabstimes.push_back(ftime);
+        }
+        vsampletimes.resize(vabstimes.size());
+        std::merge(vabstimes.begin(), vabstimes.begin()+trajectory->GetNumWaypoints(), vabstimes.begin()+trajectory->GetNumWaypoints(), vabstimes.end(), vsampletimes.begin());
 
-            if( trajectory->GetDuration() > 0 && samplingstep > 0 ) {
-                // use sampling and check segment constraints
-                // have to make sure that sampling interval doesn't include a waypoint. otherwise interpolation could become inconsistent!
-                std::vector<dReal> vabstimes, vsampletimes;
-                vabstimes.reserve(trajectory->GetNumWaypoints() + (trajectory->GetDuration()/samplingstep) + 1);
-                ConfigurationSpecification deltatimespec;
-                deltatimespec.AddDeltaTimeGroup();
-                trajectory->GetWaypoints(0, trajectory->GetNumWaypoints(), vabstimes, deltatimespec);
-                dReal totaltime = 0;
-                FOREACH(ittime, vabstimes) {
-                    totaltime += *ittime;
-                    *ittime = totaltime;
-                }
-                for(dReal ftime = 0; ftime < trajectory->GetDuration(); ftime += samplingstep ) {
-                    vabstimes.push_back(ftime);
-                }
-                vsampletimes.resize(vabstimes.size());
-                std::merge(vabstimes.begin(), vabstimes.begin()+trajectory->GetNumWaypoints(), vabstimes.begin()+trajectory->GetNumWaypoints(), vabstimes.end(), vsampletimes.begin());
-
-                // Check if the trajectory has all-linear interpolation
-                ConfigurationSpecification trajspec = trajectory->GetConfigurationSpecification();
-                vector<ConfigurationSpecification::Group>::const_iterator itvaluesgroup = trajspec.FindCompatibleGroup("joint_values", false);
-                vector<ConfigurationSpecification::Group>::const_iterator itvelocitiesgroup = trajspec.FindCompatibleGroup("joint_velocities", false);
-                vector<ConfigurationSpecification::Group>::const_iterator itaccelerationsgroup = trajspec.FindCompatibleGroup("joint_accelerations", false);
-                bool bHasAllLinearInterpolation = false;
-                if( (itvaluesgroup == trajspec._vgroups.end() || itvaluesgroup->interpolation == "linear") &&
-                    (itvelocitiesgroup == trajspec._vgroups.end() || itvelocitiesgroup->interpolation == "linear") &&
-                    (itaccelerationsgroup == trajspec._vgroups.end() || itaccelerationsgroup->interpolation == "linear") ) {
-                    bHasAllLinearInterpolation = true;
-                }
-                IntervalType interval = bHasAllLinearInterpolation ? (IntervalType)(IT_Closed | IT_AllLinear) : IT_Closed;
-
-                std::vector<dReal> vprevdata, vprevdatavel;
-                ConstraintFilterReturnPtr filterreturn(new ConstraintFilterReturn());
-                trajectory->Sample(vprevdata,0,_parameters->_configurationspecification);
-                trajectory->Sample(vprevdatavel,0,velspec);
-                std::vector<dReal>::iterator itprevtime = vsampletimes.begin();
-                for(std::vector<dReal>::iterator itsampletime = vsampletimes.begin()+1; itsampletime != vsampletimes.end(); ++itsampletime) {
-                    if (*itsampletime < *itprevtime + 1e-5 ) {
-                        continue;
-                    }
-                    filterreturn->Clear();
-                    trajectory->Sample(vdata,*itsampletime,_parameters->_configurationspecification);
-                    trajectory->Sample(vdatavel,*itsampletime,velspec);
-                    dReal deltatime = *itsampletime - *itprevtime;
-                    vdiff = vdata;
-                    _parameters->_diffstatefn(vdiff,vprevdata);
-                    for(size_t i = 0; i < _parameters->_vConfigVelocityLimit.size(); ++i) {
-                        dReal velthresh = _parameters->_vConfigVelocityLimit.at(i)*deltatime+fthresh;
-                        OPENRAVE_ASSERT_OP_FORMAT(RaveFabs(vdiff.at(i)), <=, velthresh, "time %fs-%fs, dof %d traveled %f, but maxvelocity only allows %f, wrote trajectory to %s",*itprevtime%*itsampletime%i%RaveFabs(vdiff.at(i))%velthresh%DumpTrajectory(trajectory),ORE_InconsistentConstraints);
-                    }
-                    if( _parameters->CheckPathAllConstraints(vprevdata,vdata,vprevdatavel, vdatavel, deltatime, interval, 0xffff|CFO_FillCheckedConfiguration, filterreturn) != 0 ) {
-                        if( IS_DEBUGLEVEL(Level_Verbose) ) {
-                            _parameters->CheckPathAllConstraints(vprevdata,vdata,vprevdatavel, vdatavel, deltatime, interval, 0xffff|CFO_FillCheckedConfiguration, filterreturn);
-                        }
-                        throw OPENRAVE_EXCEPTION_FORMAT(_("time %fs-%fs, CheckPathAllConstraints failed, wrote trajectory to %s"),*itprevtime%*itsampletime%DumpTrajectory(trajectory),ORE_InconsistentConstraints);
-                    }
-                    OPENRAVE_ASSERT_OP(filterreturn->_configurations.size()%_parameters->GetDOF(),==,0);
-                    std::vector<dReal>::iterator itprevconfig = filterreturn->_configurations.begin();
-                    std::vector<dReal>::iterator itcurconfig = itprevconfig + _parameters->GetDOF();
-                    for(; itcurconfig != filterreturn->_configurations.end(); itcurconfig += _parameters->GetDOF()) {
-                        std::vector<dReal> vprevconfig(itprevconfig,itprevconfig+_parameters->GetDOF());
-                        std::vector<dReal> vcurconfig(itcurconfig,itcurconfig+_parameters->GetDOF());
-                        for(int i = 0; i < _parameters->GetDOF(); ++i) {
-                            deltaq.at(i) = vcurconfig.at(i) - vprevconfig.at(i);
-                        }
-                        if( _parameters->SetStateValues(vprevconfig, 0) != 0 ) {
-                            throw OPENRAVE_EXCEPTION_FORMAT(_("time %fs-%fs, failed to set state values"), *itprevtime%*itsampletime, ORE_InconsistentConstraints);
-                        }
-                        vector<dReal> vtemp = vprevconfig;
-                        if( _parameters->_neighstatefn(vtemp,deltaq,NSO_OnlyHardConstraints) == NSS_Failed ) {
-                            throw OPENRAVE_EXCEPTION_FORMAT(_("time %fs-%fs, neighstatefn is rejecting configurations from CheckPathAllConstraints, wrote trajectory to %s"),*itprevtime%*itsampletime%DumpTrajectory(trajectory),ORE_InconsistentConstraints);
-                        }
-                        else {
-                            dReal fprevdist = _parameters->_distmetricfn(vprevconfig,vtemp);
-                            dReal fcurdist = _parameters->_distmetricfn(vcurconfig,vtemp);
-                            if( fprevdist > g_fEpsilonLinear ) {
-                                OPENRAVE_ASSERT_OP_FORMAT(fprevdist, >, fcurdist, "time %fs-%fs, neighstatefn returned a configuration closer to the previous configuration %f than the expected current %f, wrote trajectory to %s",*itprevtime%*itsampletime%fprevdist%fcurdist%DumpTrajectory(trajectory), ORE_InconsistentConstraints);
-                            }
-                        }
-                        itprevconfig=itcurconfig;
-                    }
-                    vprevdata.swap(vdata);
-                    vprevdatavel.swap(vdatavel);
-                    itprevtime = itsampletime;
+        // drop the times that are too close to the previous checked time
+        size_t numtimes = vsampletimes.empty() ? 0 : 1;
+        for(size_t itime = 1; itime < vsampletimes.size(); ++itime) {
+            if( vsampletimes[itime] >= vsampletimes[numtimes-1] + 1e-5 ) {
+                vsampletimes[numtimes++] = vsampletimes[itime];
+            }
+        }
+        vsampletimes.resize(numtimes);
+
+        // Check if the trajectory has all-linear interpolation
+        ConfigurationSpecification trajspec = trajectory->GetConfigurationSpecification();
+        vector<ConfigurationSpecification::Group>::const_iterator itvaluesgroup = trajspec.FindCompatibleGroup("joint_values", false);
+        vector<ConfigurationSpecification::Group>::const_iterator itvelocitiesgroup = trajspec.FindCompatibleGroup("joint_velocities", false);
+        vector<ConfigurationSpecification::Group>::const_iterator itaccelerationsgroup = trajspec.FindCompatibleGroup("joint_accelerations", false);
+        bool bHasAllLinearInterpolation = false;
+        if( (itvaluesgroup == trajspec._vgroups.end() || itvaluesgroup->interpolation == "linear") &&
+            (itvelocitiesgroup == trajspec._vgroups.end() || itvelocitiesgroup->interpolation == "linear") &&
+            (itaccelerationsgroup == trajspec._vgroups.end() || itaccelerationsgroup->interpolation == "linear") ) {
+            bHasAllLinearInterpolation = true;
+        }
+        return bHasAllLinearInterpolation ? (IntervalType)(IT_Closed | IT_AllLinear) : IT_Closed;
+    }
+
+    /// \brief checks the segments between vsampletimes[isegment-1] and vsampletimes[isegment] for isegment in [istart, iend), istart >= 1
+    void VerifySampledSegments(TrajectoryBaseConstPtr trajectory, const std::vector<dReal>& vsampletimes, IntervalType interval, size_t istart, size_t iend)
+    {
+        if( istart >= iend ) {
+            return;
+        }
+        _ichecked = istart; // the first samples can already fail
+        dReal fthresh = 5e-5f;
+        vector<dReal> deltaq(_parameters->GetDOF(),0);
+        std::vector<dReal> vdata, vdatavel, vdiff, vprevdata, vprevdatavel;
+        ConstraintFilterReturnPtr filterreturn(new ConstraintFilterReturn());
+        trajectory->Sample(vprevdata,istart == 1 ? 0 : vsampletimes.at(istart-1),_parameters->_configurationspecification);
+        trajectory->Sample(vprevdatavel,istart == 1 ? 0 : vsampletimes.at(istart-1),_velspec);
+        for(size_t isegment = istart; isegment < iend; ++isegment) {
+            _ichecked = isegment;
+            const dReal fprevtime = vsampletimes[isegment-1], fsampletime = vsampletimes[isegment];
+            filterreturn->Clear();
+            trajectory->Sample(vdata,fsampletime,_parameters->_configurationspecification);
+            trajectory->Sample(vdatavel,fsampletime,_velspec);
+            dReal deltatime = fsampletime - fprevtime;
+            vdiff = vdata;
+            _parameters->_diffstatefn(vdiff,vprevdata);
+            for(size_t i = 0; i < _parameters->_vConfigVelocityLimit.size(); ++i) {
+                dReal velthresh = _parameters->_vConfigVelocityLimit.at(i)*deltatime+fthresh;
+                OPENRAVE_ASSERT_OP_FORMAT(RaveFabs(vdiff.at(i)), <=, velthresh, "time %fs-%fs, dof %d traveled %f, but maxvelocity only allows %f, wrote trajectory to %s",fprevtime%fsampletime%i%RaveFabs(vdiff.at(i))%velthresh%DumpTrajectory(trajectory),ORE_InconsistentConstraints);
+            }
+            if( _parameters->CheckPathAllConstraints(vprevdata,vdata,vprevdatavel, vdatavel, deltatime, interval, 0xffff|CFO_FillCheckedConfiguration, filterreturn) != 0 ) {
+                if( IS_DEBUGLEVEL(Level_Verbose) ) {
+                    _parameters->CheckPathAllConstraints(vprevdata,vdata,vprevdatavel, vdatavel, deltatime, interval, 0xffff|CFO_FillCheckedConfiguration, filterreturn);
                 }
+                throw OPENRAVE_EXCEPTION_FORMAT(_("time %fs-%fs, CheckPathAllConstraints failed, wrote trajectory to %s"),fprevtime%fsampletime%DumpTrajectory(trajectory),ORE_InconsistentConstraints);
             }
-            else {
-                for(size_t i = 0; i < trajectory->GetNumWaypoints(); ++i) {
-                    trajectory->GetWaypoint(i,vdata,_parameters->_configurationspecification);
-                    if( _parameters->CheckPathAllConstraints(vdata,vdata,std::vector<dReal>(), std::vector<dReal>(), 0, IT_OpenStart) != 0 ) {
-                        throw OPENRAVE_EXCEPTION_FORMAT(_("CheckPathAllConstraints, failed at %d, wrote trajectory to %s"),i%DumpTrajectory(trajectory),ORE_InconsistentConstraints);
+            OPENRAVE_ASSERT_OP(filterreturn->_configurations.size()%_parameters->GetDOF(),==,0);
+            std::vector<dReal>::iterator itprevconfig = filterreturn->_configurations.begin();
+            std::vector<dReal>::iterator itcurconfig = itprevconfig + _parameters->GetDOF();
+            for(; itcurconfig != filterreturn->_configurations.end(); itcurconfig += _parameters->GetDOF()) {
+                std::vector<dReal> vprevconfig(itprevconfig,itprevconfig+_parameters->GetDOF());
+                std::vector<dReal> vcurconfig(itcurconfig,itcurconfig+_parameters->GetDOF());
+                for(int i = 0; i < _parameters->GetDOF(); ++i) {
+                    deltaq.at(i) = vcurconfig.at(i) - vprevconfig.at(i);
+                }
+                if( _parameters->SetStateValues(vprevconfig, 0) != 0 ) {
+                    throw OPENRAVE_EXCEPTION_FORMAT(_("time %fs-%fs, failed to set state values"), fprevtime%fsampletime, ORE_InconsistentConstraints);
+                }
+                vector<dReal> vtemp = vprevconfig;
+                if( _parameters->_neighstatefn(vtemp,deltaq,NSO_OnlyHardConstraints) == NSS_Failed ) {
+                    throw OPENRAVE_EXCEPTION_FORMAT(_("time %fs-%fs, neighstatefn is rejecting configurations from CheckPathAllConstraints, wrote trajectory to %s"),fprevtime%fsampletime%DumpTrajectory(trajectory),ORE_InconsistentConstraints);
+                }
+                else {
+                    dReal fprevdist = _parameters->_distmetricfn(vprevconfig,vtemp);
+                    dReal fcurdist = _parameters->_distmetricfn(vcurconfig,vtemp);
+                    if( fprevdist > g_fEpsilonLinear ) {
+                        OPENRAVE_ASSERT_OP_FORMAT(fprevdist, >, fcurdist, "time %fs-%fs, neighstatefn returned a configuration closer to the previous configuration %f than the expected current %f, wrote trajectory to %s",fprevtime%fsampletime%fprevdist%fcurdist%DumpTrajectory(trajectory), ORE_InconsistentConstraints);
                     }
                 }
+                itprevconfig=itcurconfig;
             }
+            vprevdata.swap(vdata);
+            vprevdatavel.swap(vdatavel);
         }
     }
 
+    /// \brief checks the constraints at the waypoints [istart, iend) without sampling
+    void VerifyWaypointConstraints(TrajectoryBaseConstPtr trajectory, size_t istart, size_t iend)
+    {
+        std::vector<dReal> vdata;
+        for(size_t i = istart; i < iend; ++i) {
+            _ichecked = i;
+            trajectory->GetWaypoint(i,vdata,_parameters->_configurationspecification);
+            if( _parameters->CheckPathAllConstraints(vdata,vdata,std::vector<dReal>(), std::vector<dReal>(), 0, IT_OpenStart) != 0 ) {
+                throw OPENRAVE_EXCEPTION_FORMAT(_("CheckPathAllConstraints, failed at %d, wrote trajectory to %s"),i%DumpTrajectory(trajectory),ORE_InconsistentConstraints);
+            }
+        }
+    }
+
+    /// \brief the index of the waypoint or segment that was being checked last. Used to locate failures.
+    size_t GetCheckedIndex() const {
+        return _ichecked;
+    }
+
     string DumpTrajectory(TrajectoryBaseConstPtr trajectory)
     {
         string filename = str(boost::format("%s/failedtrajectory%d.xml")%RaveGetHomeDirectory()%(RaveRandomInt()%1000));
@@ -574,6 +617,9 @@ public:
 
 protected:
     PlannerBase::PlannerParametersConstPtr _parameters;
+    ConfigurationSpecification _velspec;
+    dReal _fresolutionmean;
+    size_t _ichecked;
 };
 
 void VerifyTrajectory(PlannerBase::PlannerParametersConstPtr parameters, TrajectoryBaseConstPtr trajectory, dReal samplingstep)
@@ -587,6 +633,178 @@ void VerifyTrajectory(PlannerBase::PlannerParametersConstPtr parameters, Traject
     v.VerifyTrajectory(trajectory,samplingstep);
 }
 
+/// \brief verifies a trajectory with several threads, each owning a clone of the environment, parameters, and trajectory.
+///
+/// The parameters of every clone are made with SetConfigurationSpecification from the specification of the given parameters, so the given parameters have to be made the same way.
+class ParallelTrajectoryVerifier
+{
+    /// \brief the resources of one worker thread
+    struct Worker
+    {
+        ~Worker() {
+            if( !!_penv ) {
+                _penv->Destroy();
+            }
+        }
+        EnvironmentBasePtr _penv;
+        TrajectoryBasePtr _ptraj;
+        boost::shared_ptr<TrajectoryVerifier> _pverifier;
+    };
+    typedef boost::shared_ptr<Worker> WorkerPtr;
+
+    typedef boost::function<void (Worker&, size_t, size_t)> RangeCheckFn;
+
+public:
+    ParallelTrajectoryVerifier(PlannerBase::PlannerParametersConstPtr parameters, TrajectoryBaseConstPtr trajectory, int numthreads, bool bAbortOnFirstFailure) : _parameters(parameters), _trajectory(trajectory), _bAbortOnFirstFailure(bAbortOnFirstFailure)
+    {
+        OPENRAVE_ASSERT_FORMAT0(!!trajectory,"need valid trajectory",ORE_InvalidArguments);
+        _vworkers.resize(numthreads);
+        FOREACH(itworker, _vworkers) {
+            WorkerPtr pworker(new Worker());
+            pworker->_penv = trajectory->GetEnv()->CloneSelf(Clone_Bodies);
+            EnvironmentLock lock(pworker->_penv->GetMutex());
+            pworker->_ptraj = RaveCreateTrajectory(pworker->_penv, trajectory->GetXMLId());
+            pworker->_ptraj->Clone(trajectory, 0);
+
+            PlannerBase::PlannerParametersPtr params(new PlannerBase::PlannerParameters());
+            params->SetConfigurationSpecification(pworker->_penv, parameters->_configurationspecification);
+            pworker->_pverifier.reset(new TrajectoryVerifier(params));
+            *itworker = pworker;
+        }
+    }
+
+    void VerifyTrajectory(dReal samplingstep)
+    {
+        size_t numwaypoints = _trajectory->GetNumWaypoints();
+        _RunChecks(0, numwaypoints, boost::bind(&ParallelTrajectoryVerifier::_VerifyWaypoints, _1, _2, _3));
+        if( !!_parameters->_checkpathvelocityconstraintsfn && numwaypoints >= 2 ) {
+            if( _trajectory->GetDuration() > 0 && samplingstep > 0 ) {
+                std::vector<dReal> vsampletimes;
+                IntervalType interval = _vworkers.at(0)->_pverifier->ComputeSampleTimes(_trajectory, samplingstep, vsampletimes);
+                _RunChecks(1, vsampletimes.size(), boost::bind(&ParallelTrajectoryVerifier::_VerifySampledSegments, _1, boost::cref(vsampletimes), interval, _2, _3));
+            }
+            else {
+                _RunChecks(0, numwaypoints, boost::bind(&ParallelTrajectoryVerifier::_VerifyWaypointConstraints, _1, _2, _3));
+            }
+        }
+    }
+
+protected:
+    static void _VerifyWaypoints(Worker& worker, size_t istart, size_t iend) {
+        worker._pverifier->VerifyWaypoints(worker._ptraj, istart, iend);
+    }
+
+    static void _VerifySampledSegments(Worker& worker, const std::vector<dReal>& vsampletimes, IntervalType interval, size_t istart, size_t iend) {
+        worker._pverifier->VerifySampledSegments(worker._ptraj, vsampletimes, interval, istart, iend);
+    }
+
+    static void _VerifyWaypointConstraints(Worker& worker, size_t istart, size_t iend) {
+        worker._pverifier->VerifyWaypointConstraints(worker._ptraj, istart, iend);
+    }
+
+    /// \brief runs checkfn over [ibegin, iend) split into chunks that the workers claim in increasing order.
+    ///
+    /// Only chunks after an already found failure are skipped, so every index before the earliest failure is always checked and the rethrown exception does not depend on thread timing.
+    void _RunChecks(size_t ibegin, size_t iend, const RangeCheckFn& checkfn)
+    {
+        if( ibegin >= iend ) {
+            return;
+        }
+        // several chunks per thread so that early failures are found first and the load is balanced
+        _ibegin = ibegin;
+        _iend = iend;
+        _chunksize = max(size_t(1), (iend-ibegin)/(8*_vworkers.size()));
+        _nextchunk = 0;
+        _earliestfailure = iend;
+        _failureexception = std::exception_ptr();
+
+        size_t numthreads = min(_vworkers.size(), (iend-ibegin+_chunksize-1)/_chunksize);
+        std::vector<std::thread> vthreads;
+        vthreads.reserve(numthreads);
+        for(size_t ithread = 0; ithread < numthreads; ++ithread) {
+            vthreads.emplace_back(std::bind(&ParallelTrajectoryVerifier::_WorkerThread, this, _vworkers[ithread], std::cref(checkfn)));
+        }
+        FOREACH(itthread, vthreads) {
+            itthread->join();
+        }
+        if( !!_failureexception ) {
+            std::rethrow_exception(_failureexception);
+        }
+    }
+
+    void _WorkerThread(WorkerPtr pworker, const RangeCheckFn& checkfn)
+    {
+        EnvironmentLock lock(pworker->_penv->GetMutex());
+        while(1) {
+            size_t istart = _ibegin + _nextchunk.fetch_add(1)*_chunksize;
+            if( istart >= _iend || (_bAbortOnFirstFailure && istart > _earliestfailure.load()) ) {
+                break;
+            }
+            size_t ichunkend = min(istart+_chunksize, _iend);
+            while(istart < ichunkend) {
+                try {
+                    checkfn(*pworker, istart, ichunkend);
+                    break;
+                }
+                catch(const std::exception& ex) {
+                    size_t ifailure = pworker->_pverifier->GetCheckedIndex();
+                    _RecordFailure(ifailure, std::current_exception(), ex.what());
+                    if( _bAbortOnFirstFailure ) {
+                        break;
+                    }
+                    istart = ifailure+1;
+                }
+            }
+        }
+    }
+
+    void _RecordFailure(size_t ifailure, std::exception_ptr pexception, const char* pmessage)
+    {
+        std::lock_guard<std::mutex> lock(_mutexFailure);
+        if( !_bAbortOnFirstFailure ) {
+            RAVELOG_WARN_FORMAT("trajectory verification failed at index %d: %s", ifailure%pmessage);
+        }
+        if( ifailure < _earliestfailure.load() || !_failureexception ) {
+            _earliestfailure = ifailure;
+            _failureexception = pexception;
+        }
+    }
+
+    PlannerBase::PlannerParametersConstPtr _parameters;
+    TrajectoryBaseConstPtr _trajectory;
+    std::vector<WorkerPtr> _vworkers;
+    bool _bAbortOnFirstFailure;
+
+    size_t _ibegin, _iend, _chunksize; ///< index range and chunk size of the current check
+    std::atomic<size_t> _nextchunk; ///< the next chunk to claim
+    std::atomic<size_t> _earliestfailure; ///< the earliest failed index found so far, _iend if none
+    std::mutex _mutexFailure; ///< protects _failureexception
+    std::exception_ptr _failureexception; ///< the exception of _earliestfailure
+};
+
+void VerifyTrajectoryParallel(PlannerBase::PlannerParametersConstPtr parameters, TrajectoryBaseConstPtr trajectory, dReal samplingstep, int numthreads, bool bAbortOnFirstFailure)
+{
+    if( !!parameters ) {
+        // the functions of given parameters can be bound to any state, so they cannot be rebuilt in the cloned environments
+        RAVELOG_VERBOSE("parameters are given, so verifying the trajectory serially\n");
+        TrajectoryVerifier v(parameters);
+        v.VerifyTrajectory(trajectory,samplingstep);
+        return;
+    }
+    PlannerBase::PlannerParametersPtr newparams(new PlannerBase::PlannerParameters());
+    newparams->SetConfigurationSpecification(trajectory->GetEnv(), trajectory->GetConfigurationSpecification().GetTimeDerivativeSpecification(0));
+    if( numthreads <= 0 ) {
+        numthreads = std::thread::hardware_concurrency();
+    }
+    if( numthreads <= 1 ) {
+        TrajectoryVerifier v(newparams);
+        v.VerifyTrajectory(trajectory,samplingstep);
+        return;
+    }
+    ParallelTrajectoryVerifier v(newparams, trajectory, numthreads, bAbortOnFirstFailure);
+    v.VerifyTrajectory(samplingstep);
+}
+
 PlannerStatus _PlanActiveDOFTrajectory(TrajectoryBasePtr traj, RobotBasePtr probot, bool hastimestamps, dReal fmaxvelmult, dReal fmaxaccelmult, const std::string& plannername, bool bsmooth, const std::string& plannerparameters)
 {
     if( traj->GetNumWaypoints() == 1 ) {
@@ -4639,6 +4857,53 @@ int DynamicsCollisionConstraint::Check(const std::vector<dReal>& q0, const std::
     return 0;
 }
 
+TrajectoryWaypointStream::TrajectoryWaypointStream(const ConfigurationSpecification& spec, size_t capacity) : _spec(spec), _writeindex(0), _readindex(0)
+{
+    _dof = _spec.GetDOF();
+    OPENRAVE_ASSERT_OP(_dof,>,0);
+    size_t roundedcapacity = 1;
+    while( roundedcapacity < capacity ) {
+        roundedcapacity <<= 1;
+    }
+    _capacitymask = roundedcapacity-1;
+    _vbuffer.resize(roundedcapacity*_dof, 0);
+}
+
+bool TrajectoryWaypointStream::Push(const dReal* pwaypoint)
+{
+    const size_t writeindex = _writeindex.load(std::memory_order_relaxed);
+    if( writeindex - _readindex.load(std::memory_order_acquire) > _capacitymask ) {
+        return false;
+    }
+    std::copy(pwaypoint, pwaypoint+_dof, _vbuffer.begin() + (writeindex & _capacitymask)*_dof);
+    _writeindex.store(writeindex+1, std::memory_order_release);
+    return true;
+}
+
+size_t TrajectoryWaypointStream::Flush(TrajectoryBasePtr traj)
+{
+    const size_t readindex = _readindex.load(std::memory_order_relaxed);
+    const size_t writeindex = _writeindex.load(std::memory_order_acquire);
+    const size_t numpending = writeindex - readindex;
+    if( numpending == 0 ) {
+        return 0;
+    }
+    // pending waypoints can wrap around the end of the ring buffer, so insert at most two contiguous blocks
+    const size_t startslot = readindex & _capacitymask;
+    const size_t numfirst = std::min(numpending, _capacitymask+1-startslot);
+    traj->Insert(traj->GetNumWaypoints(), &_vbuffer[startslot*_dof], numfirst*_dof, _spec, false);
+    if( numfirst < numpending ) {
+        traj->Insert(traj->GetNumWaypoints(), &_vbuffer[0], (numpending-numfirst)*_dof, _spec, false);
+    }
+    _readindex.store(writeindex, std::memory_order_release);
+    return numpending;
+}
+
+size_t TrajectoryWaypointStream::GetNumPending() const
+{
+    return _writeindex.load(std::memory_order_acquire) - _readindex.load(std::memory_order_acquire);
+}
+
 SimpleDistanceMetric::SimpleDistanceMetric(RobotBasePtr robot) : _robot(robot)
 {
     _robot->GetActiveDOFWeights(weights2);
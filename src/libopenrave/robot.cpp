@@ -721,6 +721,8 @@ void RobotBase::RobotBaseInfo::_DeserializeReadableInterface(const std::string&
     if(itReadable != _mReadableInterfaces.end()) {
         pReadable = itReadable->second;
     }
+    // infos can be deserialized in parallel, but the registered readers do not have to be thread-safe
+    std::lock_guard<std::recursive_mutex> lock(GetJSONReaderMutex());
     BaseJSONReaderPtr pReader = RaveCallJSONReader(PT_Robot, id, pReadable, AttributesList());
     if (!!pReader) {
         pReader->DeserializeJSON(rReadable, fUnitScale);
@@ -19,6 +19,13 @@
 
 #include "md5.h"
 
+#include <tuple>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
 namespace OpenRAVE {
 namespace utils {
 
@@ -121,5 +128,53 @@ std::string GetFilenameUntilSeparator(std::istream& sinput, char separator)
     return filename.substr( startpos, endpos-startpos+1 );
 }
 
+uint64_t PruneFileCache(const std::string& directory, uint64_t maxbytes)
+{
+    uint64_t totalbytes = 0;
+#ifdef HAVE_BOOST_FILESYSTEM
+    // (modification time, size, path) of every file in the cache
+    std::vector< std::tuple<std::time_t, uint64_t, boost::filesystem::path> > vfiles;
+    boost::system::error_code ec;
+    for(boost::filesystem::directory_iterator itfile(directory, ec), itend; !ec && itfile != itend; itfile.increment(ec)) {
+        const boost::filesystem::path& filepath = itfile->path();
+        boost::system::error_code ecfile;
+        const boost::uintmax_t filesize = boost::filesystem::file_size(filepath, ecfile);
+        const std::time_t mtime = boost::filesystem::last_write_time(filepath, ecfile);
+        if( filepath.extension() == ".tmp" ) {
+            // still being written by another thread or process, unless the writer died
+            if( !ecfile && mtime + 3600 < std::time(NULL) ) {
+                boost::filesystem::remove(filepath, ecfile);
+            }
+            continue;
+        }
+        if( !ecfile ) {
+            vfiles.emplace_back(mtime, filesize, filepath);
+            totalbytes += filesize;
+        }
+    }
+    if( totalbytes <= maxbytes ) {
+        return totalbytes;
+    }
+    std::sort(vfiles.begin(), vfiles.end());
+    for(size_t ifile = 0; ifile < vfiles.size() && totalbytes > maxbytes; ++ifile) {
+        boost::system::error_code ecfile;
+        if( boost::filesystem::remove(std::get<2>(vfiles[ifile]), ecfile) ) {
+            totalbytes -= std::get<1>(vfiles[ifile]);
+        }
+    }
+#endif
+    return totalbytes;
+}
+
+std::string GetTemporaryFilename(const std::string& filename)
+{
+#ifdef _WIN32
+    const int pid = _getpid();
+#else
+    const int pid = getpid();
+#endif
+    return str(boost::format("%s.%d.%d.tmp")%filename%pid%std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
 } // utils
 } // OpenRAVE
@@ -12,6 +12,10 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 from common_test_openrave import *
+from subprocess import Popen, PIPE
+import shutil
+import sys
+import tempfile
 
 class TestCOLLADA(EnvironmentSetup):
     def test_collada_loading(self):
@@ -561,3 +565,73 @@ class TestCOLLADA(EnvironmentSetup):
         env2.Load('test_externalgrab.dae')
         misc.CompareEnvironments(env, env2)
         
+
+    def test_collada_cache(self):
+        self.log.info('loading the same collada file again uses the cached body')
+        # the cache is opt-in and read on every load
+        os.environ['OPENRAVE_COLLADA_CACHE'] = '1'
+        try:
+            self._CheckColladaCache()
+        finally:
+            del os.environ['OPENRAVE_COLLADA_CACHE']
+
+        # the body read from the disk cache of another process has to match the one converted without it
+        tempdir = tempfile.mkdtemp()
+        try:
+            script = """
+from openravepy import *
+env=Environment()
+try:
+    with env:
+        robot=env.ReadRobotURI('robots/neuronics-katana.zae')
+        env.Add(robot,True)
+        print(repr([robot.GetKinematicsGeometryHash(), robot.GetRobotStructureHash(), [[(g.GetId(), len(g.GetCollisionMesh().vertices)) for g in link.GetGeometries()] for link in robot.GetLinks()]]))
+finally:
+    env.Destroy()
+    RaveDestroy()
+"""
+            def LoadInProcess(environ):
+                process = Popen([sys.executable, '-c', script], stdout=PIPE, env=dict(os.environ, OPENRAVE_HOME=tempdir, **environ))
+                output = process.communicate()[0]
+                assert(process.returncode == 0)
+                return output.strip().splitlines()[-1]
+
+            expected = LoadInProcess({'OPENRAVE_COLLADA_CACHE':'0'})
+            assert(not os.path.exists(os.path.join(tempdir,'colladacache')))
+            # writes the disk cache
+            assert(LoadInProcess({'OPENRAVE_COLLADA_CACHE':'1'}) == expected)
+            cachefiles = [os.path.join(tempdir,'colladacache',filename) for filename in os.listdir(os.path.join(tempdir,'colladacache')) if filename.endswith('.bin')]
+            assert(len(cachefiles) > 0)
+            # reads the disk cache
+            assert(LoadInProcess({'OPENRAVE_COLLADA_CACHE':'1'}) == expected)
+            # truncated files and oversized lengths are ignored
+            for cachefile in cachefiles:
+                with open(cachefile,'rb') as f:
+                    cachedata = f.read()
+                with open(cachefile,'wb') as f:
+                    f.write(cachedata[:len(cachedata)//2] + b'\xff'*8)
+            assert(LoadInProcess({'OPENRAVE_COLLADA_CACHE':'1'}) == expected)
+        finally:
+            shutil.rmtree(tempdir)
+
+    def _CheckColladaCache(self):
+        env=self.env
+        with env:
+            robot0 = self.LoadRobot('robots/neuronics-katana.zae')
+            robot1 = env.ReadRobotURI('robots/neuronics-katana.zae')
+            robot1.SetName('cached')
+            env.Add(robot1,True)
+            misc.CompareBodies(robot0,robot1,epsilon=g_epsilon)
+            assert(robot0.GetKinematicsGeometryHash() == robot1.GetKinematicsGeometryHash())
+            assert(robot0.GetRobotStructureHash() == robot1.GetRobotStructureHash())
+            assert(robot1.GetURI() == robot0.GetURI())
+            
+            # the collada bindings are restored, so external references can still be written
+            env.Remove(robot0)
+            env.Save('test_colladacache.dae',Environment.SelectionOptions.Everything,{'externalref':'*'})
+            env2 = Environment()
+            try:
+                env2.Load('test_colladacache.dae')
+                misc.CompareEnvironments(env, env2)
+            finally:
+                env2.Destroy()
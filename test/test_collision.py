@@ -268,6 +268,58 @@ class RunCollision(EnvironmentSetup):
         manip.CheckEndEffectorCollision(report)
         assert(len(report.vLinkColliding)==4)
 
+    def test_clonedtrimesh(self):
+        self.log.info('cloned trimeshes share the mesh of the original without changing any result')
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        clonedenv=Environment()
+        try:
+            with env:
+                robot = env.GetRobots()[0]
+                manip = robot.GetManipulators()[0]
+                env.GetKinBody('mug1').SetTransform(manip.GetEndEffector().GetTransform())
+                clonedenv.Clone(env, CloningOptions.Bodies)
+                clonedenv.SetCollisionChecker(RaveCreateCollisionChecker(clonedenv,self.collisioncheckername))
+                clonedrobot = clonedenv.GetRobot(robot.GetName())
+                geompairs = []
+                for body in env.GetBodies():
+                    clonedbody = clonedenv.GetKinBody(body.GetName())
+                    for link,clonedlink in zip(body.GetLinks(),clonedbody.GetLinks()):
+                        geompairs += zip(link.GetGeometries(),clonedlink.GetGeometries())
+                    # the geometry is serialized from the shared mesh
+                    assert(body.serialize(SerializationOptions.Geometry) == clonedbody.serialize(SerializationOptions.Geometry))
+                assert(any([geom.GetType() == GeometryType.Trimesh for geom,clonedgeom in geompairs]))
+                for geom,clonedgeom in geompairs:
+                    ab = geom.ComputeAABB(eye(4))
+                    clonedab = clonedgeom.ComputeAABB(eye(4))
+                    assert(sum(abs(ab.pos()-clonedab.pos())) <= g_epsilon and sum(abs(ab.extents()-clonedab.extents())) <= g_epsilon)
+
+                lower,upper = robot.GetDOFLimits()
+                lower = maximum(lower,-pi)
+                upper = minimum(upper,pi)
+                for iconfig in range(10):
+                    values = lower + random.rand(len(lower))*(upper-lower)
+                    robot.SetDOFValues(values)
+                    clonedrobot.SetDOFValues(values)
+                    assert(env.CheckCollision(robot) == clonedenv.CheckCollision(clonedrobot))
+                    assert(robot.CheckSelfCollision() == clonedrobot.CheckSelfCollision())
+
+                # copying the mesh out of the shared buffer is lossless
+                for geom,clonedgeom in geompairs:
+                    mesh = geom.GetCollisionMesh()
+                    clonedmesh = clonedgeom.GetCollisionMesh()
+                    assert(array_equal(mesh.vertices,clonedmesh.vertices) and array_equal(mesh.indices,clonedmesh.indices))
+                    assert(array_equal(mesh.vertices,clonedgeom.GetInfo()._meshcollision.vertices))
+
+                # changing the mesh of the clone leaves the original alone
+                geom,clonedgeom = [(geom,clonedgeom) for geom,clonedgeom in geompairs if geom.GetType() == GeometryType.Trimesh and clonedgeom.IsModifiable()][0]
+                numvertices = len(geom.GetCollisionMesh().vertices)
+                clonedgeom.SetCollisionMesh(TriMesh(array([[0,0,0],[0.01,0,0],[0,0.01,0]]),array([[0,1,2]])))
+                assert(len(clonedgeom.GetCollisionMesh().vertices) == 3)
+                assert(len(geom.GetCollisionMesh().vertices) == numvertices)
+        finally:
+            clonedenv.Destroy()
+
 #generate_classes(RunCollision, globals(), [('ode','ode'),('bullet','bullet')])
 
 class test_ode(RunCollision):
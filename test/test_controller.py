@@ -65,6 +65,175 @@ class test_ideal(RunController):
     def __init__(self):
         RunController.__init__(self, 'IdealController')
 
+    def test_realtime(self):
+        self.log.debug('runs a trajectory from the fixed rate thread of the controller')
+        robot=self.LoadRobot('robots/schunk-lwa3.zae')
+        env=self.env
+        robot.GetController().SendCommand('SetRealTimeRate 500')
+        with env:
+            initvalues = robot.GetActiveDOFValues()
+            waypoint=zeros(robot.GetActiveDOF())
+            waypoint[0] = 0.5
+            waypoint[1] = 0.5
+            traj=RaveCreateTrajectory(env, '')
+            traj.Init(robot.GetActiveConfigurationSpecification('quadratic'))
+            traj.Insert(0,r_[initvalues,waypoint])
+            ret=planningutils.RetimeActiveDOFTrajectory(traj,robot,False, 1, 1, 'ParabolicTrajectoryRetimer2')
+            assert(ret.statusCode==PlannerStatusCode.HasSolution)
+            self.RunTrajectory(robot,traj)
+            assert(transdist(robot.GetActiveDOFValues(),waypoint) <= g_epsilon)
+        stats = [float(s) for s in robot.GetController().SendCommand('GetRealTimeStats').split()]
+        assert(len(stats) == 4)
+        assert(stats[0] > 0 and stats[1] <= stats[0])
+        assert(0 <= stats[2] <= stats[3])
+        robot.GetController().SendCommand('SetRealTimeRate 0')
+
+    def test_realtimepause(self):
+        self.log.debug('real-time thread sets the samples itself, freezes them while paused and scales them by the speed')
+        robot=self.LoadRobot('robots/schunk-lwa3.zae')
+        env=self.env
+        controller=robot.GetController()
+        # errors are only reported from SimulationStep when throwing exceptions, so let the thread set the samples
+        controller.SendCommand('SetThrowExceptions 0')
+        controller.SendCommand('SetRealTimeRate 500')
+        with env:
+            initvalues = robot.GetActiveDOFValues()
+            waypoint=zeros(robot.GetActiveDOF())
+            waypoint[0] = 0.5
+            waypoint[1] = 0.5
+            traj=RaveCreateTrajectory(env, '')
+            traj.Init(robot.GetActiveConfigurationSpecification('quadratic'))
+            traj.Insert(0,r_[initvalues,waypoint])
+            ret=planningutils.RetimeActiveDOFTrajectory(traj,robot,False, 1, 1, 'ParabolicTrajectoryRetimer2')
+            assert(ret.statusCode==PlannerStatusCode.HasSolution)
+            duration = traj.GetDuration()
+            assert(duration > 0.5)
+
+        def RunWithoutSimulation(speed):
+            controller.SendCommand('SetSpeed %f'%speed)
+            with env:
+                robot.SetActiveDOFValues(initvalues)
+                controller.SetPath(traj)
+            starttime = time.time()
+            while not controller.IsDone():
+                assert(time.time()-starttime < 20*duration)
+                time.sleep(0.005)
+            elapsed = time.time()-starttime
+            with env:
+                assert(transdist(robot.GetActiveDOFValues(),waypoint) <= g_epsilon)
+            return elapsed
+
+        # the environment is never stepped, so the thread has to set the samples
+        elapsednormal = RunWithoutSimulation(1)
+        assert(elapsednormal >= 0.9*duration)
+        elapsedslow = RunWithoutSimulation(0.5)
+        assert(elapsedslow >= 1.8*duration)
+        assert(elapsedslow > elapsednormal)
+
+        controller.SendCommand('SetSpeed 1')
+        with env:
+            robot.SetActiveDOFValues(initvalues)
+            controller.SetPath(traj)
+        time.sleep(0.1*duration)
+        controller.SendCommand('Pause 1')
+        time.sleep(0.05)
+        with env:
+            pausedtime = controller.GetTime()
+            pausedvalues = robot.GetActiveDOFValues()
+        assert(0 < pausedtime < duration)
+        time.sleep(0.5*duration)
+        with env:
+            assert(controller.GetTime() == pausedtime)
+            assert(transdist(robot.GetActiveDOFValues(),pausedvalues) <= g_epsilon)
+        resumetime = time.time()
+        controller.SendCommand('Pause 0')
+        time.sleep(0.05)
+        with env:
+            # continues from where it was paused instead of jumping by the paused time
+            assert(pausedtime < controller.GetTime() <= pausedtime + (time.time()-resumetime) + 0.1*duration)
+        while not controller.IsDone():
+            time.sleep(0.005)
+        with env:
+            assert(transdist(robot.GetActiveDOFValues(),waypoint) <= g_epsilon)
+        controller.SendCommand('SetRealTimeRate 0')
+        controller.SendCommand('SetThrowExceptions 1')
+
+    def test_lookahead(self):
+        self.log.debug('stops a trajectory before a collision found by the look-ahead checks')
+        robot=self.LoadRobot('robots/schunk-lwa3.zae')
+        env=self.env
+        robot.GetController().SendCommand('SetLookAheadCollisionChecking 0.2 0.01')
+        with env:
+            initvalues = robot.GetActiveDOFValues()
+            waypoint=zeros(robot.GetActiveDOF())
+            waypoint[1] = 1.0
+            # put an obstacle at the last link at the end of the trajectory
+            robot.SetActiveDOFValues(waypoint)
+            ab = robot.GetLinks()[-1].ComputeAABB()
+            robot.SetActiveDOFValues(initvalues)
+            obstacle = RaveCreateKinBody(env,'')
+            obstacle.SetName('obstacle')
+            obstacle.InitFromBoxes(array([r_[ab.pos(),0.02,0.02,0.02]]),True)
+            env.Add(obstacle)
+            assert(not env.CheckCollision(robot))
+
+            traj=RaveCreateTrajectory(env, '')
+            traj.Init(robot.GetActiveConfigurationSpecification('quadratic'))
+            traj.Insert(0,r_[initvalues,waypoint])
+            ret=planningutils.RetimeActiveDOFTrajectory(traj,robot,False, 1, 1, 'ParabolicTrajectoryRetimer2')
+            assert(ret.statusCode==PlannerStatusCode.HasSolution)
+            try:
+                self.RunTrajectory(robot,traj)
+                raise ValueError('controller did not stop before the collision')
+
+            except openrave_exception:
+                pass
+
+            assert(robot.GetController().IsDone())
+            assert(not env.CheckCollision(robot))
+
+        # the real-time thread waits for the checks and stops the same way
+        robot.GetController().SendCommand('SetRealTimeRate 100')
+        with env:
+            try:
+                self.RunTrajectory(robot,traj)
+                raise ValueError('real-time controller did not stop before the collision')
+
+            except openrave_exception:
+                pass
+
+            assert(robot.GetController().IsDone())
+            assert(not env.CheckCollision(robot))
+        robot.GetController().SendCommand('SetRealTimeRate 0')
+
+        self.log.debug('an obstacle grabbed in the middle of the trajectory moves with the robot, so it is not a collision')
+        with env:
+            midpoint = 0.5*(initvalues+waypoint)
+            robot.SetActiveDOFValues(midpoint)
+            assert(not env.CheckCollision(robot))
+            robot.SetActiveDOFValues(initvalues)
+            traj=RaveCreateTrajectory(env, '')
+            traj.Init(robot.GetActiveConfigurationSpecification('quadratic'))
+            traj.Insert(0,r_[initvalues,midpoint,waypoint])
+            ret=planningutils.RetimeActiveDOFTrajectory(traj,robot,False, 1, 1, 'ParabolicTrajectoryRetimer2')
+            assert(ret.statusCode==PlannerStatusCode.HasSolution)
+            activespec = robot.GetActiveConfigurationSpecification()
+            grabspec = traj.GetConfigurationSpecification()
+            grabspec.AddGroup('grab %s %d'%(robot.GetName(),robot.GetLinks()[-1].GetIndex()),1,'previous')
+            graboffset = grabspec.GetGroupFromName('grab').offset
+            trajgrab = RaveCreateTrajectory(env,'')
+            trajgrab.Init(grabspec)
+            data=traj.GetWaypoints(0,traj.GetNumWaypoints(),grabspec)
+            grabindices = [i for i in range(traj.GetNumWaypoints()) if transdist(traj.GetWaypoint(i,activespec),midpoint) <= g_epsilon]
+            assert(len(grabindices) > 0)
+            data[grabindices[0]*grabspec.GetDOF()+graboffset] = obstacle.GetEnvironmentBodyIndex()
+            trajgrab.Insert(0,data)
+            self.RunTrajectory(robot,trajgrab)
+            assert(transdist(robot.GetActiveDOFValues(),waypoint) <= g_epsilon)
+            assert(robot.IsGrabbing(obstacle) is not None)
+            robot.ReleaseAllGrabbed()
+        robot.GetController().SendCommand('SetLookAheadCollisionChecking 0')
+
 # class test_bullet(RunController):
 #     def __init__(self):
 #         RunController.__init__(self, 'bullet')
@@ -14,7 +14,50 @@
 from common_test_openrave import *
 from subprocess import Popen, PIPE
 import shutil
+import sys
+import tempfile
 import threading
+import json
+import hashlib
+import re
+import struct
+
+class MsgPackExt(object):
+    """msgpack extension value for _PackMsgPack"""
+    def __init__(self, exttype, data):
+        self.exttype = exttype
+        self.data = data
+
+def _PackTypedArray(dtype, values, shape=None):
+    """returns the openrave typed array extension of values"""
+    if shape is None:
+        shape = [len(values)]
+    return MsgPackExt(0x10, struct.pack('<cB%dI'%len(shape), dtype.encode('ascii'), len(shape), *shape) + struct.pack('<%d%s'%(len(values), dtype), *values))
+
+def _PackMsgPack(value):
+    """packs python values into msgpack bytes without depending on the msgpack module"""
+    if value is None:
+        return b'\xc0'
+    if value is True:
+        return b'\xc3'
+    if value is False:
+        return b'\xc2'
+    if isinstance(value, MsgPackExt):
+        return struct.pack('>BIb', 0xc9, len(value.data), value.exttype) + value.data
+    if isinstance(value, bytes) and not isinstance(value, str):
+        return struct.pack('>BI', 0xc6, len(value)) + value
+    if isinstance(value, int):
+        return struct.pack('>Bq', 0xd3, value)
+    if isinstance(value, float):
+        return struct.pack('>Bd', 0xcb, value)
+    if isinstance(value, (str, type(u''))):
+        data = value.encode('utf-8') if isinstance(value, type(u'')) else value
+        return struct.pack('>BI', 0xdb, len(data)) + data
+    if isinstance(value, (list, tuple)):
+        return struct.pack('>BI', 0xdd, len(value)) + b''.join(_PackMsgPack(item) for item in value)
+    if isinstance(value, dict):
+        return struct.pack('>BI', 0xdf, len(value)) + b''.join(_PackMsgPack(key) + _PackMsgPack(item) for key, item in value.items())
+    raise ValueError('cannot pack %r'%(value,))
 
 class TestEnvironment(EnvironmentSetup):
     def test_load(self):
@@ -209,6 +252,531 @@ class TestEnvironment(EnvironmentSetup):
         for t in threads:
             t.join()
 
+    def test_simulationstepthreads(self):
+        self.log.info('step read-only modules and sensors concurrently')
+        env=self.env
+        with env:
+            self.LoadEnv('data/lab1.env.xml')
+            for isensor in range(8):
+                sensor = RaveCreateSensor(env,'BaseForce6D')
+                sensor.SetName('force%d'%isensor)
+                env.Add(sensor)
+            # the test module reads all the links in every step
+            modules = []
+            for imodule in range(8):
+                module = RaveCreateModule(env,'ReadOnlyStepTest')
+                assert(module is not None)
+                env.Add(module)
+                modules.append(module)
+            numlinks = sum(len(body.GetLinks()) for body in env.GetBodies())
+            assert(env.GetSimulationStepThreads()==1)
+            env.SetSimulationStepThreads(4)
+            assert(env.GetSimulationStepThreads()==4)
+            simtime = env.GetSimulationTime()
+            for istep in range(10):
+                laststeptime = env.GetSimulationTime()
+                env.StepSimulation(0.01)
+            assert(env.GetSimulationTime() == simtime + 100000)
+            times = env.GetSimulationStepTimes()
+            assert(times['readonly'] > 0)
+            assert(times['physics']+times['bodies']+times['modules']+times['sensors']+times['readonly'] <= times['total'])
+            # every module was stepped once per step from the worker threads
+            for module in modules:
+                nsteps, stamp, steplinks = [int(s) for s in module.SendCommand('GetStepInfo').split()]
+                assert(nsteps == 10 and stamp == laststeptime and steplinks == numlinks)
+            env.SetSimulationStepThreads(0)
+            assert(env.GetSimulationStepThreads()==1)
+            env.StepSimulation(0.01)
+            assert(env.GetSimulationStepTimes()['readonly'] == 0)
+            for module in modules:
+                assert(int(module.SendCommand('GetStepInfo').split()[0]) == 11)
+
+    def test_fastforwardsimulation(self):
+        self.log.info('fast forward the simulation deterministically')
+        env=self.env
+        with env:
+            self.LoadEnv('data/lab1.env.xml')
+            robot=env.GetRobots()[0]
+            simtime = env.GetSimulationTime()
+            env.FastForwardSimulation(1000, 0.01, 100)
+            assert(env.GetSimulationTime() == simtime + 10000000)
+            env.FastForwardSimulation(0, 0.01)
+            assert(env.GetSimulationTime() == simtime + 10000000)
+
+            # same trajectory from the same state gives the same result
+            initvalues = robot.GetActiveDOFValues()
+            goal = initvalues.copy()
+            goal[0] += 0.2
+            traj=RaveCreateTrajectory(env,'')
+            traj.Init(robot.GetActiveConfigurationSpecification('linear'))
+            traj.Insert(0,r_[initvalues,goal])
+            planningutils.RetimeActiveDOFTrajectory(traj,robot,False,1,1,'LinearTrajectoryRetimer')
+            allvalues = []
+            for itrial in range(2):
+                robot.SetActiveDOFValues(initvalues)
+                robot.GetController().SetPath(traj)
+                env.FastForwardSimulation(37, 0.01, 10)
+                allvalues.append(robot.GetDOFValues())
+            assert(all(allvalues[0] == allvalues[1]))
+
+    def test_publishedbodies(self):
+        self.log.info('published body states stay consistent while the simulation thread republishes them')
+        env=self.env
+        xmldata = """<robot name="arm">
+  <kinbody>
+    <body name="base"><geom type="box"><extents>0.1 0.1 0.1</extents></geom></body>
+    <body name="link1"><offsetfrom>base</offsetfrom><translation>0.5 0 0</translation><geom type="box"><extents>0.1 0.1 0.1</extents></geom></body>
+    <joint name="j0" type="hinge"><body>base</body><body>link1</body><offsetfrom>link1</offsetfrom><axis>0 0 1</axis><limitsdeg>-180 180</limitsdeg></joint>
+  </kinbody>
+</robot>"""
+        with env:
+            robot=env.ReadRobotXMLData(xmldata)
+            env.Add(robot)
+            robot.SetController(RaveCreateController(env,'IdealController'),list(range(robot.GetDOF())),0)
+            robot.SetActiveDOFs([0])
+            traj=RaveCreateTrajectory(env,'')
+            traj.Init(robot.GetActiveConfigurationSpecification('linear'))
+            traj.Insert(0,[-3.0,3.0,-3.0,3.0,-3.0])
+            planningutils.RetimeActiveDOFTrajectory(traj,robot,False,1,1,'LinearTrajectoryRetimer')
+            robot.GetController().SetPath(traj)
+
+        # the snapshots are rebuilt in reused buffers by the simulation thread while this thread copies them
+        jointvalues = set()
+        env.StartSimulation(0.001,False)
+        try:
+            starttime = time.time()
+            while time.time()-starttime < 1.0:
+                for state in env.GetPublishedBodies():
+                    if state['name'] == 'arm':
+                        T = state['linktransforms'][1]
+                        assert(abs(arctan2(T[1,0],T[0,0]) - state['jointvalues'][0]) <= 1e-6)
+                        jointvalues.add(round(float(state['jointvalues'][0]),9))
+        finally:
+            env.StopSimulation()
+        assert(len(jointvalues) > 2)
+
+        with env:
+            env.UpdatePublishedBodies()
+            state = env.GetPublishedBody('arm')
+            assert(abs(state['jointvalues'][0] - robot.GetDOFValues()[0]) <= g_epsilon)
+            assert(transdist(state['linktransforms'][1], robot.GetLinks()[1].GetTransform()) <= g_epsilon)
+
+    def test_deserializeinfo(self):
+        self.log.info('deserialize an environment with many bodies')
+        env=self.env
+        with env:
+            self.LoadEnv('data/lab1.env.xml')
+            envinfo = env.ExtractInfo()
+            envdata = envinfo.SerializeJSON()
+            envinfo2 = EnvironmentBaseInfo()
+            envinfo2.DeserializeJSON(envdata)
+            assert([bodyinfo._name for bodyinfo in envinfo2._vBodyInfos] == [body.GetName() for body in env.GetBodies()])
+            for bodyinfo in envinfo2._vBodyInfos:
+                body = env.GetKinBody(bodyinfo._name)
+                assert(bodyinfo._id == body.GetId())
+                assert(len(bodyinfo._vLinkInfos) == len(body.GetLinks()))
+
+            # the same body twice is applied in order
+            bodydata = envdata['bodies'][0]
+            envinfo2.DeserializeJSON({'bodies':[dict(bodydata, name='renamed0'), dict(bodydata, name='renamed1')]})
+            assert(envinfo2._vBodyInfos[0]._name == 'renamed1')
+            assert(len(envinfo2._vBodyInfos) == len(env.GetBodies()))
+
+    def test_updatefromdelta(self):
+        self.log.info('apply scene deltas with only the changed bodies')
+        env=self.env
+        with env:
+            self.LoadEnv('data/lab1.env.xml')
+            robot=env.GetRobots()[0]
+            body=[b for b in env.GetBodies() if not b.IsRobot()][0]
+            removebody=[b for b in env.GetBodies() if not b.IsRobot()][1]
+            bodydata = removebody.ExtractInfo().SerializeJSON()
+            T = body.GetTransform()
+            T[0:3,3] += [0.1,0.2,0.3]
+            joint = robot.GetJoints()[0]
+            dofvalues = robot.GetDOFValues()
+            dofvalues[joint.GetDOFIndex()] += 0.1
+            delta = {'bodies':[{'id':body.GetId(), 'transform':poseFromMatrix(T).tolist()},
+                               {'id':robot.GetId(), 'dofValues':[{'jointName':joint.GetName(), 'jointAxis':0, 'value':dofvalues[joint.GetDOFIndex()]}]},
+                               {'id':removebody.GetId(), '__deleted__':True}]}
+            createdBodies, modifiedBodies, removedBodies = env.UpdateFromDelta(delta)
+            assert(len(createdBodies) == 0)
+            assert(set(b.GetName() for b in modifiedBodies) == set([body.GetName(), robot.GetName()]))
+            assert([b.GetName() for b in removedBodies] == [removebody.GetName()])
+            assert(transdist(body.GetTransform(), T) <= g_epsilon)
+            assert(transdist(robot.GetDOFValues(), dofvalues) <= g_epsilon)
+            assert(env.GetKinBody(removebody.GetName()) is None)
+
+            # nothing changes when applying the same delta again
+            createdBodies, modifiedBodies, removedBodies = env.UpdateFromDelta(delta)
+            assert(len(createdBodies) == 0 and len(modifiedBodies) == 0 and len(removedBodies) == 0)
+
+            # a body modified by several entries is only reported once, in the order of its first modification
+            T2 = array(T)
+            T2[0:3,3] += [0.05,0,0]
+            Trobot = robot.GetTransform()
+            Trobot[0:3,3] += [0,0.05,0]
+            dofvalues[joint.GetDOFIndex()] += 0.1
+            createdBodies, modifiedBodies, removedBodies = env.UpdateFromDelta({'bodies':[{'id':robot.GetId(), 'dofValues':[{'jointName':joint.GetName(), 'jointAxis':0, 'value':dofvalues[joint.GetDOFIndex()]}]},
+                                                                                          {'id':body.GetId(), 'transform':poseFromMatrix(T).tolist()},
+                                                                                          {'id':body.GetId(), 'transform':poseFromMatrix(T2).tolist()},
+                                                                                          {'id':robot.GetId(), 'transform':poseFromMatrix(Trobot).tolist()}]})
+            assert([b.GetName() for b in modifiedBodies] == [robot.GetName(), body.GetName()])
+            assert(transdist(body.GetTransform(), T2) <= g_epsilon)
+            assert(transdist(robot.GetTransform(), Trobot) <= g_epsilon)
+            assert(transdist(robot.GetDOFValues(), dofvalues) <= g_epsilon)
+
+            # entries with more than transforms and dof values are loaded as infos
+            createdBodies, modifiedBodies, removedBodies = env.UpdateFromDelta({'bodies':[bodydata]})
+            assert([b.GetName() for b in createdBodies] == [removebody.GetName()])
+
+            # entries are applied in order, also when some of them are loaded as infos
+            T0 = env.GetKinBody(removebody.GetName()).GetTransform()
+            T1 = array(T0)
+            T1[0:3,3] += [0.2,0.1,0.05]
+            fullbodydata = dict(bodydata)
+            fullbodydata['transform'] = poseFromMatrix(T0).tolist()
+            fullbodydata['name'] = removebody.GetName() + '_renamed'
+            createdBodies, modifiedBodies, removedBodies = env.UpdateFromDelta({'bodies':[fullbodydata, {'id':bodydata['id'], 'transform':poseFromMatrix(T1).tolist()}]})
+            assert([b.GetName() for b in modifiedBodies] == [fullbodydata['name']])
+            assert(transdist(env.GetKinBody(fullbodydata['name']).GetTransform(), T1) <= g_epsilon)
+            fullbodydata['name'] = removebody.GetName()
+            env.UpdateFromDelta({'bodies':[{'id':bodydata['id'], 'transform':poseFromMatrix(T1).tolist()}, fullbodydata]})
+            assert(transdist(env.GetKinBody(removebody.GetName()).GetTransform(), T0) <= g_epsilon)
+            createdBodies, modifiedBodies, removedBodies = env.UpdateFromDelta({'bodies':[{'id':bodydata['id'], '__deleted__':True}, bodydata]})
+            assert([b.GetName() for b in createdBodies] == [removebody.GetName()])
+            createdBodies, modifiedBodies, removedBodies = env.UpdateFromDelta({'bodies':[bodydata, {'id':bodydata['id'], '__deleted__':True}]})
+            assert(env.GetKinBody(removebody.GetName()) is None)
+
+    def test_msgpacktypedarrays(self):
+        self.log.info('meshes written as msgpack typed arrays are read back exactly for every dtype')
+        env=self.env
+        # float32 vertices with uint8 indices, float64 vertices with uint16 indices, int32 indices
+        meshes = []
+        for numvertices, scale in [(20, 0.5), (300, 0.1), (70000, 0.25)]:
+            vertices = array([[i*scale, -i*scale, 1.0] for i in range(numvertices)])
+            indices = array([[i, (i+1)%numvertices, (i+2)%numvertices] for i in range(numvertices)])
+            meshes.append(TriMesh(vertices, indices))
+        with env:
+            env.Reset()
+            for imesh, mesh in enumerate(meshes):
+                body = RaveCreateKinBody(env,'')
+                body.InitFromTrimesh(mesh, True)
+                body.SetName('mesh%d'%imesh)
+                env.Add(body)
+            typeddata = env.WriteToMemory('msgpack', Environment.SelectionOptions.Everything, {'typedArrays':'1'})
+            plaindata = env.WriteToMemory('msgpack', Environment.SelectionOptions.Everything)
+            assert(len(typeddata) < len(plaindata))
+            bodyinfo = env.GetKinBody('mesh0').ExtractInfo().SerializeJSON()
+
+        env2 = Environment()
+        try:
+            with env2:
+                env2.UpdateFromDeltaMsgPack(typeddata)
+                for imesh, mesh in enumerate(meshes):
+                    mesh2 = env2.GetKinBody('mesh%d'%imesh).GetLinks()[0].GetGeometries()[0].GetCollisionMesh()
+                    assert(transdist(mesh2.vertices, mesh.vertices) <= g_epsilon)
+                    assert(all(mesh2.indices == mesh.indices))
+
+                # int64 and every other dtype is expanded by the parser
+                vertices = [float(i) for i in range(18)]
+                indices = list(range(18))
+                geominfo = bodyinfo['links'][0]['geometries'][0]
+                for dtype in ['B','H','i','q','f','d']:
+                    values = vertices if dtype in 'fd' else [int(x) for x in vertices]
+                    if dtype == 'q':
+                        values = [x + 2**40 for x in values]
+                    typedgeominfo = dict(geominfo, mesh={'vertices':_PackTypedArray(dtype, values), 'indices':_PackTypedArray('B', indices)})
+                    typedlinkinfo = dict(bodyinfo['links'][0], geometries=[typedgeominfo])
+                    typedbodyinfo = dict(bodyinfo, name='typed'+dtype, id='typed'+dtype, links=[typedlinkinfo])
+                    env2.UpdateFromDeltaMsgPack(_PackMsgPack({'bodies':[typedbodyinfo]}))
+                    mesh2 = env2.GetKinBody('typed'+dtype).GetLinks()[0].GetGeometries()[0].GetCollisionMesh()
+                    assert(transdist(mesh2.vertices.flatten(), values) <= g_epsilon)
+                    assert(list(mesh2.indices.flatten()) == indices)
+
+                # shapes whose element count overflows are rejected instead of read out of bounds
+                overflow = MsgPackExt(0x10, struct.pack('<cB2I', b'd', 2, 2**31, 2**31))
+                assert_raises(openrave_exception, env2.UpdateFromDeltaMsgPack, _PackMsgPack({'bodies':[overflow]}))
+                truncated = _PackTypedArray('d', [1.0]*16)
+                truncated.data = truncated.data[:-8]
+                assert_raises(openrave_exception, env2.UpdateFromDeltaMsgPack, _PackMsgPack({'bodies':[truncated]}))
+        finally:
+            env2.Destroy()
+
+    def test_msgpackparse(self):
+        self.log.info('msgpack data is parsed into the same documents as json')
+        env=self.env
+        with env:
+            self.LoadEnv('data/mug1.kinbody.xml')
+            bodyinfo = env.GetBodies()[0].ExtractInfo().SerializeJSON()
+
+        # the files of a body are kept as they are, so they show what the parser produced
+        files = {'nested':{'map':{'values':[1, -2, 1.5, True, None, 'text']}, 'empty':{}}, 7:'positive key', -3:'negative key', 'bin':b'binary data',
+                 'timestamp32':MsgPackExt(-1, struct.pack('>I', 86400*365)),
+                 'timestamp64':MsgPackExt(-1, struct.pack('>Q', (500000000 << 34) | (86400*365)))}
+        delta = {'bodies':[dict(bodyinfo, name=b'parsed', id='parsed', files=files)]}
+        env2 = Environment()
+        try:
+            with env2:
+                env2.UpdateFromDeltaMsgPack(_PackMsgPack(delta))
+                body = env2.GetKinBody('parsed')
+                assert(body is not None)
+                parsedfiles = body.ExtractInfo().SerializeJSON()['files']
+                assert(parsedfiles['nested'] == {'map':{'values':[1, -2, 1.5, True, None, 'text']}, 'empty':{}})
+                assert(parsedfiles['7'] == 'positive key')
+                assert(parsedfiles['-3'] == 'negative key')
+                assert(parsedfiles['bin'] == 'binary data')
+                # timestamps are formatted in local time, which is at most a day away from utc
+                for key, fraction in [('timestamp32', ''), ('timestamp64', r'\.5')]:
+                    assert(re.match(r'^19(70-12-31|71-01-01)T\d\d:\d\d:\d\d%s(Z|[+-]\d\d:\d\d)$'%fraction, parsedfiles[key]) is not None)
+
+                # truncated and malformed data raise instead of producing a partial document
+                data = _PackMsgPack(delta)
+                for truncated in [data[:len(data)//2], data[:-1], data[:1]]:
+                    assert_raises(openrave_exception, env2.UpdateFromDeltaMsgPack, truncated)
+                # a map cannot be a key
+                assert_raises(openrave_exception, env2.UpdateFromDeltaMsgPack, b'\x81\x80\xc0')
+                # 0xc1 is never used
+                assert_raises(openrave_exception, env2.UpdateFromDeltaMsgPack, b'\xc1')
+        finally:
+            env2.Destroy()
+
+    def test_downloadcache(self):
+        self.log.info('download remote documents once and revalidate them with the on-disk cache')
+        try:
+            from http.server import BaseHTTPRequestHandler, HTTPServer
+        except ImportError:
+            from BaseHTTPServer import BaseHTTPRequestHandler, HTTPServer
+        env=self.env
+        with env:
+            self.LoadEnv('data/mug1.kinbody.xml')
+            body=env.GetBodies()[0]
+            bodyname=body.GetName()
+            content=json.dumps({'bodies':[body.ExtractInfo().SerializeJSON()]}).encode('utf-8')
+            env.Remove(body)
+
+        # unique per run so that the cache of an earlier run is not valid
+        etag='"%d"'%int(time.time()*1000000)
+        responses=[]
+        class ETagHandler(BaseHTTPRequestHandler):
+            def do_GET(self):
+                if self.headers.get('If-None-Match') == etag:
+                    self.send_response(304)
+                    self.end_headers()
+                    responses.append(304)
+                    return
+                self.send_response(200)
+                self.send_header('ETag', etag)
+                self.send_header('Content-Length', str(len(content)))
+                self.end_headers()
+                self.wfile.write(content)
+                responses.append(200)
+            def log_message(self, format, *args):
+                pass
+        server=HTTPServer(('127.0.0.1', 0), ETagHandler)
+        thread=threading.Thread(target=server.serve_forever)
+        thread.start()
+        try:
+            atts={'remoteurl':'http://127.0.0.1:%d/'%server.server_address[1]}
+            url=atts['remoteurl']+'downloadcache.json'
+            cachefile=os.path.join(RaveGetHomeDirectory(),'jsondownloadcache',hashlib.md5(url.encode('utf-8')).hexdigest()+'.bin')
+            # the on-disk cache is opt-in, so without it every load downloads the document
+            for iload in range(2):
+                with env:
+                    assert(env.LoadURI('openrave:downloadcache.json', atts))
+                    assert(env.GetKinBody(bodyname) is not None)
+                    env.Remove(env.GetKinBody(bodyname))
+            assert(responses == [200, 200])
+            assert(not os.path.exists(cachefile))
+            del responses[:]
+
+            os.environ['OPENRAVE_JSON_DOWNLOAD_CACHE'] = '1'
+            for iload in range(2):
+                with env:
+                    assert(env.LoadURI('openrave:downloadcache.json', atts))
+                    assert(env.GetKinBody(bodyname) is not None)
+                    env.Remove(env.GetKinBody(bodyname))
+            # the second load only revalidates the cached document
+            assert(responses == [200, 304])
+
+            # a cached document that cannot be read after its validators were sent is downloaded again
+            with open(cachefile,'rb') as f:
+                cachedata=f.read()
+            headersize=8+(4+len(url))+(4+len(etag))+4
+            with open(cachefile,'wb') as f:
+                f.write(cachedata[:headersize+1+4+16])
+            for iload in range(2):
+                with env:
+                    assert(env.LoadURI('openrave:downloadcache.json', atts))
+                    assert(env.GetKinBody(bodyname) is not None)
+                    env.Remove(env.GetKinBody(bodyname))
+            assert(responses == [200, 304, 304, 200, 304])
+            assert(os.path.getsize(cachefile) == len(cachedata))
+        finally:
+            os.environ.pop('OPENRAVE_JSON_DOWNLOAD_CACHE', None)
+            server.shutdown()
+            server.server_close()
+            thread.join()
+
+    def test_downloadcachetypedarrays(self):
+        self.log.info('downloaded arrays mixing integers and doubles are cached as typed arrays and read back exactly')
+        try:
+            from http.server import BaseHTTPRequestHandler, HTTPServer
+        except ImportError:
+            from BaseHTTPServer import BaseHTTPRequestHandler, HTTPServer
+        env=self.env
+        numvertices = 20
+        vertices = array([[i, 0.5*i, 0.1*i] for i in range(numvertices)])
+        indices = array([[i, (i+1)%numvertices, (i+2)%numvertices] for i in range(numvertices)])
+        with env:
+            body = RaveCreateKinBody(env,'')
+            body.InitFromTrimesh(TriMesh(vertices, indices), True)
+            body.SetName('mixedmesh%d'%int(time.time()*1000000))
+            bodyname = body.GetName()
+            bodyinfo = body.ExtractInfo().SerializeJSON()
+        # written like json from other sources, where integer-valued numbers have no fraction
+        mesh = bodyinfo['links'][0]['geometries'][0]['mesh']
+        mesh['vertices'] = [int(x) if float(x) == int(x) else float(x) for x in mesh['vertices']]
+        assert(any(isinstance(x, int) for x in mesh['vertices']) and any(isinstance(x, float) for x in mesh['vertices']))
+        content = json.dumps({'bodies':[bodyinfo]}).encode('utf-8')
+
+        etag='"%s"'%bodyname
+        class ETagHandler(BaseHTTPRequestHandler):
+            def do_GET(self):
+                if self.headers.get('If-None-Match') == etag:
+                    self.send_response(304)
+                    self.end_headers()
+                    return
+                self.send_response(200)
+                self.send_header('ETag', etag)
+                self.send_header('Content-Length', str(len(content)))
+                self.end_headers()
+                self.wfile.write(content)
+            def log_message(self, format, *args):
+                pass
+        server=HTTPServer(('127.0.0.1', 0), ETagHandler)
+        thread=threading.Thread(target=server.serve_forever)
+        thread.start()
+        os.environ['OPENRAVE_JSON_DOWNLOAD_CACHE'] = '1'
+        try:
+            atts={'remoteurl':'http://127.0.0.1:%d/'%server.server_address[1]}
+            # the second load reads the cached document
+            for iload in range(2):
+                with env:
+                    assert(env.LoadURI('openrave:mixedmesh.json', atts))
+                    mesh2 = env.GetKinBody(bodyname).GetLinks()[0].GetGeometries()[0].GetCollisionMesh()
+                    assert(transdist(mesh2.vertices, vertices) <= g_epsilon)
+                    assert(all(mesh2.indices == indices))
+                    env.Remove(env.GetKinBody(bodyname))
+            url=atts['remoteurl']+'mixedmesh.json'
+            cachefile=os.path.join(RaveGetHomeDirectory(),'jsondownloadcache',hashlib.md5(url.encode('utf-8')).hexdigest()+'.bin')
+            with open(cachefile,'rb') as f:
+                cachedata=f.read()
+            headersize=8+(4+len(url))+(4+len(etag))+4
+            if cachedata[headersize:headersize+1] == b'\x01':
+                # the document is cached as msgpack, the vertices have to be one typed array of doubles
+                assert(b'\x10d\x01'+struct.pack('<I', 3*numvertices) in cachedata)
+        finally:
+            os.environ.pop('OPENRAVE_JSON_DOWNLOAD_CACHE', None)
+            server.shutdown()
+            server.server_close()
+            thread.join()
+
+    def test_lazygeometry(self):
+        self.log.info('primitive geometries are only tessellated when their mesh is requested')
+        # the mode is read once per process
+        script = """
+from openravepy import *
+env=Environment()
+try:
+    with env:
+        geominfo=KinBody.GeometryInfo()
+        geominfo._type=GeometryType.Box
+        geominfo._vGeomData=[0.1,0.2,0.3]
+        linkinfo=KinBody.LinkInfo()
+        linkinfo._name='base'
+        linkinfo._vgeometryinfos=[geominfo]
+        body=RaveCreateKinBody(env,'')
+        body.InitFromLinkInfos([linkinfo])
+        body.SetName('box')
+        env.Add(body)
+        link=body.GetLinks()[0]
+        geom=link.GetGeometries()[0]
+        assert(len(geom.GetInfo()._meshcollision.vertices) == 0)
+        assert(len(link.GetCollisionData().vertices) == 8)
+        assert(len(geom.GetCollisionMesh().vertices) == 8)
+        assert(env.CheckCollision(body) == False)
+        print('ok')
+finally:
+    env.Destroy()
+    RaveDestroy()
+"""
+        environ = dict(os.environ, OPENRAVE_LAZY_GEOMETRY='1')
+        process = Popen([sys.executable, '-c', script], stdout=PIPE, env=environ)
+        output = process.communicate()[0]
+        assert(process.returncode == 0 and b'ok' in output)
+
+    def test_trimeshcache(self):
+        self.log.info('meshes from the trimesh cache keep the colors of each caller and ignore corrupted cache files')
+        env=self.env
+        tempdir = tempfile.mkdtemp()
+        try:
+            # a fresh copy so that no cache file from a previous run matches
+            meshfile = os.path.join(tempdir,'bucket-back.wrl')
+            shutil.copyfile('testdata/bobcat_arm_vrml/bucket-back.wrl',meshfile)
+            homedir = os.path.join(tempdir,'home')
+            xmldata = '<kinbody name="mesh"><body name="base"><geom type="trimesh"><data>%s</data></geom></body></kinbody>'%meshfile
+            script = """
+from openravepy import *
+env=Environment()
+try:
+    with env:
+        body=env.ReadKinBodyXMLData(%r)
+        geom=body.GetLinks()[0].GetGeometries()[0]
+        print(repr([float(x) for x in geom.GetDiffuseColor()]+[float(x) for x in geom.GetAmbientColor()]+[geom.GetTransparency(), len(geom.GetCollisionMesh().vertices)]))
+finally:
+    env.Destroy()
+    RaveDestroy()
+"""%xmldata
+            def LoadInProcess(environ):
+                process = Popen([sys.executable, '-c', script], stdout=PIPE, env=dict(os.environ, **environ))
+                output = process.communicate()[0]
+                assert(process.returncode == 0)
+                return array(eval(output.strip().splitlines()[-1]))
+
+            expected = LoadInProcess({'OPENRAVE_HOME':homedir})
+            assert(expected[-1] > 0)
+            # the cache is opt-in
+            assert(not os.path.exists(os.path.join(homedir,'trimeshcache')))
+            # writes the disk cache
+            assert(sum(abs(LoadInProcess({'OPENRAVE_TRIMESH_CACHE':'1','OPENRAVE_HOME':homedir})-expected)) <= g_epsilon)
+            cachefiles = [os.path.join(homedir,'trimeshcache',filename) for filename in os.listdir(os.path.join(homedir,'trimeshcache')) if filename.endswith('.bin')]
+            assert(len(cachefiles) == 1)
+            # reads the disk cache
+            assert(sum(abs(LoadInProcess({'OPENRAVE_TRIMESH_CACHE':'1','OPENRAVE_HOME':homedir})-expected)) <= g_epsilon)
+            # a truncated cache file is ignored
+            with open(cachefiles[0],'rb') as f:
+                cachedata = f.read()
+            with open(cachefiles[0],'wb') as f:
+                f.write(cachedata[:len(cachedata)//2])
+            assert(sum(abs(LoadInProcess({'OPENRAVE_TRIMESH_CACHE':'1','OPENRAVE_HOME':homedir})-expected)) <= g_epsilon)
+
+            # the cache is opt-in and read on every load
+            os.environ['OPENRAVE_TRIMESH_CACHE'] = '1'
+            try:
+                with env:
+                    # the first load of the file passes in different default colors
+                    assert(env.ReadTrimeshURI(meshfile) is not None)
+                    for iload in range(2):
+                        body=env.ReadKinBodyXMLData(xmldata)
+                        geom=body.GetLinks()[0].GetGeometries()[0]
+                        values = array([float(x) for x in geom.GetDiffuseColor()]+[float(x) for x in geom.GetAmbientColor()]+[geom.GetTransparency(), len(geom.GetCollisionMesh().vertices)])
+                        assert(sum(abs(values-expected)) <= g_epsilon)
+            finally:
+                del os.environ['OPENRAVE_TRIMESH_CACHE']
+        finally:
+            shutil.rmtree(tempdir)
+
     def test_dataccess(self):
         RaveDestroy()
         OPENRAVE_DATA = os.environ.get('OPENRAVE_DATA','')
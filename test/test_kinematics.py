@@ -12,6 +12,10 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 from common_test_openrave import *
+from subprocess import Popen, PIPE
+import shutil
+import sys
+import tempfile
 
 class TestKinematics(EnvironmentSetup):
     def test_bodybasic(self):
@@ -1056,6 +1060,70 @@ class TestKinematics(EnvironmentSetup):
                 curposes = poseFromMatrices(robot.GetLinkTransformations())
                 assert( transdist(linkposes,curposes) <= 1e-6 )
 
+    def test_hierarchysnapshot(self):
+        self.log.info('check that bodies with the same kinematics share the same hierarchy')
+        env=self.env
+        with env:
+            robot0=env.ReadRobotURI('testdata/bobcat.robot.xml')
+            env.Add(robot0,True)
+            robot1=env.ReadRobotURI('testdata/bobcat.robot.xml')
+            env.Add(robot1,True)
+            assert(robot0.GetName() != robot1.GetName())
+            assert(robot0.GetKinematicsGeometryHash() == robot1.GetKinematicsGeometryHash())
+            assert([j.GetName() for j in robot0.GetDependencyOrderedJoints()] == [j.GetName() for j in robot1.GetDependencyOrderedJoints()])
+            assert([[(link.GetName(),joint.GetName()) for link,joint in loop] for loop in robot0.GetClosedLoops()] == [[(link.GetName(),joint.GetName()) for link,joint in loop] for loop in robot1.GetClosedLoops()])
+            for link0,link1 in zip(robot0.GetLinks(),robot1.GetLinks()):
+                assert([l.GetName() for l in link0.GetParentLinks()] == [l.GetName() for l in link1.GetParentLinks()])
+            for ijoint in range(len(robot0.GetJoints())):
+                for ilink in range(len(robot0.GetLinks())):
+                    assert(robot0.DoesAffect(ijoint,ilink) == robot1.DoesAffect(ijoint,ilink))
+            dofvalues = [0.2,0.15]
+            for robot in [robot0,robot1]:
+                robot.SetTransform(eye(4))
+                robot.SetDOFValues(dofvalues,[robot.GetJoint('A').GetDOFIndex(),robot.GetJoint('L').GetDOFIndex()])
+            assert( transdist(robot0.GetLinkTransformations(),robot1.GetLinkTransformations()) <= g_epsilon )
+
+        # the hierarchy read from the opt-in cache has to match the one computed without it
+        tempdir = tempfile.mkdtemp()
+        try:
+            script = """
+from openravepy import *
+env=Environment()
+try:
+    with env:
+        robot=env.ReadRobotURI('testdata/bobcat.robot.xml')
+        env.Add(robot,True)
+        robot.SetDOFValues([0.2,0.15],[robot.GetJoint('A').GetDOFIndex(),robot.GetJoint('L').GetDOFIndex()])
+        hierarchy = [[j.GetName() for j in robot.GetDependencyOrderedJoints()], [[(link.GetName(),joint.GetName()) for link,joint in loop] for loop in robot.GetClosedLoops()], [[l.GetName() for l in link.GetParentLinks()] for link in robot.GetLinks()], [[robot.DoesAffect(ijoint,ilink) for ilink in range(len(robot.GetLinks()))] for ijoint in range(len(robot.GetJoints()))], [[round(float(x),6) for x in T.flatten()] for T in robot.GetLinkTransformations()]]
+        print(repr(hierarchy))
+finally:
+    env.Destroy()
+    RaveDestroy()
+"""
+            def LoadInProcess(environ):
+                process = Popen([sys.executable, '-c', script], stdout=PIPE, env=dict(os.environ, OPENRAVE_HOME=tempdir, **environ))
+                output = process.communicate()[0]
+                assert(process.returncode == 0)
+                return output.strip().splitlines()[-1]
+
+            expected = LoadInProcess({'OPENRAVE_KINBODY_HIERARCHY_CACHE':'0'})
+            assert(not os.path.exists(os.path.join(tempdir,'kinbodyhierarchy')))
+            # writes the disk cache
+            assert(LoadInProcess({'OPENRAVE_KINBODY_HIERARCHY_CACHE':'1'}) == expected)
+            cachefiles = [os.path.join(tempdir,'kinbodyhierarchy',filename) for filename in os.listdir(os.path.join(tempdir,'kinbodyhierarchy')) if filename.endswith('.bin')]
+            assert(len(cachefiles) > 0)
+            # reads the disk cache
+            assert(LoadInProcess({'OPENRAVE_KINBODY_HIERARCHY_CACHE':'1'}) == expected)
+            # truncated and oversized array lengths are ignored
+            for cachefile in cachefiles:
+                with open(cachefile,'rb') as f:
+                    cachedata = f.read()
+                with open(cachefile,'wb') as f:
+                    f.write(cachedata[:len(cachedata)//2] + b'\xff'*8)
+            assert(LoadInProcess({'OPENRAVE_KINBODY_HIERARCHY_CACHE':'1'}) == expected)
+        finally:
+            shutil.rmtree(tempdir)
+
     def test_custombody(self):
         env=self.env
         with env:
@@ -12,6 +12,10 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 from common_test_openrave import *
+from subprocess import Popen, PIPE
+import shutil
+import sys
+import tempfile
 
 class RunPlanning(EnvironmentSetup):
     def __init__(self,collisioncheckername):
@@ -621,6 +625,161 @@ class RunPlanning(EnvironmentSetup):
             assert(success)
             assert(not env.CheckCollision(collisionbody))
 
+    def test_graspertargetdistancefield(self):
+        self.log.info('the target distance field of the grasper only skips collision checks, so the grasps cannot change')
+        tempdir = tempfile.mkdtemp()
+        try:
+            script = """
+from openravepy import *
+from numpy import *
+env=Environment()
+try:
+    env.Load('data/lab1.env.xml')
+    with env:
+        robot=env.GetRobots()[0]
+        target=env.GetKinBody('mug1')
+        gmodel = databases.grasping.GraspingModel(robot=robot,target=target)
+        approachrays = gmodel.computeBoxApproachRays(delta=0.04)
+        results = [[],[]]
+        for approachray in approachrays[::max(1,len(approachrays)//20)]:
+            for iresult, targetdistancefield in enumerate([None, 0.005]):
+                with robot:
+                    robot.SetTransform(eye(4))
+                    robot.SetActiveDOFs(gmodel.manip.GetGripperIndices(),DOFAffine.X|DOFAffine.Y|DOFAffine.Z)
+                    try:
+                        contacts,finalconfig,mindist,volume = gmodel.grasper.Grasp(direction=-approachray[3:6], roll=0, position=approachray[0:3], standoff=0, manipulatordirection=gmodel.manip.GetLocalToolDirection(), target=target, forceclosure=False, execute=False, outputfinal=True, targetdistancefield=targetdistancefield)
+                        results[iresult].append([round(contacts,6).tolist(), round(finalconfig[0],6).tolist(), round(finalconfig[1],6).tolist()])
+                    except planning_error:
+                        results[iresult].append(None)
+        assert(results[0] == results[1])
+        print(repr(results[1]))
+finally:
+    env.Destroy()
+    RaveDestroy()
+"""
+            def GraspInProcess():
+                process = Popen([sys.executable, '-c', script], stdout=PIPE, env=dict(os.environ, OPENRAVE_HOME=tempdir))
+                output = process.communicate()[0]
+                assert(process.returncode == 0)
+                return output.strip().splitlines()[-1]
+
+            # builds and writes the field
+            expected = GraspInProcess()
+            fieldsdir = os.path.join(tempdir,'grasperdistancefields')
+            fieldfiles = [os.path.join(fieldsdir,filename) for filename in os.listdir(fieldsdir) if filename.endswith('.bin')]
+            assert(len(fieldfiles) > 0)
+            assert(not any(filename.endswith('.tmp') for filename in os.listdir(fieldsdir)))
+            # reads the field
+            assert(GraspInProcess() == expected)
+            # truncated files are rebuilt instead of being partially read
+            fieldsizes = [os.path.getsize(fieldfile) for fieldfile in fieldfiles]
+            for fieldfile in fieldfiles:
+                with open(fieldfile,'rb') as f:
+                    fielddata = f.read()
+                with open(fieldfile,'wb') as f:
+                    f.write(fielddata[:len(fielddata)//2])
+            assert(GraspInProcess() == expected)
+            assert([os.path.getsize(fieldfile) for fieldfile in fieldfiles] == fieldsizes)
+        finally:
+            shutil.rmtree(tempdir)
+
+    def test_graspthreadedpool(self):
+        self.log.info('the GraspThreaded workers are kept between calls, can resume from startindex, stop at maxgrasps and are shut down with the module')
+        env = self.env
+        self.LoadEnv('data/lab1.env.xml')
+        def GetNumTasks():
+            return len(os.listdir('/proc/self/task')) if os.path.exists('/proc/self/task') else None
+        with env:
+            robot = env.GetRobots()[0]
+            target = env.GetKinBody('mug1')
+            gmodel = databases.grasping.GraspingModel(robot=robot,target=target)
+            approachrays = gmodel.computeBoxApproachRays(delta=0.04)
+            approachrays = approachrays[::max(1,len(approachrays)//24)]
+            approachrays[:,3:6] = -approachrays[:,3:6]
+            numgrasps = len(approachrays)
+            rolls = array([0.0])
+            standoffs = array([0.0])
+            preshapes = array([robot.GetDOFValues(gmodel.manip.GetGripperIndices())])
+            manipulatordirections = array([gmodel.manip.GetLocalToolDirection()])
+            grasper = interfaces.Grasper(robot)
+            robot.SetActiveManipulator(gmodel.manip)
+            robot.SetTransform(eye(4))
+            robot.SetActiveDOFs(gmodel.manip.GetGripperIndices(),DOFAffine.X|DOFAffine.Y|DOFAffine.Z)
+            def GraspThreaded(**kwargs):
+                nextid, resultgrasps = grasper.GraspThreaded(approachrays=approachrays, rolls=rolls, standoffs=standoffs, preshapes=preshapes, manipulatordirections=manipulatordirections, target=target, forceclosurethreshold=0, **kwargs)
+                # workers claim the candidates concurrently, so the results are identified by their approach ray
+                results = {}
+                for resultgrasp in resultgrasps:
+                    iray = argmin(sum(abs(approachrays-r_[resultgrasp[0],resultgrasp[1]]),1))
+                    assert(iray not in results)
+                    results[iray] = resultgrasp[8]
+                return nextid, results
+            def CheckSameResults(results, expectedresults):
+                assert(sorted(results.keys()) == sorted(expectedresults.keys()))
+                for iray, Tfinal in results.items():
+                    assert(transdist(Tfinal, expectedresults[iray]) <= 1e-6)
+
+            numenvs0 = len(RaveGetEnvironments())
+            nextid, expectedresults = GraspThreaded(numthreads=1)
+            assert(nextid == numgrasps)
+            assert(len(expectedresults) > 3)
+            assert(len(RaveGetEnvironments()) == numenvs0+1)
+
+            # the pool grows to the largest number of threads requested and is reused by the following calls
+            nextid, results = GraspThreaded(numthreads=4)
+            assert(nextid == numgrasps)
+            CheckSameResults(results, expectedresults)
+            assert(len(RaveGetEnvironments()) == numenvs0+4)
+            numtasks = GetNumTasks()
+            for numthreads in [4, 2]:
+                nextid, results = GraspThreaded(numthreads=numthreads)
+                CheckSameResults(results, expectedresults)
+                assert(len(RaveGetEnvironments()) == numenvs0+4)
+                assert(GetNumTasks() == numtasks)
+
+            # resuming from startindex only tests the remaining candidates
+            startindex = numgrasps//2
+            nextid, results = GraspThreaded(numthreads=4, startindex=startindex)
+            assert(nextid == numgrasps)
+            CheckSameResults(results, dict((iray, Tfinal) for iray, Tfinal in expectedresults.items() if iray >= startindex))
+
+            # stops once maxgrasps are found, the candidates before nextid are all tested, so resuming from nextid finds the rest
+            maxgrasps = 2
+            nextid, results = GraspThreaded(numthreads=4, maxgrasps=maxgrasps)
+            assert(len(results) >= maxgrasps)
+            assert(nextid < numgrasps)
+            nextid2, results2 = GraspThreaded(numthreads=4, startindex=nextid)
+            assert(nextid2 == numgrasps)
+            assert(all(iray < nextid for iray in results.keys()))
+            assert(all(iray >= nextid for iray in results2.keys()))
+            results.update(results2)
+            CheckSameResults(results, expectedresults)
+
+            # removing the module stops the workers and destroys their environments
+            env.Remove(grasper.prob)
+        assert(len(RaveGetEnvironments()) == numenvs0)
+        if numtasks is not None:
+            assert(GetNumTasks() <= numtasks-4)
+
+    def test_graspqualities(self):
+        self.log.info('grasps analyzed together share the friction cone cache, so they have to match the ones analyzed alone')
+        env = self.env
+        self.LoadEnv('data/lab1.env.xml')
+        with env:
+            robot = env.GetRobots()[0]
+            grasper = interfaces.Grasper(robot,friction=0.4)
+            # contacts on all the faces of a unit cube pointing inwards
+            boxcontacts = [[0.5,0.1,0,-1,0,0],[-0.5,-0.1,0,1,0,0],[0,0.5,0.1,0,-1,0],[0,-0.5,-0.1,0,1,0],[0.1,0,0.5,0,0,-1],[-0.1,0,-0.5,0,0,1]]
+            graspcontacts = [boxcontacts, boxcontacts[0:2], [], boxcontacts[0:3]+boxcontacts[0:3]*6]
+            for frictionconefacets in [3,4,8]:
+                qualities = grasper.ComputeGraspQualities(graspcontacts,frictionconefacets=frictionconefacets)
+                for contacts, quality in zip(graspcontacts,qualities):
+                    assert(transdist(grasper.ComputeGraspQualities([contacts],frictionconefacets=frictionconefacets)[0],quality) <= g_epsilon)
+                assert(qualities[0][0] > 0)
+            assert(transdist(grasper.ComputeGraspQualities(graspcontacts+graspcontacts[::-1]),r_[grasper.ComputeGraspQualities(graspcontacts),grasper.ComputeGraspQualities(graspcontacts[::-1])]) <= g_epsilon)
+            for frictionconefacets in [-1,0,2]:
+                assert_raises(planning_error,grasper.ComputeGraspQualities,graspcontacts,frictionconefacets=frictionconefacets)
+
 #generate_classes(RunPlanning, globals(), [('ode','ode'),('bullet','bullet')])
 
 class test_ode(RunPlanning):
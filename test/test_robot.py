@@ -231,6 +231,79 @@ class RunRobot(EnvironmentSetup):
                     robot.SetActiveDOFValues(sol)
                     assert(not robot.CheckSelfCollision())
 
+    def test_grabcollision_multiple(self):
+        self.log.info('test self-collisions between grabbed bodies when they are released and regrabbed')
+        env=self.env
+        with env:
+            robot = self.LoadRobot('robots/barrettwam.robot.xml')
+            manip=robot.GetActiveManipulator()
+            armindices = manip.GetArmIndices()
+            q0 = robot.GetDOFValues(armindices)
+            q1 = array(q0)
+            q1[0] += 1.0
+            Toffset = eye(4)
+            Toffset[2,3] = 0.3
+            robot.SetDOFValues(q1,armindices)
+            Tgoal = dot(manip.GetTransform(),Toffset)
+            robot.SetDOFValues(q0,armindices)
+
+            b1=RaveCreateKinBody(env,'')
+            b1.InitFromBoxes(array([[0,0,0,0.05,0.05,0.05]]),True)
+            b1.SetName('grabbed1')
+            env.Add(b1)
+            b1.SetTransform(dot(manip.GetTransform(),Toffset))
+            b2=RaveCreateKinBody(env,'')
+            b2.InitFromBoxes(array([[0,0,0,0.05,0.05,0.05]]),True)
+            b2.SetName('grabbed2')
+            env.Add(b2)
+            b2.SetTransform(Tgoal)
+            assert(not env.CheckCollision(b1,b2))
+            robot.Grab(b1,manip.GetEndEffector())
+            robot.Grab(b2,robot.GetLinks()[0])
+
+            robot.SetDOFValues(q1,armindices)
+            assert(env.CheckCollision(b1,b2))
+            assert(robot.CheckSelfCollision())
+
+            # the pair is colliding when regrabbing, so it is ignored
+            robot.Release(b2)
+            robot.Grab(b2,robot.GetLinks()[0])
+            assert(not robot.CheckSelfCollision())
+            robot.Release(b1)
+            robot.Grab(b1,manip.GetEndEffector())
+            assert(not robot.CheckSelfCollision())
+
+    def test_nevercollidinglinkspairs(self):
+        self.log.info('test pruning self-collision link pairs that never collide')
+        env=self.env
+        with env:
+            robot = self.LoadRobot('robots/barrettwam.robot.xml')
+            nonadjacent = robot.GetNonAdjacentLinks()
+            assert(len(nonadjacent) > 0)
+            basemanip = interfaces.BaseManipulation(robot)
+            linkpairs = basemanip.ComputeNeverCollidingLinksPairs(numsamples=200,numthreads=2,seed=1)
+            assert(len(linkpairs) <= len(nonadjacent))
+            for linkpair in linkpairs:
+                assert(linkpair in nonadjacent)
+            robot.SetNeverCollidingLinksPairs(linkpairs)
+            assert(sorted(robot.GetNeverCollidingLinksPairs()) == sorted(linkpairs))
+            assert(len(robot.GetNonAdjacentLinks()) == len(nonadjacent)-len(linkpairs))
+            for linkindex0,linkindex1 in linkpairs:
+                assert(robot.AreNeverCollidingLinks(linkindex1,linkindex0))
+                assert((linkindex0,linkindex1) not in robot.GetNonAdjacentLinks())
+            # computing again is not affected by the pruned pairs
+            assert(sorted(basemanip.ComputeNeverCollidingLinksPairs(numsamples=200,numthreads=2,seed=1)) == sorted(linkpairs))
+            robot.SetNeverCollidingLinksPairs([])
+            assert(len(robot.GetNonAdjacentLinks()) == len(nonadjacent))
+            # without samples nothing is known about the pairs
+            for numsamples,numthreads in [(0,2),(-1,2),(200,0),(200,-1)]:
+                try:
+                    basemanip.ComputeNeverCollidingLinksPairs(numsamples=numsamples,numthreads=numthreads,seed=1)
+                    raise ValueError('accepted numsamples=%d, numthreads=%d'%(numsamples,numthreads))
+                except openrave_exception as ex:
+                    assert(ex.GetCode()=='InvalidArguments')
+            assert(len(robot.GetNeverCollidingLinksPairs()) == 0)
+
     def test_grabstatesaver(self):
         self.log.info('test grab state saver')
         env=self.env
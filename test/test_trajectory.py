@@ -12,6 +12,9 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 from common_test_openrave import *
+import shutil
+import struct
+import tempfile
 
 class TestTrajectory(EnvironmentSetup):
     def test_merging(self):
@@ -844,6 +847,264 @@ class TestTrajectory(EnvironmentSetup):
             planningutils.VerifyTrajectory(parameters, traj,0.01)
             
 
+    def test_samplepoints(self):
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        with env:
+            manipprob = interfaces.BaseManipulation(robot)
+            robot.SetActiveDOFs(robot.GetActiveManipulator().GetArmIndices())
+            traj=manipprob.MoveManipulator(goal=array([-0.75,1,0,2,-1,-1.5,1]),outputtrajobj=True,execute=False)
+            for times in [arange(0,traj.GetDuration()+0.1,0.001), arange(traj.GetDuration()+0.1,0,-0.013), [0.5,0.1,0.9,0.9,0.0,traj.GetDuration()]]:
+                data = traj.SamplePoints2D(times)
+                for i, t in enumerate(times):
+                    assert(transdist(data[i],traj.Sample(t)) <= g_epsilon)
+            data = traj.SamplePointsSameDeltaTime2D(0.001,True)
+            for i in range(len(data)-1):
+                assert(transdist(data[i],traj.Sample(i*0.001)) <= g_epsilon)
+            assert(transdist(data[-1],traj.GetWaypoint(-1)) <= g_epsilon)
+
+    def test_waypointstream(self):
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        with env:
+            robot.SetActiveDOFs(robot.GetActiveManipulator().GetArmIndices())
+            spec = robot.GetActiveConfigurationSpecification('linear')
+            spec.AddDeltaTimeGroup()
+            dof = spec.GetDOF()
+            waypoints = [r_[robot.GetActiveDOFValues()+0.01*i, [0.004 if i > 0 else 0]] for i in range(10)]
+            stream = planningutils.TrajectoryWaypointStream(spec,4)
+            assert(stream.GetConfigurationSpecification().GetDOF() == dof)
+            for i in range(4):
+                assert(stream.Push(waypoints[i]))
+            assert(not stream.Push(waypoints[4])) # full
+            assert(stream.GetNumPending() == 4)
+            streamtraj = RaveCreateTrajectory(env,'')
+            streamtraj.Init(spec)
+            assert(stream.Flush(streamtraj) == 4)
+            assert(stream.GetNumPending() == 0)
+            # the pending waypoints wrap around the end of the ring buffer
+            for i in range(4,10):
+                if stream.GetNumPending() == 3:
+                    stream.Flush(streamtraj)
+                assert(stream.Push(waypoints[i]))
+                # sample near the growing end
+                streamtraj.Sample(streamtraj.GetDuration())
+            stream.Flush(streamtraj)
+            traj = RaveCreateTrajectory(env,'')
+            traj.Init(spec)
+            traj.Insert(0,concatenate(waypoints))
+            assert(streamtraj.GetNumWaypoints() == traj.GetNumWaypoints())
+            assert(abs(streamtraj.GetDuration()-traj.GetDuration()) <= g_epsilon)
+            times = arange(0,traj.GetDuration(),0.001)
+            assert(transdist(streamtraj.SamplePoints2D(times),traj.SamplePoints2D(times)) <= g_epsilon)
+            for t in times[::-1]:
+                assert(transdist(streamtraj.Sample(t),traj.Sample(t)) <= g_epsilon)
+
+    def test_compression(self):
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        with env:
+            manipprob = interfaces.BaseManipulation(robot)
+            robot.SetActiveDOFs(robot.GetActiveManipulator().GetArmIndices())
+            traj=manipprob.MoveManipulator(goal=array([-0.75,1,0,2,-1,-1.5,1]),outputtrajobj=True,execute=False)
+            times = arange(0,traj.GetDuration(),0.001)
+            origdata = traj.SamplePoints2D(times)
+            origwaypoints = traj.GetWaypoints(0,traj.GetNumWaypoints())
+            quantization = 1e-9
+            compressedtraj = RaveClone(traj,0)
+            assert(compressedtraj.SendCommand('Compress 4 joint_values %.15e joint_velocities %.15e'%(quantization,quantization)) is not None)
+            assert(compressedtraj.GetNumWaypoints() == traj.GetNumWaypoints())
+            assert(abs(compressedtraj.GetDuration()-traj.GetDuration()) <= g_epsilon)
+            assert(transdist(compressedtraj.GetWaypoints(0,compressedtraj.GetNumWaypoints()),origwaypoints) <= 1e-6)
+            assert(transdist(compressedtraj.SamplePoints2D(times),origdata) <= 1e-5)
+            # compressed data has to survive serialization
+            newtraj = RaveCreateTrajectory(env,'')
+            newtraj.deserialize(compressedtraj.serialize(0))
+            assert(transdist(newtraj.SamplePoints2D(times),origdata) <= 1e-5)
+            # modifying the trajectory decompresses it
+            newtraj.Insert(newtraj.GetNumWaypoints(),origwaypoints[-traj.GetConfigurationSpecification().GetDOF():])
+            assert(newtraj.GetNumWaypoints() == traj.GetNumWaypoints()+1)
+
+    def test_compressiontruncated(self):
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        with env:
+            manipprob = interfaces.BaseManipulation(robot)
+            robot.SetActiveDOFs(robot.GetActiveManipulator().GetArmIndices())
+            traj=manipprob.MoveManipulator(goal=array([-0.75,1,0,2,-1,-1.5,1]),outputtrajobj=True,execute=False)
+            times = arange(0,traj.GetDuration(),0.001)
+            dof = traj.GetConfigurationSpecification().GetDOF()
+            numwaypoints = traj.GetNumWaypoints()
+            blocksize = 2
+            assert(numwaypoints > blocksize)
+            assert(traj.SendCommand('Compress %d joint_values 1e-9'%blocksize) is not None)
+            tempdir = tempfile.mkdtemp()
+            try:
+                filename = os.path.join(tempdir,'traj.bin')
+                traj.SaveToFile(filename)
+                with open(filename,'rb') as f:
+                    data = f.read()
+                # layout after the groups: numwaypoints, blocksize, quantization, block offsets, size of the blocks, blocks
+                header = data.find(struct.pack('<III', numwaypoints, blocksize, dof))
+                assert(header > 0)
+                numblocks = (numwaypoints+blocksize-1)//blocksize
+                offsetsstart = header+12+8*dof+4
+                blocksstart = offsetsstart+8*numblocks
+                numblockbytes = struct.unpack('<Q', data[blocksstart:blocksstart+8])[0]
+                blocksend = blocksstart+8+numblockbytes
+                secondoffset = struct.unpack('<Q', data[offsetsstart+8:offsetsstart+16])[0]
+                def Replace(pos, value):
+                    return data[:pos]+value+data[pos+len(value):]
+                baddatas = [data[:header+6], data[:offsetsstart+4], data[:blocksstart+4], data[:blocksend-1], # truncated
+                            Replace(header+4, struct.pack('<I', 0)), # block size
+                            Replace(offsetsstart-4, struct.pack('<I', numblocks+1)), # block count
+                            Replace(offsetsstart, struct.pack('<Q', 1)), # first block not at the start
+                            Replace(offsetsstart+8, struct.pack('<Q', numblockbytes+1)), # block outside of the data
+                            Replace(blocksstart, struct.pack('<Q', 1<<40))] # size of the blocks
+                for baddata in baddatas:
+                    with open(filename,'wb') as f:
+                        f.write(baddata)
+                    newtraj = RaveCreateTrajectory(env,'')
+                    try:
+                        newtraj.LoadFromFile(filename)
+                        assert(False)
+                    except openrave_exception as e:
+                        assert(e.GetCode() == 'InvalidArguments')
+
+                # values that do not end inside their block are only found when the block is decoded
+                with open(filename,'wb') as f:
+                    f.write(Replace(blocksstart+8+8*dof, b'\xff'*(secondoffset-8*dof)))
+                newtraj = RaveCreateTrajectory(env,'')
+                try:
+                    newtraj.LoadFromFile(filename)
+                    newtraj.SamplePoints2D(times)
+                    assert(False)
+                except openrave_exception as e:
+                    assert(e.GetCode() == 'InvalidArguments')
+
+                with open(filename,'wb') as f:
+                    f.write(data)
+                newtraj = RaveCreateTrajectory(env,'')
+                newtraj.LoadFromFile(filename)
+                assert(transdist(newtraj.SamplePoints2D(times),traj.SamplePoints2D(times)) <= g_epsilon)
+            finally:
+                shutil.rmtree(tempdir)
+
+    def test_verifyparallel(self):
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        with env:
+            manipprob = interfaces.BaseManipulation(robot)
+            robot.SetActiveDOFs(robot.GetActiveManipulator().GetArmIndices())
+            traj=manipprob.MoveManipulator(goal=array([-0.75,1,0,2,-1,-1.5,1]),outputtrajobj=True,execute=False)
+            parameters = Planner.PlannerParameters()
+            parameters.SetRobotActiveJoints(robot)
+            planningutils.VerifyTrajectoryParallel(parameters,traj,samplingstep=0.002,numthreads=4)
+            # put several waypoints out of limits, the earliest has to be reported
+            spec = robot.GetActiveConfigurationSpecification()
+            badtraj = RaveClone(traj,0)
+            upperlimit = robot.GetActiveDOFLimits()[1]
+            for index in [badtraj.GetNumWaypoints()-2, badtraj.GetNumWaypoints()//2]:
+                values = badtraj.GetWaypoint(index,spec)
+                values[0] = upperlimit[0]+0.1
+                badtraj.Insert(index,values,spec,True)
+            # parameters made from the specification are rebound differently in the clones, the results have to be the same as the serial ones
+            specparameters = Planner.PlannerParameters()
+            specparameters.SetConfigurationSpecification(env, spec)
+            specparameters.SetConfigVelocityLimit(parameters.GetConfigVelocityLimit())
+            planningutils.VerifyTrajectoryParallel(specparameters,traj,samplingstep=0.002,numthreads=4)
+            # only parameters made from the trajectory specification are verified in parallel, given ones are verified serially
+            planningutils.VerifyTrajectoryParallel(None,traj,samplingstep=0.002,numthreads=4)
+            for params in [parameters, specparameters, None]:
+                messages = []
+                for verify in [lambda: planningutils.VerifyTrajectory(params,badtraj,0.002), lambda: planningutils.VerifyTrajectoryParallel(params,badtraj,0.002,4,True), lambda: planningutils.VerifyTrajectoryParallel(params,badtraj,0.002,4,False)]:
+                    try:
+                        verify()
+                        assert(False)
+                    except openrave_exception as e:
+                        messages.append(str(e))
+                assert(messages[0] == messages[1] and messages[0] == messages[2])
+                assert(messages[0].find('configuration %d '%(badtraj.GetNumWaypoints()//2)) >= 0)
+            # affine dofs cannot be rebuilt from the specification, the results have to be the same as the serial ones
+            robot.SetActiveDOFs(robot.GetActiveManipulator().GetArmIndices(), DOFAffine.X|DOFAffine.Y|DOFAffine.RotationAxis, [0,0,1])
+            initvalues = robot.GetActiveDOFValues()
+            goalvalues = array(initvalues)
+            goalvalues[0] += 0.1
+            goalvalues[-3:] += [0.01,0.01,0.02]
+            affinetraj = RaveCreateTrajectory(env,'')
+            affinetraj.Init(robot.GetActiveConfigurationSpecification('quadratic'))
+            affinetraj.Insert(0,r_[initvalues,goalvalues])
+            ret = planningutils.RetimeActiveDOFTrajectory(affinetraj,robot,False,1,1,'ParabolicTrajectoryRetimer2')
+            assert(ret.statusCode==PlannerStatusCode.HasSolution)
+            affineparameters = Planner.PlannerParameters()
+            affineparameters.SetRobotActiveJoints(robot)
+            planningutils.VerifyTrajectory(affineparameters,affinetraj,0.002)
+            planningutils.VerifyTrajectoryParallel(affineparameters,affinetraj,0.002,4)
+            affinespec = robot.GetActiveConfigurationSpecification()
+            badaffinetraj = RaveClone(affinetraj,0)
+            badindex = badaffinetraj.GetNumWaypoints()-1
+            values = badaffinetraj.GetWaypoint(badindex,affinespec)
+            values[0] = robot.GetActiveDOFLimits()[1][0]+0.1
+            badaffinetraj.Insert(badindex,values,affinespec,True)
+            messages = []
+            for verify in [lambda: planningutils.VerifyTrajectory(affineparameters,badaffinetraj,0.002), lambda: planningutils.VerifyTrajectoryParallel(affineparameters,badaffinetraj,0.002,4,True), lambda: planningutils.VerifyTrajectoryParallel(affineparameters,badaffinetraj,0.002,4,False)]:
+                try:
+                    verify()
+                    assert(False)
+                except openrave_exception as e:
+                    messages.append(str(e))
+            assert(messages[0] == messages[1] and messages[0] == messages[2])
+            assert(messages[0].find('configuration %d '%badindex) >= 0)
+
+    def test_polynomialchecker(self):
+        self.log.info('checking all dofs of a chunk together gives the same results as checking each polynomial')
+        from openravepy import openravepy_piecewisepolynomials as piecewisepolynomials
+        ndof = 4
+        checker = piecewisepolynomials.PolynomialChecker(ndof, self.env.GetId())
+        def CheckAll(polynomials, duration, xmin, xmax, vm, am, jm):
+            chunk = piecewisepolynomials.Chunk(duration, polynomials)
+            boundaries = [[p.Eval(0) for p in polynomials], [p.Eval(duration) for p in polynomials], [p.Evald1(0) for p in polynomials], [p.Evald1(duration) for p in polynomials], [p.Evald2(0) for p in polynomials], [p.Evald2(duration) for p in polynomials]]
+            expected = 0
+            for idof, p in enumerate(polynomials):
+                expected = checker.CheckPolynomial(p, xmin[idof], xmax[idof], vm[idof], am[idof], jm[idof], *[values[idof] for values in boundaries])
+                if expected != 0:
+                    break
+            assert(checker.CheckChunk(chunk, xmin, xmax, vm, am, jm, *boundaries) == expected)
+            assert(checker.CheckChunks([chunk], xmin, xmax, vm, am, jm, *boundaries) == expected)
+            return expected
+
+        # limits slightly above the boundary values, so that the extrema inside the chunks decide the results
+        random.seed(0)
+        results = []
+        for itest in range(400):
+            duration = random.uniform(0.1, 2.0)
+            degree = [3, 5][itest%2]
+            polynomials = [piecewisepolynomials.Polynomial(duration, random.uniform(-1, 1, degree+1).tolist()) for idof in range(ndof)]
+            limits = []
+            for ideriv in range(4):
+                boundaryvalues = array([[p.Evaldn(0, ideriv), p.Evaldn(duration, ideriv)] for p in polynomials])
+                limits.append((boundaryvalues.min(axis=1), boundaryvalues.max(axis=1)))
+            margin = random.uniform(1.0, 1.5)
+            xmin = (limits[0][0] - 0.1*(margin-1)).tolist()
+            xmax = (limits[0][1] + 0.1*(margin-1)).tolist()
+            vm, am, jm = [(abs(array(limits[ideriv])).max(axis=0)*margin + 1e-3).tolist() for ideriv in range(1, 4)]
+            results.append(CheckAll(polynomials, duration, xmin, xmax, vm, am, jm))
+        # both the passing and the failing branches are exercised
+        assert(results.count(0) > 40 and results.count(0) < 360)
+        assert(set(results) - set([0, 1, 2, 3, 4]) == set())
+
+        # critical points exactly at the boundaries are included in the checked range like in CheckPolynomial
+        duration = 1.0
+        polynomials = [piecewisepolynomials.Polynomial(duration, [0, 0, -1.5*duration, 1.0]) for idof in range(ndof)]
+        assert(CheckAll(polynomials, duration, [-1]*ndof, [1]*ndof, [0.75]*ndof, [3]*ndof, [6]*ndof) == 0)
+        assert(CheckAll(polynomials, duration, [-0.4]*ndof, [1]*ndof, [1]*ndof, [4]*ndof, [7]*ndof) == 1)
+        assert(CheckAll(polynomials, duration, [-1]*ndof, [1]*ndof, [0.7]*ndof, [4]*ndof, [7]*ndof) == 2)
+
     def test_segmenttraj2():
         env=self.env
         trajstr = '''<trajectory>